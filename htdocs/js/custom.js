@@ -2,7 +2,7 @@
 
 $(document).ready(function() {
 
-    // Various dynamic style tweaks
+    // Various dynamic style tweaks
     $("tbody tr:even").addClass("alt");
     $("#output li:even").addClass("alt");
     $("#outwrap").resizable({ handles: 's' });
@@ -136,5 +136,37 @@ $(document).ready(function() {
     // TODO: This bombs if there's no "output" element...
     var objDiv = document.getElementById("output");
     objDiv.scrollTop = objDiv.scrollHeight;
-    
+
+    // Follow the server live through /stream instead of polling
+    if (window.EventSource) {
+        var stream = new EventSource("/stream");
+
+        var append = function (cls, text) {
+            var time = new Date().toTimeString().substr(0, 8);
+
+            $("<li>").addClass(cls).text("[CONS] " + time + " " + text).appendTo("#output ul");
+
+            objDiv.scrollTop = objDiv.scrollHeight;
+        };
+
+        stream.addEventListener("log", function (e) {
+            var data = JSON.parse(e.data);
+
+            append(data.priority <= 3 ? "err" : "", data.message);
+        }, false);
+
+        stream.addEventListener("player.chat", function (e) {
+            var data = JSON.parse(e.data);
+
+            append("", "[SAY] " + data.name + ": \"" + data.message + "\"");
+        }, false);
+
+        stream.addEventListener("player.join", function (e) {
+            append("msg", "[MSG] " + JSON.parse(e.data).name + " connected");
+        }, false);
+
+        stream.addEventListener("player.leave", function (e) {
+            append("msg", "[MSG] " + JSON.parse(e.data).name + " disconnected");
+        }, false);
+    }
 });
@@ -70,6 +70,13 @@ void CD_BufferAdd (CDBuffer* self, CDPointer data, size_t length);
 
 void CD_BufferAddBuffer (CDBuffer* self, CDBuffer* data);
 
+/**
+ * Move the content of a Buffer at the end of another without copying it
+ *
+ * @param data The Buffer to move from, it's left empty
+ */
+void CD_BufferMoveBuffer (CDBuffer* self, CDBuffer* data);
+
 CDPointer CD_BufferRemove (CDBuffer* self, size_t length);
 
 CDBuffer* CD_BufferRemoveBuffer (CDBuffer* self);
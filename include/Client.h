@@ -51,6 +51,11 @@ typedef struct _CDClient {
         pthread_rwlock_t status;
     } lock;
 
+    struct {
+        CDLink clients;
+        CDLink disconnecting;
+    } link;
+
     CD_DEFINE_DYNAMIC;
     CD_DEFINE_ERROR;
 } CDClient;
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_COMMANDS_H
+#define CRAFTD_COMMANDS_H
+
+#include <craftd/common.h>
+
+#define CD_COMMAND_NAME_LENGTH 32
+
+struct _CDServer;
+
+/**
+ * A command handler, the sender is whatever the protocol dispatched the command for
+ * (a CDPlayer for the beta protocol).
+ *
+ * @param arguments What follows the command name with the surrounding spaces removed,
+ *                  NULL if there's nothing
+ *
+ * @return false to let the command go on as a plain Player.command event
+ */
+typedef bool (*CDCommandHandler) (struct _CDServer* server, CDPointer sender, CDString* arguments);
+
+/**
+ * Get the permission level of a sender, higher is more powerful
+ */
+typedef int (*CDCommandLevel) (struct _CDServer* server, CDPointer sender);
+
+typedef enum _CDCommandStatus {
+    CDCommandNotFound,
+    CDCommandDenied,
+    CDCommandHandled
+} CDCommandStatus;
+
+/**
+ * A registered command, aliases point to the same object.
+ */
+typedef struct _CDCommand {
+    char* name;
+    int   level;
+
+    CDCommandHandler handler;
+
+    CDList* aliases;
+} CDCommand;
+
+/**
+ * A trie node, children are kept sorted by key so prefix walks are in order.
+ */
+typedef struct _CDCommandNode {
+    char key;
+
+    CDCommand* command;
+
+    size_t                 length;
+    struct _CDCommandNode* children;
+} CDCommandNode;
+
+/**
+ * The Commands class.
+ *
+ * Names are ASCII and case insensitive, they're looked up one character at a time
+ * so a dispatch never depends on how many commands are registered.
+ */
+typedef struct _CDCommands {
+    struct _CDServer* server;
+
+    CDCommandNode  root;
+    CDCommandLevel level;
+
+    pthread_rwlock_t lock;
+} CDCommands;
+
+CDCommands* CD_CreateCommands (struct _CDServer* server);
+
+void CD_DestroyCommands (CDCommands* self);
+
+/**
+ * Set the function used to get the permission level of senders, without one every
+ * sender has level 0.
+ *
+ * @param level The function or NULL to remove it
+ */
+void CD_CommandsSetLevel (CDCommands* self, CDCommandLevel level);
+
+/**
+ * Register a command
+ *
+ * @param name The name, a single word of at most CD_COMMAND_NAME_LENGTH characters
+ * @param level The permission level needed to use the command
+ * @param handler The function to call
+ *
+ * @return The command or NULL if the name is taken
+ */
+CDCommand* CD_RegisterCommand (CDCommands* self, const char* name, int level, CDCommandHandler handler);
+
+/**
+ * Add an alias to a registered command
+ *
+ * @return false if the alias or the command are invalid or the alias is taken
+ */
+bool CD_RegisterCommandAlias (CDCommands* self, const char* name, const char* alias);
+
+/**
+ * Unregister a command and all its aliases
+ *
+ * @param name The name or any alias of the command
+ */
+void CD_UnregisterCommand (CDCommands* self, const char* name);
+
+/**
+ * Check if a name or an alias is registered
+ */
+bool CD_CommandsHas (CDCommands* self, const char* name);
+
+/**
+ * Parse the command word out of a command line and call its handler.
+ *
+ * @param line The command line without the command char (e.g. "ticket list open")
+ *
+ * @return CDCommandNotFound if there's no such command or its handler declined it,
+ *         CDCommandDenied if the sender's level isn't enough, CDCommandHandled otherwise
+ */
+CDCommandStatus CD_CommandsDispatch (CDCommands* self, CDPointer sender, CDString* line);
+
+/**
+ * Get the names and aliases starting with the given prefix the sender can use, in
+ * alphabetical order.
+ *
+ * @param prefix The prefix, an empty one lists everything
+ * @param limit The maximum number of names to return, 0 for no limit
+ *
+ * @return A List of CDString, destroy them and the List when done
+ */
+CDList* CD_CommandsComplete (CDCommands* self, CDPointer sender, const char* prefix, size_t limit);
+
+#endif
@@ -32,13 +32,27 @@
 typedef json_t*      CDRawConfig;
 typedef json_error_t CDRawConfigError;
 
+/**
+ * A parsed config, once returned by CD_ParseConfig it's never modified again, a
+ * reload parses a new one and swaps it in the server, see CD_ServerReload.
+ *
+ * Everything the hot paths need is compiled in the cache, raw lookups in data are
+ * only meant for initialization.
+ */
 typedef struct _CDConfig {
     CDRawConfig      data;
     CDRawConfigError error;
 
+    char*    path;
+    uint64_t generation;
+
     struct {
         bool daemonize;
 
+        const char* logger;
+
+        bool profiling;
+
         struct {
             struct {
                 struct sockaddr_in  ipv4;
@@ -60,9 +74,29 @@ typedef struct _CDConfig {
                 } bind;
 
                 uint16_t port;
+                int      backlog;
             } connection;
 
             const char* root;
+
+            int threads;
+
+            struct {
+                int    connections;
+                size_t requests;
+                size_t body;
+                size_t headers;
+                int    timeout;
+            } limits;
+
+            struct {
+                size_t size;
+                size_t backlog;
+            } stream;
+
+            struct {
+                size_t limit;
+            } cache;
         } httpd;
 
         struct {
@@ -78,6 +112,9 @@ typedef struct _CDConfig {
                 int max;
             } players;
         } game;
+
+        CDHash* plugins;
+        CDHash* engines;
     } cache;
 } CDConfig;
 
@@ -95,6 +132,41 @@ CDConfig* CD_ParseConfig (const char* path);
  */
 void CD_DestroyConfig (CDConfig* self);
 
+/**
+ * Get the config section of a plugin
+ *
+ * @param name The name of the plugin
+ *
+ * @return The raw config of the plugin or NULL
+ */
+static inline
+CDRawConfig
+CD_ConfigPlugin (CDConfig* self, const char* name)
+{
+    return (CDRawConfig) CD_HashGet(self->cache.plugins, name);
+}
+
+/**
+ * Get the config section of a scripting engine
+ *
+ * @param name The name of the scripting engine
+ *
+ * @return The raw config of the scripting engine or NULL
+ */
+static inline
+CDRawConfig
+CD_ConfigScriptingEngine (CDConfig* self, const char* name)
+{
+    return (CDRawConfig) CD_HashGet(self->cache.engines, name);
+}
+
+/**
+ * Check if the settings that can only be applied on startup differ
+ *
+ * @return true if a restart is needed to apply the new config
+ */
+bool CD_ConfigRequiresRestart (CDConfig* self, CDConfig* other);
+
 #define J_DO for (const json_t* __tmp__ = NULL; __tmp__ == NULL; __tmp__++)
 
 #define J_IN(var, parent, key)                          \
@@ -43,7 +43,8 @@ const char* CDConsoleColors[] = {
     "\e[1;36m", // cyan
     "\e[1;31m", // red
     "\e[1;35m", // magenta
-    "\e[1;33m"  // yellow
+    "\e[1;33m", // yellow
+    "\e[0m"     // white
 };
 
 CDString* CD_ConvertStringColorForConsole (CDString* self);
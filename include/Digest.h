@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_DIGEST_H
+#define CRAFTD_DIGEST_H
+
+#include <craftd/common.h>
+
+#define CD_SHA256_LENGTH 32
+
+/**
+ * SHA-256 state, feed it with CD_SHA256Update and get the digest with CD_SHA256Final.
+ */
+typedef struct _CDSHA256 {
+    uint32_t state[8];
+    uint64_t length;
+
+    uint8_t buffer[64];
+    size_t  used;
+} CDSHA256;
+
+void CD_SHA256Init (CDSHA256* self);
+
+void CD_SHA256Update (CDSHA256* self, const void* data, size_t length);
+
+void CD_SHA256Final (CDSHA256* self, uint8_t digest[CD_SHA256_LENGTH]);
+
+/**
+ * Digest a buffer in one go
+ */
+void CD_SHA256 (const void* data, size_t length, uint8_t digest[CD_SHA256_LENGTH]);
+
+/**
+ * Fill a buffer with random bytes from the system, meant for salts and tokens
+ */
+void CD_RandomBytes (void* buffer, size_t length);
+
+/**
+ * Compare two buffers in a time that only depends on their length, use it when
+ * comparing secrets so timing doesn't leak how much of them matched.
+ */
+static inline
+bool
+CD_DigestIsEqual (const void* a, const void* b, size_t length)
+{
+    const volatile uint8_t* x      = a;
+    const volatile uint8_t* y      = b;
+          uint8_t           result = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        result |= x[i] ^ y[i];
+    }
+
+    return result == 0;
+}
+
+#endif
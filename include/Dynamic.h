@@ -26,15 +26,113 @@
 #ifndef CRAFTD_DYNAMIC_H
 #define CRAFTD_DYNAMIC_H
 
-#define CD_DEFINE_DYNAMIC CDHash* _dynamic
+/**
+ * Maximum number of slots that can be reserved
+ */
+#define CD_DYNAMIC_SLOTS 64
+
+/**
+ * A slot ID, reserved once by name and valid for every dynamic object
+ */
+typedef size_t CDDynamicSlot;
+
+/**
+ * What CD_ReserveDynamicSlot returns once every slot is taken
+ */
+#define CD_DYNAMIC_NO_SLOT ((CDDynamicSlot) -1)
+
+/**
+ * The Dynamic class.
+ *
+ * Properties with a reserved slot live in a plain array indexed by the slot
+ * ID, every other property goes in the string keyed Hash.
+ */
+typedef struct _CDDynamic {
+    CDPointer slots[CD_DYNAMIC_SLOTS];
+
+    CDHash* hash;
+} CDDynamic;
+
+#define CD_DEFINE_DYNAMIC CDDynamic* _dynamic
 
 #define DYNAMIC(data) ((data)->_dynamic)
 
-#define CD_CreateDynamic()  CD_CreateHash()
-#define CD_DestroyDynamic(self) CD_DestroyHash(self)
+/**
+ * Create a Dynamic object
+ *
+ * @return The instantiated object
+ */
+CDDynamic* CD_CreateDynamic (void);
+
+/**
+ * Destroy a Dynamic object, the saved data has to be destroyed by the owner
+ */
+void CD_DestroyDynamic (CDDynamic* self);
+
+/**
+ * Reserve a slot for the given property name, reserving an already reserved
+ * name returns the same slot.
+ *
+ * Reserve slots when loading a plugin, the string API keeps working for the
+ * name and uses the slot too.
+ *
+ * @param name The property name
+ *
+ * @return The slot ID, or CD_DYNAMIC_NO_SLOT if there are none left, the property
+ *         then has to go through the string API
+ */
+CDDynamicSlot CD_ReserveDynamicSlot (const char* name);
+
+/**
+ * Get a property by name, the compatibility shim for the slot API
+ */
+CDPointer CD_DynamicPropertyGet (CDDynamic* self, const char* name);
+
+/**
+ * Put a property by name, the compatibility shim for the slot API
+ *
+ * @return The old value
+ */
+CDPointer CD_DynamicPropertyPut (CDDynamic* self, const char* name, CDPointer value);
+
+/**
+ * Delete a property by name, the compatibility shim for the slot API
+ *
+ * @return The old value
+ */
+CDPointer CD_DynamicPropertyDelete (CDDynamic* self, const char* name);
+
+static inline
+CDPointer
+CD_DynamicSlotGet (CDDynamic* self, CDDynamicSlot slot)
+{
+    assert(slot < CD_DYNAMIC_SLOTS);
+
+    return *(volatile CDPointer*) &self->slots[slot];
+}
+
+static inline
+CDPointer
+CD_DynamicSlotPut (CDDynamic* self, CDDynamicSlot slot, CDPointer value)
+{
+    assert(slot < CD_DYNAMIC_SLOTS);
+
+    return __sync_lock_test_and_set(&self->slots[slot], value);
+}
+
+static inline
+CDPointer
+CD_DynamicSlotDelete (CDDynamic* self, CDDynamicSlot slot)
+{
+    return CD_DynamicSlotPut(self, slot, CDNull);
+}
+
+#define CD_DynamicGet(object, property)        CD_DynamicPropertyGet(DYNAMIC(object), property)
+#define CD_DynamicPut(object, property, value) CD_DynamicPropertyPut(DYNAMIC(object), property, (CDPointer) (value))
+#define CD_DynamicDelete(object, property)     CD_DynamicPropertyDelete(DYNAMIC(object), property)
 
-#define CD_DynamicGet(object, property)        CD_HashGet(DYNAMIC(object), property)
-#define CD_DynamicPut(object, property, value) CD_HashPut(DYNAMIC(object), property, (value))
-#define CD_DynamicDelete(object, property)     CD_HashDelete(DYNAMIC(object), property)
+#define CD_DynamicGetSlot(object, slot)        CD_DynamicSlotGet(DYNAMIC(object), slot)
+#define CD_DynamicPutSlot(object, slot, value) CD_DynamicSlotPut(DYNAMIC(object), slot, (CDPointer) (value))
+#define CD_DynamicDeleteSlot(object, slot)     CD_DynamicSlotDelete(DYNAMIC(object), slot)
 
 #endif
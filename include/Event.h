@@ -33,12 +33,70 @@ typedef bool (*CDEventCallbackFunction)();
 typedef struct _CDEventCallback {
     CDEventCallbackFunction function;
     int                     priority;
+
+    char* eventName;
+    char* name;
+    char* module;
+
+    struct {
+        volatile uint64_t calls;
+        volatile uint64_t total;
+        volatile uint64_t max;
+    } profile;
 } CDEventCallback;
 
 CDEventCallback* CD_CreateEventCallback (CDEventCallbackFunction function, int priority);
 
+/**
+ * Create a callback for the given event, the module name is resolved through the dynamic
+ * linker so profiling results can point at the responsible plugin.
+ *
+ * @param name The callback name, if NULL the exported symbol name or the address is used
+ */
+CDEventCallback* CD_CreateEventCallbackFor (const char* eventName, CDEventCallbackFunction function, int priority, const char* name);
+
 void CD_DestroyEventCallback (CDEventCallback* self);
 
+/**
+ * Account a callback invocation that took the given nanoseconds.
+ */
+static inline
+void
+cd_EventProfile (CDEventCallback* self, uint64_t elapsed)
+{
+    uint64_t max;
+
+    __sync_add_and_fetch(&self->profile.calls, 1);
+    __sync_add_and_fetch(&self->profile.total, elapsed);
+
+    while ((max = self->profile.max) < elapsed) {
+        if (__sync_bool_compare_and_swap(&self->profile.max, max, elapsed)) {
+            break;
+        }
+    }
+}
+
+/**
+ * Enable or disable per callback profiling, the dispatch histogram is only fed while it's
+ * enabled. When disabled dispatching only pays for a branch.
+ */
+void CD_EventProfiling (CDServer* self, bool enabled);
+
+/**
+ * Reset the profiling counters of every registered callback.
+ */
+void CD_EventProfileReset (CDServer* self);
+
+/**
+ * Get the profiling results as an array of objects sorted by cumulative time, each object
+ * has event, callback, module, priority, calls, total, max and average (times in nanoseconds).
+ *
+ * @param limit The maximum number of entries, 0 for all of them
+ *
+ * @return A new JSON array reference
+ */
+json_t* CD_EventProfileToJSON (CDServer* self, size_t limit);
+
 bool cd_EventBeforeDispatch (CDServer* self, const char* eventName, ...);
 
 bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrupted, ...);
@@ -49,6 +107,10 @@ bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrup
  * Pay attention to the parameters you pass, those go on the stack and passing float/double
  * could get them borked. Pointers are always safe to pass.
  *
+ * The callbacks run with the event lock read locked, so a callback must not register or
+ * unregister callbacks (for any event), that needs the write lock and deadlocks. Defer
+ * it to a job or a timer instead, dispatching other events is fine.
+ *
  * @param eventName The name of the event to dispatch
  */
 #define CD_EventDispatch(self, eventName, ...)                                                      \
@@ -56,26 +118,44 @@ bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrup
         assert(self);                                                                               \
         assert(eventName);                                                                          \
                                                                                                     \
+        uint64_t __start__ = self->event.profiling ? CD_MetricsNow() : 0;                           \
+                                                                                                    \
         bool __interrupted__ = false;                                                               \
                                                                                                     \
         if (!cd_EventBeforeDispatch(self, eventName, ##__VA_ARGS__)) {                              \
             break;                                                                                  \
         }                                                                                           \
                                                                                                     \
-        CDList* __callbacks__ = (CDList*) CD_HashGet(self->event.callbacks, eventName);             \
+        CDVector* __callbacks__;                                                                    \
+                                                                                                    \
+        pthread_rwlock_rdlock(&self->event.lock);                                                   \
+        __callbacks__ = (CDVector*) CD_HashGet(self->event.callbacks, eventName);                   \
+                                                                                                    \
+        uint64_t __now__ = __start__ ? CD_MetricsNow() : 0;                                         \
                                                                                                     \
-        CD_LIST_FOREACH(__callbacks__, it) {                                                        \
-            if (!CD_ListIteratorValue(it)) {                                                        \
-                continue;                                                                           \
+        CD_VECTOR_FOREACH(__callbacks__, __i__) {                                                   \
+            CDEventCallback* __callback__ = (CDEventCallback*) CD_VectorGet(__callbacks__, __i__);  \
+            bool             __result__   = __callback__->function(self, ##__VA_ARGS__);            \
+                                                                                                    \
+            if (__now__) {                                                                          \
+                uint64_t __called__ = __now__;                                                      \
+                                                                                                    \
+                __now__ = CD_MetricsNow();                                                          \
+                cd_EventProfile(__callback__, __now__ - __called__);                                \
             }                                                                                       \
                                                                                                     \
-            if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, ##__VA_ARGS__)) {    \
-                __interrupted__ = !CD_ListStopIterating(__callbacks__, false);                      \
+            if (!__result__) {                                                                      \
+                __interrupted__ = true;                                                             \
                 break;                                                                              \
             }                                                                                       \
         }                                                                                           \
+        pthread_rwlock_unlock(&self->event.lock);                                                   \
                                                                                                     \
         cd_EventAfterDispatch(self, eventName, __interrupted__, ##__VA_ARGS__);                     \
+                                                                                                    \
+        if (__start__) {                                                                            \
+            CD_MetricObserve(self->metrics.events, CD_MetricsNow() - __start__);                    \
+        }                                                                                           \
     }
 
 #define CD_EventDispatchWithResult(interrupted, self, eventName, ...)                               \
@@ -83,26 +163,44 @@ bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrup
         assert(self);                                                                               \
         assert(eventName);                                                                          \
                                                                                                     \
+        uint64_t __start__ = self->event.profiling ? CD_MetricsNow() : 0;                           \
+                                                                                                    \
         interrupted = false;                                                                        \
                                                                                                     \
         if (!cd_EventBeforeDispatch(self, eventName, ##__VA_ARGS__)) {                              \
             break;                                                                                  \
         }                                                                                           \
                                                                                                     \
-        CDList* __callbacks__ = (CDList*) CD_HashGet(self->event.callbacks, eventName);             \
+        CDVector* __callbacks__;                                                                    \
+                                                                                                    \
+        pthread_rwlock_rdlock(&self->event.lock);                                                   \
+        __callbacks__ = (CDVector*) CD_HashGet(self->event.callbacks, eventName);                   \
+                                                                                                    \
+        uint64_t __now__ = __start__ ? CD_MetricsNow() : 0;                                         \
+                                                                                                    \
+        CD_VECTOR_FOREACH(__callbacks__, __i__) {                                                   \
+            CDEventCallback* __callback__ = (CDEventCallback*) CD_VectorGet(__callbacks__, __i__);  \
+            bool             __result__   = __callback__->function(self, ##__VA_ARGS__);            \
+                                                                                                    \
+            if (__now__) {                                                                          \
+                uint64_t __called__ = __now__;                                                      \
                                                                                                     \
-        CD_LIST_FOREACH(__callbacks__, it) {                                                        \
-            if (!CD_ListIteratorValue(it)) {                                                        \
-                continue;                                                                           \
+                __now__ = CD_MetricsNow();                                                          \
+                cd_EventProfile(__callback__, __now__ - __called__);                                \
             }                                                                                       \
                                                                                                     \
-            if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, ##__VA_ARGS__)) {    \
-                interrupted = !CD_ListStopIterating(__callbacks__, false);                          \
+            if (!__result__) {                                                                      \
+                interrupted = true;                                                                 \
                 break;                                                                              \
             }                                                                                       \
         }                                                                                           \
+        pthread_rwlock_unlock(&self->event.lock);                                                   \
                                                                                                     \
         cd_EventAfterDispatch(self, eventName, interrupted, ##__VA_ARGS__);                         \
+                                                                                                    \
+        if (__start__) {                                                                            \
+            CD_MetricObserve(self->metrics.events, CD_MetricsNow() - __start__);                    \
+        }                                                                                           \
     }
 
 #define CD_EventDispatchWithError(error, self, eventName, ...)                                              \
@@ -110,6 +208,8 @@ bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrup
         assert(self);                                                                                       \
         assert(eventName);                                                                                  \
                                                                                                             \
+        uint64_t __start__ = self->event.profiling ? CD_MetricsNow() : 0;                                   \
+                                                                                                            \
         bool __interrupted__ = false;                                                                       \
              error           = CDOk;                                                                        \
                                                                                                             \
@@ -117,31 +217,49 @@ bool cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrup
             break;                                                                                          \
         }                                                                                                   \
                                                                                                             \
-        CDList* __callbacks__ = (CDList*) CD_HashGet(self->event.callbacks, eventName);                     \
+        CDVector* __callbacks__;                                                                            \
+                                                                                                            \
+        pthread_rwlock_rdlock(&self->event.lock);                                                           \
+        __callbacks__ = (CDVector*) CD_HashGet(self->event.callbacks, eventName);                           \
+                                                                                                            \
+        uint64_t __now__ = __start__ ? CD_MetricsNow() : 0;                                                 \
+                                                                                                            \
+        CD_VECTOR_FOREACH(__callbacks__, __i__) {                                                           \
+            CDEventCallback* __callback__ = (CDEventCallback*) CD_VectorGet(__callbacks__, __i__);          \
+            bool             __result__   = __callback__->function(self, ##__VA_ARGS__, &error);            \
                                                                                                             \
-        CD_LIST_FOREACH(__callbacks__, it) {                                                                \
-            if (!CD_ListIteratorValue(it)) {                                                                \
-                continue;                                                                                   \
+            if (__now__) {                                                                                  \
+                uint64_t __called__ = __now__;                                                              \
+                                                                                                            \
+                __now__ = CD_MetricsNow();                                                                  \
+                cd_EventProfile(__callback__, __now__ - __called__);                                        \
             }                                                                                               \
                                                                                                             \
-            if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, ##__VA_ARGS__, &error)) {    \
-                __interrupted__ = !CD_ListStopIterating(__callbacks__, false);                              \
+            if (!__result__) {                                                                              \
+                __interrupted__ = true;                                                                     \
                 break;                                                                                      \
             }                                                                                               \
         }                                                                                                   \
+        pthread_rwlock_unlock(&self->event.lock);                                                           \
                                                                                                             \
         cd_EventAfterDispatch(self, eventName, __interrupted__, ##__VA_ARGS__, &error);                     \
+                                                                                                            \
+        if (__start__) {                                                                                    \
+            CD_MetricObserve(self->metrics.events, CD_MetricsNow() - __start__);                            \
+        }                                                                                                   \
     }
 
 
+void cd_EventRegister (CDServer* server, const char* eventName, int priority, CDEventCallbackFunction callback, const char* name);
+
 /**
- * Register a callback for an event.
+ * Register a callback for an event, not from inside an event callback (see CD_EventDispatch).
  *
  * @param eventName The name of the event
  * @param callback The callback to be added
  */
-void CD_EventRegister (CDServer* server, const char* eventName, CDEventCallbackFunction callback);
-
+#define CD_EventRegister(server, eventName, callback) \
+    cd_EventRegister(server, eventName, 0, (CDEventCallbackFunction) callback, #callback)
 
 /**
  * Register a callback with the given priority.
@@ -152,11 +270,14 @@ void CD_EventRegister (CDServer* server, const char* eventName, CDEventCallbackF
  * @param priority The callback priority
  * @param callback THe callback to be added
  */
-void CD_EventRegisterWithPriority (CDServer* server, const char* eventName, int priority, CDEventCallbackFunction callback);
+#define CD_EventRegisterWithPriority(server, eventName, priority, callback) \
+    cd_EventRegister(server, eventName, priority, (CDEventCallbackFunction) callback, #callback)
 
 /**
  * Unregister the event with the passed name, unregisters only the passed callback or every callback if NULL.
  *
+ * Like registering it can't be done from inside an event callback (see CD_EventDispatch).
+ *
  * @param callback The callback to unregister or NULL to unregister every callback
  *
  * @return The unregistered callbacks
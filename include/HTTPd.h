@@ -27,6 +27,10 @@
 #define CRAFTD_HTTPD_H
 
 #include <craftd/common.h>
+#include <craftd/Snapshot.h>
+
+#include <craftd/HTTPdCache.h>
+#include <craftd/HTTPdStream.h>
 
 #include <event2/http.h>
 
@@ -43,6 +47,10 @@ static const CDContentType CDContentTypes[] = {
   { "html", "text/html" },
   { "htm",  "text/html" },
   { "css",  "text/css" },
+  { "json", "application/json" },
+  { "xml",  "application/xml" },
+  { "svg",  "image/svg+xml" },
+  { "ico",  "image/x-icon" },
   { "gif",  "image/gif" },
   { "jpg",  "image/jpeg"},
   { "jpeg", "image/jpeg" },
@@ -53,9 +61,40 @@ static const CDContentType CDContentTypes[] = {
 };
 
 struct _CDServer;
+struct _CDHTTPd;
 
-typedef struct _CDHTTPd {
-    struct _CDServer* server;
+/**
+ * A keep-alive connection seen by a HTTPd thread, pending holds the RPC requests
+ * still being handled by the workers so they can be dropped if the client goes away.
+ */
+typedef struct _CDHTTPdConnection {
+    struct evhttp_connection* raw;
+
+    size_t  requests;
+    CDList* pending;
+
+    CDHTTPdSubscriber* subscriber;
+} CDHTTPdConnection;
+
+#define CD_HTTPD_ROUTES 5
+
+struct _CDHTTPdThread;
+
+typedef void (*CDHTTPdHandler) (struct evhttp_request* request, struct _CDHTTPdThread* thread);
+
+/**
+ * A request handler bound to the thread it runs on
+ */
+typedef struct _CDHTTPdRoute {
+    struct _CDHTTPdThread* thread;
+    CDHTTPdHandler         handler;
+} CDHTTPdRoute;
+
+typedef struct _CDHTTPdThread {
+    struct _CDHTTPd* parent;
+
+    CDHTTPdRoute     routes[CD_HTTPD_ROUTES];
+    CDSnapshotReader reader; /* the handlers read the server config */
 
     struct {
         struct event_base*          base;
@@ -63,12 +102,60 @@ typedef struct _CDHTTPd {
         struct evhttp_bound_socket* handle;
     } event;
 
-    pthread_t      thread;
+    CDMap* connections;
+
+    struct {
+        CDList*       subscribers;
+        struct event* wakeup;
+    } stream;
+
+    pthread_t thread;
+} CDHTTPdThread;
+
+typedef struct _CDHTTPd {
+    struct _CDServer* server;
+
+    CDHTTPdCache*  cache;
+    CDHTTPdStream* stream;
+    struct event*  ticker;
+
+    size_t          length;
+    CDHTTPdThread** item;
+
+    volatile int connections;
+
     pthread_attr_t attributes;
 } CDHTTPd;
 
+/**
+ * Create the HTTPd with the configured number of threads, each thread has its own
+ * event base and listening socket (bound with SO_REUSEPORT where available).
+ */
 CDHTTPd* CD_CreateHTTPd (struct _CDServer* server);
 
-void* CD_RunHTTPd (CDHTTPd* self);
+void CD_DestroyHTTPd (CDHTTPd* self);
+
+/**
+ * Bind the listening sockets and start the HTTPd threads.
+ */
+bool CD_StartHTTPd (CDHTTPd* self);
+
+/**
+ * Check if anyone is listening on /stream, so publishers can avoid building events nobody reads.
+ */
+static inline
+bool
+CD_HTTPdIsStreaming (CDHTTPd* self)
+{
+    return self && self->stream->subscribers > 0;
+}
+
+/**
+ * Publish an event to the /stream subscribers of every HTTPd thread.
+ *
+ * @param event The event name
+ * @param data The event data, the reference is stolen
+ */
+void CD_HTTPdPublish (CDHTTPd* self, const char* event, json_t* data);
 
 #endif
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_HTTPDCACHE_H
+#define CRAFTD_HTTPDCACHE_H
+
+#include <craftd/common.h>
+
+/* files smaller than this are not worth a gzip variant */
+#define CD_HTTPD_CACHE_GZIP_MINIMUM 256
+
+typedef enum _CDHTTPdFileState {
+    CDHTTPdFileLoading,
+    CDHTTPdFileLoaded,
+    CDHTTPdFileMissing
+} CDHTTPdFileState;
+
+/**
+ * A cached file from the HTTPd root.
+ *
+ * Files up to the cache limit have their content (and a gzip variant for compressible
+ * types) in memory, bigger ones only have their metadata cached and are sent with
+ * sendfile. Entries are reference counted so an invalidation never frees content
+ * that is still being written to a client.
+ *
+ * An entry is put in the cache while it's still loading, the file is read and compressed
+ * outside of the cache lock and other requests for it wait on the cache for the outcome.
+ */
+typedef struct _CDHTTPdFile {
+    CDHTTPdFileState state;
+
+    char*       path;
+    const char* type;
+
+    off_t  size;
+    time_t modified;
+
+    char etag[48];
+    char lastModified[32];
+
+    struct {
+        uint8_t* data;
+        size_t   length;
+    } content;
+
+    struct {
+        uint8_t* data;
+        size_t   length;
+    } gzip;
+
+    volatile int references;
+} CDHTTPdFile;
+
+typedef struct _CDHTTPdCache {
+    char*  root;
+    size_t limit;
+
+    CDHash*         files;
+    pthread_mutex_t lock;
+    pthread_cond_t  loaded;
+
+    struct {
+        int           fd;
+        struct event* event;
+        CDMap*        directories;
+    } notify;
+} CDHTTPdCache;
+
+/**
+ * Create a cache for the files under the given root, if inotify is available the cache
+ * watches the directories it caches files from, otherwise entries are revalidated with
+ * a stat on every lookup.
+ *
+ * @param base The event base the inotify watcher runs on
+ * @param root The document root
+ * @param limit The maximum size of a file to keep in memory
+ *
+ * @return The instantiated object
+ */
+CDHTTPdCache* CD_CreateHTTPdCache (struct event_base* base, const char* root, size_t limit);
+
+void CD_DestroyHTTPdCache (CDHTTPdCache* self);
+
+/**
+ * Get the file for the given request path, a directory resolves to its index.html.
+ *
+ * The returned file is referenced and has to be released with CD_HTTPdFileRelease.
+ *
+ * @return The cached file or NULL if it doesn't exist or isn't readable
+ */
+CDHTTPdFile* CD_HTTPdCacheGet (CDHTTPdCache* self, const char* path);
+
+/**
+ * Drop every entry backed by the given file system path (or anything under it),
+ * or every entry if path is NULL.
+ */
+void CD_HTTPdCacheInvalidate (CDHTTPdCache* self, const char* path);
+
+void CD_HTTPdFileRelease (CDHTTPdFile* self);
+
+/**
+ * Check if the request conditions (If-None-Match, If-Modified-Since) match the file.
+ */
+bool CD_HTTPdFileIsFresh (CDHTTPdFile* self, const char* ifNoneMatch, const char* ifModifiedSince);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_HTTPDSTREAM_H
+#define CRAFTD_HTTPDSTREAM_H
+
+#include <craftd/common.h>
+
+#include <jansson.h>
+
+/**
+ * An encoded server-sent event, shared by every subscriber that sends it.
+ */
+typedef struct _CDHTTPdFrame {
+    uint64_t     id;
+    volatile int references;
+
+    size_t length;
+    char   data[];
+} CDHTTPdFrame;
+
+typedef struct _CDHTTPdSubscriber {
+    struct evhttp_request* request;
+
+    uint64_t cursor;
+} CDHTTPdSubscriber;
+
+/**
+ * A bounded broadcast ring of server-sent events.
+ *
+ * Publishing encodes the event once, subscribers only keep a cursor in the ring and
+ * a subscriber the ring laps (or with too much unsent data) is dropped instead of
+ * slowing down the publishers.
+ */
+typedef struct _CDHTTPdStream {
+    size_t size;
+    size_t backlog;
+
+    pthread_mutex_t lock;
+    CDHTTPdFrame**  frames;
+    uint64_t        next;
+
+    volatile int subscribers;
+} CDHTTPdStream;
+
+/**
+ * Create a stream
+ *
+ * @param size The number of events kept in the ring
+ * @param backlog The bytes a subscriber can have unsent before it's dropped
+ *
+ * @return The instantiated object
+ */
+CDHTTPdStream* CD_CreateHTTPdStream (size_t size, size_t backlog);
+
+void CD_DestroyHTTPdStream (CDHTTPdStream* self);
+
+/**
+ * Encode and publish an event.
+ *
+ * @param event The event name
+ * @param data The event data, the reference is stolen
+ *
+ * @return The event id
+ */
+uint64_t CD_HTTPdStreamPublish (CDHTTPdStream* self, const char* event, json_t* data);
+
+/**
+ * Get the cursor for a new subscriber, resuming after the given event id if the ring still has it.
+ *
+ * @param last The Last-Event-ID sent by the client or NULL
+ */
+uint64_t CD_HTTPdStreamCursor (CDHTTPdStream* self, const char* last);
+
+/**
+ * Add the events after the cursor to the buffer, by reference, and advance the cursor.
+ *
+ * @return false if the ring lapped the cursor
+ */
+bool CD_HTTPdStreamRead (CDHTTPdStream* self, uint64_t* cursor, struct evbuffer* buffer);
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_LINKEDLIST_H
+#define CRAFTD_LINKEDLIST_H
+
+#include <stddef.h>
+
+#include <craftd/common.h>
+
+/**
+ * A link to embed in the struct that goes in a LinkedList, a struct needs one link
+ * for every list it can be in at the same time.
+ */
+typedef struct _CDLink {
+    struct _CDLink* next;
+    struct _CDLink* prev;
+} CDLink;
+
+/**
+ * The LinkedList class.
+ *
+ * An intrusive circular doubly linked list, adding and removing never allocate and
+ * removing an element is O(1). It doesn't lock anything, so whoever shares one has
+ * to guard it explicitly.
+ */
+typedef struct _CDLinkedList {
+    CDLink head;
+    size_t length;
+} CDLinkedList;
+
+/**
+ * Get the struct a link is embedded in
+ *
+ * @param link The link
+ * @param type The type of the struct
+ * @param member The name of the link in the struct
+ */
+#define CD_LINK_OWNER(link, type, member) \
+    ((type*) ((char*) (link) - offsetof(type, member)))
+
+static inline
+void
+CD_InitializeLinkedList (CDLinkedList* self)
+{
+    self->head.next = &self->head;
+    self->head.prev = &self->head;
+    self->length    = 0;
+}
+
+static inline
+void
+CD_InitializeLink (CDLink* link)
+{
+    link->next = NULL;
+    link->prev = NULL;
+}
+
+/**
+ * Check if a link is in a list, the link must have been initialized
+ */
+static inline
+bool
+CD_LinkIsLinked (CDLink* link)
+{
+    return link->next != NULL;
+}
+
+static inline
+size_t
+CD_LinkedListLength (CDLinkedList* self)
+{
+    return self->length;
+}
+
+static inline
+bool
+CD_LinkedListIsEmpty (CDLinkedList* self)
+{
+    return self->head.next == &self->head;
+}
+
+/**
+ * Append a link that isn't in any list
+ */
+static inline
+void
+CD_LinkedListPush (CDLinkedList* self, CDLink* link)
+{
+    link->prev = self->head.prev;
+    link->next = &self->head;
+
+    self->head.prev->next = link;
+    self->head.prev       = link;
+
+    self->length++;
+}
+
+/**
+ * Remove a link from the list it's in
+ */
+static inline
+void
+CD_LinkedListDelete (CDLinkedList* self, CDLink* link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+
+    CD_InitializeLink(link);
+
+    self->length--;
+}
+
+/**
+ * Remove the first link from the list
+ *
+ * @return The link or NULL if the list is empty
+ */
+static inline
+CDLink*
+CD_LinkedListShift (CDLinkedList* self)
+{
+    CDLink* link = self->head.next;
+
+    if (link == &self->head) {
+        return NULL;
+    }
+
+    CD_LinkedListDelete(self, link);
+
+    return link;
+}
+
+/**
+ * Move every link from a list to the end of another one
+ */
+static inline
+void
+CD_LinkedListSplice (CDLinkedList* self, CDLinkedList* from)
+{
+    if (CD_LinkedListIsEmpty(from)) {
+        return;
+    }
+
+    from->head.next->prev = self->head.prev;
+    from->head.prev->next = &self->head;
+
+    self->head.prev->next = from->head.next;
+    self->head.prev       = from->head.prev;
+
+    self->length += from->length;
+
+    CD_InitializeLinkedList(from);
+}
+
+/**
+ * Iterate over the given LinkedList, the current link can be removed while iterating
+ *
+ * @parameter it The name of the link variable
+ */
+#define CD_LINKED_LIST_FOREACH(self, it)                                         \
+    for (CDLink* it = (self)->head.next, *__next__ = it->next;                   \
+         it != &(self)->head;                                                    \
+         it = __next__, __next__ = it->next)
+
+#endif
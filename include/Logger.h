@@ -30,8 +30,35 @@
 
 #include "common.h"
 
+/**
+ * Priorities above this level are compiled out, their arguments are never
+ * evaluated (e.g. -DCRAFTD_LOG_LEVEL=LOG_INFO drops every debug message)
+ */
+#ifndef CRAFTD_LOG_LEVEL
+#define CRAFTD_LOG_LEVEL LOG_DEBUG
+#endif
+
+typedef enum _CDLogSubsystem {
+    CDLogCore,
+    CDLogNetwork,
+    CDLogWorkers,
+    CDLogHTTPd,
+    CDLogPlugins,
+
+    CDLogSubsystems
+} CDLogSubsystem;
+
+/**
+ * The subsystem SLOG and friends log as, define it before including any
+ * header to change it for a whole file
+ */
+#ifndef CRAFTD_LOG_SUBSYSTEM
+#define CRAFTD_LOG_SUBSYSTEM CDLogCore
+#endif
+
 typedef struct _CDLogger {
     void (*log)        (int, const char*, ...);
+    void (*vlog)       (int, const char*, va_list);
     int  (*setlogmask) (int);
     void (*closelog)   (void);
 } CDLogger;
@@ -39,13 +66,57 @@ typedef struct _CDLogger {
 #ifndef CRAFTD_LOGGER_IGNORE_EXTERN
 extern CDLogger CDConsoleLogger;
 extern CDLogger CDSystemLogger;
+extern CDLogger CDAsyncLogger;
 extern CDLogger CDDefaultLogger;
+
+extern int CDLogLevel[CDLogSubsystems];
 #endif
 
-#define LOG(priority, format, ...) \
-    ((CDMainServer != NULL) \
-        ? CDMainServer->logger.log(priority, "%s> " format, CD_ServerToString(CDMainServer), ##__VA_ARGS__) \
-        : CDDefaultLogger.log(priority, format, ##__VA_ARGS__))
+/**
+ * Get the number of lines the asynchronous logger dropped because its ring was full
+ */
+uint64_t CD_AsyncLoggerDropped (void);
+
+/**
+ * Set the runtime level of a subsystem, messages with a higher priority value
+ * are skipped before their arguments are evaluated
+ *
+ * @param subsystem The subsystem, CDLogSubsystems sets every one of them
+ */
+void CD_LogSetLevel (CDLogSubsystem subsystem, int level);
+
+/**
+ * Set the level of every subsystem and remember it as the one they go back to
+ * when the config doesn't set theirs
+ *
+ * @param forced Ignore the levels from the config altogether, e.g. with -d
+ */
+void CD_LogSetBaseLevel (int level, bool forced);
+
+/**
+ * Apply the levels from a parsed config, subsystems with a negative level go
+ * back to the base level
+ */
+void CD_LogResetLevels (const int levels[CDLogSubsystems]);
+
+/**
+ * Get a syslog priority from its name ("debug", "info", "crit"...)
+ *
+ * @return The priority or -1 if the name is unknown
+ */
+int CD_LogLevelFromName (const char* name);
+
+#define CD_LogIsEnabled(subsystem, priority) \
+    ((priority) <= CRAFTD_LOG_LEVEL && (priority) <= CDLogLevel[subsystem])
+
+#define LOG_IN(subsystem, priority, format, ...) \
+    (!CD_LogIsEnabled(subsystem, priority) \
+        ? (void) 0 \
+        : (CDMainServer != NULL) \
+            ? CDMainServer->logger.log(priority, "%s> " format, CD_ServerToString(CDMainServer), ##__VA_ARGS__) \
+            : CDDefaultLogger.log(priority, format, ##__VA_ARGS__))
+
+#define LOG(priority, format, ...) LOG_IN(CRAFTD_LOG_SUBSYSTEM, priority, format, ##__VA_ARGS__)
 
 #define DEBUG(format, ...) LOG(LOG_DEBUG, format, ##__VA_ARGS__)
 
@@ -56,14 +127,21 @@ extern CDLogger CDDefaultLogger;
     CDDefaultLogger.closelog(); \
 } while (0)
 
-#define CLOG(priority, format, ...) CDConsoleLogger.log(priority, format, ##__VA_ARGS__)
+#define CLOG(priority, format, ...) \
+    (!CD_LogIsEnabled(CRAFTD_LOG_SUBSYSTEM, priority) ? (void) 0 : CDConsoleLogger.log(priority, format, ##__VA_ARGS__))
 
 #define CDEBUG(format, ...) CLOG(LOG_DEBUG, format, ##__VA_ARGS__)
 
 #define CERR(format, ...) CLOG(LOG_CRIT, format, ##__VA_ARGS__)
 
-#define SLOG(server, priority, format, ...) \
-    server->logger.log(priority, "%s> " format, CD_ServerToString(server), ##__VA_ARGS__)
+#define SLOG_IN(server, subsystem, priority, format, ...) \
+    (!CD_LogIsEnabled(subsystem, priority) \
+        ? (void) 0 \
+        : (server)->logger.log(priority, "%s> " format, CD_ServerToString(server), ##__VA_ARGS__))
+
+#define SLOG(server, priority, format, ...) SLOG_IN(server, CRAFTD_LOG_SUBSYSTEM, priority, format, ##__VA_ARGS__)
+
+#define SDEBUG_IN(server, subsystem, format, ...) SLOG_IN(server, subsystem, LOG_DEBUG, format, ##__VA_ARGS__)
 
 #define SDEBUG(server, format, ...) SLOG(server, LOG_DEBUG, format, ##__VA_ARGS__)
 
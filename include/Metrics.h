@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_METRICS_H
+#define CRAFTD_METRICS_H
+
+#include <time.h>
+
+#include <craftd/common.h>
+#include <craftd/Buffer.h>
+
+#define CD_METRIC_SHARDS 16
+
+/* histograms go from 1.024µs to ~17s with 4 buckets per power of two */
+#define CD_METRIC_OCTAVES   24
+#define CD_METRIC_PRECISION 2
+#define CD_METRIC_BUCKETS   ((CD_METRIC_OCTAVES << CD_METRIC_PRECISION) + 2)
+
+typedef enum _CDMetricType {
+    CDMetricCounter,
+    CDMetricGauge,
+    CDMetricHistogram
+} CDMetricType;
+
+typedef struct _CDMetricShard {
+    volatile int64_t value;
+    volatile int64_t count;
+    volatile int64_t buckets[];
+} CDMetricShard;
+
+/**
+ * A counter, gauge or latency histogram.
+ *
+ * Counters and histograms are split in cache line aligned shards, each thread
+ * updates its own shard with atomic operations so updates never take a lock.
+ */
+typedef struct _CDMetric {
+    CDMetricType type;
+
+    char* name;
+    char* labels;
+    char* help;
+
+    size_t   stride;
+    uint8_t* shards;
+} CDMetric;
+
+/**
+ * Create a metric and add it to the exported ones.
+ *
+ * @param name The metric name, metrics sharing a name must have different labels
+ * @param labels Already formatted labels (e.g. "event=\"Player.login\"") or NULL
+ * @param help The description of the metric
+ *
+ * @return The instantiated object
+ */
+CDMetric* CD_CreateMetric (CDMetricType type, const char* name, const char* labels, const char* help);
+
+/**
+ * Remove a metric from the exported ones and destroy it
+ */
+void CD_DestroyMetric (CDMetric* self);
+
+/**
+ * Add to a counter or a gauge, NULL metrics are ignored
+ */
+void CD_MetricAdd (CDMetric* self, int64_t value);
+
+/**
+ * Set the value of a gauge, NULL metrics are ignored
+ */
+void CD_MetricSet (CDMetric* self, int64_t value);
+
+/**
+ * Record a duration in a histogram, NULL metrics are ignored
+ *
+ * @param nanoseconds The duration, usually the difference of two CD_MetricsNow
+ */
+void CD_MetricObserve (CDMetric* self, uint64_t nanoseconds);
+
+/**
+ * Get the value of a counter or gauge, or the number of observations of a histogram
+ */
+int64_t CD_MetricValue (CDMetric* self);
+
+/**
+ * Get an upper bound of the given quantile of a histogram
+ *
+ * @param quantile Between 0 and 1
+ *
+ * @return The quantile in nanoseconds
+ */
+uint64_t CD_MetricQuantile (CDMetric* self, double quantile);
+
+/**
+ * Write every metric in the Prometheus text format
+ */
+void CD_MetricsToBuffer (CDBuffer* buffer);
+
+/**
+ * Get a monotonic timestamp in nanoseconds
+ */
+static inline
+uint64_t
+CD_MetricsNow (void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+#endif
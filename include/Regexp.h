@@ -43,14 +43,33 @@ typedef enum _CDRegexpOption {
 
 #include <craftd/String.h>
 
+/* CD_RegexpExec refuses patterns with more groups than this, CD_RegexpMatch takes any */
+#define CD_REGEXP_CAPTURES 15
+
 typedef struct _CDRegexp {
     char* string;
     int   options;
+    int   captures;
+    bool  cached;
 
     pcre*       pattern;
     pcre_extra* study;
+
+    /* the cached regexp with the same pattern and other options */
+    struct _CDRegexp* next;
 } CDRegexp;
 
+/**
+ * Captures of a CD_RegexpExec, they're offsets into the subject so it has to
+ * outlive them, meant to be put on the stack.
+ */
+typedef struct _CDRegexpCaptures {
+    const char* subject;
+    int         length;
+
+    int offsets[3 * (CD_REGEXP_CAPTURES + 1)];
+} CDRegexpCaptures;
+
 typedef struct _CDRegexpMatches {
     size_t matched;
 
@@ -60,6 +79,24 @@ typedef struct _CDRegexpMatches {
 
 CDRegexp* CD_CreateRegexp (char* regexp, int options);
 
+/**
+ * Get a compiled regexp from the process wide cache, compiling it the first time.
+ *
+ * The result is shared between threads and must not be destroyed, CD_DestroyRegexp
+ * ignores cached regexps.
+ *
+ * @param regexp The pattern, it's copied
+ * @param options CDRegexpOption flags
+ *
+ * @return The compiled regexp or NULL if the pattern is invalid
+ */
+CDRegexp* CD_GetRegexp (const char* regexp, int options);
+
+/**
+ * Destroy every cached regexp, only call it when no thread can use them anymore
+ */
+void CD_ClearRegexpCache (void);
+
 void CD_DestroyRegexp (CDRegexp* self);
 
 void CD_DestroyRegexpKeepString (CDRegexp* self);
@@ -74,6 +111,61 @@ CDRegexpMatches* CD_RegexpMatchString (char* regexp, int options, CDString* stri
 
 CDRegexpMatches* CD_RegexpMatchCString (char* regexp, int options, char* string);
 
+/**
+ * Check if the string matches, nothing is captured so any number of groups is fine
+ */
 bool CD_RegexpTest (CDRegexp* self, CDString* string);
 
+/**
+ * Match a subject without copying anything, captures are read with the
+ * CD_RegexpCapture functions.
+ *
+ * The captures only have room for CD_REGEXP_CAPTURES groups, a pattern with more
+ * is logged and never matches, use CD_RegexpMatch for those.
+ *
+ * @param subject The subject, it has to stay around as long as the captures are used
+ * @param length The length of the subject
+ * @param captures Where to put the captures
+ *
+ * @return true if the subject matched
+ */
+bool CD_RegexpExec (CDRegexp* self, const char* subject, size_t length, CDRegexpCaptures* captures);
+
+/**
+ * Check if a group took part in the match
+ */
+static inline
+bool
+CD_RegexpCaptureIsSet (const CDRegexpCaptures* self, int index)
+{
+    return index >= 0 && index < self->length && self->offsets[2 * index] >= 0;
+}
+
+static inline
+const char*
+CD_RegexpCaptureStart (const CDRegexpCaptures* self, int index)
+{
+    return CD_RegexpCaptureIsSet(self, index) ? self->subject + self->offsets[2 * index] : NULL;
+}
+
+static inline
+size_t
+CD_RegexpCaptureLength (const CDRegexpCaptures* self, int index)
+{
+    return CD_RegexpCaptureIsSet(self, index) ? (size_t) (self->offsets[2 * index + 1] - self->offsets[2 * index]) : 0;
+}
+
+/**
+ * Compare a capture with a C string
+ */
+static inline
+bool
+CD_RegexpCaptureIsEqual (const CDRegexpCaptures* self, int index, const char* string)
+{
+    size_t length = strlen(string);
+
+    return CD_RegexpCaptureIsSet(self, index) && CD_RegexpCaptureLength(self, index) == length &&
+        strncmp(CD_RegexpCaptureStart(self, index), string, length) == 0;
+}
+
 #endif
@@ -28,11 +28,15 @@
 
 #include <craftd/Config.h>
 #include <craftd/Logger.h>
+#include <craftd/Metrics.h>
+#include <craftd/Snapshot.h>
 #include <craftd/HTTPd.h>
 #include <craftd/TimeLoop.h>
+#include <craftd/Ticker.h>
 #include <craftd/Workers.h>
 #include <craftd/Plugins.h>
 #include <craftd/ScriptingEngines.h>
+#include <craftd/Commands.h>
 #include <craftd/Client.h>
 
 /**
@@ -49,14 +53,22 @@ typedef struct _CDServer {
     CDHTTPd* httpd;
 
     CDTimeLoop*         timeloop;
+    CDTicker*           ticker;
     CDWorkers*          workers;
+    CDCommands*         commands;
     CDConfig*           config;
     CDPlugins*          plugins;
     CDScriptingEngines* scriptingEngines;
     CDLogger            logger;
 
-    CDList* clients;
-    CDList* disconnecting;
+    /* only changed from the main loop, other threads read it holding lock.clients */
+    CDLinkedList clients;
+    CDLinkedList disconnecting;
+
+    struct {
+        pthread_rwlock_t clients;
+        pthread_mutex_t  disconnecting;
+    } lock;
 
     bool running;
 
@@ -66,9 +78,30 @@ typedef struct _CDServer {
         struct event_base* base;
         struct event*      listener;
 
-        CDHash* callbacks;
+        CDHash*          callbacks;
+        pthread_rwlock_t lock;
+        bool             profiling;
     } event;
 
+    struct {
+        struct event* reload;
+        struct event* reclaim;
+
+        CDList*           retired;
+        volatile uint64_t epoch;
+
+        /* threads outside the worker pool, see CD_ServerAddReader */
+        CDLinkedList    readers;
+        pthread_mutex_t lock;
+    } snapshot;
+
+    struct {
+        CDMetric* accepted;
+        CDMetric* clients;
+        CDMetric* reads;
+        CDMetric* events;
+    } metrics;
+
     evutil_socket_t socket;
 
     CD_DEFINE_DYNAMIC;
@@ -107,6 +140,36 @@ bool CD_StopServer (CDServer* self);
 
 void CD_ServerFlush (CDServer* self, bool now);
 
+/**
+ * Reload the config file, the new config is swapped in atomically and every loaded
+ * plugin and scripting engine gets pointed at its new section, after that the
+ * Config.reload event is fired with the new and the old config.
+ *
+ * Settings that are only read on startup (ports, workers, logger...) need a restart.
+ *
+ * It has to be called from the main loop, use CD_ServerScheduleReload elsewhere.
+ *
+ * @return true if the config has been reloaded, false if it couldn't be parsed
+ */
+bool CD_ServerReload (CDServer* self);
+
+/**
+ * Schedule a config reload in the main loop, it's safe to call from any thread
+ */
+void CD_ServerScheduleReload (CDServer* self);
+
+/**
+ * Retire a snapshot that has been swapped out, the destructor is called once no
+ * worker or registered reader can still be reading it.
+ *
+ * Threads outside the worker pool have to register a CDSnapshotReader and enter it
+ * around the code that reads snapshots.
+ *
+ * @param data The snapshot
+ * @param destroy The function to call to free the snapshot
+ */
+void CD_ServerRetire (CDServer* self, CDPointer data, void (*destroy)(CDPointer));
+
 void CD_ServerCleanDisconnects (CDServer* self);
 
 void CD_ReadFromClient (CDClient* client);
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_SNAPSHOT_H
+#define CRAFTD_SNAPSHOT_H
+
+#include <craftd/common.h>
+
+struct _CDServer;
+
+/**
+ * A thread outside the worker pool that reads config snapshots, retired snapshots
+ * aren't freed while a registered reader that entered before the retirement is
+ * still inside.
+ */
+typedef struct _CDSnapshotReader {
+    CDLink link;
+
+    volatile uint64_t epoch; /* 0 when not reading */
+} CDSnapshotReader;
+
+/**
+ * Register a reader, it starts outside
+ */
+void CD_ServerAddReader (struct _CDServer* server, CDSnapshotReader* reader);
+
+void CD_ServerRemoveReader (struct _CDServer* server, CDSnapshotReader* reader);
+
+/**
+ * Mark the reader as reading, snapshots retired from now on are kept until it leaves
+ */
+void CD_ServerEnterSnapshot (struct _CDServer* server, CDSnapshotReader* reader);
+
+void CD_ServerLeaveSnapshot (CDSnapshotReader* reader);
+
+#endif
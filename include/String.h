@@ -33,15 +33,145 @@
 
 typedef bstring CDRawString;
 
+/**
+ * Bytes stored inside the String object itself, strings up to
+ * CD_STRING_INLINE_SIZE - 1 bytes don't need a separate allocation.
+ */
+#define CD_STRING_INLINE_SIZE 24
+
+/**
+ * Default size of the chunks an arena grows with.
+ */
+#define CD_STRING_ARENA_CHUNK_SIZE 4096
+
+typedef struct _CDStringArenaChunk {
+    struct _CDStringArenaChunk* next;
+
+    size_t size;
+    char   data[];
+} CDStringArenaChunk;
+
+/**
+ * The StringArena class.
+ *
+ * Strings created in an arena are bump allocated and released all at once
+ * by CD_StringArenaReset, CD_DestroyString on them is a no-op.
+ *
+ * An arena is NOT thread safe, use one per thread or per request.
+ */
+typedef struct _CDStringArena {
+    struct {
+        char*  data;
+        size_t size;
+        size_t used;
+    } current;
+
+    struct {
+        char*  data;
+        size_t size;
+        bool   allocated;
+    } initial;
+
+    CDStringArenaChunk* chunks;
+} CDStringArena;
+
 /**
  * The String class.
+ *
+ * raw always points to header, whose data is either the inline buffer, a
+ * heap block, an arena block or a borrowed external buffer.
+ *
+ * length is the cached UTF-8 length, it's kept up to date by every function
+ * that changes the content.
  */
 typedef struct _CDString {
-    CDRawString raw;
-    size_t      length;
-    bool        external;
+    CDRawString    raw;
+    size_t         length;
+    bool           external;
+    CDStringArena* arena;
+
+    struct tagbstring header;
+    char              buffer[CD_STRING_INLINE_SIZE];
 } CDString;
 
+/**
+ * A cursor over the chars of a String, moving to the next char doesn't
+ * rescan from the start like CD_CharAt does.
+ */
+typedef struct _CDStringIterator {
+    CDString* parent;
+    size_t    position;
+    size_t    index;
+} CDStringIterator;
+
+/**
+ * Create a heap allocated StringArena
+ *
+ * @param size The size of the first chunk, 0 for the default
+ *
+ * @return The instantiated object
+ */
+CDStringArena* CD_CreateStringArena (size_t size);
+
+/**
+ * Destroy a StringArena created with CD_CreateStringArena and every String in it
+ */
+void CD_DestroyStringArena (CDStringArena* self);
+
+/**
+ * Initialize a StringArena on a caller provided buffer, usually on the stack
+ *
+ * @param buffer The memory to use before falling back to the heap
+ * @param size The size of the buffer
+ */
+void CD_InitializeStringArena (CDStringArena* self, void* buffer, size_t size);
+
+/**
+ * Release the heap chunks of an initialized StringArena
+ */
+void CD_FinalizeStringArena (CDStringArena* self);
+
+/**
+ * Forget every String in the arena and keep the first chunk for reuse
+ */
+void CD_StringArenaReset (CDStringArena* self);
+
+/**
+ * Create an empty String object in the given arena
+ *
+ * @return The instantiated object
+ */
+CDString* CD_CreateStringInArena (CDStringArena* arena);
+
+/**
+ * Create a String object in the given arena copying a length given buffer
+ *
+ * @param buffer The buffer with the data
+ * @param length The length of the data
+ *
+ * @return The instantiated object
+ */
+CDString* CD_CreateStringFromBufferInArena (CDStringArena* arena, const char* buffer, size_t length);
+
+/**
+ * Create a String object in the given arena from a printf-like format string
+ *
+ * @param format The format to use
+ *
+ * @return The instantiated object
+ */
+CDString* CD_CreateStringFromFormatInArena (CDStringArena* arena, const char* format, ...);
+
+/**
+ * Create a String object in the given arena from a printf-like format string and a passed va_list
+ *
+ * @param format The format to use
+ * @param ap A va_started va_list
+ *
+ * @return The instantiated object
+ */
+CDString* CD_CreateStringFromFormatListInArena (CDStringArena* arena, const char* format, va_list ap);
+
 /**
  * Create an empty String object
  *
@@ -151,7 +281,16 @@ CDString* CD_AppendString (CDString* self, CDString* append);
 CDString* CD_AppendCString (CDString* self, const char* append);
 
 /**
- * Get the char at the given index
+ * Append a length given buffer, the cached length is updated counting only the appended data
+ *
+ * @param buffer The data to append
+ * @param size The size of the data in bytes
+ */
+CDString* CD_AppendBuffer (CDString* self, const char* buffer, size_t size);
+
+/**
+ * Get the char at the given index, the result fits in the inline storage
+ * and the lookup doesn't scan when the String is plain ASCII
  *
  * @param index The position of the char you want to get
  *
@@ -218,6 +357,77 @@ size_t CD_UTF8_strnlen (const char* data, size_t limit);
 
 size_t CD_UTF8_offset (const char* data, size_t offset);
 
+/**
+ * Get the byte offset of the given char looking at most at limit bytes
+ *
+ * @return The offset, or limit if the data has less chars
+ */
+size_t CD_UTF8_noffset (const char* data, size_t offset, size_t limit);
+
+/**
+ * Check if the data is well formed UTF-8 (no overlongs, surrogates or chars past U+10FFFF)
+ *
+ * @param size The size of the data in bytes
+ *
+ * @return true if valid, false otherwise
+ */
+bool CD_UTF8_valid (const char* data, size_t size);
+
+/**
+ * Get an iterator to the first char
+ */
+CDStringIterator CD_StringBegin (CDString* self);
+
+/**
+ * Get an iterator past the last char
+ */
+CDStringIterator CD_StringEnd (CDString* self);
+
+/**
+ * Get an iterator to the given char, scanning once
+ *
+ * @param index The index of the char, clamped to the length
+ */
+CDStringIterator CD_StringAt (CDString* self, size_t index);
+
+/**
+ * Move the iterator to the next char
+ */
+CDStringIterator CD_StringNext (CDStringIterator it);
+
+bool CD_StringIteratorIsEqual (CDStringIterator a, CDStringIterator b);
+
+/**
+ * Get the pointer to the char the iterator is on, it's NOT null terminated
+ * after the char, use CD_StringIteratorSize
+ */
+const char* CD_StringIteratorValue (CDStringIterator it);
+
+/**
+ * Get the size in bytes of the char the iterator is on
+ */
+size_t CD_StringIteratorSize (CDStringIterator it);
+
+/**
+ * Get the index of the char the iterator is on
+ */
+size_t CD_StringIteratorIndex (CDStringIterator it);
+
+/**
+ * Check if the char the iterator is on is the given one
+ *
+ * @param check A C string with a single char
+ */
+bool CD_StringIteratorIs (CDStringIterator it, const char* check);
+
+/**
+ * Iterate over the chars of a String
+ */
+#define CD_STRING_FOREACH(self, it)                                                 \
+    for (CDStringIterator it = CD_StringBegin(self), __end__ = CD_StringEnd(self); \
+        !CD_StringIteratorIsEqual(it, __end__);                                    \
+        it = CD_StringNext(it))
+
 CDString* CD_StringDirname (CDString* self);
 
 CDString* CD_StringBasename (CDString* self);
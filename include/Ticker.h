@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_TICKER_H
+#define CRAFTD_TICKER_H
+
+#include <craftd/common.h>
+#include <craftd/Metrics.h>
+#include <craftd/Snapshot.h>
+
+struct _CDServer;
+
+/**
+ * Game ticks per second
+ */
+#define CD_TICKER_RATE 20
+
+/**
+ * Nanoseconds between two ticks
+ */
+#define CD_TICKER_PERIOD (1000000000 / CD_TICKER_RATE)
+
+/**
+ * The phases of a tick, run in this order on the ticker thread.
+ */
+typedef enum _CDTickPhase {
+    CDTickInput,     /* drain what the clients sent since the last tick */
+    CDTickWorld,     /* advance the worlds */
+    CDTickEntities,  /* broadcast entity and world changes */
+    CDTickFlush,     /* flush the outgoing buffers */
+
+    CDTickPhases
+} CDTickPhase;
+
+typedef void (*CDTickFunction) (struct _CDServer* server, uint64_t tick, CDPointer data);
+
+typedef struct _CDTickHandler {
+    CDTickFunction function;
+    CDPointer      data;
+} CDTickHandler;
+
+/**
+ * The Ticker class.
+ *
+ * Runs the registered phase handlers CD_TICKER_RATE times per second on its
+ * own thread. Deadlines are computed from the start time so the rate doesn't
+ * drift, a tick that starts a whole period late skips the missed deadlines
+ * instead of replaying them, and a tick running longer than the period is
+ * accounted as an overrun.
+ */
+typedef struct _CDTicker {
+    struct _CDServer* server;
+
+    pthread_t thread;
+    bool      started;
+
+    volatile bool running;
+
+    uint64_t tick;     /* ticks run so far */
+    uint64_t deadline; /* when the next tick is due, in CD_MetricsNow time */
+
+    CDVector* phases[CDTickPhases];
+
+    struct {
+        pthread_rwlock_t phases;
+    } lock;
+
+    CDSnapshotReader reader;
+
+    struct {
+        CDMetric* ticks;
+        CDMetric* skipped;
+        CDMetric* overruns;
+        CDMetric* lateness;
+        CDMetric* duration;
+        CDMetric* phases[CDTickPhases];
+    } metrics;
+} CDTicker;
+
+/**
+ * Create a Ticker for the given server, it doesn't start ticking until CD_RunTicker.
+ *
+ * @param server The Server passed to the handlers
+ *
+ * @return The instantiated Ticker object
+ */
+CDTicker* CD_CreateTicker (struct _CDServer* server);
+
+/**
+ * Destroy a Ticker object, stopping it if it's running
+ */
+void CD_DestroyTicker (CDTicker* self);
+
+/**
+ * Start ticking on a new thread
+ *
+ * @return true if the thread has been started
+ */
+bool CD_RunTicker (CDTicker* self);
+
+/**
+ * Stop ticking and wait for the current tick to finish, it must not be called from a handler
+ */
+bool CD_StopTicker (CDTicker* self);
+
+/**
+ * Register a handler for the given phase, handlers of a phase run in registration order.
+ *
+ * Handlers can't register or unregister other handlers while running.
+ *
+ * @param phase The phase to run the handler in
+ * @param function The function to call, with the server, the tick number and the data
+ * @param data The data passed to the function
+ */
+void CD_TickerRegister (CDTicker* self, CDTickPhase phase, CDTickFunction function, CDPointer data);
+
+/**
+ * Unregister a handler registered with the same function and data
+ *
+ * @return true if the handler was registered
+ */
+bool CD_TickerUnregister (CDTicker* self, CDTickPhase phase, CDTickFunction function, CDPointer data);
+
+/**
+ * Run the tick due at the given time, if any.
+ *
+ * The ticker thread calls it on its own, it's exposed to drive the ticker by hand.
+ *
+ * @param now The current time as returned by CD_MetricsNow
+ *
+ * @return true if a tick has been run, false if the next one isn't due yet
+ */
+bool CD_TickerStep (CDTicker* self, uint64_t now);
+
+/**
+ * Get the name of a phase as used in the metrics labels
+ */
+const char* CD_TickPhaseToString (CDTickPhase phase);
+
+#endif
@@ -27,12 +27,75 @@
 #define CRAFTD_TIMELOOP_H
 
 #include <craftd/common.h>
-#include <craftd/Map.h>
+#include <craftd/Snapshot.h>
 
 struct _CDServer;
 
+/**
+ * Milliseconds per tick of the timing wheel
+ */
+#define CD_TIMELOOP_RESOLUTION 10
+
+/**
+ * The wheel has a first level of 2^8 ticks and 4 more levels of 2^6 slots,
+ * each slot of a level spanning a whole turn of the previous one.
+ */
+#define CD_TIMELOOP_ROOT_BITS  8
+#define CD_TIMELOOP_LEVEL_BITS 6
+#define CD_TIMELOOP_LEVELS     4
+
+#define CD_TIMELOOP_ROOT_SIZE  (1 << CD_TIMELOOP_ROOT_BITS)
+#define CD_TIMELOOP_LEVEL_SIZE (1 << CD_TIMELOOP_LEVEL_BITS)
+
+/**
+ * Timers are allocated in pages that never move
+ */
+#define CD_TIMELOOP_PAGE_BITS 10
+#define CD_TIMELOOP_PAGE_SIZE (1 << CD_TIMELOOP_PAGE_BITS)
+
+/**
+ * Maximum number of expired timers handed to a worker in a single job
+ */
+#define CD_TIMELOOP_BATCH 64
+
+/**
+ * A timer ID, the low 32 bits are the timer index and the high 32 bits its
+ * generation, so a cleared ID never refers to a timer reusing the index.
+ *
+ * 0 is never a valid ID.
+ */
+typedef uint64_t CDTimerId;
+
+typedef enum _CDTimerState {
+    CDTimerFree,
+    CDTimerPending,
+    CDTimerFired
+} CDTimerState;
+
+typedef struct _CDTimer {
+    CDLink        link;
+    CDLinkedList* list; /* the wheel slot it's pending in */
+
+    uint32_t     index;
+    uint32_t     generation;
+    CDTimerState state;
+
+    uint64_t expires;
+    uint64_t interval;
+
+    event_callback_fn callback;
+    CDPointer         data;
+
+    uint32_t next; /* next free timer */
+} CDTimer;
+
 /**
  * The TimeLoop class.
+ *
+ * Timers live in a hashed hierarchical timing wheel advanced by a single
+ * libevent timer, insert and clear are O(1). Expired timers are handed to
+ * the worker pool in batches, intervals are rescheduled after their callback
+ * returns so they never overlap.
  */
 typedef struct _CDTimeLoop {
     struct _CDServer* server;
@@ -42,16 +105,34 @@ typedef struct _CDTimeLoop {
 
     bool running;
 
-    int    last;
-    CDMap* callbacks;
+    struct {
+        uint64_t start;
+        uint64_t current; /* next tick to process */
+
+        CDLinkedList root[CD_TIMELOOP_ROOT_SIZE];
+        CDLinkedList levels[CD_TIMELOOP_LEVELS][CD_TIMELOOP_LEVEL_SIZE];
+    } wheel;
+
+    struct {
+        CDTimer** pages;
+        size_t    length;
+
+        uint32_t free;
+        size_t   active;
+    } timers;
 
     struct {
         struct event_base* base;
+        struct event*      tick;
     } event;
 
+    CDLinkedList queued; /* batches handed to the workers and not run yet */
+
     struct {
-        pthread_spinlock_t last;
+        pthread_mutex_t wheel;
     } lock;
+
+    CDSnapshotReader reader; /* callbacks run inline when there are no workers */
 } CDTimeLoop;
 
 /**
@@ -69,12 +150,37 @@ CDTimeLoop* CD_CreateTimeLoop (struct _CDServer* server);
 void CD_DestroyTimeLoop (CDTimeLoop* self);
 
 /**
- * Start the TimeLoop operations.
+ * Run the TimeLoop in the current thread until it's stopped.
  */
 bool CD_RunTimeLoop (CDTimeLoop* self);
 
+/**
+ * Run the TimeLoop in its own thread.
+ */
+bool CD_StartTimeLoop (CDTimeLoop* self);
+
+/**
+ * Stop the TimeLoop and wait for its thread to exit, once it returns no more
+ * batches are handed to the workers.
+ */
 bool CD_StopTimeLoop (CDTimeLoop* self);
 
+/**
+ * Get the current tick of the TimeLoop clock
+ */
+uint64_t CD_TimeLoopNow (CDTimeLoop* self);
+
+/**
+ * Expire every timer due up to the given tick and dispatch their callbacks.
+ *
+ * The TimeLoop calls it on its own, it's exposed to drive the wheel by hand.
+ *
+ * @param now The tick to process up to, included
+ *
+ * @return The number of expired timers
+ */
+size_t CD_TimeLoopExpire (CDTimeLoop* self, uint64_t now);
+
 /**
  * Create an event that will run after the given seconds and delete itself after that
  *
@@ -83,14 +189,14 @@ bool CD_StopTimeLoop (CDTimeLoop* self);
  *
  * @return An ID referring to the timeout with which you can stop it
  */
-int CD_SetTimeout (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data);
+CDTimerId CD_SetTimeout (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data);
 
 /**
  * Stop the timeout from happening
  *
  * @param id The timeout ID as returned by CD_SetTimeout
  */
-void CD_ClearTimeout (CDTimeLoop* self, int id);
+void CD_ClearTimeout (CDTimeLoop* self, CDTimerId id);
 
 /**
  * Create an event that will run after the given seconds and keep repeating
@@ -100,13 +206,13 @@ void CD_ClearTimeout (CDTimeLoop* self, int id);
  *
  * @return An ID referring to the interval with which you can stop it
  */
-int CD_SetInterval (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data);
+CDTimerId CD_SetInterval (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data);
 
 /**
  * Stop the interval from happening
  *
  * @param id The timeout ID as returned by CD_SetInterval
  */
-void CD_ClearInterval (CDTimeLoop* self, int id);
+void CD_ClearInterval (CDTimeLoop* self, CDTimerId id);
 
 #endif
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_VECTOR_H
+#define CRAFTD_VECTOR_H
+
+#include <craftd/common.h>
+
+typedef int8_t (*CDVectorCompareCallback) (CDPointer a, CDPointer b);
+
+/**
+ * The Vector class.
+ *
+ * A growable array of values owned by a single thread, it doesn't lock anything so
+ * whoever shares one has to guard it explicitly.
+ */
+typedef struct _CDVector {
+    size_t     length;
+    size_t     size;
+    CDPointer* item;
+} CDVector;
+
+/**
+ * Create a Vector object
+ *
+ * @return The instantiated object
+ */
+CDVector* CD_CreateVector (void);
+
+/**
+ * Create a Vector object with room for the given number of values
+ *
+ * @param hint The number of values to reserve
+ *
+ * @return The instantiated object
+ */
+CDVector* CD_CreateVectorWith (size_t hint);
+
+/**
+ * Destroy a Vector object, the values aren't touched
+ */
+void CD_DestroyVector (CDVector* self);
+
+/**
+ * Push a value at the end of the Vector
+ *
+ * @return self
+ */
+CDVector* CD_VectorPush (CDVector* self, CDPointer data);
+
+/**
+ * Insert a value in an already sorted Vector, before the values that compare equal
+ *
+ * @param callback a strcmp like callback function
+ *
+ * @return self
+ */
+CDVector* CD_VectorSortedPush (CDVector* self, CDPointer data, CDVectorCompareCallback callback);
+
+/**
+ * Get the index of the first value equal to the passed one
+ *
+ * @return The index or -1 if it's not there
+ */
+ssize_t CD_VectorIndexOf (CDVector* self, CDPointer data);
+
+/**
+ * Delete the value at the given index, the following values are moved back
+ *
+ * @return The removed value
+ */
+CDPointer CD_VectorDeleteAt (CDVector* self, size_t index);
+
+/**
+ * Delete the first value equal to the passed one, the order is kept
+ *
+ * @return The removed value or CDNull
+ */
+CDPointer CD_VectorDelete (CDVector* self, CDPointer data);
+
+/**
+ * Delete the first value equal to the passed one by moving the last value in its
+ * place, the order isn't kept
+ *
+ * @return The removed value or CDNull
+ */
+CDPointer CD_VectorFastDelete (CDVector* self, CDPointer data);
+
+/**
+ * Empty the Vector keeping its memory
+ */
+void CD_VectorClear (CDVector* self);
+
+static inline
+size_t
+CD_VectorLength (CDVector* self)
+{
+    return self->length;
+}
+
+static inline
+CDPointer
+CD_VectorGet (CDVector* self, size_t index)
+{
+    assert(index < self->length);
+
+    return self->item[index];
+}
+
+static inline
+bool
+CD_VectorContains (CDVector* self, CDPointer data)
+{
+    return CD_VectorIndexOf(self, data) >= 0;
+}
+
+/**
+ * Iterate over the given Vector, NULL Vectors are skipped
+ *
+ * The Vector can't be changed while iterating, except for CD_VectorDeleteAt(self, it)
+ * when followed by a continue with it decremented.
+ *
+ * @parameter it The name of the index variable
+ */
+#define CD_VECTOR_FOREACH(self, it) \
+    for (size_t it = 0; (self) && it < (self)->length; it++)
+
+#endif
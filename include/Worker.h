@@ -42,6 +42,8 @@ typedef struct _CDWorker {
 
     CDJob* job;
     bool   working;
+
+    volatile uint64_t epoch;
 } CDWorker;
 
 /**
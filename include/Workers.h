@@ -27,6 +27,7 @@
 #define CRAFTD_WORKERS_H
 
 #include <craftd/common.h>
+#include <craftd/Metrics.h>
 #include <craftd/Worker.h>
 
 #define CD_THREAD_STACK 8388608
@@ -49,6 +50,12 @@ typedef struct _CDWorkers {
         pthread_cond_t  condition;
         pthread_mutex_t mutex;
     } lock;
+
+    struct {
+        CDMetric* jobs;
+        CDMetric* queued;
+        CDMetric* latency;
+    } metrics;
 } CDWorkers;
 
 CDWorkers* CD_CreateWorkers (struct _CDServer* server);
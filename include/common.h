@@ -76,6 +76,8 @@
 #include <craftd/Error.h>
 #include <craftd/Arithmetic.h>
 #include <craftd/List.h>
+#include <craftd/LinkedList.h>
+#include <craftd/Vector.h>
 #include <craftd/Map.h>
 #include <craftd/Hash.h>
 #include <craftd/Set.h>
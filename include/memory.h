@@ -99,6 +99,27 @@ CD_alloc (size_t size)
     return pointer;
 }
 
+/**
+ * Aligned malloc wrapper w/error handling, the result can be freed with CD_free
+ *
+ * @param alignment alignment in bytes, a power of two multiple of sizeof(void*)
+ * @param size allocation size
+ *
+ * @return valid pointer to heap memory aligned as requested
+ */
+static inline
+void*
+CD_memalign (size_t alignment, size_t size)
+{
+    void* pointer = NULL;
+
+    if (posix_memalign(&pointer, alignment, size) != 0) {
+        CD_abort("could not allocate memory with a posix_memalign");
+    }
+
+    return pointer;
+}
+
 /**
  * Simple realloc wrapper w/error handling.  Mimics glibc's implementation
  *
@@ -28,7 +28,7 @@
 
 #include <craftd/common.h>
 
-void CD_abort (const char* error, ...);
+void CD_abort (const char* error, ...) __attribute__((noreturn));
 
 int CD_mkdir (const char* path, mode_t mode);
 
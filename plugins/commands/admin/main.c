@@ -23,62 +23,270 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define CRAFTD_LOG_SUBSYSTEM CDLogPlugins
+
 #include <craftd/Server.h>
 #include <craftd/Plugin.h>
+#include <craftd/Digest.h>
 
 #include <beta/Player.h>
+#include <beta/World.h>
 
-static struct {
+typedef enum _CDAuthLevel {
+    CDLevelUser,
+    CDLevelRegisteredUser,
+    CDLevelModerator,
+    CDLevelAdmin
+} CDAuthLevel;
+
+#define CD_ADMIN_SALT_LENGTH 16
+
+/**
+ * An authorization from the config, the password is only kept salted and hashed.
+ */
+typedef struct _CDACredential {
+    char* name;
+    char* level;
+
+    uint8_t salt[CD_ADMIN_SALT_LENGTH];
+    uint8_t digest[CD_SHA256_LENGTH];
+} CDACredential;
+
+/**
+ * Compiled plugin config, it's swapped as a whole when the config is reloaded so
+ * get the pointer once and use that.
+ */
+typedef struct _CDAConfig {
     struct {
         int max;
     } ticket;
-} _config;
 
-typedef struct _CDATicket {
-    CDPlayer* requester;
-    CDPlayer* assignee;
+    struct {
+        int attempts;
+        int window;
+    } throttle;
 
-    enum {
-        CDTicketOpen,
-        CDTicketAssigned
-    } status;
+    CDHash*       authorizations;
+    CDACredential dummy;
+} CDAConfig;
 
-    CDString* content;
-} CDATicket;
+static CDAConfig* _config;
+
+/**
+ * Failed /auth attempts per address, counted in fixed windows, the previous window
+ * is weighted by how much of it still overlaps the sliding window.
+ */
+typedef struct _CDAThrottle {
+    time_t window;
+    int    current;
+    int    previous;
+} CDAThrottle;
+
+static struct {
+    CDHash*         addresses;
+    size_t          sweep;
+    pthread_mutex_t lock;
+} _throttle;
 
-CDATicket*
-cdadmin_CreateTicket (CDPlayer* requester, CDString* content)
+/* Slot of the Authorization.level player property, CD_DYNAMIC_NO_SLOT if it goes by name */
+static CDDynamicSlot _level;
+
+#include "tickets.c"
+
+static
+void
+cdadmin_HashPassword (const uint8_t* salt, const char* password, uint8_t* digest)
+{
+    CDSHA256 context;
+
+    CD_SHA256Init(&context);
+    CD_SHA256Update(&context, salt, CD_ADMIN_SALT_LENGTH);
+    CD_SHA256Update(&context, password, strlen(password));
+    CD_SHA256Final(&context, digest);
+}
+
+static
+CDAConfig*
+cdadmin_CompileConfig (CDRawConfig config)
 {
-    CDATicket* self = CD_malloc(sizeof(CDATicket));
+    CDAConfig* self = CD_alloc(sizeof(CDAConfig));
+
+    self->ticket.max = 20;
+
+    self->throttle.attempts = 5;
+    self->throttle.window   = 60;
+
+    self->authorizations = CD_CreateHash();
+
+    J_DO {
+        J_IN(ticket, config, "ticket") {
+            J_INT(ticket, "max", self->ticket.max);
+        }
+
+        J_IN(throttle, config, "throttle") {
+            J_INT(throttle, "attempts", self->throttle.attempts);
+            J_INT(throttle, "window",   self->throttle.window);
+        }
+
+        J_FOREACH(auth, config, "authorizations") {
+            const char* name     = NULL;
+            const char* password = NULL;
+            const char* level    = "user";
+
+            J_STRING(auth, "name", name);
+            J_STRING(auth, "password", password);
+            J_STRING(auth, "level", level);
 
-    assert(self);
+            if (!name || !password || CD_HashHasKey(self->authorizations, name)) {
+                continue;
+            }
+
+            CDACredential* credential = CD_malloc(sizeof(CDACredential));
+
+            credential->name  = strdup(name);
+            credential->level = strdup(level);
+
+            CD_RandomBytes(credential->salt, CD_ADMIN_SALT_LENGTH);
+            cdadmin_HashPassword(credential->salt, password, credential->digest);
+
+            CD_HashPut(self->authorizations, name, (CDPointer) credential);
+        }
+    }
 
-    self->requester = requester;
-    self->assignee  = NULL;
-    self->status    = CDTicketOpen;
-    self->content   = content;
+    if (self->throttle.window < 1) {
+        self->throttle.window = 1;
+    }
+
+    // Unknown names are checked against this so they take as long as known ones
+    CD_RandomBytes(self->dummy.salt, CD_ADMIN_SALT_LENGTH);
+    CD_RandomBytes(self->dummy.digest, CD_SHA256_LENGTH);
 
     return self;
 }
 
+static
 void
-cdadmin_DestroyTicket (CDATicket* self)
+cdadmin_DestroyConfig (CDAConfig* self)
 {
-    if (self->content) {
-        CD_DestroyString(self->content);
+    CD_HASH_FOREACH(self->authorizations, it) {
+        CDACredential* credential = (CDACredential*) CD_HashIteratorValue(it);
+
+        CD_free(credential->name);
+        CD_free(credential->level);
+        CD_free(credential);
     }
 
+    CD_DestroyHash(self->authorizations);
+
     CD_free(self);
 }
 
-static CDList* _tickets;
+/**
+ * Check a name and password against the compiled authorizations
+ *
+ * @return The matching credential or NULL
+ */
+static
+const CDACredential*
+cdadmin_Authorize (const CDAConfig* config, const char* name, const char* password)
+{
+    const CDACredential* credential = (CDACredential*) CD_HashGet(config->authorizations, name);
+          uint8_t        digest[CD_SHA256_LENGTH];
 
-typedef enum _CDAuthLevel {
-    CDLevelUser,
-    CDLevelRegisteredUser,
-    CDLevelModerator,
-    CDLevelAdmin
-} CDAuthLevel;
+    cdadmin_HashPassword(credential ? credential->salt : config->dummy.salt, password, digest);
+
+    if (!credential) {
+        CD_DigestIsEqual(digest, config->dummy.digest, CD_SHA256_LENGTH);
+
+        return NULL;
+    }
+
+    return CD_DigestIsEqual(digest, credential->digest, CD_SHA256_LENGTH) ? credential : NULL;
+}
+
+static
+void
+cdadmin_ThrottleSweep (time_t window)
+{
+    CDList* stale = CD_CreateList();
+
+    CD_HASH_FOREACH(_throttle.addresses, it) {
+        if (((CDAThrottle*) CD_HashIteratorValue(it))->window < window - 1) {
+            CD_ListPush(stale, (CDPointer) strdup(CD_HashIteratorKey(it)));
+        }
+    }
+
+    CD_LIST_FOREACH(stale, it) {
+        char* address = (char*) CD_ListIteratorValue(it);
+
+        CD_free((void*) CD_HashDelete(_throttle.addresses, address));
+        CD_free(address);
+    }
+
+    CD_DestroyList(stale);
+
+    _throttle.sweep = CD_HashLength(_throttle.addresses) * 2;
+
+    if (_throttle.sweep < 1024) {
+        _throttle.sweep = 1024;
+    }
+}
+
+/**
+ * Check if an address can try to authorize, and count the attempt if it's a failure
+ *
+ * @param failed true to count a failed attempt
+ *
+ * @return false if the address has too many failed attempts in the window
+ */
+static
+bool
+cdadmin_Throttle (const CDAConfig* config, const char* address, bool failed)
+{
+    CDAThrottle* throttle;
+    time_t       now    = time(NULL);
+    time_t       window = now / config->throttle.window;
+    bool         result;
+
+    if (config->throttle.attempts <= 0) {
+        return true;
+    }
+
+    pthread_mutex_lock(&_throttle.lock);
+    if ((throttle = (CDAThrottle*) CD_HashGet(_throttle.addresses, address)) == NULL) {
+        if (!failed) {
+            pthread_mutex_unlock(&_throttle.lock);
+
+            return true;
+        }
+
+        if (CD_HashLength(_throttle.addresses) >= _throttle.sweep) {
+            cdadmin_ThrottleSweep(window);
+        }
+
+        throttle = CD_alloc(sizeof(CDAThrottle));
+        throttle->window = window;
+
+        CD_HashPut(_throttle.addresses, address, (CDPointer) throttle);
+    }
+
+    if (throttle->window != window) {
+        throttle->previous = (throttle->window == window - 1) ? throttle->current : 0;
+        throttle->current  = 0;
+        throttle->window   = window;
+    }
+
+    if (failed) {
+        throttle->current++;
+    }
+
+    result = (int64_t) throttle->previous * (config->throttle.window - now % config->throttle.window) +
+             (int64_t) throttle->current * config->throttle.window <
+             (int64_t) config->throttle.attempts * config->throttle.window;
+    pthread_mutex_unlock(&_throttle.lock);
+
+    return result;
+}
 
 static
 void
@@ -141,14 +349,23 @@ cdadmin_SetPlayerAuthLevel (CDPlayer* player, const char* level)
         apply = CDLevelRegisteredUser;
     }
 
-    CD_DynamicPut((player), "Authorization.level", apply);
+    if (_level == CD_DYNAMIC_NO_SLOT) {
+        CD_DynamicPut(player, "Authorization.level", apply);
+    }
+    else {
+        CD_DynamicPutSlot(player, _level, apply);
+    }
 }
 
 static
 CDAuthLevel
 cdadmin_GetPlayerAuthLevel (CDPlayer* player)
 {
-    return CD_DynamicGet(player, "Authorization.level");
+    if (_level == CD_DYNAMIC_NO_SLOT) {
+        return CD_DynamicGet(player, "Authorization.level");
+    }
+
+    return CD_DynamicGetSlot(player, _level);
 }
 
 static
@@ -191,44 +408,57 @@ cdadmin_ColoredNick (CDPlayer* player) {
 }
 
 static
-bool
-cdadmin_HandleCommand (CDServer* server, CDPlayer* player, CDString* command)
+CDPlayer*
+cdadmin_GetPlayer (CDServer* server, const char* name)
 {
-    CDRegexp*        regexp  = CD_CreateRegexp("^(\\w+)(?:\\s+(.*?))?$", CDRegexpNone);
-    CDRegexpMatches* matches = CD_RegexpMatch(regexp, command);
-
-    if (!matches) {
-        goto error;
-    }
+    CDList*   worlds = (CDList*) CD_DynamicGet(server, "World.list");
+    CDPlayer* result = NULL;
 
-    SDEBUG(server, "Command> %s: %s\n", CD_StringContent(matches->item[1]), CD_StringContent(matches->item[2]));
+    CD_LIST_FOREACH(worlds, it) {
+        CDWorld* world = (CDWorld*) CD_ListIteratorValue(it);
 
-    #include "src/auth.c"
-    #include "src/workers.c"
-//    #include "src/player.c"
-//    #include "src/ticket.c"
+        if (CD_HashHasKey(world->players, name)) {
+            result = (CDPlayer*) CD_HashGet(world->players, name);
 
-    error: {
-        CD_DestroyRegexpKeepString(regexp);
-
-        if (matches) {
-            CD_DestroyRegexpMatches(matches);
+            CD_LIST_BREAK(worlds);
         }
-
-        return true;
     }
 
-    done: {
-        CD_DestroyRegexpKeepString(regexp);
+    return result;
+}
 
-        if (matches) {
-            CD_DestroyRegexpMatches(matches);
-        }
+/**
+ * Split the first word of the arguments from the rest
+ *
+ * @return The matches with the word in 1 and the rest, if any, in 2 or NULL
+ */
+static
+CDRegexpMatches*
+cdadmin_SplitArguments (CDString* arguments)
+{
+    CDRegexp* regexp = CD_GetRegexp("^(\\S+)(?:\\s+(.*?))?$", CDRegexpNone);
 
-        return false;
+    if (!arguments || !regexp) {
+        return NULL;
     }
+
+    return CD_RegexpMatch(regexp, arguments);
 }
 
+static
+int
+cdadmin_CommandLevel (CDServer* server, CDPlayer* player)
+{
+    return cdadmin_GetPlayerAuthLevel(player);
+}
+
+#include "src/auth.c"
+#include "src/workers.c"
+#include "src/profile.c"
+#include "src/reload.c"
+#include "src/ticket.c"
+//#include "src/player.c"
+
 static
 bool
 cdadmin_HandleChat (CDServer* server, CDPlayer* player, CDString* message)
@@ -255,27 +485,23 @@ cdadmin_HandleChat (CDServer* server, CDPlayer* player, CDString* message)
 }
 
 static
-int8_t
-cdadmin_CompareTicket (CDPlayer* player, CDATicket* ticket)
+bool
+cdadmin_ConfigReload (CDServer* server, CDConfig* config, CDConfig* old)
 {
-    return (ticket->requester == player) ? 0 : 1;
+    CDAConfig* current = __sync_lock_test_and_set(&_config,
+        cdadmin_CompileConfig(CD_ConfigPlugin(config, "commands.admin")));
+
+    CD_ServerRetire(server, (CDPointer) current, (void (*)(CDPointer)) cdadmin_DestroyConfig);
+
+    return true;
 }
 
 static
 bool
 cdadmin_PlayerLogout (CDServer* server, CDPlayer* player, bool status)
 {
-    CD_ListDeleteIf(_tickets, (CDPointer) player, (CDListCompareCallback) cdadmin_CompareTicket);
-
-    if (cdadmin_AuthLevelIsEnough(player, CDLevelModerator)) {
-        CD_LIST_FOREACH(_tickets, it) {
-            CDATicket* ticket = (CDATicket*) CD_ListIteratorValue(it);
-
-            if (ticket->assignee == player) {
-                ticket->status   = CDTicketOpen;
-                ticket->assignee = NULL;
-            }
-        }
+    if (player->username && cdadmin_AuthLevelIsEnough(player, CDLevelModerator)) {
+        cdadmin_UnassignTickets(CD_StringContent(player->username));
     }
 
     return true;
@@ -285,26 +511,43 @@ extern
 bool
 CD_PluginInitialize (CDPlugin* self)
 {
-    self->description = CD_CreateStringFromCString("Admin Commands [auth, ticket, player, workers]");
+    self->description = CD_CreateStringFromCString("Admin Commands [auth, ticket, player, workers, profile, reload]");
+
+    _config = cdadmin_CompileConfig(self->config);
+
+    _level = CD_ReserveDynamicSlot("Authorization.level");
+
+    _throttle.addresses = CD_CreateHash();
+    _throttle.sweep     = 1024;
+
+    pthread_mutex_init(&_throttle.lock, NULL);
 
-    DO { // Initiailize config cache
-        _config.ticket.max = 20;
+    DO {
+        const char* path = CD_ADMIN_TICKET_LOG;
 
         J_DO {
             J_IN(ticket, self->config, "ticket") {
-                J_INT(ticket, "max", _config.ticket.max);
+                J_STRING(ticket, "path", path);
             }
         }
+
+        cdadmin_InitializeTickets(path);
     }
 
-    _tickets = CD_CreateList();
+    CD_CommandsSetLevel(self->server->commands, (CDCommandLevel) cdadmin_CommandLevel);
+
+    CD_RegisterCommand(self->server->commands, "auth",    CDLevelUser,  (CDCommandHandler) cdadmin_CommandAuth);
+    CD_RegisterCommand(self->server->commands, "ticket",  CDLevelUser,  (CDCommandHandler) cdadmin_CommandTicket);
+    CD_RegisterCommand(self->server->commands, "workers", CDLevelAdmin, (CDCommandHandler) cdadmin_CommandWorkers);
+    CD_RegisterCommand(self->server->commands, "profile", CDLevelAdmin, (CDCommandHandler) cdadmin_CommandProfile);
+    CD_RegisterCommand(self->server->commands, "reload",  CDLevelAdmin, (CDCommandHandler) cdadmin_CommandReload);
 
-    CD_DynamicPut(self->server, "Admin.tickets", (CDPointer) _tickets);
+    CD_RegisterCommandAlias(self->server->commands, "auth", "login");
 
-    CD_EventRegisterWithPriority(self->server, "Player.command", -10, cdadmin_HandleCommand);
     CD_EventRegisterWithPriority(self->server, "Player.chat", -10, cdadmin_HandleChat);
 
     CD_EventRegister(self->server, "Player.logout", (CDEventCallbackFunction) cdadmin_PlayerLogout);
+    CD_EventRegister(self->server, "Config.reload", (CDEventCallbackFunction) cdadmin_ConfigReload);
 
     return true;
 }
@@ -313,12 +556,30 @@ extern
 bool
 CD_PluginFinalize (CDPlugin* self)
 {
-    CD_EventUnregister(self->server, "Player.command", cdadmin_HandleCommand);
+    CD_UnregisterCommand(self->server->commands, "auth");
+    CD_UnregisterCommand(self->server->commands, "ticket");
+    CD_UnregisterCommand(self->server->commands, "workers");
+    CD_UnregisterCommand(self->server->commands, "profile");
+    CD_UnregisterCommand(self->server->commands, "reload");
+
+    CD_CommandsSetLevel(self->server->commands, NULL);
+
     CD_EventUnregister(self->server, "Player.chat", cdadmin_HandleChat);
 
     CD_EventUnregister(self->server, "Player.logout", (CDEventCallbackFunction) cdadmin_PlayerLogout);
+    CD_EventUnregister(self->server, "Config.reload", (CDEventCallbackFunction) cdadmin_ConfigReload);
+
+    cdadmin_FinalizeTickets();
+
+    cdadmin_DestroyConfig(_config);
+
+    CD_HASH_FOREACH(_throttle.addresses, it) {
+        CD_free((void*) CD_HashIteratorValue(it));
+    }
+
+    CD_DestroyHash(_throttle.addresses);
 
-    CD_DestroyList((CDList*) CD_DynamicDelete(self->server, "Admin.tickets"));
+    pthread_mutex_destroy(&_throttle.lock);
 
     return true;
 }
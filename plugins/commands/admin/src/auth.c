@@ -28,74 +28,56 @@
     "   name          If omitted Player's username is used\n" \
     "   password    Password to login"
 
+static
+bool
+cdadmin_CommandAuth (CDServer* server, CDPlayer* player, CDString* arguments)
+{
+    const CDAConfig*     config     = _config;
+    const CDACredential* credential = NULL;
+    const char*          name       = NULL;
+    const char*          password   = NULL;
+    CDRegexpMatches*     matches    = NULL;
 
-if (CD_StringIsEqual(matches->item[1], "auth")) {
-    if (!matches->item[2]) {
+    if (!(matches = cdadmin_SplitArguments(arguments))) {
         cdadmin_SendUsage(player, CD_ADMIN_AUTH_USAGE);
 
         goto done;
     }
 
-    DO {
-        CDRegexpMatches* old = matches;
-        matches = CD_RegexpMatch(regexp, old->item[2]);
-        CD_DestroyRegexpMatches(old);
+    if (matches->item[2]) {
+        name     = CD_StringContent(matches->item[1]);
+        password = CD_StringContent(matches->item[2]);
+    }
+    else {
+        name     = CD_StringContent(player->username);
+        password = CD_StringContent(matches->item[1]);
     }
 
-    DO {
-        const char* currentName     = NULL;
-        const char* currentPassword = NULL;
-        const char* name            = NULL;
-        const char* password        = NULL;
-        const char* level           = NULL;
-              bool  authorized      = false;
-
-        if (matches->item[2]) {
-            currentName     = CD_StringContent(matches->item[1]);
-            currentPassword = CD_StringContent(matches->item[2]);
-        }
-        else {
-            currentName     = CD_StringContent(player->username);
-            currentPassword = CD_StringContent(matches->item[1]);
-        }
-
-        J_DO {
-            J_IN(server, player->client->server->config->data, "server") {
-                J_IN(plugin, server, "plugin") {
-                    J_FOREACH(plugin, plugin, "plugins") {
-                        J_IF_STRING(plugin, "name") {
-                            if (CD_CStringIsEqual(J_STRING_VALUE, "admin")) {
-                                J_FOREACH(auth, plugin, "authorizations") {
-                                    J_STRING(auth, "name", name);
-                                    J_STRING(auth, "password", password);
-                                    J_STRING(auth, "level", level);
-
-                                    if (CD_CStringIsEqual(currentName, name) && CD_CStringIsEqual(currentPassword, password)) {
-                                        cdadmin_SetPlayerAuthLevel(player, level);
+    if (!cdadmin_Throttle(config, player->client->ip, false)) {
+        cdadmin_SendFailure(player, CD_CreateStringFromCString(
+            "Too many failed attempts, try again later"));
 
-                                        cdadmin_SendSuccess(player, CD_CreateStringFromFormat(
-                                            "Authorized as %s with level %s", name, level
-                                        ));
+        goto done;
+    }
 
-                                        authorized = true;
+    if ((credential = cdadmin_Authorize(config, name, password))) {
+        cdadmin_SetPlayerAuthLevel(player, credential->level);
 
-                                        break;
-                                    }
-                                }
+        cdadmin_SendSuccess(player, CD_CreateStringFromFormat(
+            "Authorized as %s with level %s", credential->name, credential->level));
+    }
+    else {
+        cdadmin_Throttle(config, player->client->ip, true);
 
-                                if (!authorized) {
-                                    cdadmin_SendFailure(player, CD_CreateStringFromFormat(
-                                        "Failed to authorize as %s", currentName));
-                                }
+        cdadmin_SendFailure(player, CD_CreateStringFromFormat(
+            "Failed to authorize as %s", name));
+    }
 
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
+    done: {
+        if (matches) {
+            CD_DestroyRegexpMatches(matches);
         }
-    }
 
-    goto done;
+        return true;
+    }
 }
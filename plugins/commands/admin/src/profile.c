@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+static
+bool
+cdadmin_CommandProfile (CDServer* server, CDPlayer* player, CDString* arguments)
+{
+    if (!arguments) {
+        json_t* profile = CD_EventProfileToJSON(server, 5);
+
+        cdadmin_SendResponse(player, CD_CreateStringFromFormat("Event profiling is %s.",
+            server->event.profiling ? "on" : "off"));
+
+        for (size_t i = 0; i < json_array_size(profile); i++) {
+            json_t* entry = json_array_get(profile, i);
+
+            cdadmin_SendResponse(player, CD_CreateStringFromFormat("%s %s (%s): %lld calls, %.2fms total, %.2fms max",
+                json_string_value(json_object_get(entry, "event")),
+                json_string_value(json_object_get(entry, "callback")),
+                json_string_value(json_object_get(entry, "module")),
+                (long long) json_integer_value(json_object_get(entry, "calls")),
+                json_integer_value(json_object_get(entry, "total")) / 1000000.0,
+                json_integer_value(json_object_get(entry, "max")) / 1000000.0));
+        }
+
+        json_decref(profile);
+    }
+    else if (CD_StringIsEqual(arguments, "on")) {
+        CD_EventProfiling(server, true);
+
+        cdadmin_SendResponse(player, CD_CreateStringFromCString("Event profiling enabled."));
+    }
+    else if (CD_StringIsEqual(arguments, "off")) {
+        CD_EventProfiling(server, false);
+
+        cdadmin_SendResponse(player, CD_CreateStringFromCString("Event profiling disabled."));
+    }
+    else if (CD_StringIsEqual(arguments, "reset")) {
+        CD_EventProfileReset(server);
+
+        cdadmin_SendResponse(player, CD_CreateStringFromCString("Event profiling counters reset."));
+    }
+    else {
+        cdadmin_SendUsage(player, "/profile [on|off|reset]");
+    }
+
+    return true;
+}
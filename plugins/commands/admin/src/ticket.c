@@ -30,8 +30,9 @@
     "    close      Close a ticket"
 
 #define CD_ADMIN_TICKET_MODERATOR_LIST_USAGE \
-    "Usage: /ticket list <status>\n" \
-    "   status    [all, open, assigned, mine]"
+    "Usage: /ticket list <status> [page]\n" \
+    "   status    [all, open, assigned, mine]\n" \
+    "   page      Page to show, starting from 1"
 
 #define CD_ADMIN_TICKET_MODERATOR_ASSIGN_USAGE \
     "Usage: /ticket assign <id> <name>\n" \
@@ -50,235 +51,169 @@
 #define CD_ADMIN_TICKET_PLAYER_CREATE_USAGE \
     "Usage: /ticket create <text>"
 
-if (CD_StringIsEqual(matches->item[1], "ticket")) {
-    if (cdadmin_AuthLevelIsEnough(player, CDLevelModerator)) {
-        if (!matches->item[2]) {
-            cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_USAGE);
-            goto done;
-        }
+static
+void
+cdadmin_TicketList (CDServer* server, CDPlayer* player, CDString* arguments)
+{
+    CDRegexpMatches* matches = NULL;
+    CDList*          lines   = NULL;
+    size_t           page    = 0;
 
-        DO {
-            CDRegexpMatches* old = matches;
-            matches = CD_RegexpMatch(regexp, old->item[2]);
-            CD_DestroyRegexpMatches(old);
-        }
+    if (!arguments || !(matches = CD_RegexpMatchString("^(\\w+)(?:\\s+(\\d+))?$", CDRegexpNone, arguments))) {
+        cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_LIST_USAGE);
 
-        if (CD_StringIsEqual(matches->item[1], "list")) {
-            if (!matches->item[2]) {
-                cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_LIST_USAGE);
-                goto done;
-            }
-
-            size_t count = 0;
-            size_t shown = 0;
-
-            CD_LIST_FOREACH(_tickets, it) {
-                CDATicket* ticket = (CDATicket*) CD_ListIteratorValue(it);
-                bool       show   = false;
-
-                if (CD_StringIsEqual(matches->item[2], "all")) {
-                    show = true;
-                }
-                else if (CD_StringIsEqual(matches->item[2], "open")) {
-                    if (ticket->status == CDTicketOpen) {
-                        show = true;
-                    }
-                }
-                else if (CD_StringIsEqual(matches->item[2], "assigned")) {
-                    if (ticket->status == CDTicketAssigned) {
-                        show = true;
-                    }
-                }
-                else if (CD_StringIsEqual(matches->item[2], "mine")) {
-                    if (ticket->assignee == player) {
-                        show = true;
-                    }
-                }
-
-                count++;
-
-                if (!show) {
-                    continue;
-                }
-                else {
-                    shown++;
-                }
-
-                if (ticket->assignee) {
-                    cdadmin_SendResponse(player, CD_CreateStringFromFormat(
-                        MC_COLOR_DARKRED "%d: " MC_COLOR_WHITE "%s (%s)" MC_COLOR_GRAY "> " MC_COLOR_WHITE "%s",
-                        count - 1, CD_StringContent(ticket->requester->username),
-                        CD_StringContent(ticket->assignee->username), CD_StringContent(ticket->content)));
-                }
-                else {
-                    cdadmin_SendResponse(player, CD_CreateStringFromFormat(
-                        MC_COLOR_DARKRED "%d: " MC_COLOR_WHITE "%s" MC_COLOR_GRAY "> " MC_COLOR_WHITE "%s",
-                        count - 1, CD_StringContent(ticket->requester->username), CD_StringContent(ticket->content)));
-                }
-
-                if (shown <= 0) {
-                    cdadmin_SendResponse(player, CD_CreateStringFromCString("No tickets"));
-                }
-            }
-
-            goto done;
-        }
+        return;
+    }
 
-        if (CD_StringIsEqual(matches->item[1], "assign")) {
-            if (!matches->item[2]) {
-                cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_ASSIGN_USAGE);
-                goto done;
-            }
+    if (matches->item[2] && atoi(CD_StringContent(matches->item[2])) > 0) {
+        page = atoi(CD_StringContent(matches->item[2])) - 1;
+    }
 
-            DO {
-                CDRegexpMatches* old = matches;
-                matches = CD_RegexpMatchString("^(\\d+)\\s+(.+)$", CDRegexpNone, old->item[2]);
-                CD_DestroyRegexpMatches(old);
-            }
+    if ((lines = cdadmin_ListTickets(CD_StringContent(matches->item[1]), CD_StringContent(player->username), page))) {
+        CD_LIST_FOREACH(lines, it) {
+            cdadmin_SendResponse(player, (CDString*) CD_ListIteratorValue(it));
+        }
 
-            if (!matches) {
-                cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_ASSIGN_USAGE);
-                goto done;
-            }
+        CD_DestroyList(lines);
+    }
+    else {
+        cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_LIST_USAGE);
+    }
 
-            CDPlayer* assignee = NULL;
+    CD_DestroyRegexpMatches(matches);
+}
 
-            if (!CD_HashHasKey(server->players, CD_StringContent(matches->item[2]))) {
-                cdadmin_SendFailure(player, CD_CreateStringFromFormat("%s isn't connected",
-                    CD_StringContent(matches->item[2])));
+static
+void
+cdadmin_TicketAssign (CDServer* server, CDPlayer* player, CDString* arguments)
+{
+    CDRegexpMatches* matches  = NULL;
+    CDPlayer*        assignee = NULL;
 
-                goto done;
-            }
-            else {
-                assignee = (CDPlayer*) CD_HashGet(server->players, CD_StringContent(matches->item[2]));
+    if (!arguments || !(matches = CD_RegexpMatchString("^(\\d+)\\s+(.+)$", CDRegexpNone, arguments))) {
+        cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_ASSIGN_USAGE);
 
-                if (!cdadmin_AuthLevelIsEnough(assignee, CDLevelModerator)) {
-                    cdadmin_SendFailure(player, CD_CreateStringFromFormat("%s isn't a moderator",
-                        CD_StringContent(matches->item[2])));
+        return;
+    }
+
+    if (!(assignee = cdadmin_GetPlayer(server, CD_StringContent(matches->item[2])))) {
+        cdadmin_SendFailure(player, CD_CreateStringFromFormat("%s isn't connected",
+            CD_StringContent(matches->item[2])));
+    }
+    else if (!cdadmin_AuthLevelIsEnough(assignee, CDLevelModerator)) {
+        cdadmin_SendFailure(player, CD_CreateStringFromFormat("%s isn't a moderator",
+            CD_StringContent(matches->item[2])));
+    }
+    else if (cdadmin_AssignTicket(atoi(CD_StringContent(matches->item[1])), CD_StringContent(assignee->username))) {
+        cdadmin_SendSuccess(player, CD_CreateStringFromFormat("Ticket assigned to %s",
+            CD_StringContent(matches->item[2])));
+    }
+    else {
+        cdadmin_SendFailure(player, CD_CreateStringFromFormat("Ticket %s couldn't be found",
+            CD_StringContent(matches->item[1])));
+    }
 
-                    goto done;
-                }
-            }
+    CD_DestroyRegexpMatches(matches);
+}
 
-            size_t id      = atoi(CD_StringContent(matches->item[1]));
-            size_t current = 0;
+static
+void
+cdadmin_TicketClose (CDServer* server, CDPlayer* player, CDString* arguments)
+{
+    uint32_t id;
 
-            CD_LIST_FOREACH(_tickets, it) {
-                if (current == id) {
-                    CDATicket* ticket = (CDATicket*) CD_ListIteratorValue(it);
+    if (!arguments) {
+        cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_CLOSE_USAGE);
 
-                    ticket->assignee = assignee;
-                    ticket->status   = CDTicketAssigned;
+        return;
+    }
 
-                    CD_LIST_BREAK(_tickets);
-                }
+    id = atoi(CD_StringContent(arguments));
 
-                current++;
-            }
+    if (cdadmin_CloseTicket(id)) {
+        cdadmin_SendSuccess(player, CD_CreateStringFromFormat("Ticket %u closed", id));
+    }
+    else {
+        cdadmin_SendFailure(player, CD_CreateStringFromFormat("Ticket %u couldn't be found", id));
+    }
+}
 
-            cdadmin_SendSuccess(player, CD_CreateStringFromFormat("Ticket assigned to %s",
-                CD_StringContent(matches->item[2])));
+static
+void
+cdadmin_TicketCreate (CDServer* server, CDPlayer* player, CDString* arguments)
+{
+    uint32_t id;
 
-            goto done;
-        }
+    if (!arguments) {
+        cdadmin_SendUsage(player, CD_ADMIN_TICKET_PLAYER_CREATE_USAGE);
 
-        if (CD_StringIsEqual(matches->item[1], "close")) {
-            if (!matches->item[2]) {
-                cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_CLOSE_USAGE);
-                goto done;
-            }
+        return;
+    }
 
-            size_t     id      = atoi(CD_StringContent(matches->item[1]));
-            size_t     current = 0;
-            CDATicket* ticket  = NULL;
+    if ((id = cdadmin_OpenTicket(CD_StringContent(player->username), CD_StringContent(arguments), _config->ticket.max))) {
+        cdadmin_SendSuccess(player, CD_CreateStringFromFormat(
+            "Ticket %u has been added, it will be taken care of as soon as possible.", id));
+    }
+    else {
+        cdadmin_SendFailure(player, CD_CreateStringFromCString(
+            "You already have a ticket open or there are too many, try again later"));
+    }
+}
 
-            CD_LIST_FOREACH(_tickets, it) {
-                if (current == id) {
-                    ticket = (CDATicket*) CD_ListIteratorValue(it);
+static
+void
+cdadmin_TicketStatusOf (CDServer* server, CDPlayer* player, CDString* arguments)
+{
+    CDString* status = cdadmin_TicketStatus(CD_StringContent(player->username));
 
-                    CD_LIST_BREAK(_tickets);
-                }
+    if (status) {
+        cdadmin_SendResponse(player, status);
+    }
+    else {
+        cdadmin_SendFailure(player, CD_CreateStringFromCString("There are no tickets related to you"));
+    }
+}
 
-                current++;
-            }
+static
+bool
+cdadmin_CommandTicket (CDServer* server, CDPlayer* player, CDString* arguments)
+{
+    bool             moderator = cdadmin_AuthLevelIsEnough(player, CDLevelModerator);
+    CDRegexpMatches* matches   = cdadmin_SplitArguments(arguments);
 
-            if (ticket) {
-                CD_ListDelete(_tickets, (CDPointer) ticket);
-                cdadmin_DestroyTicket(ticket);
+    if (!matches) {
+        cdadmin_SendUsage(player, moderator ? CD_ADMIN_TICKET_MODERATOR_USAGE : CD_ADMIN_TICKET_PLAYER_USAGE);
 
-                cdadmin_SendSuccess(player, CD_CreateStringFromFormat("Ticket %d closed", id));
-            }
-            else {
-                cdadmin_SendFailure(player, CD_CreateStringFromFormat("Ticket %d couldn't be found",
-                    id));
-            }
+        return true;
+    }
 
-            goto done;
+    if (moderator) {
+        if (CD_StringIsEqual(matches->item[1], "list")) {
+            cdadmin_TicketList(server, player, matches->item[2]);
+        }
+        else if (CD_StringIsEqual(matches->item[1], "assign")) {
+            cdadmin_TicketAssign(server, player, matches->item[2]);
+        }
+        else if (CD_StringIsEqual(matches->item[1], "close")) {
+            cdadmin_TicketClose(server, player, matches->item[2]);
+        }
+        else {
+            cdadmin_SendUsage(player, CD_ADMIN_TICKET_MODERATOR_USAGE);
         }
     }
     else {
-        if (!matches->item[2]) {
-            cdadmin_SendUsage(player, CD_ADMIN_TICKET_PLAYER_USAGE);
-            goto done;
+        if (CD_StringIsEqual(matches->item[1], "create")) {
+            cdadmin_TicketCreate(server, player, matches->item[2]);
         }
-
-        DO {
-            CDRegexpMatches* old = matches;
-            matches = CD_RegexpMatch(regexp, old->item[2]);
-            CD_DestroyRegexpMatches(old);
+        else if (CD_StringIsEqual(matches->item[1], "status")) {
+            cdadmin_TicketStatusOf(server, player, matches->item[2]);
         }
-
-        if (CD_StringIsEqual(matches->item[1], "create")) {
-            if (!matches->item[2]) {
-                cdadmin_SendUsage(player, CD_ADMIN_TICKET_PLAYER_CREATE_USAGE);
-                goto done;
-            }
-
-            if (CD_ListLength(_tickets) > _config.ticket.max) {
-                cdadmin_SendFailure(player, CD_CreateStringFromCString(
-                    "There can't be more tickets at this moment, try again later"));
-
-                goto done;
-            }
-
-            CD_LIST_FOREACH(_tickets, it) {
-                if (((CDATicket*) CD_ListIteratorValue(it))->requester == player) {
-                    cdadmin_SendFailure(player, CD_CreateStringFromCString(
-                        "You can't have more than one ticket open at the same time"));
-
-                    goto done;
-                }
-            }
-
-            CD_ListPush(_tickets, (CDPointer) cdadmin_CreateTicket(player, CD_CloneString(matches->item[2])));
-
-            cdadmin_SendSuccess(player, CD_CreateStringFromCString(
-                "The ticket has been added, it will be taken care of as soon as possible."));
-
-            goto done;
+        else {
+            cdadmin_SendUsage(player, CD_ADMIN_TICKET_PLAYER_USAGE);
         }
+    }
 
-        if (CD_StringIsEqual(matches->item[1], "status")) {
-            CD_LIST_FOREACH(_tickets, it) {
-                CDATicket* ticket = (CDATicket*) CD_ListIteratorValue(it);
-
-                if (ticket->requester == player) {
-                    if (ticket->assignee) {
-                        cdadmin_SendResponse(player, CD_CreateStringFromFormat(
-                            "Assigned to %s", CD_StringContent(ticket->assignee->username)));
-                    }
-                    else {
-                        cdadmin_SendResponse(player, CD_CreateStringFromCString(
-                            "Nobody is taking care of your ticket at the moment, please be patient"));
-                    }
-
-                    goto done;
-                }
-            }
-
-            cdadmin_SendFailure(player, CD_CreateStringFromCString("There are no tickets related to you"));
+    CD_DestroyRegexpMatches(matches);
 
-            goto done;
-        }
-    }
+    return true;
 }
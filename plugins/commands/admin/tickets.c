@@ -0,0 +1,752 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Ticket store, tickets live in a table indexed by ID and are also kept in ID
+ * ordered indexes by status and assignee, so listing a page never scans the
+ * whole store.
+ *
+ * Players are referenced by username so tickets outlive disconnections, every
+ * change is appended to a log that is replayed, and compacted, on load.
+ */
+
+#define CD_ADMIN_TICKET_PAGE 8
+
+/* the build passes LOCALSTATEDIR, the config can still point the log anywhere */
+#ifndef CRAFTD_LOCALSTATEDIR
+#define CRAFTD_LOCALSTATEDIR "/var"
+#endif
+
+#define CD_ADMIN_TICKET_LOG CRAFTD_LOCALSTATEDIR "/craftd/tickets.log"
+
+typedef enum _CDATicketStatus {
+    CDTicketOpen,
+    CDTicketAssigned,
+
+    CDTicketStatuses
+} CDATicketStatus;
+
+typedef struct _CDATicket {
+    uint32_t        id;
+    CDATicketStatus status;
+    time_t          created;
+
+    char* requester;
+    char* assignee;
+    char* content;
+} CDATicket;
+
+typedef struct _CDATicketIndex {
+    size_t      length;
+    size_t      size;
+    CDATicket** item;
+} CDATicketIndex;
+
+static struct {
+    pthread_mutex_t lock;
+
+    uint32_t    base;
+    uint32_t    next;
+    size_t      length;
+    size_t      size;
+    CDATicket** item;
+
+    CDATicketIndex all;
+    CDATicketIndex status[CDTicketStatuses];
+    CDHash*        assignees;
+    CDHash*        requesters;
+
+    struct {
+        FILE*  file;
+        char*  path;
+        size_t records;
+    } log;
+} _tickets;
+
+static
+size_t
+cdadmin_TicketIndexFind (CDATicketIndex* self, uint32_t id)
+{
+    size_t low  = 0;
+    size_t high = self->length;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if (self->item[middle]->id < id) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+static
+void
+cdadmin_TicketIndexAdd (CDATicketIndex* self, CDATicket* ticket)
+{
+    size_t position = cdadmin_TicketIndexFind(self, ticket->id);
+
+    if (self->length == self->size) {
+        self->size = self->size ? self->size * 2 : 16;
+        self->item = CD_realloc(self->item, sizeof(CDATicket*) * self->size);
+    }
+
+    memmove(&self->item[position + 1], &self->item[position], sizeof(CDATicket*) * (self->length - position));
+
+    self->item[position] = ticket;
+    self->length++;
+}
+
+static
+void
+cdadmin_TicketIndexRemove (CDATicketIndex* self, CDATicket* ticket)
+{
+    size_t position = cdadmin_TicketIndexFind(self, ticket->id);
+
+    if (position >= self->length || self->item[position] != ticket) {
+        return;
+    }
+
+    self->length--;
+
+    memmove(&self->item[position], &self->item[position + 1], sizeof(CDATicket*) * (self->length - position));
+}
+
+static
+CDATicketIndex*
+cdadmin_TicketAssigneeIndex (const char* name, bool create)
+{
+    CDATicketIndex* index = (CDATicketIndex*) CD_HashGet(_tickets.assignees, name);
+
+    if (!index && create) {
+        index = CD_alloc(sizeof(CDATicketIndex));
+
+        CD_HashPut(_tickets.assignees, name, (CDPointer) index);
+    }
+
+    return index;
+}
+
+/**
+ * Take a ticket out of the index of its assignee, an index goes away with its last ticket
+ */
+static
+void
+cdadmin_TicketAssigneeRemove (CDATicket* ticket)
+{
+    CDATicketIndex* index = cdadmin_TicketAssigneeIndex(ticket->assignee, false);
+
+    if (!index) {
+        return;
+    }
+
+    cdadmin_TicketIndexRemove(index, ticket);
+
+    if (index->length == 0) {
+        CD_HashDelete(_tickets.assignees, ticket->assignee);
+
+        CD_free(index->item);
+        CD_free(index);
+    }
+}
+
+/**
+ * Drop the closed slots at the start of the table
+ *
+ * @param all Drop them however few they are, otherwise only once they're half of the table
+ */
+static
+void
+cdadmin_TicketsTrim (bool all)
+{
+    size_t leading = 0;
+
+    while (leading < _tickets.length && !_tickets.item[leading]) {
+        leading++;
+    }
+
+    if (leading == 0 || (!all && leading * 2 < _tickets.length)) {
+        return;
+    }
+
+    _tickets.length -= leading;
+    _tickets.base   += leading;
+
+    memmove(_tickets.item, &_tickets.item[leading], sizeof(CDATicket*) * _tickets.length);
+}
+
+static
+void
+cdadmin_TicketsLog (json_t* record)
+{
+    if (_tickets.log.file) {
+        char* line = json_dumps(record, JSON_COMPACT);
+
+        fprintf(_tickets.log.file, "%s\n", line);
+        fflush(_tickets.log.file);
+
+        free(line);
+
+        _tickets.log.records++;
+    }
+
+    json_decref(record);
+}
+
+static
+void
+cdadmin_TicketsLogCreate (CDATicket* ticket)
+{
+    json_t* record = json_object();
+
+    json_object_set_new(record, "create",    json_integer(ticket->id));
+    json_object_set_new(record, "requester", json_string(ticket->requester));
+    json_object_set_new(record, "content",   json_string(ticket->content));
+    json_object_set_new(record, "created",   json_integer(ticket->created));
+
+    cdadmin_TicketsLog(record);
+}
+
+static
+void
+cdadmin_TicketsLogAssign (CDATicket* ticket)
+{
+    json_t* record = json_object();
+
+    json_object_set_new(record, "assign",   json_integer(ticket->id));
+    json_object_set_new(record, "assignee", ticket->assignee ? json_string(ticket->assignee) : json_null());
+
+    cdadmin_TicketsLog(record);
+}
+
+static
+void
+cdadmin_TicketsLogClose (uint32_t id)
+{
+    json_t* record = json_object();
+
+    json_object_set_new(record, "close", json_integer(id));
+
+    cdadmin_TicketsLog(record);
+}
+
+static
+CDATicket*
+cdadmin_TicketsPut (uint32_t id, const char* requester, const char* content, time_t created)
+{
+    CDATicket* ticket;
+
+    if (id < _tickets.base || CD_HashHasKey(_tickets.requesters, requester)) {
+        return NULL;
+    }
+
+    if (_tickets.length == 0) {
+        _tickets.base = id;
+    }
+
+    if (id - _tickets.base >= _tickets.length) {
+        size_t length;
+
+        // make room by moving past the closed heads before growing the table
+        if (id - _tickets.base >= _tickets.size) {
+            cdadmin_TicketsTrim(true);
+        }
+
+        if (_tickets.length == 0) {
+            _tickets.base = id;
+        }
+
+        length = id - _tickets.base + 1;
+
+        if (length > _tickets.size) {
+            _tickets.size = _tickets.size ? _tickets.size * 2 : 16;
+
+            if (_tickets.size < length) {
+                _tickets.size = length;
+            }
+
+            _tickets.item = CD_realloc(_tickets.item, sizeof(CDATicket*) * _tickets.size);
+        }
+
+        memset(&_tickets.item[_tickets.length], 0, sizeof(CDATicket*) * (length - _tickets.length));
+
+        _tickets.length = length;
+    }
+
+    if (_tickets.item[id - _tickets.base]) {
+        return NULL;
+    }
+
+    ticket = CD_malloc(sizeof(CDATicket));
+
+    ticket->id        = id;
+    ticket->status    = CDTicketOpen;
+    ticket->created   = created;
+    ticket->requester = strdup(requester);
+    ticket->assignee  = NULL;
+    ticket->content   = strdup(content);
+
+    _tickets.item[id - _tickets.base] = ticket;
+
+    if (id >= _tickets.next) {
+        _tickets.next = id + 1;
+    }
+
+    cdadmin_TicketIndexAdd(&_tickets.all, ticket);
+    cdadmin_TicketIndexAdd(&_tickets.status[CDTicketOpen], ticket);
+
+    CD_HashPut(_tickets.requesters, requester, (CDPointer) ticket);
+
+    return ticket;
+}
+
+static
+void
+cdadmin_TicketsSetAssignee (CDATicket* ticket, const char* assignee)
+{
+    if (ticket->assignee) {
+        cdadmin_TicketAssigneeRemove(ticket);
+
+        CD_free(ticket->assignee);
+    }
+
+    cdadmin_TicketIndexRemove(&_tickets.status[ticket->status], ticket);
+
+    if (assignee) {
+        ticket->assignee = strdup(assignee);
+        ticket->status   = CDTicketAssigned;
+
+        cdadmin_TicketIndexAdd(cdadmin_TicketAssigneeIndex(assignee, true), ticket);
+    }
+    else {
+        ticket->assignee = NULL;
+        ticket->status   = CDTicketOpen;
+    }
+
+    cdadmin_TicketIndexAdd(&_tickets.status[ticket->status], ticket);
+}
+
+static
+void
+cdadmin_TicketsDelete (CDATicket* ticket)
+{
+    if (ticket->assignee) {
+        cdadmin_TicketAssigneeRemove(ticket);
+    }
+
+    cdadmin_TicketIndexRemove(&_tickets.status[ticket->status], ticket);
+    cdadmin_TicketIndexRemove(&_tickets.all, ticket);
+
+    CD_HashDelete(_tickets.requesters, ticket->requester);
+
+    _tickets.item[ticket->id - _tickets.base] = NULL;
+
+    cdadmin_TicketsTrim(false);
+
+    CD_free(ticket->requester);
+    CD_free(ticket->assignee);
+    CD_free(ticket->content);
+    CD_free(ticket);
+}
+
+static
+CDATicket*
+cdadmin_TicketsGet (uint32_t id)
+{
+    if (id < _tickets.base || id - _tickets.base >= _tickets.length) {
+        return NULL;
+    }
+
+    return _tickets.item[id - _tickets.base];
+}
+
+static
+void
+cdadmin_TicketsReplay (FILE* file)
+{
+    char*   line   = NULL;
+    size_t  size   = 0;
+    ssize_t length;
+
+    while ((length = getline(&line, &size, file)) > 0) {
+        json_error_t error;
+        json_t*      record = json_loads(line, 0, &error);
+
+        if (!record) {
+            continue;
+        }
+
+        _tickets.log.records++;
+
+        J_DO {
+            J_IF_INT(record, "create") {
+                const char* requester = NULL;
+                const char* content   = NULL;
+                json_int_t  created   = 0;
+                uint32_t    id        = J_INT_VALUE;
+
+                J_STRING(record, "requester", requester);
+                J_STRING(record, "content",   content);
+                J_INT(record,    "created",   created);
+
+                if (requester && content) {
+                    cdadmin_TicketsPut(id, requester, content, created);
+                }
+            }
+
+            J_IF_INT(record, "assign") {
+                CDATicket* ticket = cdadmin_TicketsGet(J_INT_VALUE);
+
+                if (ticket) {
+                    cdadmin_TicketsSetAssignee(ticket, json_string_value(json_object_get(record, "assignee")));
+                }
+            }
+
+            J_IF_INT(record, "close") {
+                CDATicket* ticket = cdadmin_TicketsGet(J_INT_VALUE);
+
+                if (ticket) {
+                    cdadmin_TicketsDelete(ticket);
+                }
+
+                if ((uint32_t) J_INT_VALUE >= _tickets.next) {
+                    _tickets.next = J_INT_VALUE + 1;
+                }
+            }
+        }
+
+        json_decref(record);
+    }
+
+    free(line);
+}
+
+/**
+ * Rewrite the log with only the live tickets
+ */
+static
+bool
+cdadmin_TicketsCompact (void)
+{
+    CDString* path = CD_CreateStringFromFormat("%s.tmp", _tickets.log.path);
+    FILE*     file = fopen(CD_StringContent(path), "w");
+
+    if (!file) {
+        CD_DestroyString(path);
+
+        return false;
+    }
+
+    if (_tickets.log.file) {
+        fclose(_tickets.log.file);
+    }
+
+    _tickets.log.file    = file;
+    _tickets.log.records = 0;
+
+    // Keep the next ID even if the last tickets are closed
+    if (_tickets.all.length == 0 || _tickets.all.item[_tickets.all.length - 1]->id + 1 < _tickets.next) {
+        cdadmin_TicketsLogClose(_tickets.next - 1);
+    }
+
+    for (size_t i = 0; i < _tickets.all.length; i++) {
+        cdadmin_TicketsLogCreate(_tickets.all.item[i]);
+
+        if (_tickets.all.item[i]->assignee) {
+            cdadmin_TicketsLogAssign(_tickets.all.item[i]);
+        }
+    }
+
+    if (rename(CD_StringContent(path), _tickets.log.path) != 0) {
+        fclose(_tickets.log.file);
+
+        _tickets.log.file = fopen(_tickets.log.path, "a");
+    }
+
+    CD_DestroyString(path);
+
+    return _tickets.log.file != NULL;
+}
+
+static
+void
+cdadmin_InitializeTickets (const char* path)
+{
+    pthread_mutex_init(&_tickets.lock, NULL);
+
+    _tickets.base   = 1;
+    _tickets.next   = 1;
+    _tickets.length = 0;
+    _tickets.size   = 0;
+    _tickets.item   = NULL;
+
+    _tickets.assignees  = CD_CreateHash();
+    _tickets.requesters = CD_CreateHash();
+
+    _tickets.log.file    = NULL;
+    _tickets.log.path    = path ? strdup(path) : NULL;
+    _tickets.log.records = 0;
+
+    if (!_tickets.log.path) {
+        return;
+    }
+
+    DO {
+        FILE* file = fopen(_tickets.log.path, "r");
+
+        if (file) {
+            cdadmin_TicketsReplay(file);
+            fclose(file);
+        }
+    }
+
+    if (_tickets.log.records > _tickets.all.length * 2 + 64) {
+        cdadmin_TicketsCompact();
+    }
+    else {
+        _tickets.log.file = fopen(_tickets.log.path, "a");
+    }
+
+    if (!_tickets.log.file) {
+        ERR("tickets won't be saved, %s couldn't be opened: %s", _tickets.log.path, strerror(errno));
+    }
+}
+
+static
+void
+cdadmin_FinalizeTickets (void)
+{
+    while (_tickets.all.length > 0) {
+        CDATicket* ticket = _tickets.all.item[_tickets.all.length - 1];
+
+        // Closing on shutdown isn't a real close, so skip the log
+        cdadmin_TicketsDelete(ticket);
+    }
+
+    CD_HASH_FOREACH(_tickets.assignees, it) {
+        CDATicketIndex* index = (CDATicketIndex*) CD_HashIteratorValue(it);
+
+        CD_free(index->item);
+        CD_free(index);
+    }
+
+    CD_DestroyHash(_tickets.assignees);
+    CD_DestroyHash(_tickets.requesters);
+
+    CD_free(_tickets.all.item);
+
+    for (int i = 0; i < CDTicketStatuses; i++) {
+        CD_free(_tickets.status[i].item);
+    }
+
+    CD_free(_tickets.item);
+
+    if (_tickets.log.file) {
+        fclose(_tickets.log.file);
+    }
+
+    CD_free(_tickets.log.path);
+
+    pthread_mutex_destroy(&_tickets.lock);
+}
+
+/**
+ * Open a ticket for a player
+ *
+ * @return The ID of the ticket, 0 if the player already has one or there are too many
+ */
+static
+uint32_t
+cdadmin_OpenTicket (const char* requester, const char* content, size_t max)
+{
+    CDATicket* ticket = NULL;
+
+    pthread_mutex_lock(&_tickets.lock);
+    if (_tickets.all.length < max) {
+        if ((ticket = cdadmin_TicketsPut(_tickets.next, requester, content, time(NULL)))) {
+            cdadmin_TicketsLogCreate(ticket);
+        }
+    }
+    pthread_mutex_unlock(&_tickets.lock);
+
+    return ticket ? ticket->id : 0;
+}
+
+/**
+ * Assign a ticket to a moderator, or open it again if the assignee is NULL
+ */
+static
+bool
+cdadmin_AssignTicket (uint32_t id, const char* assignee)
+{
+    CDATicket* ticket;
+
+    pthread_mutex_lock(&_tickets.lock);
+    if ((ticket = cdadmin_TicketsGet(id))) {
+        cdadmin_TicketsSetAssignee(ticket, assignee);
+        cdadmin_TicketsLogAssign(ticket);
+    }
+    pthread_mutex_unlock(&_tickets.lock);
+
+    return ticket != NULL;
+}
+
+/**
+ * Put the tickets assigned to a moderator back in the open ones
+ */
+static
+void
+cdadmin_UnassignTickets (const char* assignee)
+{
+    CDATicketIndex* index;
+
+    // the index is freed along with its last ticket, so look it up again every time
+    pthread_mutex_lock(&_tickets.lock);
+    while ((index = cdadmin_TicketAssigneeIndex(assignee, false))) {
+        CDATicket* ticket = index->item[index->length - 1];
+
+        cdadmin_TicketsSetAssignee(ticket, NULL);
+        cdadmin_TicketsLogAssign(ticket);
+    }
+    pthread_mutex_unlock(&_tickets.lock);
+}
+
+static
+bool
+cdadmin_CloseTicket (uint32_t id)
+{
+    CDATicket* ticket;
+
+    pthread_mutex_lock(&_tickets.lock);
+    if ((ticket = cdadmin_TicketsGet(id))) {
+        cdadmin_TicketsDelete(ticket);
+        cdadmin_TicketsLogClose(id);
+
+        if (_tickets.log.records > _tickets.all.length * 2 + 64) {
+            cdadmin_TicketsCompact();
+        }
+    }
+    pthread_mutex_unlock(&_tickets.lock);
+
+    return ticket != NULL;
+}
+
+/**
+ * Get the status of the ticket of a player
+ *
+ * @return A message to send or NULL if the player has no ticket
+ */
+static
+CDString*
+cdadmin_TicketStatus (const char* requester)
+{
+    CDATicket* ticket;
+    CDString*  result = NULL;
+
+    pthread_mutex_lock(&_tickets.lock);
+    if ((ticket = (CDATicket*) CD_HashGet(_tickets.requesters, requester))) {
+        if (ticket->assignee) {
+            result = CD_CreateStringFromFormat("Ticket %u is assigned to %s", ticket->id, ticket->assignee);
+        }
+        else {
+            result = CD_CreateStringFromFormat("Nobody is taking care of ticket %u at the moment, please be patient",
+                ticket->id);
+        }
+    }
+    pthread_mutex_unlock(&_tickets.lock);
+
+    return result;
+}
+
+/**
+ * Format a page of tickets
+ *
+ * @param filter all, open, assigned or mine
+ * @param name The name of the moderator asking, used by mine
+ * @param page The page, starting from 0
+ *
+ * @return A list of CDString to send, the first one is the header, NULL if the filter is unknown
+ */
+static
+CDList*
+cdadmin_ListTickets (const char* filter, const char* name, size_t page)
+{
+    CDATicketIndex  none   = { 0, 0, NULL };
+    CDATicketIndex* index  = NULL;
+    CDList*         result = NULL;
+
+    pthread_mutex_lock(&_tickets.lock);
+    if (CD_CStringIsEqual(filter, "all")) {
+        index = &_tickets.all;
+    }
+    else if (CD_CStringIsEqual(filter, "open")) {
+        index = &_tickets.status[CDTicketOpen];
+    }
+    else if (CD_CStringIsEqual(filter, "assigned")) {
+        index = &_tickets.status[CDTicketAssigned];
+    }
+    else if (CD_CStringIsEqual(filter, "mine")) {
+        // moderators without tickets have no index, don't make one just to list it
+        if (!(index = cdadmin_TicketAssigneeIndex(name, false))) {
+            index = &none;
+        }
+    }
+
+    if (index) {
+        size_t pages = (index->length + CD_ADMIN_TICKET_PAGE - 1) / CD_ADMIN_TICKET_PAGE;
+
+        result = CD_CreateList();
+
+        if (index->length == 0) {
+            CD_ListPush(result, (CDPointer) CD_CreateStringFromCString("No tickets"));
+        }
+        else {
+            CD_ListPush(result, (CDPointer) CD_CreateStringFromFormat("%zu tickets, page %zu of %zu",
+                index->length, page + 1, pages));
+        }
+
+        for (size_t i = page * CD_ADMIN_TICKET_PAGE; i < index->length && i < (page + 1) * CD_ADMIN_TICKET_PAGE; i++) {
+            CDATicket* ticket = index->item[i];
+
+            if (ticket->assignee) {
+                CD_ListPush(result, (CDPointer) CD_CreateStringFromFormat(
+                    MC_COLOR_DARKRED "%u: " MC_COLOR_WHITE "%s (%s)" MC_COLOR_GRAY "> " MC_COLOR_WHITE "%s",
+                    ticket->id, ticket->requester, ticket->assignee, ticket->content));
+            }
+            else {
+                CD_ListPush(result, (CDPointer) CD_CreateStringFromFormat(
+                    MC_COLOR_DARKRED "%u: " MC_COLOR_WHITE "%s" MC_COLOR_GRAY "> " MC_COLOR_WHITE "%s",
+                    ticket->id, ticket->requester, ticket->content));
+            }
+        }
+    }
+    pthread_mutex_unlock(&_tickets.lock);
+
+    return result;
+}
@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Noise cache for the classic generator.
+ *
+ * The noise functions are sampled on a coarse lattice (one sample every
+ * CDCLASSIC_LATTICE_STEP blocks on every axis) and the values for each block are
+ * interpolated from it. Lattice columns are cached by their world position, so the
+ * columns on a chunk border are computed once and reused by the neighbouring chunk,
+ * the least recently used ones are evicted when the cache is full.
+ *
+ * The result is close to, but not the same as, the exact generation.
+ */
+
+#define CDCLASSIC_LATTICE_STEP   4
+#define CDCLASSIC_LATTICE_WIDTH  ((16 / CDCLASSIC_LATTICE_STEP) + 1)
+#define CDCLASSIC_LATTICE_HEIGHT ((128 / CDCLASSIC_LATTICE_STEP) + 1)
+
+/*
+ * Linear interpolation shrinks the variance of the noise between lattice points, which
+ * would make the thresholded tails used for minerals (and so ores) much rarer. Mineral
+ * samples are scaled by (1 / sqrt(sum of squared weights)) ^ CDCLASSIC_MINERAL_BOOST,
+ * the exponent was measured to keep the ore count close to the exact generation.
+ */
+#define CDCLASSIC_MINERAL_BOOST 0.55
+
+static float _mineralScale[CDCLASSIC_LATTICE_STEP][CDCLASSIC_LATTICE_STEP][CDCLASSIC_LATTICE_STEP];
+
+typedef struct _CDClassicLatticeColumn {
+    float height;
+    float caves[CDCLASSIC_LATTICE_HEIGHT];
+    float erosion[CDCLASSIC_LATTICE_HEIGHT];
+    float minerals[CDCLASSIC_MINERALS][CDCLASSIC_LATTICE_HEIGHT];
+} CDClassicLatticeColumn;
+
+typedef struct _CDClassicCacheEntry {
+    CDMapId id;
+
+    struct _CDClassicCacheEntry* previous;
+    struct _CDClassicCacheEntry* next;
+
+    CDClassicLatticeColumn column;
+} CDClassicCacheEntry;
+
+typedef struct _CDClassicCache {
+    const snoise_context* noise;
+
+    CDMap* entries;
+    size_t length;
+    size_t capacity;
+
+    // most recently used first
+    CDClassicCacheEntry* head;
+    CDClassicCacheEntry* tail;
+
+    pthread_mutex_t lock;
+} CDClassicCache;
+
+static
+void
+cdclassic_CacheInitialize (void)
+{
+    for (int x = 0; x < CDCLASSIC_LATTICE_STEP; x++) {
+        for (int y = 0; y < CDCLASSIC_LATTICE_STEP; y++) {
+            for (int z = 0; z < CDCLASSIC_LATTICE_STEP; z++) {
+                double fx = ((double) x) / CDCLASSIC_LATTICE_STEP;
+                double fy = ((double) y) / CDCLASSIC_LATTICE_STEP;
+                double fz = ((double) z) / CDCLASSIC_LATTICE_STEP;
+
+                double weights = (((1 - fx) * (1 - fx)) + (fx * fx))
+                               * (((1 - fy) * (1 - fy)) + (fy * fy))
+                               * (((1 - fz) * (1 - fz)) + (fz * fz));
+
+                _mineralScale[x][z][y] = pow(1 / sqrt(weights), CDCLASSIC_MINERAL_BOOST);
+            }
+        }
+    }
+}
+
+static
+CDClassicCache*
+cdclassic_CreateCache (const snoise_context* noise, size_t capacity)
+{
+    CDClassicCache* self = CD_malloc(sizeof(CDClassicCache));
+
+    self->noise    = noise;
+    self->entries  = CD_CreateMap();
+    self->length   = 0;
+    self->capacity = CD_Max(capacity, CDCLASSIC_LATTICE_WIDTH * CDCLASSIC_LATTICE_WIDTH);
+    self->head     = NULL;
+    self->tail     = NULL;
+
+    pthread_mutex_init(&self->lock, NULL);
+
+    return self;
+}
+
+static
+void
+cdclassic_DestroyCache (CDClassicCache* self)
+{
+    for (CDClassicCacheEntry* entry = self->head, *next; entry; entry = next) {
+        next = entry->next;
+
+        CD_free(entry);
+    }
+
+    CD_DestroyMap(self->entries);
+
+    pthread_mutex_destroy(&self->lock);
+
+    CD_free(self);
+}
+
+static inline
+CDMapId
+cdclassic_LatticeId (int latticeX, int latticeZ)
+{
+    return (CDMapId) (((uint64_t) (uint32_t) latticeX << 32) | (uint32_t) latticeZ);
+}
+
+static
+void
+cdclassic_CacheUnlink (CDClassicCache* self, CDClassicCacheEntry* entry)
+{
+    if (entry->previous) {
+        entry->previous->next = entry->next;
+    }
+    else {
+        self->head = entry->next;
+    }
+
+    if (entry->next) {
+        entry->next->previous = entry->previous;
+    }
+    else {
+        self->tail = entry->previous;
+    }
+}
+
+static
+void
+cdclassic_CachePushFront (CDClassicCache* self, CDClassicCacheEntry* entry)
+{
+    entry->previous = NULL;
+    entry->next     = self->head;
+
+    if (self->head) {
+        self->head->previous = entry;
+    }
+    else {
+        self->tail = entry;
+    }
+
+    self->head = entry;
+}
+
+/**
+ * Sample the exact noise at a lattice column, this is the expensive part.
+ */
+static
+void
+cdclassic_SampleLatticeColumn (const snoise_context* noise, int latticeX, int latticeZ, CDClassicLatticeColumn* column)
+{
+    int   blockX = latticeX * CDCLASSIC_LATTICE_STEP;
+    int   blockZ = latticeZ * CDCLASSIC_LATTICE_STEP;
+    float totalX = (float) blockX;
+    float totalZ = (float) blockZ;
+
+    column->height = cdclassic_HeightNoise(noise, blockX, blockZ);
+
+    for (int i = 0; i < CDCLASSIC_LATTICE_HEIGHT; i++) {
+        int   y      = i * CDCLASSIC_LATTICE_STEP;
+        float totalY = ((float) y) * 0.075;
+
+        column->caves[i]   = cdclassic_CaveNoise(noise, totalX, y, totalZ);
+        column->erosion[i] = cdclassic_ErosionNoise(noise, totalX, y, totalZ);
+
+        for (size_t mineral = 0; mineral < CDCLASSIC_MINERALS; mineral++) {
+            column->minerals[mineral][i] = cdclassic_MineralNoise(noise,
+                totalX * 0.075, totalY, totalZ * 0.075, cdclassic_Minerals[mineral]);
+        }
+    }
+}
+
+/**
+ * Copy a lattice column out of the cache, sampling and caching it if it isn't there.
+ *
+ * The sampling is done without holding the lock, if two workers miss the same column
+ * at the same time it's computed twice and only the first one is kept.
+ */
+static
+void
+cdclassic_CacheFetch (CDClassicCache* self, int latticeX, int latticeZ, CDClassicLatticeColumn* column)
+{
+    CDMapId              id = cdclassic_LatticeId(latticeX, latticeZ);
+    CDClassicCacheEntry* entry;
+
+    pthread_mutex_lock(&self->lock);
+    if ((entry = (CDClassicCacheEntry*) CD_MapGet(self->entries, id))) {
+        cdclassic_CacheUnlink(self, entry);
+        cdclassic_CachePushFront(self, entry);
+
+        *column = entry->column;
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    if (entry) {
+        return;
+    }
+
+    cdclassic_SampleLatticeColumn(self->noise, latticeX, latticeZ, column);
+
+    pthread_mutex_lock(&self->lock);
+    if (!CD_MapHasKey(self->entries, id)) {
+        if (self->length >= self->capacity) {
+            // reuse the least recently used entry
+            entry = self->tail;
+
+            cdclassic_CacheUnlink(self, entry);
+            CD_MapDelete(self->entries, entry->id);
+        }
+        else {
+            entry = CD_malloc(sizeof(CDClassicCacheEntry));
+
+            self->length++;
+        }
+
+        entry->id     = id;
+        entry->column = *column;
+
+        CD_MapPut(self->entries, id, (CDPointer) entry);
+        cdclassic_CachePushFront(self, entry);
+    }
+    pthread_mutex_unlock(&self->lock);
+}
+
+/**
+ * Fetch all the lattice columns covering a chunk, borders included.
+ */
+static
+void
+cdclassic_CacheFetchChunk (CDClassicCache* self, int chunkX, int chunkZ, CDClassicLatticeColumn lattice[CDCLASSIC_LATTICE_WIDTH][CDCLASSIC_LATTICE_WIDTH])
+{
+    int originX = chunkX * (16 / CDCLASSIC_LATTICE_STEP);
+    int originZ = chunkZ * (16 / CDCLASSIC_LATTICE_STEP);
+
+    for (int x = 0; x < CDCLASSIC_LATTICE_WIDTH; x++) {
+        for (int z = 0; z < CDCLASSIC_LATTICE_WIDTH; z++) {
+            cdclassic_CacheFetch(self, originX + x, originZ + z, &lattice[x][z]);
+        }
+    }
+}
+
+static inline
+float
+cdclassic_Bilerp (float v00, float v10, float v01, float v11, float fx, float fz)
+{
+    float a = v00 + ((v10 - v00) * fx);
+    float b = v01 + ((v11 - v01) * fx);
+
+    return a + ((b - a) * fz);
+}
+
+static
+void
+cdclassic_InterpolateColumn (const float* c00, const float* c10, const float* c01, const float* c11, float fx, float fz, const float* scale, float* result)
+{
+    float lattice[CDCLASSIC_LATTICE_HEIGHT];
+
+    for (int i = 0; i < CDCLASSIC_LATTICE_HEIGHT; i++) {
+        lattice[i] = cdclassic_Bilerp(c00[i], c10[i], c01[i], c11[i], fx, fz);
+    }
+
+    for (int y = 0; y < 128; y++) {
+        int   i  = y / CDCLASSIC_LATTICE_STEP;
+        float fy = ((float) (y % CDCLASSIC_LATTICE_STEP)) / CDCLASSIC_LATTICE_STEP;
+
+        result[y] = lattice[i] + ((lattice[i + 1] - lattice[i]) * fy);
+
+        if (scale) {
+            result[y] *= scale[y % CDCLASSIC_LATTICE_STEP];
+        }
+    }
+}
+
+/**
+ * Interpolate the noise values of a block column from the lattice columns around it.
+ */
+static
+void
+cdclassic_InterpolateSamples (CDClassicLatticeColumn lattice[CDCLASSIC_LATTICE_WIDTH][CDCLASSIC_LATTICE_WIDTH], int x, int z, CDClassicSamples* samples)
+{
+    int   latticeX = x / CDCLASSIC_LATTICE_STEP;
+    int   latticeZ = z / CDCLASSIC_LATTICE_STEP;
+    float fx       = ((float) (x % CDCLASSIC_LATTICE_STEP)) / CDCLASSIC_LATTICE_STEP;
+    float fz       = ((float) (z % CDCLASSIC_LATTICE_STEP)) / CDCLASSIC_LATTICE_STEP;
+
+    const CDClassicLatticeColumn* c00 = &lattice[latticeX][latticeZ];
+    const CDClassicLatticeColumn* c10 = &lattice[latticeX + 1][latticeZ];
+    const CDClassicLatticeColumn* c01 = &lattice[latticeX][latticeZ + 1];
+    const CDClassicLatticeColumn* c11 = &lattice[latticeX + 1][latticeZ + 1];
+
+    samples->height = cdclassic_Bilerp(c00->height, c10->height, c01->height, c11->height, fx, fz);
+
+    cdclassic_InterpolateColumn(c00->caves, c10->caves, c01->caves, c11->caves, fx, fz, NULL, samples->caves);
+    cdclassic_InterpolateColumn(c00->erosion, c10->erosion, c01->erosion, c11->erosion, fx, fz, NULL, samples->erosion);
+
+    for (size_t mineral = 0; mineral < CDCLASSIC_MINERALS; mineral++) {
+        cdclassic_InterpolateColumn(c00->minerals[mineral], c10->minerals[mineral],
+            c01->minerals[mineral], c11->minerals[mineral], fx, fz,
+            _mineralScale[x % CDCLASSIC_LATTICE_STEP][z % CDCLASSIC_LATTICE_STEP], samples->minerals[mineral]);
+    }
+}
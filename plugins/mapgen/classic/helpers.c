@@ -26,24 +26,58 @@
 #include <math.h>
 #include <noise/simplexnoise1234.h>
 
+#define CDCLASSIC_HEIGHT_LACUNARITY 2.7
+#define CDCLASSIC_HEIGHT_OCTAVES    20
+
+/**
+ * Mineral blocks in the order they're tried, a later mineral replaces an earlier one.
+ */
+static const MCBlockType cdclassic_Minerals[] = {
+    MCCoalOre, MCDirt, MCGravel, MCIronOre, MCLapisLazuliOre, MCGoldOre, MCDiamondOre, MCRedstoneOre
+};
+
+#define CDCLASSIC_MINERALS ARRAY_SIZE(cdclassic_Minerals)
+
+/**
+ * Noise values for a whole column, interpolated from the noise cache.
+ *
+ * When the generator runs without a cache the passes get NULL and evaluate the noise
+ * at every block instead.
+ */
+typedef struct _CDClassicSamples {
+    float height;
+    float caves[128];
+    float erosion[128];
+    float minerals[CDCLASSIC_MINERALS][128];
+} CDClassicSamples;
+
+/**
+ * Precompute the per octave amplitudes of a multifractal, they only depend on the
+ * lacunarity and used to be recomputed with pow() for every single column.
+ */
 static
-float
-cdclassic_Multifractal2d (float x, float z, float lacunarity, int octaves)
+void
+cdclassic_MultifractalExponents (float* exponents, float lacunarity, int octaves)
 {
-    float exponentArray[octaves];
     float frequency = 1.0;
     float H         = 0.25;
-    float offset    = 0.7;
-    float weight    = 1.0;
-    float result    = 0.0;
 
     for (int i = 0; i < octaves; i++) {
-        exponentArray[i] = pow(frequency, -H);
-        frequency       *= lacunarity;
+        exponents[i] = pow(frequency, -H);
+        frequency   *= lacunarity;
     }
+}
+
+static
+float
+cdclassic_Multifractal2d (const snoise_context* noise, const float* exponents, float x, float z, float lacunarity, int octaves)
+{
+    float offset    = 0.7;
+    float weight    = 1.0;
+    float result    = 0.0;
 
     for (int i = 0; i < octaves; i++) {
-        float _signal = (snoise2(x, z) + offset) * exponentArray[i];
+        float _signal = (snoise2(noise, x, z) + offset) * exponents[i];
 
         if (weight > 1.0) {
             weight = 1.0;
@@ -60,30 +94,22 @@ cdclassic_Multifractal2d (float x, float z, float lacunarity, int octaves)
 
 static
 float
-cdclassic_Multifractal3d (float x, float y, float z, float lacunarity, int octaves)
+cdclassic_Multifractal3d (const snoise_context* noise, const float* exponents, float x, float y, float z, float lacunarity, int octaves)
 {
-    float exponentArray[octaves];
-    float frequency   = 1.0;
-    float H           = 0.25;
     float offset      = 0.7;
     float weight      = 1.0;
     float totalWeight = 0.0;
     float result      = 0.0;
 
     for (int i = 0; i < octaves; i++) {
-        exponentArray[i] = pow(frequency, -H);
-        frequency       *= lacunarity;
-    }
-
-    for (int i = 0; i < octaves; i++) {
-        float _signal = (snoise3(x, y, z) + offset) * exponentArray[i];
+        float _signal = (snoise3(noise, x, y, z) + offset) * exponents[i];
 
         if (weight > 1.0) {
             weight = 1.0;
         }
 
         result      += (weight * _signal);
-        totalWeight += (exponentArray[i] * weight);
+        totalWeight += (exponents[i] * weight);
 
         weight *= _signal;
         x      *= lacunarity;
@@ -93,226 +119,275 @@ cdclassic_Multifractal3d (float x, float y, float z, float lacunarity, int octav
     return result;
 }
 
+static float _heightExponents[CDCLASSIC_HEIGHT_OCTAVES];
+
+/*
+ * The raw noise functions of each pass, these are what the noise cache samples.
+ */
+
+static inline
+float
+cdclassic_HeightNoise (const snoise_context* noise, int blockX, int blockZ)
+{
+    float totalX = ((float) blockX) * 0.00155; // magic
+    float totalZ = ((float) blockZ) * 0.00155;
+
+    return cdclassic_Multifractal2d(noise, _heightExponents, totalX, totalZ, CDCLASSIC_HEIGHT_LACUNARITY, CDCLASSIC_HEIGHT_OCTAVES);
+}
+
+static inline
+float
+cdclassic_CaveNoise (const snoise_context* noise, float totalX, int y, float totalZ)
+{
+    return (snoise3(noise, totalX / 12.0, y / 12.0, totalZ / 12.0)
+        + (0.5 * snoise3(noise, totalX / 24.0, y / 24.0, totalZ / 24.0))) / 1.5;
+}
+
+static inline
+float
+cdclassic_ErosionNoise (const snoise_context* noise, float totalX, int y, float totalZ)
+{
+    return (snoise3(noise, totalX / 40.0, y / 50.0, totalZ / 40.0)
+        + (0.5 * snoise3(noise, totalX / 80.0, y / 100.0, totalZ / 80.0))) / 1.5;
+}
+
+static inline
+float
+cdclassic_MineralNoise (const snoise_context* noise, float totalX, float totalY, float totalZ, MCBlockType blockType)
+{
+    return snoise4(noise, totalX, totalY, totalZ, blockType);
+}
+
+/*
+ * Every pass below works on a single column: blocks and sky light are stored with Y as
+ * the fastest moving index, so a column is a contiguous run of 128 blocks (and 64 bytes
+ * of packed sky light) and the whole column stays in cache while all the passes run on it.
+ */
+
+static inline
+uint8_t*
+cdclassic_ColumnBlocks (MCChunk* chunk, int x, int z)
+{
+    return &chunk->blocks[(z * 128) + (x * 128 * 16)];
+}
+
+static inline
+uint8_t*
+cdclassic_ColumnSkyLight (MCChunk* chunk, int x, int z)
+{
+    return &chunk->skyLight[((z * 128) + (x * 128 * 16)) / 2];
+}
+
 static
 void
-cdclassic_GenerateHeightMap (MCChunk* chunk, int chunkX, int chunkZ)
+cdclassic_GenerateHeight (const snoise_context* noise, const CDClassicSamples* samples, uint8_t* height, int blockX, int blockZ)
 {
-    // step 1: generate the height map
-    for (int x = 0; x < 16; x++) {
-        for (int z = 0; z < 16; z++) {
-            float totalX = ((((float) chunkX) * 16.0) + ((float) x)) * 0.00155; // magic
-            float totalZ = ((((float) chunkZ) * 16.0) + ((float) z)) * 0.00155;
+    float value = samples ? samples->height : cdclassic_HeightNoise(noise, blockX, blockZ);
 
-            chunk->heightMap[x + (z * 16)] = cdclassic_Multifractal2d(totalX, totalZ, 2.7, 20) * 13.5 + 55;
-        }
-    }
+    *height = value * 13.5 + 55;
 }
 
 static
 void
-cdclassic_GenerateFilledChunk (MCChunk* chunk, int chunkX, int chunkZ, MCBlockType blockType)
+cdclassic_FillColumn (uint8_t* column, uint8_t height, MCBlockType blockType)
 {
-    for (int x = 0; x < 16; x++) {
-        for (int z = 0; z < 16; z++) {
-            for (int y = 0; y < chunk->heightMap[x + (z * 16)] && y < 128; y++) {
-                // stone is the basis of MC worlds
-                chunk->blocks[y + (z * 128) + (x * 128 * 16)] = blockType;
-            }
-        }
-    }
+    int filled = CD_Min(height, 128);
+
+    // stone is the basis of MC worlds, everything above it is air
+    memset(column, blockType, filled);
+    memset(column + filled, MCAir, 128 - filled);
 }
 
 static
 void
-cdclassic_GenerateSkyLight (MCChunk* chunk, int chunkX, int chunkZ)
+cdclassic_DigCavesColumn (const snoise_context* noise, const CDClassicSamples* samples, uint8_t* column, uint8_t* height, int blockX, int blockZ)
 {
-    int lightValue = 0x0F;
-
-    for (int x = 0; x < 16; x++) {
-        for (int z = 0; z < 16; z++) {
-            for (int y = chunk->heightMap[x + (z * 16)]; y < 128; y++) {
-                if (y % 2) {
-                    chunk->skyLight[((z * 128) + (x * 128 * 16) + y) / 2] |= (lightValue << 4);
-                }
-                else {
-                    chunk->skyLight[((z * 128) + (x * 128 * 16) + y) / 2] |= (lightValue);
-                }
+    float totalX = (float) blockX;
+    float totalZ = (float) blockZ;
+
+    for (int y = 0; y < 54; y++) {
+        float result = samples ? samples->caves[y] : cdclassic_CaveNoise(noise, totalX, y, totalZ);
+
+        if (result > 0.35) {
+            if (y < 16) {
+                column[y] = MCLava;
+            }
+            else {
+                column[y] = MCAir;
             }
         }
     }
+
+    for (int y = 54; y < *height - 4; y++) {
+        float result = samples ? samples->caves[y] : cdclassic_CaveNoise(noise, totalX, y, totalZ);
+
+        if (result > 0.45) {
+            column[y] = MCAir;
+        }
+    }
+
+    // update height map
+    for (int y = CD_Min(*height, 127); y > 0 && column[y] == MCAir; y--) {
+        *height = y;
+    }
 }
 
 static
 void
-cdclassic_DigCaves (MCChunk* chunk, int chunkX, int chunkZ)
+cdclassic_ErodeColumn (const snoise_context* noise, const CDClassicSamples* samples, uint8_t* column, uint8_t* height, int blockX, int blockZ)
 {
-    for (int x = 0; x < 16; x++) {
-        for (int z = 0; z < 16; z++) {
-            float totalX = ((((float) chunkX) * 16.0) + ((float) x));
-            float totalZ = ((((float) chunkZ) * 16.0) + ((float) z));
-
-            for (int y = 0; y < 54; y++) {
-                float result  = (snoise3(totalX / 12.0, y / 12.0, totalZ / 12.0)
-                    + (0.5 * snoise3(totalX / 24.0, y / 24.0, totalZ / 24.0))) / 1.5;
-
-                if (result > 0.35) {
-                    if (y < 16) {
-                        chunk->blocks[y + (z * 128) + (x * 128 * 16)] = MCLava;
-                    }
-                    else {
-                        chunk->blocks[y + (z * 128) + (x * 128 * 16)] = MCAir;
-                    }
-                }
-            }
+    float totalX = (float) blockX;
+    float totalZ = (float) blockZ;
 
-            for (int y = 54; y < chunk->heightMap[x + (z * 16)] - 4; y++) {
-                float result = (snoise3(totalX / 12.0, y / 12.0, totalZ / 12.0)
-                    + (0.5 * snoise3(totalX / 24.0, y / 24.0, totalZ / 24.0))) / 1.5;
+    // erosion (over ground)
+    for (int y = 65; y < *height; y++) {
+        float result = samples ? samples->erosion[y] : cdclassic_ErosionNoise(noise, totalX, y, totalZ);
 
-                if (result > 0.45) {
-                    chunk->blocks[y + (z * 128) + (x * 128 * 16)] = MCAir;
-                }
-            }
-
-            // update height map
-            for (int y = chunk->heightMap[x + (z * 16)]; y > 0 && chunk->blocks[y + (z * 128) + (x * 128 * 16)] == MCAir; y--) {
-                chunk->heightMap[x + (z * 16)] = y;
-            }
+        if (result > 0.50) {
+            // cave
+            column[y] = MCAir;
         }
     }
+
+    // update height map
+    int y = CD_Min(*height, 127);
+    while (y > 0 && column[y] == MCAir) {
+        *height = y--;
+    }
 }
 
 static
 void
-cdclassic_ErodeLandscape (MCChunk* chunk, int chunkX, int chunkZ)
+cdclassic_AddSedimentsColumn (uint8_t* column, uint8_t* height)
 {
-    for (int x = 0; x < 16; x++) {
-        for (int z = 0; z < 16; z++) {
-            float totalX = ((((float) chunkX) * 16.0) + ((float) x));
-            float totalZ = ((((float) chunkZ) * 16.0) + ((float) z));
-
-            // erosion (over ground)
-            for (int y = 65; y < chunk->heightMap[x + (z * 16)]; y++) {
-                float result = (snoise3(totalX / 40.0, y / 50.0, totalZ / 40.0)
-                    + (0.5 * snoise3(totalX / 80.0, y / 100.0, totalZ / 80.0))) / 1.5;
-
-                if (result > 0.50) {
-                    // cave
-                    chunk->blocks[y + (z * 128) + (x * 128 * 16)] = MCAir;
-                }
-            }
+    // replace top with grass / the higher, the less blocks / 0 to 3
+    int y              = *height;
+    int sedimentHeight = (128 - *height) / 21; // 0 - 3 blocks
 
-            // update height map
-            int y = chunk->heightMap[x + (z * 16)];
-            while (y > 0 && chunk->blocks[y + (z * 128) + (x * 128 * 16)] == MCAir) {
-                chunk->heightMap[x + (z * 16)] = y--;
-            }
+    if (y < 64) {
+        // sand underwater
+        memset(column + y, MCSand, CD_Max(sedimentHeight, 0));
+    }
+    else if (y >= 64 && sedimentHeight > 0) {
+        for (int i = 0; i < sedimentHeight - 1; i++, sedimentHeight--) {
+            column[y + i] = MCDirt;
         }
+
+        column[y + sedimentHeight - 1] = MCGrass;
     }
+
+    *height += sedimentHeight;
 }
 
 static
 void
-cdclassic_AddSediments (MCChunk* chunk, int chunkX, int chunkZ)
+cdclassic_FloodColumn (uint8_t* column, int8_t waterLevel)
 {
-    for (int x = 0; x < 16; x++) {
-        for (int z = 0; z < 16; z++) {
-            // step 3: replace top with grass / the higher, the less blocks / 0 to 3
-
-            int y              = chunk->heightMap[x + (z * 16)];
-            int sedimentHeight = (128 - chunk->heightMap[x + (z * 16)]) / 21; // 0 - 3 blocks
-
-            if (y < 64) {
-                for (int i = 0; i < sedimentHeight; i++) {
-                    // sand underwater
-                    chunk->blocks[y + (z * 128) + (x * 128 * 16) + i] = MCSand;
-                }
-            }
-            else if (y >= 64 && sedimentHeight > 0) {
-                for (int i = 0; i < sedimentHeight - 1; i++, sedimentHeight--) {
-                    chunk->blocks[y + (z * 128) + (x * 128 * 16) + i] = MCDirt;
-                }
-
-                chunk->blocks[y + (z * 128) + (x * 128 * 16) + sedimentHeight - 1] = MCGrass;
-            }
+    int y = waterLevel;
 
-            chunk->heightMap[x + (z * 16)] += sedimentHeight;
-        }
+    // flood every air block from the water level down to the first solid one
+    while (y >= 0 && column[y] == MCAir) {
+        y--;
     }
+
+    memset(column + y + 1, MCWater, waterLevel - y);
 }
 
 static
 void
-cdclassic_FloodWithWater (MCChunk* chunk, int chunkX, int chunkZ, int8_t waterLevel)
+cdclassic_BedrockColumn (uint8_t* column, uint8_t* height)
 {
-    for (int x = 0; x < 16; x++) {
-        for (int z = 0; z < 16; z++) {
-            // step 4: flood with water at level 64
-            for (int y = waterLevel; chunk->blocks[y + (z * 128) + (x * 128 * 16)] == MCAir; y--) {
-                chunk->blocks[y + (z * 128) + (x * 128 * 16)] = MCWater;
-            }
-        }
-    }
+    column[0] = MCBedrock;
+    column[1] = MCBedrock;
+    *height   = CD_Max(*height, 2);
 }
 
 static
 void
-cdclassic_BedrockGround (MCChunk* chunk, int chunkX, int chunkZ)
+cdclassic_SkyLightColumn (uint8_t* light, uint8_t height)
 {
-    for (int x = 0; x < 16; x++) {
-        for (int z = 0; z < 16; z++) {
-            chunk->blocks[0 + (z * 128) + (x*128*16)] = MCBedrock;
-            chunk->blocks[1 + (z * 128) + (x*128*16)] = MCBedrock;
-            chunk->heightMap[x+(z * 16)]              = CD_Max(chunk->heightMap[x + (z * 16)], 2);
-        }
+    int lit = CD_Min(height, 128);
+
+    // two blocks per byte, the odd block of each pair is in the high nibble
+    memset(light, 0x00, lit / 2);
+
+    if (lit % 2) {
+        light[lit / 2] = 0xF0;
+        lit++;
     }
+
+    memset(light + (lit / 2), 0xFF, (128 - lit) / 2);
 }
 
 static
 void
-cdclassic_AddMineral (MCChunk* chunk, int x, int z, int y, float totalX, float totalZ, float totalY, MCBlockType blockType, float probability)
+cdclassic_AddMineral (const snoise_context* noise, const CDClassicSamples* samples, uint8_t* column, int y, float totalX, float totalZ, float totalY, size_t mineral, float probability)
 {
-    if (snoise4(totalX, totalY, totalZ, blockType) + 1.0 <= (0.25 * probability)) {
-        chunk->blocks[y + (z * 128) + (x * 128 * 16)] = blockType;
+    MCBlockType blockType = cdclassic_Minerals[mineral];
+    float       value     = samples ? samples->minerals[mineral][y] : cdclassic_MineralNoise(noise, totalX, totalY, totalZ, blockType);
+
+    if (value + 1.0 <= (0.25 * probability)) {
+        column[y] = blockType;
     }
 }
 
 static
 void
-cdclassic_AddMinerals (MCChunk* chunk, int chunkX, int chunkZ)
+cdclassic_AddMineralsColumn (const snoise_context* noise, const CDClassicSamples* samples, uint8_t* column, uint8_t height, int blockX, int blockZ)
 {
-    for (int x = 0; x < 16; x++) {
-        float totalX = ((((float) chunkX) * 16.0) + ((float) x)) * 0.075;
-
-        for (int z = 0; z < 16; z++) {
-            float totalZ = ((((float) chunkZ) * 16.0) + ((float) z)) * 0.075;
+    float totalX = ((float) blockX) * 0.075;
+    float totalZ = ((float) blockZ) * 0.075;
 
-            for (int y = 2; y < chunk->heightMap[x + (z * 16)]; y++) {
-                if (chunk->blocks[y + (z * 128) + (x * 128 * 16)] == MCAir) {
-                    continue;
-                }
+    for (int y = 2; y < height; y++) {
+        if (column[y] == MCAir) {
+            continue;
+        }
 
-                float totalY = (((float) y)) * 0.075;
+        float totalY = (((float) y)) * 0.075;
 
-                cdclassic_AddMineral(chunk, x, z, y, totalX, totalZ, totalY, MCCoalOre, 1.3);
-                cdclassic_AddMineral(chunk, x, z, y, totalX, totalZ, totalY, MCDirt, 2.5);
-                cdclassic_AddMineral(chunk, x, z, y, totalX, totalZ, totalY, MCGravel, 2.5);
+        cdclassic_AddMineral(noise, samples, column, y, totalX, totalZ, totalY, 0, 1.3);  // coal
+        cdclassic_AddMineral(noise, samples, column, y, totalX, totalZ, totalY, 1, 2.5);  // dirt
+        cdclassic_AddMineral(noise, samples, column, y, totalX, totalZ, totalY, 2, 2.5);  // gravel
 
-                // 5 blocks under the surface
-                if (y < chunk->heightMap[x + (z * 16)] - 5) {
-                    cdclassic_AddMineral(chunk, x, z, y, totalX, totalZ, totalY, MCIronOre, 1.15);
-                }
+        // 5 blocks under the surface
+        if (y < height - 5) {
+            cdclassic_AddMineral(noise, samples, column, y, totalX, totalZ, totalY, 3, 1.15); // iron
+        }
 
-                if (y < 40) {
-                    cdclassic_AddMineral(chunk, x, z, y, totalX, totalZ, totalY, MCLapisLazuliOre, 0.80);
-                    cdclassic_AddMineral(chunk, x, z, y, totalX, totalZ, totalY, MCGoldOre, 0.85);
-                }
+        if (y < 40) {
+            cdclassic_AddMineral(noise, samples, column, y, totalX, totalZ, totalY, 4, 0.80); // lapis lazuli
+            cdclassic_AddMineral(noise, samples, column, y, totalX, totalZ, totalY, 5, 0.85); // gold
+        }
 
-                if (y < 20) {
-                    cdclassic_AddMineral(chunk, x, z, y, totalX, totalZ, totalY, MCDiamondOre, 0.80);
-                    cdclassic_AddMineral(chunk, x, z, y, totalX, totalZ, totalY, MCRedstoneOre, 1.2);
-                }
-            }
+        if (y < 20) {
+            cdclassic_AddMineral(noise, samples, column, y, totalX, totalZ, totalY, 6, 0.80); // diamond
+            cdclassic_AddMineral(noise, samples, column, y, totalX, totalZ, totalY, 7, 1.2);  // redstone
         }
     }
 }
+
+/**
+ * Run every generation pass on one column, in the same order the passes used to run
+ * on the whole chunk. Columns don't depend on each other so the result is the same.
+ *
+ * samples is NULL for exact generation, otherwise the noise is read from it.
+ */
+static
+void
+cdclassic_GenerateColumn (const snoise_context* noise, const CDClassicSamples* samples, MCChunk* chunk, int chunkX, int chunkZ, int x, int z)
+{
+    uint8_t* column = cdclassic_ColumnBlocks(chunk, x, z);
+    uint8_t* height = &chunk->heightMap[x + (z * 16)];
+    int      blockX = (chunkX * 16) + x;
+    int      blockZ = (chunkZ * 16) + z;
+
+    cdclassic_GenerateHeight(noise, samples, height, blockX, blockZ);
+    cdclassic_FillColumn(column, *height, MCStone);
+    cdclassic_DigCavesColumn(noise, samples, column, height, blockX, blockZ);
+    cdclassic_ErodeColumn(noise, samples, column, height, blockX, blockZ);
+    cdclassic_AddMineralsColumn(noise, samples, column, *height, blockX, blockZ);
+    cdclassic_AddSedimentsColumn(column, height);
+    cdclassic_FloodColumn(column, 64);
+    cdclassic_BedrockColumn(column, height);
+    cdclassic_SkyLightColumn(cdclassic_ColumnSkyLight(chunk, x, z), *height);
+}
@@ -23,6 +23,8 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define CRAFTD_LOG_SUBSYSTEM CDLogPlugins
+
 #include <craftd/Server.h>
 #include <craftd/Plugin.h>
 
@@ -31,9 +33,92 @@
 
 static struct {
     const char* seed;
+
+    struct {
+        bool enabled;
+        int  size;
+    } cache;
 } _config;
 
+static struct {
+    CDHash*         contexts;
+    pthread_mutex_t lock;
+} _noise;
+
 #include "helpers.c"
+#include "cache.c"
+
+typedef struct _CDClassicNoise {
+    snoise_context context;
+
+    CDClassicCache* cache;
+} CDClassicNoise;
+
+/**
+ * Hash a seed string into the integer seed for the noise tables (32 bit FNV-1a).
+ */
+static
+uint32_t
+cdclassic_SeedToInteger (const char* seed)
+{
+    uint32_t result = 2166136261u;
+
+    for (const char* current = seed; *current != '\0'; current++) {
+        result ^= (uint8_t) *current;
+        result *= 16777619u;
+    }
+
+    return result;
+}
+
+/**
+ * Get the noise context for a world, the seed is taken from the parameter, the world
+ * config or the plugin config, in that order.
+ *
+ * Contexts are created once per seed and are never modified afterwards, so they can
+ * be used by every worker at the same time.
+ *
+ * If the world has the noise cache enabled, the cache for the seed is put in cache,
+ * otherwise it's set to NULL.
+ */
+static
+const snoise_context*
+cdclassic_GetNoise (CDWorld* world, const char* seed, CDClassicCache** cache)
+{
+    CDClassicNoise* result;
+    bool            cached = _config.cache.enabled;
+
+    J_DO {
+        if (seed == NULL) {
+            J_STRING(world->config, "seed", seed);
+        }
+
+        J_BOOL(world->config, "cache", cached);
+    }
+
+    if (seed == NULL) {
+        seed = _config.seed;
+    }
+
+    pthread_mutex_lock(&_noise.lock);
+    if ((result = (CDClassicNoise*) CD_HashGet(_noise.contexts, seed)) == NULL) {
+        result = CD_memalign(64, sizeof(CDClassicNoise));
+
+        snoise_init(&result->context, cdclassic_SeedToInteger(seed));
+        result->cache = NULL;
+
+        CD_HashPut(_noise.contexts, seed, (CDPointer) result);
+    }
+
+    if (cached && !result->cache) {
+        result->cache = cdclassic_CreateCache(&result->context, _config.cache.size);
+    }
+
+    *cache = cached ? result->cache : NULL;
+    pthread_mutex_unlock(&_noise.lock);
+
+    return &result->context;
+}
 
 static
 bool
@@ -56,21 +141,34 @@ static
 bool
 cdclassic_GenerateChunk (CDServer* server, CDWorld* world, int x, int z, MCChunk* data, const char* seed)
 {
-    memset(data, 0, sizeof(*data));
+    CDClassicCache*       cache;
+    const snoise_context* noise = cdclassic_GetNoise(world, seed, &cache);
 
-    if (seed == NULL) {
-        seed = _config.seed;
-    }
+    // blocks, sky light and height map are completely written by the column passes
+    memset(&data->position, 0, sizeof(data->position));
+    memset(data->data, 0, sizeof(data->data));
+    memset(data->blockLight, 0, sizeof(data->blockLight));
 
-    cdclassic_GenerateHeightMap(data, x, z);
-    cdclassic_GenerateFilledChunk(data, x, z, MCStone);
-    cdclassic_DigCaves(data, x, z);
-    cdclassic_ErodeLandscape(data, x, z);
-    cdclassic_AddMinerals(data, x, z);
-    cdclassic_AddSediments(data, x, z);
-    cdclassic_FloodWithWater(data, x, z, 64);
-    cdclassic_BedrockGround(data, x, z);
-    cdclassic_GenerateSkyLight(data, x, z);
+    if (cache) {
+        CDClassicLatticeColumn lattice[CDCLASSIC_LATTICE_WIDTH][CDCLASSIC_LATTICE_WIDTH];
+        CDClassicSamples       samples;
+
+        cdclassic_CacheFetchChunk(cache, x, z, lattice);
+
+        for (int columnX = 0; columnX < 16; columnX++) {
+            for (int columnZ = 0; columnZ < 16; columnZ++) {
+                cdclassic_InterpolateSamples(lattice, columnX, columnZ, &samples);
+                cdclassic_GenerateColumn(noise, &samples, data, x, z, columnX, columnZ);
+            }
+        }
+    }
+    else {
+        for (int columnX = 0; columnX < 16; columnX++) {
+            for (int columnZ = 0; columnZ < 16; columnZ++) {
+                cdclassic_GenerateColumn(noise, NULL, data, x, z, columnX, columnZ);
+            }
+        }
+    }
 
     return true;
 }
@@ -84,11 +182,27 @@ CD_PluginInitialize (CDPlugin* self)
     DO { // Initiailize config cache
         _config.seed = "^_^";
 
+        _config.cache.enabled = false;
+        _config.cache.size    = 4096;
+
         J_DO {
             J_STRING(self->config, "seed", _config.seed);
+
+            J_IN(cache, self->config, "cache") {
+                J_BOOL(cache, "enabled", _config.cache.enabled);
+                J_INT(cache, "size",     _config.cache.size);
+            }
         }
+
+        // The raw config goes away on reload
+        _config.seed = strdup(_config.seed);
     }
 
+    cdclassic_MultifractalExponents(_heightExponents, CDCLASSIC_HEIGHT_LACUNARITY, CDCLASSIC_HEIGHT_OCTAVES);
+    cdclassic_CacheInitialize();
+
+    _noise.contexts = CD_CreateHash();
+    pthread_mutex_init(&_noise.lock, NULL);
 
     CD_EventRegister(self->server, "Mapgen.level", cdclassic_GenerateLevel);
     CD_EventRegister(self->server, "Mapgen.chunk", cdclassic_GenerateChunk);
@@ -103,5 +217,20 @@ CD_PluginFinalize (CDPlugin* self)
     CD_EventUnregister(self->server, "Mapgen.level", cdclassic_GenerateLevel);
     CD_EventUnregister(self->server, "Mapgen.chunk", cdclassic_GenerateChunk);
 
+    CD_free((void*) _config.seed);
+
+    CD_HASH_FOREACH(_noise.contexts, it) {
+        CDClassicNoise* noise = (CDClassicNoise*) CD_HashIteratorValue(it);
+
+        if (noise->cache) {
+            cdclassic_DestroyCache(noise->cache);
+        }
+
+        CD_free(noise);
+    }
+
+    CD_DestroyHash(_noise.contexts);
+    pthread_mutex_destroy(&_noise.lock);
+
     return true;
 }
@@ -29,9 +29,26 @@
  * on some platforms. Having both versions could be useful.
  */
 
+#ifndef SIMPLEXNOISE1234_H
+#define SIMPLEXNOISE1234_H
+
+/** Noise context, holds the seeded permutation table.
+ *  Aligned on a cache line, and read-only once initialised, so a single
+ *  context can be shared by any number of threads.
+ */
+    typedef struct snoise_context {
+        unsigned char perm[512];
+    } __attribute__((aligned(64))) snoise_context;
+
+/** Initialise a context for the given seed, seed 0 gives the reference table
+ */
+    void snoise_init( snoise_context* ctx, unsigned int seed );
+
 /** 1D, 2D, 3D and 4D float Perlin simplex noise
  */
-    float snoise1( float x );
-    float snoise2( float x, float y );
-    float snoise3( float x, float y, float z );
-    float snoise4( float x, float y, float z, float w );
+    float snoise1( const snoise_context* ctx, float x );
+    float snoise2( const snoise_context* ctx, float x, float y );
+    float snoise3( const snoise_context* ctx, float x, float y, float z );
+    float snoise4( const snoise_context* ctx, float x, float y, float z, float w );
+
+#endif
@@ -23,6 +23,8 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define CRAFTD_LOG_SUBSYSTEM CDLogPlugins
+
 #include <craftd/Server.h>
 #include <craftd/Plugin.h>
 
@@ -23,6 +23,8 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define CRAFTD_LOG_SUBSYSTEM CDLogPlugins
+
 #include <sys/stat.h>
 #include <fcntl.h>
 
@@ -278,6 +280,9 @@ CD_PluginInitialize (CDPlugin* self)
             J_STRING(self->config, "path", _config.path);
             J_INT(self->config, "base", _config.base);
         }
+
+        // The raw config goes away on reload
+        _config.path = strdup(_config.path);
     }
 
     CD_EventRegister(self->server, "World.create",  cdnbt_WorldCreate);
@@ -299,5 +304,7 @@ CD_PluginFinalize (CDPlugin* self)
     CD_EventUnregister(self->server, "World.save",    cdnbt_WorldSave);
     CD_EventUnregister(self->server, "World.destroy", cdnbt_WorldDestroy);
 
+    CD_free((void*) _config.path);
+
     return true;
 }
@@ -30,6 +30,114 @@
 #include <beta/World.h>
 #include <beta/Region.h>
 #include <beta/Player.h>
+#include <beta/ChunkSet.h>
+
+typedef struct _CDBetaChunkStream {
+    z_stream stream;
+    MCChunk  chunk;
+} CDBetaChunkStream;
+
+static
+void
+cdbeta_DestroyChunkStream (CDBetaChunkStream* self)
+{
+    deflateEnd(&self->stream);
+
+    CD_free(self);
+}
+
+/**
+ * Thread exit destructor, the stream is only destroyed if it's still in the
+ * registry, otherwise the plugin finalizer already took care of it
+ */
+static
+void
+cdbeta_ReleaseChunkStream (CDBetaChunkStream* self)
+{
+    if (CD_ListDelete(_compression.streams, (CDPointer) self)) {
+        cdbeta_DestroyChunkStream(self);
+    }
+}
+
+/**
+ * Get the deflate stream and chunk scratch space of the calling thread, they're
+ * created on first use and reused for every chunk sent after that
+ */
+static
+CDBetaChunkStream*
+cdbeta_GetChunkStream (void)
+{
+    CDBetaChunkStream* self = pthread_getspecific(_compression.stream);
+
+    if (self) {
+        deflateReset(&self->stream);
+
+        return self;
+    }
+
+    self = CD_alloc(sizeof(CDBetaChunkStream));
+
+    if (deflateInit(&self->stream, _config.compression) != Z_OK) {
+        CD_free(self);
+
+        return NULL;
+    }
+
+    pthread_setspecific(_compression.stream, self);
+
+    CD_ListPush(_compression.streams, (CDPointer) self);
+
+    return self;
+}
+
+/**
+ * Deflate the chunk arrays in wire order straight into space reserved at the
+ * end of the output buffer
+ */
+static
+bool
+cdbeta_DeflateChunk (z_stream* stream, MCChunk* chunk, CDBuffer* output)
+{
+    struct {
+        Bytef* data;
+        uInt   length;
+    } input[] = {
+        { chunk->blocks,     sizeof(chunk->blocks) },
+        { chunk->data,       sizeof(chunk->data) },
+        { chunk->blockLight, sizeof(chunk->blockLight) },
+        { chunk->skyLight,   sizeof(chunk->skyLight) }
+    };
+
+    int result = Z_OK;
+
+    for (size_t i = 0; i < 4; i++) {
+        int flush = (i == 3) ? Z_FINISH : Z_NO_FLUSH;
+
+        stream->next_in  = input[i].data;
+        stream->avail_in = input[i].length;
+
+        do {
+            struct evbuffer_iovec vector;
+
+            if (evbuffer_reserve_space(output->raw, 16384, &vector, 1) < 1) {
+                return false;
+            }
+
+            stream->next_out  = vector.iov_base;
+            stream->avail_out = vector.iov_len;
+
+            if ((result = deflate(stream, flush)) == Z_STREAM_ERROR) {
+                return false;
+            }
+
+            vector.iov_len -= stream->avail_out;
+
+            evbuffer_commit_space(output->raw, &vector, 1);
+        } while (stream->avail_out == 0);
+    }
+
+    return result == Z_STREAM_END;
+}
 
 static
 bool
@@ -51,36 +159,36 @@ cdbeta_SendChunk (CDServer* server, CDPlayer* player, MCChunkPosition* coord)
     DO {
         SDEBUG(server, "sending chunk (%d, %d)", coord->x, coord->z);
 
-        MCChunk* chunk = CD_malloc(sizeof(MCChunk));
-        CDError  status;
+        CDBetaChunkStream* stream = cdbeta_GetChunkStream();
+        CDError            status;
+        uint64_t           start  = CD_MetricsNow();
 
-        CD_EventDispatchWithError(status, server, "World.chunk", player->world, coord->x, coord->z, chunk);
+        if (!stream) {
+            SERR(server, "zlib deflateInit failure");
 
-        if (status != CDOk) {
-            CD_free(chunk);
+            return false;
+        }
+
+        CD_EventDispatchWithError(status, server, "World.chunk", player->world, coord->x, coord->z, &stream->chunk);
 
+        if (status != CDOk) {
             return false;
         }
 
-        uLongf written = compressBound(81920);
-        Bytef* buffer  = CD_malloc(written);
-        Bytef* data    = CD_malloc(81920);
-            
-        MC_ChunkToByteArray(chunk, data);
+        CDBuffer* buffer = CD_CreateBuffer();
 
-        if (compress(buffer, &written, (Bytef*) data, 81920) != Z_OK) {
+        if (!cdbeta_DeflateChunk(&stream->stream, &stream->chunk, buffer)) {
             SERR(server, "zlib compress failure");
 
-            CD_free(chunk);
-            CD_free(data);
+            CD_DestroyBuffer(buffer);
 
             return false;
         }
 
-        SDEBUG(server, "compressed to %ld bytes", written);
+        SDEBUG(server, "compressed to %zu bytes", CD_BufferLength(buffer));
 
-        CD_free(chunk);
-        CD_free(data);
+        CD_MetricAdd(_metrics.chunks, 1);
+        CD_MetricAdd(_metrics.bytes, CD_BufferLength(buffer));
 
         CDPacketMapChunk pkt = {
             .response = {
@@ -92,14 +200,16 @@ cdbeta_SendChunk (CDServer* server, CDPlayer* player, MCChunkPosition* coord)
                     .z = 16
                 },
 
-                .length = written,
-                .item   = (MCByte*) buffer
+                .length = CD_BufferLength(buffer),
+                .buffer = buffer
             }
         };
 
         CDPacket response = { CDResponse, CDMapChunk, (CDPointer) &pkt };
 
         CD_PlayerSendPacketAndCleanData(player, &response);
+
+        CD_MetricObserve(_metrics.latency, CD_MetricsNow() - start);
     }
 
     return true;
@@ -107,16 +217,15 @@ cdbeta_SendChunk (CDServer* server, CDPlayer* player, MCChunkPosition* coord)
 
 static
 void
-cdbeta_ChunkRadiusUnload (CDSet* self, MCChunkPosition* coord, CDPlayer* player)
+cdbeta_ChunkRadiusUnload (MCChunkSet* self, MCChunkPosition coord, CDPlayer* player)
 {
     assert(self);
-    assert(coord);
     assert(player);
 
     DO {
         CDPacketPreChunk pkt = {
             .response = {
-                .position = *coord,
+                .position = coord,
                 .mode = false
             }
         };
@@ -125,62 +234,26 @@ cdbeta_ChunkRadiusUnload (CDSet* self, MCChunkPosition* coord, CDPlayer* player)
 
         CD_PlayerSendPacketAndCleanData(player, &response);
     }
-
-    CD_free(coord);
-}
-
-static
-void
-cdbeta_ChunkMemberFree (CDSet* self, MCChunkPosition* coord, void* _)
-{
-    assert(self);
-    assert(coord);
-
-    CD_free(coord);
 }
 
 static
 void
-cdbeta_ChunkRadiusLoad (CDSet* self, MCChunkPosition* coord, CDPlayer* player)
+cdbeta_ChunkRadiusLoad (MCChunkSet* self, MCChunkPosition coord, CDPlayer* player)
 {
     assert(self);
-    assert(coord);
     assert(player);
 
-    cdbeta_SendChunk(player->client->server, player, coord);
+    cdbeta_SendChunk(player->client->server, player, &coord);
 }
 
 static
 void
 cdbeta_SendChunkRadius (CDPlayer* player, MCChunkPosition* area, int radius)
 {
-    CDSet* loadedChunks = (CDSet*) CD_DynamicGet(player, "Player.loadedChunks");
-    CDSet* oldChunks    = loadedChunks;
-    CDSet* newChunks    = CD_CreateSetWith(400, (CDSetCompare) MC_CompareChunkPosition, (CDSetHash) MC_HashChunkPosition);
-
-    for (int x = -radius; x < radius; x++) {
-        for (int z = -radius; z < radius; z++) {
-            if ((x * x + z * z) <= (radius * radius)) {
-                MCChunkPosition* coord = CD_malloc(sizeof(MCChunkPosition));
-                coord->x          = x + area->x;
-                coord->z          = z + area->z;
-
-                CD_SetPut(newChunks, (CDPointer) coord);
-            }
-        }
-    }
-
-    CDSet* toRemove = CD_SetMinus(oldChunks, newChunks);
-    CDSet* toAdd    = CD_SetMinus(newChunks, oldChunks);
+    MCChunkSet* loadedChunks = (MCChunkSet*) CD_DynamicGetSlot(player, MCSlotPlayerLoadedChunks);
 
-    CD_SetMap(toRemove, (CDSetApply) cdbeta_ChunkRadiusUnload, (CDPointer) player);
-    CD_SetMap(toAdd, (CDSetApply) cdbeta_ChunkRadiusLoad, (CDPointer) player);
-
-    CD_DestroySet(toRemove);
-    CD_DestroySet(toAdd);
-    CD_DestroySet(oldChunks);
-
-    CD_DynamicPut(player, "Player.loadedChunks", (CDPointer) newChunks);
+    MC_ChunkSetMoveRadius(loadedChunks, *area, radius,
+        (MCChunkSetApply) cdbeta_ChunkRadiusUnload, (MCChunkSetApply) cdbeta_ChunkRadiusLoad, (CDPointer) player);
 }
 
 static
@@ -225,15 +298,17 @@ static
 void
 cdbeta_SendPacketToAllInRegion(CDPlayer *player, CDPacket *pkt)
 {
-  CDList *seenPlayers = (CDList *) CD_DynamicGet(player, "Player.seenPlayers");
+  CDVector *seenPlayers = (CDVector *) CD_DynamicGetSlot(player, MCSlotPlayerSeenPlayers);
 
-  CD_LIST_FOREACH(seenPlayers, it)
+  pthread_rwlock_rdlock(&player->world->lock.seen);
+  CD_VECTOR_FOREACH(seenPlayers, i)
   {
-    if ( player != (CDPlayer *) CD_ListIteratorValue(it) )
-      CD_PlayerSendPacket( (CDPlayer *) CD_ListIteratorValue(it), pkt );
+    if ( player != (CDPlayer *) CD_VectorGet(seenPlayers, i) )
+      CD_PlayerSendPacket( (CDPlayer *) CD_VectorGet(seenPlayers, i), pkt );
     else
       CERR("We have a player with himself in the List????");
   }
+  pthread_rwlock_unlock(&player->world->lock.seen);
 }
 
 static
@@ -374,10 +449,13 @@ static
 void
 cdbeta_CheckPlayersInRegion (CDServer* server, CDPlayer* player, MCChunkPosition *coord, int radius)
 {
-    CDList* seenPlayers = (CDList*) CD_DynamicGet(player, "Player.seenPlayers");;
+    CDVector* seenPlayers = (CDVector*) CD_DynamicGetSlot(player, MCSlotPlayerSeenPlayers);
 
+    // the players hash is read locked for the whole walk, so nobody in it can go away while we send to them
     CD_HASH_FOREACH(player->world->players, it) {
         CDPlayer* otherPlayer = (CDPlayer *) CD_HashIteratorValue(it);
+        bool      spawned     = false;
+        bool      destroyed   = false;
 
         // If we are the player to check just skip
         if (otherPlayer == player) {
@@ -385,31 +463,44 @@ cdbeta_CheckPlayersInRegion (CDServer* server, CDPlayer* player, MCChunkPosition
         }
 
         MCChunkPosition chunkPos = MC_PrecisePositionToChunkPosition(otherPlayer->entity.position);
+        bool            inRange  = cdbeta_CoordInRadius(&chunkPos, coord, radius);
+
+        // only the seen lists are changed under the lock, the packets go out after it's released
+        pthread_rwlock_wrlock(&player->world->lock.seen);
+        DO {
+            CDVector* otherSeenPlayers = (CDVector *) CD_DynamicGetSlot(otherPlayer, MCSlotPlayerSeenPlayers);
+
+            // the other player is logging out
+            if (!otherSeenPlayers) {
+                break;
+            }
 
-        if (cdbeta_CoordInRadius(&chunkPos, coord, radius)) {
             /* If the player is in range, but not in the list. */
-            if (!CD_ListContains(seenPlayers, (CDPointer) otherPlayer)) {
-                CD_ListPush(seenPlayers, (CDPointer) otherPlayer);
-                cdbeta_SendNamedPlayerSpawn(player, otherPlayer);
+            if (inRange && !CD_VectorContains(seenPlayers, (CDPointer) otherPlayer)) {
+                CD_VectorPush(seenPlayers, (CDPointer) otherPlayer);
+                CD_VectorPush(otherSeenPlayers, (CDPointer) player);
 
-                CDList *otherSeenPlayers = (CDList *) CD_DynamicGet(otherPlayer, "Player.seenPlayers");
-                CD_ListPush(otherSeenPlayers, (CDPointer) player);
-                cdbeta_SendNamedPlayerSpawn(otherPlayer, player);
+                spawned = true;
             }
-        }
-        else {
             /* If the player is out of range but in the list */
-            if (CD_ListContains(seenPlayers, (CDPointer) otherPlayer)) {
-                CDList *otherSeenPlayers = (CDList *) CD_DynamicGet(otherPlayer, "Player.seenPlayers");
-
-                CD_ListDeleteAll(seenPlayers, (CDPointer) otherPlayer);
-                CD_ListDeleteAll(otherSeenPlayers, (CDPointer) player);
+            else if (!inRange && CD_VectorContains(seenPlayers, (CDPointer) otherPlayer)) {
+                CD_VectorFastDelete(seenPlayers, (CDPointer) otherPlayer);
+                CD_VectorFastDelete(otherSeenPlayers, (CDPointer) player);
 
-                /* Should send both players an update. */
-                cdbeta_SendDestroyEntity(player, &otherPlayer->entity);
-                cdbeta_SendDestroyEntity(otherPlayer, &player->entity);
+                destroyed = true;
             }
         }
+        pthread_rwlock_unlock(&player->world->lock.seen);
+
+        if (spawned) {
+            cdbeta_SendNamedPlayerSpawn(player, otherPlayer);
+            cdbeta_SendNamedPlayerSpawn(otherPlayer, player);
+        }
+        else if (destroyed) {
+            /* Should send both players an update. */
+            cdbeta_SendDestroyEntity(player, &otherPlayer->entity);
+            cdbeta_SendDestroyEntity(otherPlayer, &player->entity);
+        }
     }
 }
 
@@ -418,13 +509,13 @@ bool
 cdbeta_ClientProcess (CDServer* server, CDClient* client, CDPacket* packet)
 {
     CDWorld*  world;
-    CDPlayer* player = (CDPlayer*) CD_DynamicGet(client, "Client.player");
+    CDPlayer* player = (CDPlayer*) CD_DynamicGetSlot(client, MCSlotClientPlayer);
 
     if (player && player->world) {
         world = player->world;
     }
     else {
-        world = (CDWorld*) CD_DynamicGet(server, "World.default");
+        world = (CDWorld*) CD_DynamicGetSlot(server, MCSlotWorldDefault);
     }
 
     switch (packet->type) {
@@ -447,10 +538,27 @@ cdbeta_ClientProcess (CDServer* server, CDClient* client, CDPacket* packet)
                 return false;
             }
 
+            // the player starts above the spawn, the entity has to be seeded there
+            DO {
+                MCPrecisePosition spawn = MC_BlockPositionToPrecisePosition(world->spawnPosition);
+
+                player->entity.position = (MCPrecisePosition) { spawn.x, spawn.y + 6, spawn.z };
+            }
+
+            if (!CD_WorldAddEntity(world, &player->entity, (CDPointer) player)) {
+                pthread_mutex_unlock(&_lock.login);
+
+                CD_ServerKick(server, client, CD_CreateStringFromCString("The world is full"));
+
+                return false;
+            }
+
             if (CD_HashHasKey(world->players, CD_StringContent(data->request.username))) {
                 SLOG(server, LOG_NOTICE, "%s: nick exists on the server", CD_StringContent(data->request.username));
 
                 if (server->config->cache.game.standard) {
+                    CD_WorldRemoveEntity(world, &player->entity);
+
                     CD_ServerKick(server, client, CD_CreateStringFromFormat("%s nick already exists",
                         CD_StringContent(data->request.username)));
 
@@ -469,7 +577,6 @@ cdbeta_ClientProcess (CDServer* server, CDClient* client, CDPacket* packet)
             player->world = world;
 
             CD_HashPut(world->players, CD_StringContent(player->username), (CDPointer) player);
-            CD_MapPut(world->entities, player->entity.id, (CDPointer) player);
 
             pthread_mutex_unlock(&_lock.login);
 
@@ -519,16 +626,12 @@ cdbeta_ClientProcess (CDServer* server, CDClient* client, CDPacket* packet)
             }
 
             DO {
-                MCPrecisePosition pos = MC_BlockPositionToPrecisePosition(world->spawnPosition);
+                MCPrecisePosition pos = player->entity.position;
                 CDPacketPlayerMoveLook pkt = {
                     .response = {
-                        .position = {
-                            .x = pos.x,
-                            .y = pos.y + 6,
-                            .z = pos.z
-                        },
+                        .position = pos,
 
-                        .stance = pos.y + 6.1,
+                        .stance = pos.y + 0.1,
                         .yaw    = 0,
                         .pitch  = 0,
 
@@ -559,7 +662,7 @@ cdbeta_ClientProcess (CDServer* server, CDClient* client, CDPacket* packet)
 
             player = CD_CreatePlayer(client);
 
-            CD_DynamicPut(client, "Client.player", (CDPointer) player);
+            CD_DynamicPutSlot(client, MCSlotClientPlayer, (CDPointer) player);
 
             CDPacket response = { CDResponse, CDHandshake, (CDPointer) &pkt };
 
@@ -575,7 +678,20 @@ cdbeta_ClientProcess (CDServer* server, CDClient* client, CDPacket* packet)
 
             if (CD_StringStartWith(data->request.message, _config.commandChar)) {
                 CDString* commandString = CD_CreateStringFromOffset(data->request.message, 1, 0);
-                CD_EventDispatch(server, "Player.command", player, commandString);
+
+                switch (CD_CommandsDispatch(server->commands, (CDPointer) player, commandString)) {
+                    case CDCommandNotFound: {
+                        CD_EventDispatch(server, "Player.command", player, commandString);
+                    } break;
+
+                    case CDCommandDenied: {
+                        CD_PlayerSendMessage(player, MC_StringColor(CD_CreateStringFromCString(
+                            "Authorization level not enough"), MCColorDarkRed));
+                    } break;
+
+                    default: break;
+                }
+
                 CD_DestroyString(commandString);
             }
             else {
@@ -605,6 +721,8 @@ cdbeta_ClientProcess (CDServer* server, CDClient* client, CDPacket* packet)
             cdbeta_SendUpdatePos(player, &data->request.position, false, 0, 0);
 
             player->entity.position = data->request.position;
+
+            MC_EntityTableSetPosition(world->entities, player->entity.id, data->request.position);
         } break;
 
         case CDPlayerLook: {
@@ -648,6 +766,8 @@ cdbeta_ClientProcess (CDServer* server, CDClient* client, CDPacket* packet)
             player->entity.position = data->request.position;
             player->yaw             = data->request.yaw;
             player->pitch           = data->request.pitch;
+
+            MC_EntityTableSetPosition(world->entities, player->entity.id, data->request.position);
         } break;
 
         case CDDisconnect: {
@@ -707,11 +827,16 @@ cdbeta_PlayerLogin (CDServer* server, CDPlayer* player, int status)
     CD_WorldBroadcastMessage(player->world, MC_StringColor(CD_CreateStringFromFormat("%s has joined the game",
                 CD_StringContent(player->username)), MCColorYellow));
 
+    if (CD_HTTPdIsStreaming(server->httpd)) {
+        CD_HTTPdPublish(server->httpd, "player.join", json_pack("{s:s, s:i}",
+            "name", CD_StringContent(player->username),
+            "id",   player->entity.id));
+    }
 
-    CD_DynamicPut(player, "Player.loadedChunks", (CDPointer) CD_CreateSetWith(
-        400, (CDSetCompare) MC_CompareChunkPosition, (CDSetHash) MC_HashChunkPosition));
 
-    CD_DynamicPut(player, "Player.seenPlayers", (CDPointer) CD_CreateList());
+    CD_DynamicPutSlot(player, MCSlotPlayerLoadedChunks, (CDPointer) MC_CreateChunkSet(400));
+
+    CD_DynamicPutSlot(player, MCSlotPlayerSeenPlayers, (CDPointer) CD_CreateVector());
 
     MCChunkPosition playerChunk = MC_PrecisePositionToChunkPosition(player->entity.position);
 
@@ -727,26 +852,35 @@ cdbeta_PlayerLogout (CDServer* server, CDPlayer* player)
     CD_WorldBroadcastMessage(player->world, MC_StringColor(CD_CreateStringFromFormat("%s has left the game",
         CD_StringContent(player->username)), MCColorYellow));
 
-    CDList* seenPlayers = (CDList*) CD_DynamicDelete(player, "Player.seenPlayers");
+    if (CD_HTTPdIsStreaming(server->httpd)) {
+        CD_HTTPdPublish(server->httpd, "player.leave", json_pack("{s:s, s:i}",
+            "name", CD_StringContent(player->username),
+            "id",   player->entity.id));
+    }
+
+    pthread_rwlock_wrlock(&player->world->lock.seen);
+    CDVector* seenPlayers = (CDVector*) CD_DynamicDeleteSlot(player, MCSlotPlayerSeenPlayers);
 
-    CD_LIST_FOREACH(seenPlayers, it) {
-        CDPlayer* other            = (CDPlayer*) CD_ListIteratorValue(it);
-        CDList*   otherSeenPlayers = (CDList*) CD_DynamicGet(other, "Player.seenPlayers");
+    CD_VECTOR_FOREACH(seenPlayers, i) {
+        CDPlayer* other            = (CDPlayer*) CD_VectorGet(seenPlayers, i);
+        CDVector* otherSeenPlayers = (CDVector*) CD_DynamicGetSlot(other, MCSlotPlayerSeenPlayers);
 
         cdbeta_SendDestroyEntity(other, &player->entity);
-        CD_ListDeleteAll(otherSeenPlayers, (CDPointer) player);
+        CD_VectorFastDelete(otherSeenPlayers, (CDPointer) player);
     }
+    pthread_rwlock_unlock(&player->world->lock.seen);
 
     CD_HashDelete(player->world->players, CD_StringContent(player->username));
-    CD_MapDelete(player->world->entities, player->entity.id);
+    CD_WorldRemoveEntity(player->world, &player->entity);
 
-    CD_DestroyList(seenPlayers);
+    if (seenPlayers) {
+        CD_DestroyVector(seenPlayers);
+    }
 
-    CDSet* chunks = (CDSet*) CD_DynamicDelete(player, "Player.loadedChunks");
+    MCChunkSet* chunks = (MCChunkSet*) CD_DynamicDeleteSlot(player, MCSlotPlayerLoadedChunks);
 
     if (chunks) {
-        CD_SetMap(chunks, (CDSetApply) cdbeta_ChunkMemberFree, CDNull);
-        CD_DestroySet(chunks);
+        MC_DestroyChunkSet(chunks);
     }
 
     return true;
@@ -756,7 +890,7 @@ static
 bool
 cdbeta_ClientDisconnect (CDServer* server, CDClient* client, bool status)
 {
-    CDPlayer* player = (CDPlayer*) CD_DynamicGet(client, "Client.player");
+    CDPlayer* player = (CDPlayer*) CD_DynamicGetSlot(client, MCSlotClientPlayer);
 
     if (player->world) {
         CD_EventDispatch(server, "Player.logout", player, status);
@@ -791,11 +925,12 @@ static
 bool
 cdbeta_PlayerCommand (CDServer* server, CDPlayer* player, CDString* command)
 {
-    CDRegexpMatches* matches = CD_RegexpMatchString("^(\\w+)(?:\\s+(.*?))?$", CDRegexpNone, command);
+    CDRegexp*        regexp = CD_GetRegexp("^(\\w+)(?:\\s+(.*?))?$", CDRegexpNone);
+    CDRegexpCaptures captures;
 
-    if (matches) {
-        CD_PlayerSendMessage(player, MC_StringColor(CD_CreateStringFromFormat("%s: unknown command",
-            CD_StringContent(matches->item[1])), MCColorRed));
+    if (regexp && CD_RegexpExec(regexp, CD_StringContent(command), CD_StringSize(command), &captures)) {
+        CD_PlayerSendMessage(player, MC_StringColor(CD_CreateStringFromFormat("%.*s: unknown command",
+            (int) CD_RegexpCaptureLength(&captures, 1), CD_RegexpCaptureStart(&captures, 1)), MCColorRed));
     }
 
     return false;
@@ -812,6 +947,12 @@ cdbeta_PlayerChat (CDServer* server, CDPlayer* player, CDString* message)
         CD_StringContent(player->username),
         CD_StringContent(message)));
 
+    if (CD_HTTPdIsStreaming(server->httpd)) {
+        CD_HTTPdPublish(server->httpd, "player.chat", json_pack("{s:s, s:s}",
+            "name",    CD_StringContent(player->username),
+            "message", CD_StringContent(message)));
+    }
+
     return true;
 }
 
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_BETA_CHUNK_H
+#define CRAFTD_BETA_CHUNK_H
+
+#include <beta/minecraft.h>
+
+#define MC_CHUNK_SECTIONS       8
+#define MC_CHUNK_SECTION_HEIGHT 16
+#define MC_CHUNK_SECTION_VOLUME 4096
+
+/**
+ * Up to 4096 values of at most 8 bits each, stored as a single value when
+ * uniform, as bit-packed indices into a small palette when there are at most
+ * 16 distinct values, or as plain bytes otherwise.
+ */
+typedef struct _MCPalettedArray {
+    uint8_t bits;
+    uint8_t length;
+    uint8_t palette[16];
+
+    uint64_t* indices;
+} MCPalettedArray;
+
+/**
+ * A 16x16x16 slice of a chunk, values are indexed as (x << 8) | (z << 4) | y
+ * so every column is contiguous like in the wire format.
+ */
+typedef struct _MCChunkSection {
+    MCPalettedArray blocks;
+    MCPalettedArray data;
+    MCPalettedArray blockLight;
+    MCPalettedArray skyLight;
+} MCChunkSection;
+
+/**
+ * A chunk split in 16 high sections, a missing section is air lit by the sky.
+ */
+typedef struct _MCCompactChunk {
+    MCChunkPosition position;
+
+    uint8_t heightMap[256];
+
+    MCChunkSection* sections[MC_CHUNK_SECTIONS];
+} MCCompactChunk;
+
+/**
+ * Create an empty chunk made only of air
+ */
+MCCompactChunk* MC_CreateCompactChunk (void);
+
+/**
+ * Create a compact copy of a flat chunk
+ */
+MCCompactChunk* MC_CreateCompactChunkFromChunk (MCChunk* chunk);
+
+void MC_DestroyCompactChunk (MCCompactChunk* self);
+
+/**
+ * Repack every section dropping unused palette entries and free the sections
+ * that went back to plain air
+ */
+void MC_CompactChunkShrink (MCCompactChunk* self);
+
+/**
+ * Get the heap memory used by the chunk, the struct itself included
+ */
+size_t MC_CompactChunkSize (MCCompactChunk* self);
+
+void MC_CompactChunkSetBlock (MCCompactChunk* self, int x, int y, int z, uint8_t value);
+
+void MC_CompactChunkSetData (MCCompactChunk* self, int x, int y, int z, uint8_t value);
+
+void MC_CompactChunkSetBlockLight (MCCompactChunk* self, int x, int y, int z, uint8_t value);
+
+void MC_CompactChunkSetSkyLight (MCCompactChunk* self, int x, int y, int z, uint8_t value);
+
+/**
+ * Expand the chunk into a flat one
+ */
+void MC_CompactChunkToChunk (MCCompactChunk* self, MCChunk* chunk);
+
+/**
+ * Write the chunk in the same layout as MC_ChunkToByteArray
+ *
+ * @param array 81920 bytes long
+ */
+void MC_CompactChunkToByteArray (MCCompactChunk* self, uint8_t* array);
+
+static inline
+uint8_t
+MC_PalettedArrayGet (const MCPalettedArray* self, uint16_t index)
+{
+    if (self->bits == 0) {
+        return self->palette[0];
+    }
+    else if (self->bits == 8) {
+        return ((uint8_t*) self->indices)[index];
+    }
+    else {
+        uint16_t offset = index * self->bits;
+
+        return self->palette[(self->indices[offset >> 6] >> (offset & 63)) & ((1 << self->bits) - 1)];
+    }
+}
+
+static inline
+uint16_t
+MC_ChunkSectionIndex (int x, int y, int z)
+{
+    return (x << 8) | (z << 4) | (y & 15);
+}
+
+static inline
+uint8_t
+MC_CompactChunkGetBlock (const MCCompactChunk* self, int x, int y, int z)
+{
+    const MCChunkSection* section = self->sections[y >> 4];
+
+    if (!section) {
+        return MCAir;
+    }
+
+    return MC_PalettedArrayGet(&section->blocks, MC_ChunkSectionIndex(x, y, z));
+}
+
+static inline
+uint8_t
+MC_CompactChunkGetData (const MCCompactChunk* self, int x, int y, int z)
+{
+    const MCChunkSection* section = self->sections[y >> 4];
+
+    if (!section) {
+        return 0;
+    }
+
+    return MC_PalettedArrayGet(&section->data, MC_ChunkSectionIndex(x, y, z));
+}
+
+static inline
+uint8_t
+MC_CompactChunkGetBlockLight (const MCCompactChunk* self, int x, int y, int z)
+{
+    const MCChunkSection* section = self->sections[y >> 4];
+
+    if (!section) {
+        return 0;
+    }
+
+    return MC_PalettedArrayGet(&section->blockLight, MC_ChunkSectionIndex(x, y, z));
+}
+
+static inline
+uint8_t
+MC_CompactChunkGetSkyLight (const MCCompactChunk* self, int x, int y, int z)
+{
+    const MCChunkSection* section = self->sections[y >> 4];
+
+    if (!section) {
+        return 15;
+    }
+
+    return MC_PalettedArrayGet(&section->skyLight, MC_ChunkSectionIndex(x, y, z));
+}
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_BETA_CHUNKSET_H
+#define CRAFTD_BETA_CHUNKSET_H
+
+#include <beta/minecraft.h>
+
+/* (INT32_MIN, INT32_MIN) is way past the world border, so it marks free slots */
+#define MC_CHUNK_SET_EMPTY UINT64_C(0x8000000080000000)
+
+/**
+ * An open addressing set of chunk positions, positions are packed in a 64 bit key
+ * and stored inline with linear probing, so nothing is allocated per member.
+ *
+ * The set isn't locked, it's meant to be owned by a single player.
+ */
+typedef struct _MCChunkSet {
+    size_t length;
+    size_t size;
+    int    bits;
+
+    uint64_t* keys;
+} MCChunkSet;
+
+typedef void (*MCChunkSetApply) (MCChunkSet* self, MCChunkPosition position, CDPointer data);
+
+typedef bool (*MCChunkSetFilter) (MCChunkSet* self, MCChunkPosition position, CDPointer data);
+
+static inline
+uint64_t
+MC_ChunkPositionToKey (MCChunkPosition position)
+{
+    return ((uint64_t) (uint32_t) position.x << 32) | (uint32_t) position.z;
+}
+
+static inline
+MCChunkPosition
+MC_ChunkPositionFromKey (uint64_t key)
+{
+    return (MCChunkPosition) {
+        .x = (int32_t) (uint32_t) (key >> 32),
+        .z = (int32_t) (uint32_t) key
+    };
+}
+
+/**
+ * Create a ChunkSet
+ *
+ * @param hint The number of positions it should hold without growing
+ *
+ * @return The instantiated object
+ */
+MCChunkSet* MC_CreateChunkSet (size_t hint);
+
+void MC_DestroyChunkSet (MCChunkSet* self);
+
+static inline
+size_t
+MC_ChunkSetLength (MCChunkSet* self)
+{
+    return self->length;
+}
+
+bool MC_ChunkSetHas (MCChunkSet* self, MCChunkPosition position);
+
+/**
+ * Add a position to the set
+ *
+ * @return false if it was already there
+ */
+bool MC_ChunkSetPut (MCChunkSet* self, MCChunkPosition position);
+
+/**
+ * Remove a position from the set
+ *
+ * @return false if it wasn't there
+ */
+bool MC_ChunkSetDelete (MCChunkSet* self, MCChunkPosition position);
+
+void MC_ChunkSetClear (MCChunkSet* self);
+
+/**
+ * Get the next position in the set, the set can't be changed while iterating.
+ *
+ * @param iterator Where to start from, initialize it to 0
+ * @param position Where to put the position
+ *
+ * @return false when there are no more positions
+ */
+bool MC_ChunkSetNext (MCChunkSet* self, size_t* iterator, MCChunkPosition* position);
+
+/**
+ * Remove the positions the filter returns true for, it can be called more than once
+ * for the same position so it shouldn't have side effects on positions it keeps.
+ */
+void MC_ChunkSetDeleteIf (MCChunkSet* self, MCChunkSetFilter filter, CDPointer data);
+
+/**
+ * Turn self into the symmetric difference of self and other
+ */
+void MC_ChunkSetSymmetricDifference (MCChunkSet* self, MCChunkSet* other);
+
+/**
+ * Turn the set into the chunks in the radius around the center, removed is called for
+ * the chunks that go away and added for the ones that come in, in that order.
+ *
+ * Nothing is allocated unless the set has to grow.
+ *
+ * @param removed Called for every removed chunk, can be NULL
+ * @param added Called for every added chunk, can be NULL
+ */
+void MC_ChunkSetMoveRadius (MCChunkSet* self, MCChunkPosition center, int radius, MCChunkSetApply removed, MCChunkSetApply added, CDPointer data);
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CRAFTD_BETA_ENTITYTABLE_H
+#define CRAFTD_BETA_ENTITYTABLE_H
+
+#include <beta/minecraft.h>
+
+/**
+ * Entity IDs are a slot index in the low bits and the slot generation in the
+ * high ones, generations start from 1 so IDs are always positive and never 0.
+ *
+ * The free list is LIFO, so a despawned slot is the first one handed out again
+ * and the generation of a busy slot wraps after 2047 respawns. An ID kept for
+ * longer than that, e.g. by a client that missed the destroy, can resolve to
+ * whatever entity holds the slot then.
+ */
+#define MC_ENTITY_INDEX_BITS      20
+#define MC_ENTITY_GENERATION_BITS (31 - MC_ENTITY_INDEX_BITS)
+
+#define MC_ENTITY_INDEX_MASK      ((1 << MC_ENTITY_INDEX_BITS) - 1)
+#define MC_ENTITY_GENERATION_MASK ((1 << MC_ENTITY_GENERATION_BITS) - 1)
+
+/**
+ * Slots are allocated in pages that never move, so they can be read without a lock
+ */
+#define MC_ENTITY_PAGE_BITS 10
+#define MC_ENTITY_PAGE_SIZE (1 << MC_ENTITY_PAGE_BITS)
+#define MC_ENTITY_PAGES     (1 << (MC_ENTITY_INDEX_BITS - MC_ENTITY_PAGE_BITS))
+
+/**
+ * Velocities are in 1/8000 of a block per tick, as they're sent to the clients
+ */
+#define MC_ENTITY_VELOCITY_SCALE 8000.0
+
+typedef struct _MCEntitySlot {
+    volatile uint32_t generation;
+    volatile uint32_t dense; /* index in the dense arrays, or MC_ENTITY_NONE */
+
+    volatile uint32_t next; /* next free slot */
+} MCEntitySlot;
+
+/**
+ * A generational slot map of the entities of a world.
+ *
+ * IDs are allocated from a lock-free free list so spawning never waits on other
+ * spawns for an ID. The entities themselves are kept in dense parallel arrays,
+ * removals move the last entity in the hole, so ticks iterate over contiguous
+ * positions, velocities and types. Lookups by ID are O(1) and a despawned ID
+ * never resolves to the entity reusing its slot.
+ */
+typedef struct _MCEntityTable {
+    MCEntitySlot* volatile pages[MC_ENTITY_PAGES];
+
+    volatile uint64_t free;   /* ABA tag << 32 | head of the free list */
+    volatile uint32_t length; /* slots ever handed out */
+
+    struct {
+        size_t length;
+        size_t size;
+
+        MCEntityId*        id;
+        MCEntityType*      type;
+        MCPrecisePosition* position;
+        MCVelocity*        velocity;
+        CDPointer*         data;
+    } dense;
+
+    struct {
+        pthread_rwlock_t dense;
+        pthread_mutex_t  pages;
+    } lock;
+} MCEntityTable;
+
+/**
+ * Create an EntityTable
+ *
+ * @return The instantiated object
+ */
+MCEntityTable* MC_CreateEntityTable (void);
+
+void MC_DestroyEntityTable (MCEntityTable* self);
+
+/**
+ * Add an entity to the table, it's safe to call from any thread
+ *
+ * @param type The entity type
+ * @param position The starting position, the velocity starts at 0
+ * @param data The object the entity belongs to, e.g. the CDPlayer
+ *
+ * @return The new ID or 0 if the table is full
+ */
+MCEntityId MC_EntityTableSpawn (MCEntityTable* self, MCEntityType type, MCPrecisePosition position, CDPointer data);
+
+/**
+ * Remove an entity from the table, its ID can't be resolved anymore
+ *
+ * @return The data of the entity or CDNull if the ID didn't resolve
+ */
+CDPointer MC_EntityTableDespawn (MCEntityTable* self, MCEntityId id);
+
+/**
+ * Get the data of an entity
+ *
+ * @return The data or CDNull if the ID didn't resolve
+ */
+CDPointer MC_EntityTableGet (MCEntityTable* self, MCEntityId id);
+
+bool MC_EntityTableHas (MCEntityTable* self, MCEntityId id);
+
+bool MC_EntityTableGetPosition (MCEntityTable* self, MCEntityId id, MCPrecisePosition* position);
+
+bool MC_EntityTableSetPosition (MCEntityTable* self, MCEntityId id, MCPrecisePosition position);
+
+bool MC_EntityTableSetVelocity (MCEntityTable* self, MCEntityId id, MCVelocity velocity);
+
+size_t MC_EntityTableLength (MCEntityTable* self);
+
+/**
+ * Advance every entity by one tick of its velocity, nothing calls it until
+ * something sets velocities and the world ticks send the moves to the clients.
+ */
+void MC_EntityTableMove (MCEntityTable* self);
+
+/**
+ * Lock the dense arrays for reading, nothing can be spawned or despawned until
+ * MC_EntityTableUnlock is called.
+ */
+void MC_EntityTableLock (MCEntityTable* self);
+
+void MC_EntityTableUnlock (MCEntityTable* self);
+
+/**
+ * Iterate over the dense arrays, the table has to be locked with MC_EntityTableLock
+ *
+ * @parameter it The name of the index variable, use it on self->dense.*
+ */
+#define MC_ENTITY_TABLE_FOREACH(self, it) \
+    for (size_t it = 0; it < (self)->dense.length; it++)
+
+#endif
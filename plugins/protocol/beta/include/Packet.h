@@ -524,6 +524,9 @@ typedef union _CDPacketMapChunk {
 
         MCInteger length;
         MCByte*   item;
+
+        /* already compressed data, used in place of item when set */
+        CDBuffer* buffer;
     } response;
 } CDPacketMapChunk;
 
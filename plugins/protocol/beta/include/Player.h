@@ -51,6 +51,11 @@ typedef struct _CDPlayer {
     CD_DEFINE_ERROR;
 } CDPlayer;
 
+/* Dynamic slots of the properties used on every packet, reserved when the plugin is loaded */
+extern CDDynamicSlot MCSlotClientPlayer;       /* CDPlayer* of a CDClient */
+extern CDDynamicSlot MCSlotPlayerLoadedChunks; /* MCChunkSet* */
+extern CDDynamicSlot MCSlotPlayerSeenPlayers;  /* CDVector* of CDPlayer*, guarded by the world seen lock */
+
 /**
  * Create a Player object on the given Server.
  *
@@ -29,6 +29,7 @@
 #include <craftd/Server.h>
 
 #include <beta/Player.h>
+#include <beta/EntityTable.h>
 
 typedef enum _CDWorldDimension {
     CDWorldHell   = -1,
@@ -46,10 +47,11 @@ typedef struct _CDWorld {
 
     struct {
         pthread_spinlock_t time;
+        pthread_rwlock_t   seen; /* guards the Player.seenPlayers of every player in the world */
     } lock;
 
-    CDHash* players;
-    CDMap*  entities;
+    CDHash*        players;
+    MCEntityTable* entities;
 
     MCBlockPosition spawnPosition;
     CDSet*          chunks;
@@ -58,6 +60,19 @@ typedef struct _CDWorld {
     CD_DEFINE_ERROR;
 } CDWorld;
 
+extern CDDynamicSlot MCSlotWorldList;    /* CDList* of CDWorld* of the CDServer */
+extern CDDynamicSlot MCSlotWorldDefault; /* CDWorld* of the CDServer */
+
+/**
+ * Compile the worlds section of the plugin config, worlds created afterwards and the
+ * already existing ones get their section from it.
+ *
+ * The previous version is retired, so it can be called again on reload.
+ */
+void CD_WorldsLoadConfig (CDServer* server, CDRawConfig config);
+
+void CD_WorldsUnloadConfig (void);
+
 CDWorld* CD_CreateWorld (CDServer* server, const char* name);
 
 bool CD_WorldSave (CDWorld* self);
@@ -66,7 +81,19 @@ void CD_DestroyWorld (CDWorld* self);
 
 void CD_WorldLoad (CDWorld* self);
 
-MCEntityId CD_WorldGenerateEntityId (CDWorld* self);
+/**
+ * Add an entity to the world, the allocated ID is set on the entity
+ *
+ * @param data The object the entity belongs to
+ *
+ * @return The new ID or 0 if the world can't hold more entities
+ */
+MCEntityId CD_WorldAddEntity (CDWorld* self, MCEntity* entity, CDPointer data);
+
+/**
+ * Remove an entity from the world and reset its ID
+ */
+void CD_WorldRemoveEntity (CDWorld* self, MCEntity* entity);
 
 void CD_WorldAddPlayer (CDWorld* self, CDPlayer* player);
 
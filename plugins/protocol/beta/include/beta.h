@@ -28,6 +28,7 @@
 
 #include <beta/minecraft.h>
 
+#include <beta/Chunk.h>
 #include <beta/World.h>
 #include <beta/Player.h>
 #include <beta/Packet.h>
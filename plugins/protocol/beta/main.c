@@ -23,6 +23,8 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define CRAFTD_LOG_SUBSYSTEM CDLogPlugins
+
 #include <craftd/Plugin.h>
 #include <craftd/Server.h>
 
@@ -44,45 +46,74 @@ static struct {
         short sunset;
         short night;
     } rate;
+
+    int compression;
 } _config;
 
+static struct {
+    pthread_key_t stream;
+    CDList*       streams;
+} _compression;
+
+static struct {
+    CDMetric* chunks;
+    CDMetric* bytes;
+    CDMetric* latency;
+} _metrics;
+
 #include "callbacks.c"
 
 static
 void
-cdbeta_TimeIncrease (void* _, void* __, CDServer* server)
+cdbeta_TimeIncrease (CDServer* server, uint64_t tick, CDPointer _)
 {
-    CDList* worlds = (CDList*) CD_DynamicGet(server, "World.list");
+    if (tick % CD_TICKER_RATE != 0) {
+        return;
+    }
+
+    // the list is only put and deleted by Server.start! and Server.stop!, which bracket the ticker
+    CDList* worlds = (CDList*) CD_DynamicGetSlot(server, MCSlotWorldList);
 
     CD_LIST_FOREACH(worlds, it) {
         CDWorld* world = (CDWorld*) CD_ListIteratorValue(it);
 
-        uint16_t current = CD_WorldGetTime(world);
+        // workers can set the time too, read and write it in one go
+        pthread_spin_lock(&world->lock.time);
+
+        uint16_t current = world->time;
 
         if (current >= 0 && current <= 11999) {
-            CD_WorldSetTime(world, current += _config.rate.day);
+            current += _config.rate.day;
         }
         else if (current >= 12000 && current <= 13799) {
-            CD_WorldSetTime(world, current += _config.rate.sunset);
+            current += _config.rate.sunset;
         }
         else if (current >= 13800 && current <= 22199) {
-            CD_WorldSetTime(world, current += _config.rate.night);
+            current += _config.rate.night;
         }
         else if (current >= 22200 && current <= 23999) {
-            CD_WorldSetTime(world, current += _config.rate.sunrise);
+            current += _config.rate.sunrise;
         }
 
         if (current >= 24000) {
-            CD_WorldSetTime(world, current - 24000);
+            current -= 24000;
         }
+
+        world->time = current;
+
+        pthread_spin_unlock(&world->lock.time);
     }
 }
 
 static
 void
-cdbeta_TimeUpdate (void* _, void* __, CDServer* server)
+cdbeta_TimeUpdate (CDServer* server, uint64_t tick, CDPointer _)
 {
-    CDList* worlds = (CDList*) CD_DynamicGet(server, "World.list");
+    if (tick % (30 * CD_TICKER_RATE) != 0) {
+        return;
+    }
+
+    CDList* worlds = (CDList*) CD_DynamicGetSlot(server, MCSlotWorldList);
 
     CD_LIST_FOREACH(worlds, it) {
         CDWorld* world = (CDWorld*) CD_ListIteratorValue(it);
@@ -101,14 +132,20 @@ cdbeta_TimeUpdate (void* _, void* __, CDServer* server)
 
 static
 void
-cdbeta_KeepAlive (void* _, void* __, CDServer* server)
+cdbeta_KeepAlive (CDServer* server, uint64_t tick, CDPointer _)
 {
+    if (tick % (10 * CD_TICKER_RATE) != 0) {
+        return;
+    }
+
     CDPacket  packet = { CDResponse, CDKeepAlive, CDNull };
     CDBuffer* buffer = CD_PacketToBuffer(&packet);
 
-    CD_LIST_FOREACH(server->clients, it) {
-        CD_ClientSendBuffer((CDClient*) CD_ListIteratorValue(it), buffer);
+    pthread_rwlock_rdlock(&server->lock.clients);
+    CD_LINKED_LIST_FOREACH(&server->clients, it) {
+        CD_ClientSendBuffer(CD_LINK_OWNER(it, CDClient, link.clients), buffer);
     }
+    pthread_rwlock_unlock(&server->lock.clients);
 
     CD_DestroyBuffer(buffer);
 }
@@ -154,8 +191,8 @@ cdbeta_ServerStart (CDServer* server)
         }
     }
 
-    CD_DynamicPut(self->server, "World.list", (CDPointer) worlds);
-    CD_DynamicPut(self->server, "World.default", (CDPointer) defaultWorld);
+    CD_DynamicPutSlot(self->server, MCSlotWorldList, (CDPointer) worlds);
+    CD_DynamicPutSlot(self->server, MCSlotWorldDefault, (CDPointer) defaultWorld);
 
     return true;
 }
@@ -164,9 +201,9 @@ static
 bool
 cdbeta_ServerStop (CDServer* server)
 {
-    CD_DynamicDelete(server, "World.default");
+    CD_DynamicDeleteSlot(server, MCSlotWorldDefault);
 
-    CDList* worlds = (CDList*) CD_DynamicDelete(server, "World.list");
+    CDList* worlds = (CDList*) CD_DynamicDeleteSlot(server, MCSlotWorldList);
 
     CD_LIST_FOREACH(worlds, it) {
         CD_DestroyWorld((CDWorld*) CD_ListIteratorValue(it));
@@ -175,6 +212,15 @@ cdbeta_ServerStop (CDServer* server)
     return true;
 }
 
+static
+bool
+cdbeta_ConfigReload (CDServer* server, CDConfig* config, CDConfig* old)
+{
+    CD_WorldsLoadConfig(server, CD_ConfigPlugin(config, "protocol.beta"));
+
+    return true;
+}
+
 bool
 cdbeta_JSON (CDServer* server, json_t* input, json_t* output)
 {
@@ -201,6 +247,8 @@ CD_PluginInitialize (CDPlugin* self)
         _config.rate.sunset  = 20;
         _config.rate.night   = 20;
 
+        _config.compression = Z_DEFAULT_COMPRESSION;
+
         J_DO {
             J_STRING(self->config, "commandChar", _config.commandChar);
 
@@ -210,23 +258,61 @@ CD_PluginInitialize (CDPlugin* self)
                 J_INT(rate, "sunset",  _config.rate.sunset);
                 J_INT(rate, "night",   _config.rate.night);
             }
+
+            J_INT(self->config, "compression", _config.compression);
+        }
+
+        if (_config.compression < Z_DEFAULT_COMPRESSION || _config.compression > Z_BEST_COMPRESSION) {
+            _config.compression = Z_DEFAULT_COMPRESSION;
+        }
+
+        // The raw config goes away on reload
+        _config.commandChar = strdup(_config.commandChar);
+    }
+
+    DO { // Reserve the dynamic slots used on every packet
+        MCSlotClientPlayer       = CD_ReserveDynamicSlot("Client.player");
+        MCSlotPlayerLoadedChunks = CD_ReserveDynamicSlot("Player.loadedChunks");
+        MCSlotPlayerSeenPlayers  = CD_ReserveDynamicSlot("Player.seenPlayers");
+        MCSlotWorldList          = CD_ReserveDynamicSlot("World.list");
+        MCSlotWorldDefault       = CD_ReserveDynamicSlot("World.default");
+
+        // every packet goes through these, there's no falling back to the string API
+        if (MCSlotClientPlayer == CD_DYNAMIC_NO_SLOT || MCSlotPlayerLoadedChunks == CD_DYNAMIC_NO_SLOT ||
+                MCSlotPlayerSeenPlayers == CD_DYNAMIC_NO_SLOT || MCSlotWorldList == CD_DYNAMIC_NO_SLOT ||
+                MCSlotWorldDefault == CD_DYNAMIC_NO_SLOT) {
+            SERR(self->server, "not enough dynamic slots left for the beta protocol");
+
+            return false;
         }
     }
 
+    CD_WorldsLoadConfig(self->server, self->config);
+
     self->server->packet.parsable = CD_PacketParsable;
     self->server->packet.parse    = (void* (*)(CDBuffers *)) CD_PacketFromBuffers;
 
     pthread_mutex_init(&_lock.login, NULL);
 
-    CD_DynamicPut(self, "Event.timeIncrease", CD_SetInterval(self->server->timeloop, 1,  (event_callback_fn) cdbeta_TimeIncrease, CDNull));
-    CD_DynamicPut(self, "Event.timeUpdate",   CD_SetInterval(self->server->timeloop, 30, (event_callback_fn) cdbeta_TimeUpdate, CDNull));
-    CD_DynamicPut(self, "Event.keepAlive",    CD_SetInterval(self->server->timeloop, 10, (event_callback_fn) cdbeta_KeepAlive, CDNull));
+    _compression.streams = CD_CreateList();
+
+    pthread_key_create(&_compression.stream, (void (*)(void*)) cdbeta_ReleaseChunkStream);
+
+    _metrics.chunks  = CD_CreateMetric(CDMetricCounter, "craftd_chunks_sent_total", NULL, "Map chunks sent to players");
+    _metrics.bytes   = CD_CreateMetric(CDMetricCounter, "craftd_chunk_bytes_total", NULL, "Compressed map chunk bytes sent to players");
+    _metrics.latency = CD_CreateMetric(CDMetricHistogram, "craftd_chunk_send_seconds", NULL, "Time spent loading, compressing and queueing a map chunk");
+
+    CD_TickerRegister(self->server->ticker, CDTickWorld, cdbeta_TimeIncrease, CDNull);
+    CD_TickerRegister(self->server->ticker, CDTickEntities, cdbeta_TimeUpdate, CDNull);
+    CD_TickerRegister(self->server->ticker, CDTickEntities, cdbeta_KeepAlive, CDNull);
 
     CD_EventRegister(self->server, "RPC.JSON", cdbeta_JSON);
 
     CD_EventRegister(self->server, "Server.start!", cdbeta_ServerStart);
     CD_EventRegister(self->server, "Server.stop!", cdbeta_ServerStop);
 
+    CD_EventRegister(self->server, "Config.reload", cdbeta_ConfigReload);
+
     CD_EventRegister(self->server, "Client.process", cdbeta_ClientProcess);
     CD_EventRegister(self->server, "Client.processed", cdbeta_ClientProcessed);
 
@@ -249,15 +335,17 @@ extern
 bool
 CD_PluginFinalize (CDPlugin* self)
 {
-    CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.timeIncrease"));
-    CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.timeUpdate"));
-    CD_ClearInterval(self->server->timeloop, (int) CD_DynamicDelete(self, "Event.keepAlive"));
+    CD_TickerUnregister(self->server->ticker, CDTickWorld, cdbeta_TimeIncrease, CDNull);
+    CD_TickerUnregister(self->server->ticker, CDTickEntities, cdbeta_TimeUpdate, CDNull);
+    CD_TickerUnregister(self->server->ticker, CDTickEntities, cdbeta_KeepAlive, CDNull);
 
     CD_EventUnregister(self->server, "RPC.JSON", cdbeta_JSON);
 
     CD_EventUnregister(self->server, "Server.start!", cdbeta_ServerStart);
     CD_EventUnregister(self->server, "Server.stop!", cdbeta_ServerStop);
 
+    CD_EventUnregister(self->server, "Config.reload", cdbeta_ConfigReload);
+
     CD_EventUnregister(self->server, "Client.process", cdbeta_ClientProcess);
     CD_EventUnregister(self->server, "Client.processed", cdbeta_ClientProcessed);
 
@@ -275,5 +363,26 @@ CD_PluginFinalize (CDPlugin* self)
 
     pthread_mutex_destroy(&_lock.login);
 
+    // the key destructors only run on thread exit, streams of live threads are freed here
+    pthread_key_delete(_compression.stream);
+
+    DO {
+        CDBetaChunkStream* stream;
+
+        while ((stream = (CDBetaChunkStream*) CD_ListShift(_compression.streams))) {
+            cdbeta_DestroyChunkStream(stream);
+        }
+
+        CD_DestroyList(_compression.streams);
+    }
+
+    CD_WorldsUnloadConfig();
+
+    CD_free((void*) _config.commandChar);
+
+    CD_DestroyMetric(_metrics.chunks);
+    CD_DestroyMetric(_metrics.bytes);
+    CD_DestroyMetric(_metrics.latency);
+
     return true;
 }
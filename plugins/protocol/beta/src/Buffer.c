@@ -256,8 +256,9 @@ CD_BufferRemoveString (CDBuffer* self)
 
     data[length] = '\0';
 
-    result           = CD_CreateStringFromBuffer(data, length + 1);
-    result->external = false;
+    result            = CD_CreateStringFromBuffer(data, length);
+    result->raw->mlen = length + 1;
+    result->external  = false;
 
     return result;
 }
@@ -0,0 +1,497 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <beta/Chunk.h>
+
+static
+size_t
+cd_PalettedArrayStorage (uint8_t bits)
+{
+    return (MC_CHUNK_SECTION_VOLUME * bits) / 8;
+}
+
+static
+void
+cd_PalettedArrayInitialize (MCPalettedArray* self, uint8_t value)
+{
+    self->bits       = 0;
+    self->length     = 1;
+    self->palette[0] = value;
+    self->indices    = NULL;
+}
+
+static
+void
+cd_PalettedArrayUnpack (const MCPalettedArray* self, uint8_t* values)
+{
+    if (self->bits == 0) {
+        memset(values, self->palette[0], MC_CHUNK_SECTION_VOLUME);
+    }
+    else if (self->bits == 8) {
+        memcpy(values, self->indices, MC_CHUNK_SECTION_VOLUME);
+    }
+    else {
+        const uint64_t mask    = (1 << self->bits) - 1;
+        const size_t   perWord = 64 / self->bits;
+
+        for (size_t word = 0, index = 0; index < MC_CHUNK_SECTION_VOLUME; word++) {
+            uint64_t current = self->indices[word];
+
+            for (size_t i = 0; i < perWord; i++, index++, current >>= self->bits) {
+                values[index] = self->palette[current & mask];
+            }
+        }
+    }
+}
+
+/**
+ * Replace the content with the given values, picking the smallest encoding
+ * that can hold them
+ */
+static
+void
+cd_PalettedArrayPack (MCPalettedArray* self, const uint8_t* values)
+{
+    int16_t lookup[256];
+    size_t  length = 0;
+
+    memset(lookup, 0xFF, sizeof(lookup));
+
+    for (size_t i = 0; i < MC_CHUNK_SECTION_VOLUME; i++) {
+        if (lookup[values[i]] >= 0) {
+            continue;
+        }
+
+        if (length == 16) {
+            length++;
+            break;
+        }
+
+        lookup[values[i]]     = length;
+        self->palette[length] = values[i];
+        length++;
+    }
+
+    CD_free(self->indices);
+    self->indices = NULL;
+
+    if (length == 1) {
+        self->bits   = 0;
+        self->length = 1;
+
+        return;
+    }
+
+    if (length > 16) {
+        self->bits    = 8;
+        self->length  = 0;
+        self->indices = CD_malloc(cd_PalettedArrayStorage(8));
+
+        memcpy(self->indices, values, MC_CHUNK_SECTION_VOLUME);
+
+        return;
+    }
+
+    self->bits    = (length <= 2) ? 1 : (length <= 4) ? 2 : 4;
+    self->length  = length;
+    self->indices = CD_alloc(cd_PalettedArrayStorage(self->bits));
+
+    for (size_t i = 0; i < MC_CHUNK_SECTION_VOLUME; i++) {
+        size_t offset = i * self->bits;
+
+        self->indices[offset >> 6] |= (uint64_t) lookup[values[i]] << (offset & 63);
+    }
+}
+
+static
+void
+cd_PalettedArraySet (MCPalettedArray* self, uint16_t index, uint8_t value)
+{
+    size_t entry;
+
+    if (self->bits == 8) {
+        ((uint8_t*) self->indices)[index] = value;
+
+        return;
+    }
+
+    for (entry = 0; entry < self->length; entry++) {
+        if (self->palette[entry] == value) {
+            break;
+        }
+    }
+
+    if (entry == self->length) {
+        if (self->bits > 0 && self->length < (1 << self->bits)) {
+            self->palette[self->length++] = value;
+        }
+        else {
+            uint8_t values[MC_CHUNK_SECTION_VOLUME];
+
+            cd_PalettedArrayUnpack(self, values);
+            values[index] = value;
+            cd_PalettedArrayPack(self, values);
+
+            return;
+        }
+    }
+
+    if (self->bits == 0) {
+        return;
+    }
+
+    size_t   offset = index * self->bits;
+    uint64_t mask   = (uint64_t) ((1 << self->bits) - 1) << (offset & 63);
+
+    self->indices[offset >> 6] = (self->indices[offset >> 6] & ~mask) | ((uint64_t) entry << (offset & 63));
+}
+
+static
+void
+cd_PalettedArrayShrink (MCPalettedArray* self)
+{
+    uint8_t values[MC_CHUNK_SECTION_VOLUME];
+
+    if (self->bits == 0) {
+        return;
+    }
+
+    cd_PalettedArrayUnpack(self, values);
+    cd_PalettedArrayPack(self, values);
+}
+
+static
+bool
+cd_PalettedArrayIsUniform (const MCPalettedArray* self, uint8_t value)
+{
+    return self->bits == 0 && self->palette[0] == value;
+}
+
+static
+MCChunkSection*
+cd_CreateChunkSection (void)
+{
+    MCChunkSection* self = CD_malloc(sizeof(MCChunkSection));
+
+    cd_PalettedArrayInitialize(&self->blocks,     MCAir);
+    cd_PalettedArrayInitialize(&self->data,       0);
+    cd_PalettedArrayInitialize(&self->blockLight, 0);
+    cd_PalettedArrayInitialize(&self->skyLight,   15);
+
+    return self;
+}
+
+static
+void
+cd_DestroyChunkSection (MCChunkSection* self)
+{
+    if (!self) {
+        return;
+    }
+
+    CD_free(self->blocks.indices);
+    CD_free(self->data.indices);
+    CD_free(self->blockLight.indices);
+    CD_free(self->skyLight.indices);
+
+    CD_free(self);
+}
+
+static
+bool
+cd_ChunkSectionIsEmpty (const MCChunkSection* self)
+{
+    return cd_PalettedArrayIsUniform(&self->blocks,     MCAir) &&
+           cd_PalettedArrayIsUniform(&self->data,       0) &&
+           cd_PalettedArrayIsUniform(&self->blockLight, 0) &&
+           cd_PalettedArrayIsUniform(&self->skyLight,   15);
+}
+
+/**
+ * Copy one section worth of a flat chunk array into section order, nibble
+ * arrays are expanded to one value per byte
+ */
+static
+void
+cd_GatherSection (const uint8_t* source, bool nibbles, int section, uint8_t* values)
+{
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            size_t   base   = (section << 4) + (z << 7) + (x << 11);
+            uint8_t* column = values + MC_ChunkSectionIndex(x, 0, z);
+
+            if (nibbles) {
+                const uint8_t* packed = source + (base >> 1);
+
+                for (int y = 0; y < 8; y++) {
+                    column[y << 1]       = packed[y] & 0x0F;
+                    column[(y << 1) + 1] = packed[y] >> 4;
+                }
+            }
+            else {
+                memcpy(column, source + base, MC_CHUNK_SECTION_HEIGHT);
+            }
+        }
+    }
+}
+
+static
+void
+cd_ScatterSection (const uint8_t* values, bool nibbles, int section, uint8_t* destination)
+{
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            size_t         base   = (section << 4) + (z << 7) + (x << 11);
+            const uint8_t* column = values + MC_ChunkSectionIndex(x, 0, z);
+
+            if (nibbles) {
+                uint8_t* packed = destination + (base >> 1);
+
+                for (int y = 0; y < 8; y++) {
+                    packed[y] = column[y << 1] | (column[(y << 1) + 1] << 4);
+                }
+            }
+            else {
+                memcpy(destination + base, column, MC_CHUNK_SECTION_HEIGHT);
+            }
+        }
+    }
+}
+
+static
+void
+cd_FillSection (uint8_t value, bool nibbles, int section, uint8_t* destination)
+{
+    if (nibbles) {
+        value |= value << 4;
+    }
+
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            size_t base = (section << 4) + (z << 7) + (x << 11);
+
+            if (nibbles) {
+                memset(destination + (base >> 1), value, MC_CHUNK_SECTION_HEIGHT / 2);
+            }
+            else {
+                memset(destination + base, value, MC_CHUNK_SECTION_HEIGHT);
+            }
+        }
+    }
+}
+
+static
+void
+cd_ExportLayer (const MCPalettedArray* layer, uint8_t fallback, bool nibbles, int section, uint8_t* destination)
+{
+    if (!layer) {
+        cd_FillSection(fallback, nibbles, section, destination);
+    }
+    else if (layer->bits == 0) {
+        cd_FillSection(layer->palette[0], nibbles, section, destination);
+    }
+    else {
+        uint8_t values[MC_CHUNK_SECTION_VOLUME];
+
+        cd_PalettedArrayUnpack(layer, values);
+        cd_ScatterSection(values, nibbles, section, destination);
+    }
+}
+
+static
+void
+cd_CompactChunkExport (MCCompactChunk* self, uint8_t* blocks, uint8_t* data, uint8_t* blockLight, uint8_t* skyLight)
+{
+    for (int i = 0; i < MC_CHUNK_SECTIONS; i++) {
+        MCChunkSection* section = self->sections[i];
+
+        cd_ExportLayer(section ? &section->blocks     : NULL, MCAir, false, i, blocks);
+        cd_ExportLayer(section ? &section->data       : NULL, 0,     true,  i, data);
+        cd_ExportLayer(section ? &section->blockLight : NULL, 0,     true,  i, blockLight);
+        cd_ExportLayer(section ? &section->skyLight   : NULL, 15,    true,  i, skyLight);
+    }
+}
+
+static inline
+MCChunkSection*
+cd_CompactChunkSection (MCCompactChunk* self, int y)
+{
+    if (!self->sections[y >> 4]) {
+        self->sections[y >> 4] = cd_CreateChunkSection();
+    }
+
+    return self->sections[y >> 4];
+}
+
+MCCompactChunk*
+MC_CreateCompactChunk (void)
+{
+    return CD_alloc(sizeof(MCCompactChunk));
+}
+
+MCCompactChunk*
+MC_CreateCompactChunkFromChunk (MCChunk* chunk)
+{
+    MCCompactChunk* self = MC_CreateCompactChunk();
+    uint8_t         values[MC_CHUNK_SECTION_VOLUME];
+
+    self->position = chunk->position;
+    memcpy(self->heightMap, chunk->heightMap, sizeof(self->heightMap));
+
+    for (int i = 0; i < MC_CHUNK_SECTIONS; i++) {
+        MCChunkSection* section = cd_CreateChunkSection();
+
+        cd_GatherSection(chunk->blocks, false, i, values);
+        cd_PalettedArrayPack(&section->blocks, values);
+
+        cd_GatherSection(chunk->data, true, i, values);
+        cd_PalettedArrayPack(&section->data, values);
+
+        cd_GatherSection(chunk->blockLight, true, i, values);
+        cd_PalettedArrayPack(&section->blockLight, values);
+
+        cd_GatherSection(chunk->skyLight, true, i, values);
+        cd_PalettedArrayPack(&section->skyLight, values);
+
+        if (cd_ChunkSectionIsEmpty(section)) {
+            cd_DestroyChunkSection(section);
+        }
+        else {
+            self->sections[i] = section;
+        }
+    }
+
+    return self;
+}
+
+void
+MC_DestroyCompactChunk (MCCompactChunk* self)
+{
+    for (int i = 0; i < MC_CHUNK_SECTIONS; i++) {
+        cd_DestroyChunkSection(self->sections[i]);
+    }
+
+    CD_free(self);
+}
+
+void
+MC_CompactChunkShrink (MCCompactChunk* self)
+{
+    for (int i = 0; i < MC_CHUNK_SECTIONS; i++) {
+        MCChunkSection* section = self->sections[i];
+
+        if (!section) {
+            continue;
+        }
+
+        cd_PalettedArrayShrink(&section->blocks);
+        cd_PalettedArrayShrink(&section->data);
+        cd_PalettedArrayShrink(&section->blockLight);
+        cd_PalettedArrayShrink(&section->skyLight);
+
+        if (cd_ChunkSectionIsEmpty(section)) {
+            cd_DestroyChunkSection(section);
+
+            self->sections[i] = NULL;
+        }
+    }
+}
+
+size_t
+MC_CompactChunkSize (MCCompactChunk* self)
+{
+    size_t result = sizeof(MCCompactChunk);
+
+    for (int i = 0; i < MC_CHUNK_SECTIONS; i++) {
+        MCChunkSection* section = self->sections[i];
+
+        if (!section) {
+            continue;
+        }
+
+        result += sizeof(MCChunkSection);
+        result += cd_PalettedArrayStorage(section->blocks.bits);
+        result += cd_PalettedArrayStorage(section->data.bits);
+        result += cd_PalettedArrayStorage(section->blockLight.bits);
+        result += cd_PalettedArrayStorage(section->skyLight.bits);
+    }
+
+    return result;
+}
+
+void
+MC_CompactChunkSetBlock (MCCompactChunk* self, int x, int y, int z, uint8_t value)
+{
+    if (!self->sections[y >> 4] && value == MCAir) {
+        return;
+    }
+
+    cd_PalettedArraySet(&cd_CompactChunkSection(self, y)->blocks, MC_ChunkSectionIndex(x, y, z), value);
+}
+
+void
+MC_CompactChunkSetData (MCCompactChunk* self, int x, int y, int z, uint8_t value)
+{
+    if (!self->sections[y >> 4] && (value & 0x0F) == 0) {
+        return;
+    }
+
+    cd_PalettedArraySet(&cd_CompactChunkSection(self, y)->data, MC_ChunkSectionIndex(x, y, z), value & 0x0F);
+}
+
+void
+MC_CompactChunkSetBlockLight (MCCompactChunk* self, int x, int y, int z, uint8_t value)
+{
+    if (!self->sections[y >> 4] && (value & 0x0F) == 0) {
+        return;
+    }
+
+    cd_PalettedArraySet(&cd_CompactChunkSection(self, y)->blockLight, MC_ChunkSectionIndex(x, y, z), value & 0x0F);
+}
+
+void
+MC_CompactChunkSetSkyLight (MCCompactChunk* self, int x, int y, int z, uint8_t value)
+{
+    if (!self->sections[y >> 4] && (value & 0x0F) == 15) {
+        return;
+    }
+
+    cd_PalettedArraySet(&cd_CompactChunkSection(self, y)->skyLight, MC_ChunkSectionIndex(x, y, z), value & 0x0F);
+}
+
+void
+MC_CompactChunkToChunk (MCCompactChunk* self, MCChunk* chunk)
+{
+    chunk->position = self->position;
+    memcpy(chunk->heightMap, self->heightMap, sizeof(chunk->heightMap));
+
+    cd_CompactChunkExport(self, chunk->blocks, chunk->data, chunk->blockLight, chunk->skyLight);
+}
+
+void
+MC_CompactChunkToByteArray (MCCompactChunk* self, uint8_t* array)
+{
+    cd_CompactChunkExport(self, array, array + 32768, array + 49152, array + 65536);
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <beta/ChunkSet.h>
+
+static inline
+size_t
+cd_ChunkSetSlot (MCChunkSet* self, uint64_t key)
+{
+    return (key * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - self->bits);
+}
+
+static
+void
+cd_ChunkSetAllocate (MCChunkSet* self, int bits)
+{
+    self->bits   = bits;
+    self->size   = (size_t) 1 << bits;
+    self->length = 0;
+    self->keys   = CD_malloc(sizeof(uint64_t) * self->size);
+
+    for (size_t i = 0; i < self->size; i++) {
+        self->keys[i] = MC_CHUNK_SET_EMPTY;
+    }
+}
+
+static
+void
+cd_ChunkSetInsert (MCChunkSet* self, uint64_t key)
+{
+    size_t mask = self->size - 1;
+    size_t slot = cd_ChunkSetSlot(self, key);
+
+    while (self->keys[slot] != MC_CHUNK_SET_EMPTY) {
+        slot = (slot + 1) & mask;
+    }
+
+    self->keys[slot] = key;
+    self->length++;
+}
+
+/**
+ * Keep the load under 3/4, linear probing degrades quickly past that
+ */
+static
+void
+cd_ChunkSetReserve (MCChunkSet* self, size_t length)
+{
+    uint64_t* keys = self->keys;
+    size_t    size = self->size;
+    int       bits = self->bits;
+
+    if (length * 4 <= self->size * 3) {
+        return;
+    }
+
+    while (length * 4 > ((size_t) 1 << bits) * 3) {
+        bits++;
+    }
+
+    cd_ChunkSetAllocate(self, bits);
+
+    for (size_t i = 0; i < size; i++) {
+        if (keys[i] != MC_CHUNK_SET_EMPTY) {
+            cd_ChunkSetInsert(self, keys[i]);
+        }
+    }
+
+    CD_free(keys);
+}
+
+static
+ssize_t
+cd_ChunkSetFind (MCChunkSet* self, uint64_t key)
+{
+    size_t mask = self->size - 1;
+    size_t slot = cd_ChunkSetSlot(self, key);
+
+    while (self->keys[slot] != MC_CHUNK_SET_EMPTY) {
+        if (self->keys[slot] == key) {
+            return slot;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return -1;
+}
+
+/**
+ * Free a slot shifting back the following keys of the cluster, so there are no
+ * tombstones and lookups stay short
+ */
+static
+void
+cd_ChunkSetRemove (MCChunkSet* self, size_t slot)
+{
+    size_t mask = self->size - 1;
+    size_t next = slot;
+
+    while (true) {
+        size_t home;
+
+        self->keys[slot] = MC_CHUNK_SET_EMPTY;
+
+        do {
+            next = (next + 1) & mask;
+
+            if (self->keys[next] == MC_CHUNK_SET_EMPTY) {
+                self->length--;
+
+                return;
+            }
+
+            home = cd_ChunkSetSlot(self, self->keys[next]);
+        } while (((next - home) & mask) < ((next - slot) & mask));
+
+        self->keys[slot] = self->keys[next];
+        slot             = next;
+    }
+}
+
+MCChunkSet*
+MC_CreateChunkSet (size_t hint)
+{
+    MCChunkSet* self = CD_malloc(sizeof(MCChunkSet));
+    int         bits = 4;
+
+    while (hint * 4 > ((size_t) 1 << bits) * 3) {
+        bits++;
+    }
+
+    cd_ChunkSetAllocate(self, bits);
+
+    return self;
+}
+
+void
+MC_DestroyChunkSet (MCChunkSet* self)
+{
+    assert(self);
+
+    CD_free(self->keys);
+    CD_free(self);
+}
+
+bool
+MC_ChunkSetHas (MCChunkSet* self, MCChunkPosition position)
+{
+    return cd_ChunkSetFind(self, MC_ChunkPositionToKey(position)) >= 0;
+}
+
+bool
+MC_ChunkSetPut (MCChunkSet* self, MCChunkPosition position)
+{
+    uint64_t key = MC_ChunkPositionToKey(position);
+
+    assert(key != MC_CHUNK_SET_EMPTY);
+
+    if (cd_ChunkSetFind(self, key) >= 0) {
+        return false;
+    }
+
+    cd_ChunkSetReserve(self, self->length + 1);
+    cd_ChunkSetInsert(self, key);
+
+    return true;
+}
+
+bool
+MC_ChunkSetDelete (MCChunkSet* self, MCChunkPosition position)
+{
+    ssize_t slot = cd_ChunkSetFind(self, MC_ChunkPositionToKey(position));
+
+    if (slot < 0) {
+        return false;
+    }
+
+    cd_ChunkSetRemove(self, slot);
+
+    return true;
+}
+
+void
+MC_ChunkSetClear (MCChunkSet* self)
+{
+    for (size_t i = 0; i < self->size; i++) {
+        self->keys[i] = MC_CHUNK_SET_EMPTY;
+    }
+
+    self->length = 0;
+}
+
+bool
+MC_ChunkSetNext (MCChunkSet* self, size_t* iterator, MCChunkPosition* position)
+{
+    for (; *iterator < self->size; (*iterator)++) {
+        if (self->keys[*iterator] != MC_CHUNK_SET_EMPTY) {
+            *position = MC_ChunkPositionFromKey(self->keys[(*iterator)++]);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+MC_ChunkSetDeleteIf (MCChunkSet* self, MCChunkSetFilter filter, CDPointer data)
+{
+    size_t slot = 0;
+
+    // A removal can shift a key not seen yet in the current slot, so it's checked again,
+    // keys wrapping around from the start can be seen twice
+    while (slot < self->size) {
+        if (self->keys[slot] != MC_CHUNK_SET_EMPTY && filter(self, MC_ChunkPositionFromKey(self->keys[slot]), data)) {
+            cd_ChunkSetRemove(self, slot);
+        }
+        else {
+            slot++;
+        }
+    }
+}
+
+void
+MC_ChunkSetSymmetricDifference (MCChunkSet* self, MCChunkSet* other)
+{
+    for (size_t i = 0; i < other->size; i++) {
+        ssize_t slot;
+
+        if (other->keys[i] == MC_CHUNK_SET_EMPTY) {
+            continue;
+        }
+
+        if ((slot = cd_ChunkSetFind(self, other->keys[i])) >= 0) {
+            cd_ChunkSetRemove(self, slot);
+        }
+        else {
+            cd_ChunkSetReserve(self, self->length + 1);
+            cd_ChunkSetInsert(self, other->keys[i]);
+        }
+    }
+}
+
+typedef struct _MCChunkSetRadius {
+    MCChunkPosition center;
+    int             radius;
+
+    MCChunkSetApply removed;
+    CDPointer       data;
+} MCChunkSetRadius;
+
+static inline
+bool
+cd_ChunkInRadius (int x, int z, int radius)
+{
+    return x >= -radius && x < radius && z >= -radius && z < radius && x * x + z * z <= radius * radius;
+}
+
+static
+bool
+cd_ChunkSetOutsideRadius (MCChunkSet* self, MCChunkPosition position, MCChunkSetRadius* radius)
+{
+    if (cd_ChunkInRadius(position.x - radius->center.x, position.z - radius->center.z, radius->radius)) {
+        return false;
+    }
+
+    if (radius->removed) {
+        radius->removed(self, position, radius->data);
+    }
+
+    return true;
+}
+
+void
+MC_ChunkSetMoveRadius (MCChunkSet* self, MCChunkPosition center, int radius, MCChunkSetApply removed, MCChunkSetApply added, CDPointer data)
+{
+    MCChunkSetRadius context = { center, radius, removed, data };
+
+    MC_ChunkSetDeleteIf(self, (MCChunkSetFilter) cd_ChunkSetOutsideRadius, (CDPointer) &context);
+
+    for (int x = -radius; x < radius; x++) {
+        for (int z = -radius; z < radius; z++) {
+            MCChunkPosition position = { center.x + x, center.z + z };
+
+            if (!cd_ChunkInRadius(x, z, radius)) {
+                continue;
+            }
+
+            if (MC_ChunkSetPut(self, position) && added) {
+                added(self, position, data);
+            }
+        }
+    }
+}
@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <beta/EntityTable.h>
+
+#define MC_ENTITY_NONE UINT32_MAX
+
+static inline
+MCEntitySlot*
+cd_EntityTableSlot (MCEntityTable* self, uint32_t index)
+{
+    MCEntitySlot* page = self->pages[index >> MC_ENTITY_PAGE_BITS];
+
+    if (!page) {
+        return NULL;
+    }
+
+    return &page[index & (MC_ENTITY_PAGE_SIZE - 1)];
+}
+
+static inline
+MCEntityId
+cd_EntityId (MCEntitySlot* slot, uint32_t index)
+{
+    return (MCEntityId) ((slot->generation << MC_ENTITY_INDEX_BITS) | index);
+}
+
+static
+MCEntitySlot*
+cd_EntityTablePage (MCEntityTable* self, uint32_t index)
+{
+    MCEntitySlot* slot;
+
+    if ((slot = cd_EntityTableSlot(self, index))) {
+        return slot;
+    }
+
+    pthread_mutex_lock(&self->lock.pages);
+    if (!self->pages[index >> MC_ENTITY_PAGE_BITS]) {
+        MCEntitySlot* page = CD_malloc(sizeof(MCEntitySlot) * MC_ENTITY_PAGE_SIZE);
+
+        for (size_t i = 0; i < MC_ENTITY_PAGE_SIZE; i++) {
+            page[i].generation = 1;
+            page[i].dense      = MC_ENTITY_NONE;
+            page[i].next       = MC_ENTITY_NONE;
+        }
+
+        __sync_synchronize();
+
+        self->pages[index >> MC_ENTITY_PAGE_BITS] = page;
+    }
+    pthread_mutex_unlock(&self->lock.pages);
+
+    return cd_EntityTableSlot(self, index);
+}
+
+/**
+ * Pop a slot from the free list or take a fresh one, the free list head carries
+ * a tag bumped on every pop so a head popped and pushed back in the meantime
+ * makes the CAS fail.
+ */
+static
+uint32_t
+cd_EntityTableAllocate (MCEntityTable* self)
+{
+    uint64_t head;
+    uint32_t index;
+
+    do {
+        head  = self->free;
+        index = (uint32_t) head;
+
+        if (index == MC_ENTITY_NONE) {
+            break;
+        }
+    } while (!__sync_bool_compare_and_swap(&self->free, head,
+        (((head >> 32) + 1) << 32) | cd_EntityTableSlot(self, index)->next));
+
+    if (index != MC_ENTITY_NONE) {
+        return index;
+    }
+
+    if (self->length > MC_ENTITY_INDEX_MASK) {
+        return MC_ENTITY_NONE;
+    }
+
+    if ((index = __sync_fetch_and_add(&self->length, 1)) > MC_ENTITY_INDEX_MASK) {
+        return MC_ENTITY_NONE;
+    }
+
+    cd_EntityTablePage(self, index);
+
+    return index;
+}
+
+static
+void
+cd_EntityTableRelease (MCEntityTable* self, uint32_t index)
+{
+    MCEntitySlot* slot = cd_EntityTableSlot(self, index);
+    uint64_t      head;
+
+    do {
+        head       = self->free;
+        slot->next = (uint32_t) head;
+    } while (!__sync_bool_compare_and_swap(&self->free, head, (head & 0xFFFFFFFF00000000ULL) | index));
+}
+
+/**
+ * Get the dense index of an ID, it has to be called holding lock.dense
+ */
+static
+uint32_t
+cd_EntityTableResolve (MCEntityTable* self, MCEntityId id)
+{
+    MCEntitySlot* slot;
+    uint32_t      index = (uint32_t) id & MC_ENTITY_INDEX_MASK;
+
+    if (id <= 0 || index >= self->length || !(slot = cd_EntityTableSlot(self, index))) {
+        return MC_ENTITY_NONE;
+    }
+
+    if (slot->generation != ((uint32_t) id >> MC_ENTITY_INDEX_BITS)) {
+        return MC_ENTITY_NONE;
+    }
+
+    return slot->dense;
+}
+
+static
+void
+cd_EntityTableGrow (MCEntityTable* self)
+{
+    size_t size = self->dense.size ? self->dense.size * 2 : 64;
+
+    self->dense.id       = CD_realloc(self->dense.id, sizeof(MCEntityId) * size);
+    self->dense.type     = CD_realloc(self->dense.type, sizeof(MCEntityType) * size);
+    self->dense.position = CD_realloc(self->dense.position, sizeof(MCPrecisePosition) * size);
+    self->dense.velocity = CD_realloc(self->dense.velocity, sizeof(MCVelocity) * size);
+    self->dense.data     = CD_realloc(self->dense.data, sizeof(CDPointer) * size);
+
+    self->dense.size = size;
+}
+
+MCEntityTable*
+MC_CreateEntityTable (void)
+{
+    MCEntityTable* self = CD_malloc(sizeof(MCEntityTable));
+
+    for (size_t i = 0; i < MC_ENTITY_PAGES; i++) {
+        self->pages[i] = NULL;
+    }
+
+    self->free   = MC_ENTITY_NONE;
+    self->length = 0;
+
+    self->dense.length   = 0;
+    self->dense.size     = 0;
+    self->dense.id       = NULL;
+    self->dense.type     = NULL;
+    self->dense.position = NULL;
+    self->dense.velocity = NULL;
+    self->dense.data     = NULL;
+
+    if (pthread_rwlock_init(&self->lock.dense, NULL) != 0 || pthread_mutex_init(&self->lock.pages, NULL) != 0) {
+        CD_abort("pthread lock failed to initialize");
+    }
+
+    return self;
+}
+
+void
+MC_DestroyEntityTable (MCEntityTable* self)
+{
+    assert(self);
+
+    for (size_t i = 0; i < MC_ENTITY_PAGES; i++) {
+        CD_free(self->pages[i]);
+    }
+
+    CD_free(self->dense.id);
+    CD_free(self->dense.type);
+    CD_free(self->dense.position);
+    CD_free(self->dense.velocity);
+    CD_free(self->dense.data);
+
+    pthread_rwlock_destroy(&self->lock.dense);
+    pthread_mutex_destroy(&self->lock.pages);
+
+    CD_free(self);
+}
+
+MCEntityId
+MC_EntityTableSpawn (MCEntityTable* self, MCEntityType type, MCPrecisePosition position, CDPointer data)
+{
+    MCEntitySlot* slot;
+    MCEntityId    id;
+    uint32_t      index;
+    size_t        dense;
+
+    assert(self);
+
+    if ((index = cd_EntityTableAllocate(self)) == MC_ENTITY_NONE) {
+        return 0;
+    }
+
+    slot = cd_EntityTableSlot(self, index);
+
+    pthread_rwlock_wrlock(&self->lock.dense);
+    if (self->dense.length == self->dense.size) {
+        cd_EntityTableGrow(self);
+    }
+
+    dense = self->dense.length++;
+    id    = cd_EntityId(slot, index);
+
+    self->dense.id[dense]       = id;
+    self->dense.type[dense]     = type;
+    self->dense.position[dense] = position;
+    self->dense.velocity[dense] = (MCVelocity) { 0, 0, 0 };
+    self->dense.data[dense]     = data;
+
+    slot->dense = dense;
+    pthread_rwlock_unlock(&self->lock.dense);
+
+    return id;
+}
+
+CDPointer
+MC_EntityTableDespawn (MCEntityTable* self, MCEntityId id)
+{
+    MCEntitySlot* slot;
+    CDPointer     data;
+    uint32_t      index = (uint32_t) id & MC_ENTITY_INDEX_MASK;
+    uint32_t      dense;
+    size_t        last;
+
+    assert(self);
+
+    pthread_rwlock_wrlock(&self->lock.dense);
+    if ((dense = cd_EntityTableResolve(self, id)) == MC_ENTITY_NONE) {
+        pthread_rwlock_unlock(&self->lock.dense);
+
+        return CDNull;
+    }
+
+    slot = cd_EntityTableSlot(self, index);
+    data = self->dense.data[dense];
+    last = --self->dense.length;
+
+    // move the last entity in the hole to keep the arrays packed
+    if (dense != last) {
+        MCEntityId moved = self->dense.id[last];
+
+        self->dense.id[dense]       = moved;
+        self->dense.type[dense]     = self->dense.type[last];
+        self->dense.position[dense] = self->dense.position[last];
+        self->dense.velocity[dense] = self->dense.velocity[last];
+        self->dense.data[dense]     = self->dense.data[last];
+
+        cd_EntityTableSlot(self, (uint32_t) moved & MC_ENTITY_INDEX_MASK)->dense = dense;
+    }
+
+    slot->dense      = MC_ENTITY_NONE;
+    slot->generation = (slot->generation % MC_ENTITY_GENERATION_MASK) + 1;
+    pthread_rwlock_unlock(&self->lock.dense);
+
+    cd_EntityTableRelease(self, index);
+
+    return data;
+}
+
+CDPointer
+MC_EntityTableGet (MCEntityTable* self, MCEntityId id)
+{
+    CDPointer result = CDNull;
+    uint32_t  dense;
+
+    assert(self);
+
+    pthread_rwlock_rdlock(&self->lock.dense);
+    if ((dense = cd_EntityTableResolve(self, id)) != MC_ENTITY_NONE) {
+        result = self->dense.data[dense];
+    }
+    pthread_rwlock_unlock(&self->lock.dense);
+
+    return result;
+}
+
+bool
+MC_EntityTableHas (MCEntityTable* self, MCEntityId id)
+{
+    bool result;
+
+    assert(self);
+
+    pthread_rwlock_rdlock(&self->lock.dense);
+    result = cd_EntityTableResolve(self, id) != MC_ENTITY_NONE;
+    pthread_rwlock_unlock(&self->lock.dense);
+
+    return result;
+}
+
+bool
+MC_EntityTableGetPosition (MCEntityTable* self, MCEntityId id, MCPrecisePosition* position)
+{
+    uint32_t dense;
+
+    assert(self);
+    assert(position);
+
+    pthread_rwlock_rdlock(&self->lock.dense);
+    if ((dense = cd_EntityTableResolve(self, id)) != MC_ENTITY_NONE) {
+        *position = self->dense.position[dense];
+    }
+    pthread_rwlock_unlock(&self->lock.dense);
+
+    return dense != MC_ENTITY_NONE;
+}
+
+bool
+MC_EntityTableSetPosition (MCEntityTable* self, MCEntityId id, MCPrecisePosition position)
+{
+    uint32_t dense;
+
+    assert(self);
+
+    pthread_rwlock_wrlock(&self->lock.dense);
+    if ((dense = cd_EntityTableResolve(self, id)) != MC_ENTITY_NONE) {
+        self->dense.position[dense] = position;
+    }
+    pthread_rwlock_unlock(&self->lock.dense);
+
+    return dense != MC_ENTITY_NONE;
+}
+
+bool
+MC_EntityTableSetVelocity (MCEntityTable* self, MCEntityId id, MCVelocity velocity)
+{
+    uint32_t dense;
+
+    assert(self);
+
+    pthread_rwlock_wrlock(&self->lock.dense);
+    if ((dense = cd_EntityTableResolve(self, id)) != MC_ENTITY_NONE) {
+        self->dense.velocity[dense] = velocity;
+    }
+    pthread_rwlock_unlock(&self->lock.dense);
+
+    return dense != MC_ENTITY_NONE;
+}
+
+size_t
+MC_EntityTableLength (MCEntityTable* self)
+{
+    size_t result;
+
+    assert(self);
+
+    pthread_rwlock_rdlock(&self->lock.dense);
+    result = self->dense.length;
+    pthread_rwlock_unlock(&self->lock.dense);
+
+    return result;
+}
+
+void
+MC_EntityTableMove (MCEntityTable* self)
+{
+    assert(self);
+
+    pthread_rwlock_wrlock(&self->lock.dense);
+    MC_ENTITY_TABLE_FOREACH(self, i) {
+        MCVelocity velocity = self->dense.velocity[i];
+
+        if (velocity.x == 0 && velocity.y == 0 && velocity.z == 0) {
+            continue;
+        }
+
+        self->dense.position[i].x += velocity.x / MC_ENTITY_VELOCITY_SCALE;
+        self->dense.position[i].y += velocity.y / MC_ENTITY_VELOCITY_SCALE;
+        self->dense.position[i].z += velocity.z / MC_ENTITY_VELOCITY_SCALE;
+    }
+    pthread_rwlock_unlock(&self->lock.dense);
+}
+
+void
+MC_EntityTableLock (MCEntityTable* self)
+{
+    assert(self);
+
+    pthread_rwlock_rdlock(&self->lock.dense);
+}
+
+void
+MC_EntityTableUnlock (MCEntityTable* self)
+{
+    assert(self);
+
+    pthread_rwlock_unlock(&self->lock.dense);
+}
@@ -165,6 +165,10 @@ CD_DestroyPacketData (CDPacket* self)
                     CDPacketMapChunk* packet = (CDPacketMapChunk*) self->data;
 
                     CD_free(packet->response.item);
+
+                    if (packet->response.buffer) {
+                        CD_DestroyBuffer(packet->response.buffer);
+                    }
                 } break;
 
                 case CDMultiBlockChange: {
@@ -774,7 +778,12 @@ CD_PacketToBuffer (CDPacket* self)
 
                     CD_BufferAddInteger(data, packet->response.length);
 
-                    CD_BufferAdd(data, (CDPointer) packet->response.item, packet->response.length * MCByteSize);
+                    if (packet->response.buffer) {
+                        CD_BufferMoveBuffer(data, packet->response.buffer);
+                    }
+                    else {
+                        CD_BufferAdd(data, (CDPointer) packet->response.item, packet->response.length * MCByteSize);
+                    }
                 } break;
 
                 case CDMultiBlockChange: {
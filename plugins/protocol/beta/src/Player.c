@@ -27,6 +27,10 @@
 
 #include <beta/Player.h>
 
+CDDynamicSlot MCSlotClientPlayer;
+CDDynamicSlot MCSlotPlayerLoadedChunks;
+CDDynamicSlot MCSlotPlayerSeenPlayers;
+
 CDPlayer*
 CD_CreatePlayer (CDClient* client)
 {
@@ -24,6 +24,7 @@
  */
 
 #include <beta/Region.h>
+#include <beta/World.h>
 
 bool
 CD_IsCoordInRadius (MCChunkPosition* coord, MCChunkPosition* centerCoord, int radius)
@@ -58,15 +59,17 @@ CD_RelativeMove (MCPrecisePosition* a, MCPrecisePosition* b)
 void
 CD_RegionBroadcastPacket (CDPlayer* player, CDPacket* packet)
 {
-    CDList* seenPlayers = (CDList*) CD_DynamicGet(player, "Player.seenPlayers");
+    CDVector* seenPlayers = (CDVector*) CD_DynamicGetSlot(player, MCSlotPlayerSeenPlayers);
 
-    CD_LIST_FOREACH(seenPlayers, it) {
-        if (player == (CDPlayer*) CD_ListIteratorValue(it)) {
+    pthread_rwlock_rdlock(&player->world->lock.seen);
+    CD_VECTOR_FOREACH(seenPlayers, i) {
+        if (player == (CDPlayer*) CD_VectorGet(seenPlayers, i)) {
             continue;
         }
 
-        CD_PlayerSendPacket((CDPlayer*) CD_ListIteratorValue(it), packet);
+        CD_PlayerSendPacket((CDPlayer*) CD_VectorGet(seenPlayers, i), packet);
     }
+    pthread_rwlock_unlock(&player->world->lock.seen);
 }
 
 
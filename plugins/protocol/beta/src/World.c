@@ -25,6 +25,91 @@
 
 #include <beta/World.h>
 
+CDDynamicSlot MCSlotWorldList;
+CDDynamicSlot MCSlotWorldDefault;
+
+/* World name to raw world config, compiled from the plugin config, each section
+ * holds a reference so it outlives the config it comes from */
+static CDHash* _worlds = NULL;
+
+static
+void
+cd_WorldsDestroyConfig (CDHash* worlds)
+{
+    CD_HASH_FOREACH(worlds, it) {
+        json_decref((json_t*) CD_HashIteratorValue(it));
+    }
+
+    CD_DestroyHash(worlds);
+}
+
+static
+void
+cd_WorldReleaseConfig (CDRawConfig config)
+{
+    json_decref(config);
+}
+
+void
+CD_WorldsLoadConfig (CDServer* server, CDRawConfig config)
+{
+    CDHash* worlds = CD_CreateHash();
+    CDHash* old;
+
+    J_DO {
+        J_FOREACH(world, config, "worlds") {
+            J_IF_STRING(world, "name") {
+                if (!CD_HashHasKey(worlds, J_STRING_VALUE)) {
+                    CD_HashPut(worlds, J_STRING_VALUE, (CDPointer) json_incref((json_t*) world));
+                }
+            }
+        }
+    }
+
+    old = __sync_lock_test_and_set(&_worlds, worlds);
+
+    if (!old) {
+        return;
+    }
+
+    CDList* list = (CDList*) CD_DynamicGetSlot(server, MCSlotWorldList);
+
+    if (list) {
+        CD_LIST_FOREACH(list, it) {
+            CDWorld*    world   = (CDWorld*) CD_ListIteratorValue(it);
+            CDRawConfig current = world->config;
+            CDRawConfig next    = (CDRawConfig) CD_HashGet(worlds, CD_StringContent(world->name));
+
+            // a running world can't go without settings, it keeps the ones it has until a restart
+            if (!next) {
+                if (current) {
+                    SLOG(server, LOG_WARNING, "world %s has been removed from the config, keeping its settings until a restart",
+                        CD_StringContent(world->name));
+                }
+
+                continue;
+            }
+
+            world->config = json_incref(next);
+
+            if (current) {
+                CD_ServerRetire(server, (CDPointer) current, (void (*)(CDPointer)) cd_WorldReleaseConfig);
+            }
+        }
+    }
+
+    CD_ServerRetire(server, (CDPointer) old, (void (*)(CDPointer)) cd_WorldsDestroyConfig);
+}
+
+void
+CD_WorldsUnloadConfig (void)
+{
+    if (_worlds) {
+        cd_WorldsDestroyConfig(_worlds);
+        _worlds = NULL;
+    }
+}
+
 CDWorld*
 CD_CreateWorld (CDServer* server, const char* name)
 {
@@ -36,25 +121,20 @@ CD_CreateWorld (CDServer* server, const char* name)
         CD_abort("pthread spinlock failed to initialize");
     }
 
+    if (pthread_rwlock_init(&self->lock.seen, NULL) != 0) {
+        CD_abort("pthread rwlock failed to initialize");
+    }
+
     self->server = server;
 
-    J_DO { self->config = NULL;
-        J_FOREACH(world, CD_GetPlugin(server->plugins, "protocol.beta")->config, "worlds") {
-            J_IF_STRING(world, "name") {
-                if (CD_CStringIsEqual(J_STRING_VALUE, name)) {
-                    self->config = (CDRawConfig) world;
-                    break;
-                }
-            }
-        }
-    }
+    self->config = json_incref((CDRawConfig) CD_HashGet(_worlds, name));
 
     self->name      = CD_CreateStringFromCStringCopy(name);
     self->dimension = CDWorldNormal;
     self->time      = 0;
 
     self->players  = CD_CreateHash();
-    self->entities = CD_CreateMap();
+    self->entities = MC_CreateEntityTable();
 
     self->chunks = CD_CreateSetWith(2000, (CDSetCompare) MC_CompareChunkPosition, (CDSetHash) MC_HashChunkPosition);
 
@@ -92,35 +172,40 @@ CD_DestroyWorld (CDWorld* self)
     }
 
     CD_DestroyHash(self->players);
-    CD_DestroyMap(self->entities);
+    MC_DestroyEntityTable(self->entities);
 
     CD_DestroySet(self->chunks);
 
     CD_DestroyString(self->name);
 
+    json_decref(self->config);
+
     CD_DestroyDynamic(DYNAMIC(self));
 
     pthread_spin_destroy(&self->lock.time);
+    pthread_rwlock_destroy(&self->lock.seen);
 
     CD_free(self);
 }
 
-// FIXME: This is just a dummy function
 MCEntityId
-CD_WorldGenerateEntityId (CDWorld* self)
+CD_WorldAddEntity (CDWorld* self, MCEntity* entity, CDPointer data)
 {
-    MCEntityId result;
+    assert(self);
+    assert(entity);
+
+    return entity->id = MC_EntityTableSpawn(self->entities, entity->type, entity->position, data);
+}
 
+void
+CD_WorldRemoveEntity (CDWorld* self, MCEntity* entity)
+{
     assert(self);
+    assert(entity);
 
-    if (CD_MapLength(self->entities) != 0) {
-        result = ((MCEntity*) CD_MapLast(self->entities))->id + 1;
-    }
-    else {
-        result = 10;
-    }
+    MC_EntityTableDespawn(self->entities, entity->id);
 
-    return result;
+    entity->id = 0;
 }
 
 void
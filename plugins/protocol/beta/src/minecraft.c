@@ -112,30 +112,39 @@ MC_AppendData (MCMetadata* metadata, MCData* data)
     return metadata;
 }
 
+static
 bool
-MC_StringIsValid (MCString self)
+cd_CharsetHas (const char* ch, size_t size)
 {
-    assert(self);
+    char buffer[5];
 
-    for (size_t i = 0, ie = CD_StringLength(self); i < ie; i++) {
-        bool      has = false;
-        CDString* ch  = CD_CharAt(self, i);
+    // ASCII bytes never appear inside multibyte chars
+    if (size == 1) {
+        return ch[0] != '\0' && (ch[0] & 0x80) == 0 && strchr(MCCharset, ch[0]) != NULL;
+    }
 
-        for (size_t h = 0, he = CD_UTF8_strlen(MCCharset); h < he; h++) {
-            const char* che = &MCCharset[CD_UTF8_offset(MCCharset, h)];
+    if (size >= sizeof(buffer) || !CD_UTF8_valid(ch, size)) {
+        return false;
+    }
 
-            if (strncmp(CD_StringContent(ch), che, CD_StringSize(ch)) == 0) {
-                has = true;
-                break;
-            }
-        }
+    memcpy(buffer, ch, size);
+    buffer[size] = '\0';
+
+    return strstr(MCCharset, buffer) != NULL;
+}
+
+bool
+MC_StringIsValid (MCString self)
+{
+    assert(self);
 
-        if (!has && !(strncmp(CD_StringContent(ch), "§", 2) == 0 && i < ie - 2)) {
-            CD_DestroyString(ch);
+    size_t length = CD_StringLength(self);
+
+    CD_STRING_FOREACH(self, it) {
+        if (!cd_CharsetHas(CD_StringIteratorValue(it), CD_StringIteratorSize(it)) &&
+            !(CD_StringIteratorIs(it, "§") && CD_StringIteratorIndex(it) < length - 2)) {
             return false;
         }
-
-        CD_DestroyString(ch);
     }
 
     return true;
@@ -148,36 +157,25 @@ MC_StringSanitize (MCString self)
 
     assert(self);
 
-    for (size_t i = 0, ie = CD_StringLength(self); i < ie; i++) {
-        bool      has = false;
-        CDString* ch  = CD_CharAt(self, i);
+    size_t length = CD_StringLength(self);
 
-        for (size_t h = 0, he = CD_UTF8_strlen(MCCharset); h < he; h++) {
-            const char* che = &MCCharset[CD_UTF8_offset(MCCharset, h)];
+    CD_STRING_FOREACH(self, it) {
+        const char* ch    = CD_StringIteratorValue(it);
+        size_t      size  = CD_StringIteratorSize(it);
+        bool        color = CD_StringIteratorIs(it, "§");
 
-            if (strncmp(CD_StringContent(ch), che, CD_StringSize(ch)) == 0) {
-                has = true;
-                break;
-            }
-        }
-
-        if (i == ie - 2 && strncmp(CD_StringContent(ch), "§", 2) == 0){
-            CD_DestroyString(ch);
+        if (color && CD_StringIteratorIndex(it) == length - 2) {
             break;
         }
 
-        if (has || strncmp(CD_StringContent(ch), "§", 2) == 0) {
-            CD_AppendString(result, ch);
+        if (color || cd_CharsetHas(ch, size)) {
+            CD_AppendBuffer(result, ch, size);
         }
         else {
             CD_AppendCString(result, "?");
         }
-
-        CD_DestroyString(ch);
     }
 
-    self->length = CD_UTF8_strnlen(CD_StringContent(self), self->raw->slen);
-
     return result;
 }
 
@@ -25,9 +25,13 @@
 
 #include <craftd/Server.h>
 #include <craftd/Plugin.h>
+#include <craftd/Digest.h>
 
 #include <beta/Player.h>
 #include <beta/minecraft.h>
+#include <beta/Chunk.h>
+#include <beta/ChunkSet.h>
+#include <beta/EntityTable.h>
 
 #include <tinytest/tinytest.h>
 #include <tinytest/tinytest_macros.h>
@@ -45,8 +49,58 @@ cdtest_String_fromBuffer (void* data)
     }
 }
 
+void
+cdtest_String_append (void* data)
+{
+    CDString* string = CD_CreateStringFromCString("Æ§");
+    CDString* append = CD_CreateStringFromCStringCopy(" and a string longer than the inline storage");
+
+    CD_AppendString(string, append);
+    CD_AppendCString(string, "Ð");
+    CD_AppendString(string, string);
+
+    tt_int_op(string->external, ==, false);
+    tt_int_op(CD_StringLength(string), ==, 2 * (3 + CD_StringLength(append)));
+    tt_int_op(CD_StringLength(string), ==, CD_UTF8_strlen(CD_StringContent(string)));
+
+    end: {
+        CD_DestroyString(string);
+        CD_DestroyString(append);
+    }
+}
+
+void
+cdtest_String_arena (void* data)
+{
+    char          storage[64];
+    CDStringArena arena;
+    CDString*     small;
+    CDString*     large;
+
+    CD_InitializeStringArena(&arena, storage, sizeof(storage));
+
+    small = CD_CreateStringFromFormatInArena(&arena, "%d", 42);
+    large = CD_CreateStringFromFormatInArena(&arena, "%s %0128d", "padded", 0);
+
+    tt_assert(CD_StringIsEqual(small, "42"));
+    tt_int_op(CD_StringLength(large), ==, 7 + 128);
+
+    CD_AppendString(small, large);
+
+    tt_int_op(CD_StringLength(small), ==, 2 + 7 + 128);
+    tt_assert(CD_StringStartWith(small, "42padded 000"));
+
+    CD_DestroyString(small);
+
+    end: {
+        CD_FinalizeStringArena(&arena);
+    }
+}
+
 struct testcase_t cd_utils_String_tests[] = {
     { "fromBuffer", cdtest_String_fromBuffer, },
+    { "append",     cdtest_String_append, },
+    { "arena",      cdtest_String_arena, },
 
     END_OF_TESTCASES
 };
@@ -79,9 +133,52 @@ cdtest_String_UTF8_charAt (void* data)
     }
 }
 
+void
+cdtest_String_UTF8_valid (void* data)
+{
+    tt_assert(CD_UTF8_valid("plain ascii, long enough for a block", 36));
+    tt_assert(CD_UTF8_valid("Æ§Ð €𝄞", 14));
+    tt_assert(!CD_UTF8_valid("\xC0\xAF", 2));
+    tt_assert(!CD_UTF8_valid("\xED\xA0\x80", 3));
+    tt_assert(!CD_UTF8_valid("\xF4\x90\x80\x80", 4));
+    tt_assert(!CD_UTF8_valid("truncated \xE2\x82", 12));
+
+    tt_int_op(CD_UTF8_strlen("\xA0 stray continuation"), ==, 19);
+
+    end: {}
+}
+
+void
+cdtest_String_UTF8_iterator (void* data)
+{
+    CDString* test   = CD_CreateStringFromCString("aÆ§Ð€b and some more text to cross a block");
+    size_t    chars  = 0;
+    size_t    offset = 0;
+
+    CD_STRING_FOREACH(test, it) {
+        tt_int_op(CD_StringIteratorIndex(it), ==, chars);
+        tt_int_op(CD_StringIteratorValue(it) - CD_StringContent(test), ==, offset);
+
+        offset += CD_StringIteratorSize(it);
+        chars++;
+    }
+
+    tt_int_op(chars, ==, CD_StringLength(test));
+    tt_int_op(offset, ==, CD_StringSize(test));
+
+    tt_assert(CD_StringIteratorIs(CD_StringAt(test, 2), "§"));
+    tt_assert(CD_StringIteratorIs(CD_StringNext(CD_StringAt(test, 4)), "b"));
+
+    end: {
+        CD_DestroyString(test);
+    }
+}
+
 struct testcase_t cd_utils_String_UTF8_tests[] = {
-    { "length", cdtest_String_UTF8_length, },
-    { "charAt", cdtest_String_UTF8_charAt, },
+    { "length",   cdtest_String_UTF8_length, },
+    { "charAt",   cdtest_String_UTF8_charAt, },
+    { "valid",    cdtest_String_UTF8_valid, },
+    { "iterator", cdtest_String_UTF8_iterator, },
 
     END_OF_TESTCASES
 };
@@ -359,6 +456,152 @@ struct testcase_t cd_utils_List_tests[] = {
     END_OF_TESTCASES
 };
 
+void
+cdtest_Vector_push (void* data)
+{
+    CDVector* vector = CD_CreateVector();
+
+    for (CDPointer i = 1; i <= 100; i++) {
+        CD_VectorPush(vector, i);
+    }
+
+    tt_int_op(CD_VectorLength(vector), ==, 100);
+    tt_int_op(CD_VectorGet(vector, 41), ==, 42);
+    tt_int_op(CD_VectorIndexOf(vector, 42), ==, 41);
+    tt_int_op(CD_VectorIndexOf(vector, 101), ==, -1);
+
+    end: {
+        CD_DestroyVector(vector);
+    }
+}
+
+void
+cdtest_Vector_delete (void* data)
+{
+    CDVector* vector = CD_CreateVector();
+
+    CD_VectorPush(vector, 1);
+    CD_VectorPush(vector, 2);
+    CD_VectorPush(vector, 3);
+    CD_VectorPush(vector, 4);
+
+    tt_int_op(CD_VectorDelete(vector, 2), ==, 2);
+    tt_int_op(CD_VectorGet(vector, 1), ==, 3);
+
+    tt_int_op(CD_VectorFastDelete(vector, 1), ==, 1);
+    tt_int_op(CD_VectorGet(vector, 0), ==, 4);
+
+    tt_int_op(CD_VectorDelete(vector, 42), ==, CDNull);
+    tt_int_op(CD_VectorLength(vector), ==, 2);
+
+    end: {
+        CD_DestroyVector(vector);
+    }
+}
+
+void
+cdtest_Vector_sortedPush (void* data)
+{
+    CDVector* vector = CD_CreateVector();
+
+    CD_VectorSortedPush(vector, 3, cdtest_ListCompare);
+    CD_VectorSortedPush(vector, 1, cdtest_ListCompare);
+    CD_VectorSortedPush(vector, 2, cdtest_ListCompare);
+
+    CD_VECTOR_FOREACH(vector, i) {
+        tt_int_op(CD_VectorGet(vector, i), ==, i + 1);
+    }
+
+    end: {
+        CD_DestroyVector(vector);
+    }
+}
+
+struct testcase_t cd_utils_Vector_tests[] = {
+    { "push",        cdtest_Vector_push, },
+    { "delete",      cdtest_Vector_delete, },
+    { "sorted push", cdtest_Vector_sortedPush, },
+
+    END_OF_TESTCASES
+};
+
+typedef struct _CDTestLinked {
+    int    value;
+    CDLink link;
+} CDTestLinked;
+
+void
+cdtest_LinkedList_foreach (void* data)
+{
+    CDTestLinked items[4];
+    CDLinkedList list;
+    int          sum = 0;
+
+    CD_InitializeLinkedList(&list);
+
+    for (int i = 0; i < 4; i++) {
+        items[i].value = i + 1;
+
+        CD_InitializeLink(&items[i].link);
+        CD_LinkedListPush(&list, &items[i].link);
+    }
+
+    tt_int_op(CD_LinkedListLength(&list), ==, 4);
+
+    CD_LINKED_LIST_FOREACH(&list, it) {
+        CDTestLinked* item = CD_LINK_OWNER(it, CDTestLinked, link);
+
+        if (item->value % 2 == 0) {
+            CD_LinkedListDelete(&list, it);
+        }
+        else {
+            sum += item->value;
+        }
+    }
+
+    tt_int_op(sum, ==, 4);
+    tt_int_op(CD_LinkedListLength(&list), ==, 2);
+    tt_assert(!CD_LinkIsLinked(&items[1].link));
+
+    tt_assert(CD_LinkedListShift(&list) == &items[0].link);
+    tt_assert(CD_LinkedListShift(&list) == &items[2].link);
+    tt_assert(CD_LinkedListShift(&list) == NULL);
+    tt_assert(CD_LinkedListIsEmpty(&list));
+
+    end: {}
+}
+
+void
+cdtest_LinkedList_splice (void* data)
+{
+    CDLink       links[3];
+    CDLinkedList first;
+    CDLinkedList second;
+
+    CD_InitializeLinkedList(&first);
+    CD_InitializeLinkedList(&second);
+
+    CD_LinkedListPush(&first, &links[0]);
+    CD_LinkedListPush(&second, &links[1]);
+    CD_LinkedListPush(&second, &links[2]);
+
+    CD_LinkedListSplice(&first, &second);
+
+    tt_int_op(CD_LinkedListLength(&first), ==, 3);
+    tt_assert(CD_LinkedListIsEmpty(&second));
+    tt_assert(first.head.prev == &links[2]);
+    tt_assert(links[2].next == &first.head);
+
+    end: {}
+}
+
+struct testcase_t cd_utils_LinkedList_tests[] = {
+    { "foreach", cdtest_LinkedList_foreach, },
+    { "splice",  cdtest_LinkedList_splice, },
+
+    END_OF_TESTCASES
+};
+
 void
 cdtest_Set_put (void* data)
 {
@@ -418,6 +661,199 @@ struct testcase_t cd_utils_Set_tests[] = {
     END_OF_TESTCASES
 };
 
+typedef struct _CDTestDynamic {
+    CD_DEFINE_DYNAMIC;
+} CDTestDynamic;
+
+void
+cdtest_Dynamic_slots (void* data)
+{
+    CDTestDynamic object = { CD_CreateDynamic() };
+    CDDynamicSlot slot   = CD_ReserveDynamicSlot("Test.slot");
+
+    tt_int_op(CD_ReserveDynamicSlot("Test.slot"), ==, slot);
+    tt_int_op(CD_ReserveDynamicSlot("Test.other"), !=, slot);
+
+    tt_int_op(CD_DynamicPutSlot(&object, slot, 42), ==, CDNull);
+    tt_int_op(CD_DynamicGetSlot(&object, slot), ==, 42);
+
+    // the string API goes through the slot for reserved names
+    tt_int_op(CD_DynamicGet(&object, "Test.slot"), ==, 42);
+    tt_int_op(CD_DynamicPut(&object, "Test.slot", 23), ==, 42);
+    tt_int_op(CD_DynamicGetSlot(&object, slot), ==, 23);
+
+    tt_int_op(CD_DynamicDeleteSlot(&object, slot), ==, 23);
+    tt_int_op(CD_DynamicGet(&object, "Test.slot"), ==, CDNull);
+
+    // and the Hash for the others
+    CD_DynamicPut(&object, "Test.hash", 1337);
+
+    tt_int_op(CD_DynamicGet(&object, "Test.hash"), ==, 1337);
+    tt_int_op(CD_DynamicDelete(&object, "Test.hash"), ==, 1337);
+
+    end: {
+        CD_DestroyDynamic(DYNAMIC(&object));
+    }
+}
+
+struct testcase_t cd_utils_Dynamic_tests[] = {
+    { "slots", cdtest_Dynamic_slots, },
+
+    END_OF_TESTCASES
+};
+
+static
+void
+cdtest_TimeLoop_count (evutil_socket_t fd, short events, int* counter)
+{
+    (*counter)++;
+}
+
+void
+cdtest_TimeLoop_timeout (void* data)
+{
+    CDTimeLoop* timeloop = CD_CreateTimeLoop(NULL);
+    uint64_t    now      = CD_TimeLoopNow(timeloop);
+    int         counter  = 0;
+
+    CD_SetTimeout(timeloop, 1, (event_callback_fn) cdtest_TimeLoop_count, (CDPointer) &counter);
+    CD_SetTimeout(timeloop, 600, (event_callback_fn) cdtest_TimeLoop_count, (CDPointer) &counter);
+
+    CDTimerId cleared = CD_SetTimeout(timeloop, 5, (event_callback_fn) cdtest_TimeLoop_count, (CDPointer) &counter);
+    CD_ClearTimeout(timeloop, cleared);
+
+    tt_int_op(CD_TimeLoopExpire(timeloop, now + 50), ==, 0);
+    tt_int_op(CD_TimeLoopExpire(timeloop, now + 200), ==, 1);
+    tt_int_op(counter, ==, 1);
+
+    // the 10 minutes one went through the upper levels of the wheel
+    tt_int_op(CD_TimeLoopExpire(timeloop, now + 59000), ==, 0);
+    tt_int_op(CD_TimeLoopExpire(timeloop, now + 61000), ==, 1);
+    tt_int_op(counter, ==, 2);
+
+    // clearing a stale ID doesn't touch the timer reusing its index
+    CD_SetTimeout(timeloop, 1, (event_callback_fn) cdtest_TimeLoop_count, (CDPointer) &counter);
+    CD_ClearTimeout(timeloop, cleared);
+
+    tt_int_op(CD_TimeLoopExpire(timeloop, now + 62000), ==, 1);
+
+    end: {
+        CD_DestroyTimeLoop(timeloop);
+    }
+}
+
+void
+cdtest_TimeLoop_interval (void* data)
+{
+    CDTimeLoop* timeloop = CD_CreateTimeLoop(NULL);
+    uint64_t    now      = CD_TimeLoopNow(timeloop);
+    int         counter  = 0;
+    CDTimerId   interval = CD_SetInterval(timeloop, 1, (event_callback_fn) cdtest_TimeLoop_count, (CDPointer) &counter);
+
+    for (int i = 1; i <= 10; i++) {
+        CD_TimeLoopExpire(timeloop, now + i * 100 + 50);
+    }
+
+    tt_int_op(counter, ==, 10);
+
+    CD_ClearInterval(timeloop, interval);
+    CD_TimeLoopExpire(timeloop, now + 5000);
+
+    tt_int_op(counter, ==, 10);
+
+    end: {
+        CD_DestroyTimeLoop(timeloop);
+    }
+}
+
+struct testcase_t cd_utils_TimeLoop_tests[] = {
+    { "timeout",  cdtest_TimeLoop_timeout, },
+    { "interval", cdtest_TimeLoop_interval, },
+
+    END_OF_TESTCASES
+};
+
+typedef struct _cdtest_TickerEntry {
+    CDVector*   log;
+    CDTickPhase phase;
+} cdtest_TickerEntry;
+
+static
+void
+cdtest_Ticker_record (CDServer* server, uint64_t tick, cdtest_TickerEntry* entry)
+{
+    CD_VectorPush(entry->log, (CDPointer) entry->phase);
+}
+
+void
+cdtest_Ticker_phases (void* data)
+{
+    CDTicker*          ticker = CD_CreateTicker(NULL);
+    CDVector*          log    = CD_CreateVector();
+    cdtest_TickerEntry entries[CDTickPhases];
+
+    // registered backwards, they still run in phase order
+    for (int phase = CDTickPhases - 1; phase >= 0; phase--) {
+        entries[phase].log   = log;
+        entries[phase].phase = phase;
+
+        CD_TickerRegister(ticker, phase, (CDTickFunction) cdtest_Ticker_record, (CDPointer) &entries[phase]);
+    }
+
+    tt_assert(CD_TickerStep(ticker, ticker->deadline));
+    tt_int_op(CD_VectorLength(log), ==, CDTickPhases);
+
+    CD_VECTOR_FOREACH(log, i) {
+        tt_int_op(CD_VectorGet(log, i), ==, i);
+    }
+
+    tt_assert(CD_TickerUnregister(ticker, CDTickWorld, (CDTickFunction) cdtest_Ticker_record, (CDPointer) &entries[CDTickWorld]));
+    tt_assert(!CD_TickerUnregister(ticker, CDTickWorld, (CDTickFunction) cdtest_Ticker_record, (CDPointer) &entries[CDTickWorld]));
+
+    CD_VectorClear(log);
+
+    tt_assert(CD_TickerStep(ticker, ticker->deadline));
+    tt_int_op(CD_VectorLength(log), ==, CDTickPhases - 1);
+    tt_assert(!CD_VectorContains(log, CDTickWorld));
+
+    end: {
+        CD_DestroyTicker(ticker);
+        CD_DestroyVector(log);
+    }
+}
+
+void
+cdtest_Ticker_schedule (void* data)
+{
+    CDTicker* ticker  = CD_CreateTicker(NULL);
+    uint64_t  start   = ticker->deadline;
+    int64_t   skipped = CD_MetricValue(ticker->metrics.skipped);
+
+    tt_assert(CD_TickerStep(ticker, start));
+    tt_assert(!CD_TickerStep(ticker, start + CD_TICKER_PERIOD / 2));
+
+    // a late tick runs right away and the next deadline doesn't move
+    tt_assert(CD_TickerStep(ticker, start + CD_TICKER_PERIOD + CD_TICKER_PERIOD / 2));
+    tt_int_op(ticker->deadline, ==, start + 2 * CD_TICKER_PERIOD);
+
+    // three whole periods behind, those ticks are skipped
+    tt_assert(CD_TickerStep(ticker, start + 5 * CD_TICKER_PERIOD + CD_TICKER_PERIOD / 2));
+    tt_int_op(ticker->deadline, ==, start + 6 * CD_TICKER_PERIOD);
+    tt_int_op(ticker->tick, ==, 3);
+    tt_int_op(CD_MetricValue(ticker->metrics.skipped) - skipped, ==, 3);
+
+    end: {
+        CD_DestroyTicker(ticker);
+    }
+}
+
+struct testcase_t cd_utils_Ticker_tests[] = {
+    { "phases",   cdtest_Ticker_phases, },
+    { "schedule", cdtest_Ticker_schedule, },
+
+    END_OF_TESTCASES
+};
+
 void
 cdtest_Regexp_match (void* data)
 {
@@ -450,9 +886,528 @@ cdtest_Regexp_test (void* data)
     }
 }
 
+void
+cdtest_Regexp_exec (void* data)
+{
+    CDRegexp*        regexp  = CD_GetRegexp("^(\\w+)(?:\\s+(.*?))?$", CDRegexpNone);
+    const char*      subject = "ticket list open";
+    CDRegexpCaptures captures;
+
+    tt_assert(regexp == CD_GetRegexp("^(\\w+)(?:\\s+(.*?))?$", CDRegexpNone));
+    tt_assert(regexp != CD_GetRegexp("^(\\w+)(?:\\s+(.*?))?$", CDRegexpCaseInsensitive));
+
+    tt_assert(CD_RegexpExec(regexp, subject, strlen(subject), &captures));
+    tt_assert(CD_RegexpCaptureIsEqual(&captures, 1, "ticket"));
+    tt_assert(CD_RegexpCaptureStart(&captures, 2) == subject + 7);
+    tt_int_op(CD_RegexpCaptureLength(&captures, 2), ==, 9);
+
+    tt_assert(CD_RegexpExec(regexp, "ticket", 6, &captures));
+    tt_assert(!CD_RegexpCaptureIsSet(&captures, 2));
+
+    tt_assert(!CD_RegexpExec(regexp, "", 0, &captures));
+
+    tt_assert(regexp == CD_GetRegexp("^(\\w+)(?:\\s+(.*?))?$", CDRegexpNone));
+    tt_assert(CD_GetRegexp("^(\\w+)(?:\\s+(.*?))?$", CDRegexpCaseInsensitive) ==
+        CD_GetRegexp("^(\\w+)(?:\\s+(.*?))?$", CDRegexpCaseInsensitive));
+
+    end: {}
+}
+
+void
+cdtest_Regexp_groups (void* data)
+{
+    CDRegexp*        regexp  = CD_GetRegexp("^(a)(b)(c)(d)(e)(f)(g)(h)(i)(j)(k)(l)(m)(n)(o)(p)$", CDRegexpNone);
+    CDString*        subject = CD_CreateStringFromCString("abcdefghijklmnop");
+    CDString*        other   = CD_CreateStringFromCString("abcdefghijklmno");
+    CDRegexpMatches* matches = NULL;
+    CDRegexpCaptures captures;
+
+    tt_assert(regexp);
+    tt_int_op(regexp->captures, ==, CD_REGEXP_CAPTURES + 1);
+
+    // too many groups for the captures, rather not match than lose the last one
+    tt_assert(!CD_RegexpExec(regexp, CD_StringContent(subject), CD_StringSize(subject), &captures));
+
+    // a plain test doesn't need any of the groups
+    tt_assert(CD_RegexpTest(regexp, subject));
+    tt_assert(!CD_RegexpTest(regexp, other));
+
+    tt_assert(matches = CD_RegexpMatch(regexp, subject));
+    tt_int_op(matches->matched, ==, CD_REGEXP_CAPTURES + 1);
+    tt_assert(CD_StringIsEqual(matches->item[CD_REGEXP_CAPTURES + 1], "p"));
+
+    end: {
+        if (matches) {
+            CD_DestroyRegexpMatches(matches);
+        }
+
+        CD_DestroyString(subject);
+        CD_DestroyString(other);
+    }
+}
+
 struct testcase_t cd_utils_Regexp_tests[] = {
-    { "match", cdtest_Regexp_match, },
-    { "test",  cdtest_Regexp_test, },
+    { "match",  cdtest_Regexp_match, },
+    { "test",   cdtest_Regexp_test, },
+    { "exec",   cdtest_Regexp_exec, },
+    { "groups", cdtest_Regexp_groups, },
+
+    END_OF_TESTCASES
+};
+
+static
+bool
+cdtest_CommandHandler (CDServer* server, CDPointer sender, CDString* arguments)
+{
+    *((int*) sender) = arguments ? CD_StringLength(arguments) : 0;
+
+    return true;
+}
+
+static
+int
+cdtest_CommandLevel (CDServer* server, CDPointer sender)
+{
+    return 0;
+}
+
+static
+CDCommandStatus
+cdtest_CommandDispatch (CDCommands* commands, int* result, const char* line)
+{
+    CDString*       string = CD_CreateStringFromCString(line);
+    CDCommandStatus status = CD_CommandsDispatch(commands, (CDPointer) result, string);
+
+    CD_DestroyString(string);
+
+    return status;
+}
+
+void
+cdtest_Commands_dispatch (void* data)
+{
+    CDCommands* commands = CD_CreateCommands(NULL);
+    int         result   = -1;
+
+    tt_assert(CD_RegisterCommand(commands, "ticket", 0, cdtest_CommandHandler));
+    tt_assert(!CD_RegisterCommand(commands, "ticket", 0, cdtest_CommandHandler));
+    tt_assert(!CD_RegisterCommand(commands, "two words", 0, cdtest_CommandHandler));
+    tt_assert(CD_RegisterCommand(commands, "reload", 3, cdtest_CommandHandler));
+    tt_assert(CD_RegisterCommandAlias(commands, "ticket", "t"));
+
+    tt_int_op(cdtest_CommandDispatch(commands, &result, "TICKET  list open "), ==, CDCommandHandled);
+    tt_int_op(result, ==, 9);
+
+    tt_int_op(cdtest_CommandDispatch(commands, &result, "t"), ==, CDCommandHandled);
+    tt_int_op(result, ==, 0);
+
+    tt_int_op(cdtest_CommandDispatch(commands, &result, "tick"), ==, CDCommandNotFound);
+    tt_int_op(cdtest_CommandDispatch(commands, &result, "reload"), ==, CDCommandDenied);
+
+    CD_CommandsSetLevel(commands, cdtest_CommandLevel);
+    tt_int_op(cdtest_CommandDispatch(commands, &result, "reload"), ==, CDCommandDenied);
+
+    CD_UnregisterCommand(commands, "t");
+    tt_assert(!CD_CommandsHas(commands, "ticket"));
+    tt_assert(!CD_CommandsHas(commands, "t"));
+    tt_assert(CD_CommandsHas(commands, "reload"));
+
+    end: {
+        CD_DestroyCommands(commands);
+    }
+}
+
+void
+cdtest_Commands_complete (void* data)
+{
+    static const char* expected[] = { "ticket", "tickets", "tp" };
+
+    CDCommands* commands = CD_CreateCommands(NULL);
+    CDList*     names    = NULL;
+    size_t      i        = 0;
+
+    CD_RegisterCommand(commands, "tp", 0, cdtest_CommandHandler);
+    CD_RegisterCommand(commands, "time", 3, cdtest_CommandHandler);
+    CD_RegisterCommand(commands, "ticket", 0, cdtest_CommandHandler);
+    CD_RegisterCommandAlias(commands, "ticket", "tickets");
+
+    names = CD_CommandsComplete(commands, CDNull, "T", 0);
+
+    tt_int_op(CD_ListLength(names), ==, 3);
+
+    CD_LIST_FOREACH(names, it) {
+        if (CD_StringIsEqual((CDString*) CD_ListIteratorValue(it), expected[i])) {
+            i++;
+        }
+    }
+
+    tt_int_op(i, ==, 3);
+
+    end: {
+        if (names) {
+            CD_LIST_FOREACH(names, it) {
+                CD_DestroyString((CDString*) CD_ListIteratorValue(it));
+            }
+
+            CD_DestroyList(names);
+        }
+
+        CD_DestroyCommands(commands);
+    }
+}
+
+struct testcase_t cd_utils_Commands_tests[] = {
+    { "dispatch", cdtest_Commands_dispatch, },
+    { "complete", cdtest_Commands_complete, },
+
+    END_OF_TESTCASES
+};
+
+static
+const char*
+cdtest_DigestToHex (const uint8_t digest[CD_SHA256_LENGTH], char hex[2 * CD_SHA256_LENGTH + 1])
+{
+    for (size_t i = 0; i < CD_SHA256_LENGTH; i++) {
+        snprintf(&hex[2 * i], 3, "%02x", digest[i]);
+    }
+
+    return hex;
+}
+
+void
+cdtest_Digest_known (void* data)
+{
+    // the FIPS 180-2 examples, plus the empty message
+    static const struct {
+        const char* message;
+        const char* digest;
+    } known[] = {
+        { "",
+          "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+        { "abc",
+          "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" }
+    };
+
+    uint8_t digest[CD_SHA256_LENGTH];
+    char    hex[2 * CD_SHA256_LENGTH + 1];
+
+    for (size_t i = 0; i < ARRAY_SIZE(known); i++) {
+        CD_SHA256(known[i].message, strlen(known[i].message), digest);
+
+        tt_str_op(cdtest_DigestToHex(digest, hex), ==, known[i].digest);
+    }
+
+    end: {}
+}
+
+void
+cdtest_Digest_update (void* data)
+{
+    const char* message = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    char        block[1000];
+    uint8_t     digest[CD_SHA256_LENGTH];
+    char        hex[2 * CD_SHA256_LENGTH + 1];
+    CDSHA256    state;
+
+    // fed a byte at a time it has to cross the block boundaries on its own
+    CD_SHA256Init(&state);
+
+    for (size_t i = 0; message[i]; i++) {
+        CD_SHA256Update(&state, &message[i], 1);
+    }
+
+    CD_SHA256Final(&state, digest);
+
+    tt_str_op(cdtest_DigestToHex(digest, hex), ==,
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    // the third FIPS 180-2 example, a million times "a"
+    memset(block, 'a', sizeof(block));
+
+    CD_SHA256Init(&state);
+
+    for (int i = 0; i < 1000; i++) {
+        CD_SHA256Update(&state, block, sizeof(block));
+    }
+
+    CD_SHA256Final(&state, digest);
+
+    tt_str_op(cdtest_DigestToHex(digest, hex), ==,
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    end: {}
+}
+
+struct testcase_t cd_utils_Digest_tests[] = {
+    { "known",  cdtest_Digest_known, },
+    { "update", cdtest_Digest_update, },
+
+    END_OF_TESTCASES
+};
+
+void
+cdtest_Chunk_roundtrip (void* data)
+{
+    MCChunk*        chunk    = CD_alloc(sizeof(MCChunk));
+    uint8_t*        expected = CD_malloc(81920);
+    uint8_t*        result   = CD_malloc(81920);
+    MCCompactChunk* compact  = NULL;
+
+    for (size_t i = 0; i < 32768; i++) {
+        chunk->blocks[i] = ((i & 127) < 64) ? ((i % 7) ? MCStone : MCCoalOre) : MCAir;
+    }
+
+    memset(chunk->skyLight + 8192, 0xFF, 8192);
+    chunk->data[42] = 0x3A;
+
+    compact = MC_CreateCompactChunkFromChunk(chunk);
+
+    MC_ChunkToByteArray(chunk, expected);
+    MC_CompactChunkToByteArray(compact, result);
+
+    tt_assert(memcmp(expected, result, 81920) == 0);
+    tt_assert(MC_CompactChunkSize(compact) < sizeof(MCChunk));
+
+    end: {
+        if (compact) {
+            MC_DestroyCompactChunk(compact);
+        }
+
+        CD_free(chunk);
+        CD_free(expected);
+        CD_free(result);
+    }
+}
+
+void
+cdtest_Chunk_set (void* data)
+{
+    MCCompactChunk* compact = MC_CreateCompactChunk();
+
+    tt_int_op(MC_CompactChunkGetBlock(compact, 3, 100, 5), ==, MCAir);
+    tt_int_op(MC_CompactChunkGetSkyLight(compact, 3, 100, 5), ==, 15);
+
+    for (int i = 0; i < 40; i++) {
+        MC_CompactChunkSetBlock(compact, i % 16, 70 + i / 16, 2, i + 1);
+    }
+
+    for (int i = 0; i < 40; i++) {
+        tt_int_op(MC_CompactChunkGetBlock(compact, i % 16, 70 + i / 16, 2), ==, i + 1);
+    }
+
+    MC_CompactChunkSetData(compact, 0, 0, 0, 0x1F);
+    tt_int_op(MC_CompactChunkGetData(compact, 0, 0, 0), ==, 0x0F);
+
+    for (int i = 0; i < 40; i++) {
+        MC_CompactChunkSetBlock(compact, i % 16, 70 + i / 16, 2, MCAir);
+    }
+
+    MC_CompactChunkShrink(compact);
+
+    tt_assert(compact->sections[4] == NULL);
+
+    end: {
+        MC_DestroyCompactChunk(compact);
+    }
+}
+
+struct testcase_t cd_beta_Chunk_tests[] = {
+    { "roundtrip", cdtest_Chunk_roundtrip, },
+    { "set",       cdtest_Chunk_set, },
+
+    END_OF_TESTCASES
+};
+
+void
+cdtest_ChunkSet_put (void* data)
+{
+    MCChunkSet* set = MC_CreateChunkSet(0);
+
+    for (int x = -20; x < 20; x++) {
+        for (int z = -20; z < 20; z++) {
+            MC_ChunkSetPut(set, (MCChunkPosition) { x, z });
+        }
+    }
+
+    tt_int_op(MC_ChunkSetLength(set), ==, 1600);
+    tt_assert(!MC_ChunkSetPut(set, (MCChunkPosition) { -1, -1 }));
+    tt_assert(MC_ChunkSetHas(set, (MCChunkPosition) { 19, -20 }));
+    tt_assert(!MC_ChunkSetHas(set, (MCChunkPosition) { 20, 0 }));
+
+    for (int x = -20; x < 20; x += 2) {
+        for (int z = -20; z < 20; z++) {
+            tt_assert(MC_ChunkSetDelete(set, (MCChunkPosition) { x, z }));
+        }
+    }
+
+    tt_int_op(MC_ChunkSetLength(set), ==, 800);
+    tt_assert(!MC_ChunkSetHas(set, (MCChunkPosition) { 0, 0 }));
+    tt_assert(MC_ChunkSetHas(set, (MCChunkPosition) { 1, 0 }));
+
+    end: {
+        MC_DestroyChunkSet(set);
+    }
+}
+
+static
+void
+cdtest_ChunkSetCount (MCChunkSet* self, MCChunkPosition position, int* count)
+{
+    (*count)++;
+}
+
+void
+cdtest_ChunkSet_moveRadius (void* data)
+{
+    MCChunkSet* set     = MC_CreateChunkSet(400);
+    MCChunkSet* other   = MC_CreateChunkSet(400);
+    int         removed = 0;
+    int         added   = 0;
+
+    MC_ChunkSetMoveRadius(set, (MCChunkPosition) { 0, 0 }, 10, NULL, (MCChunkSetApply) cdtest_ChunkSetCount, (CDPointer) &added);
+    tt_int_op(added, ==, MC_ChunkSetLength(set));
+
+    added = 0;
+    MC_ChunkSetMoveRadius(set, (MCChunkPosition) { 1, 0 }, 10,
+        (MCChunkSetApply) cdtest_ChunkSetCount, (MCChunkSetApply) cdtest_ChunkSetCount, (CDPointer) &removed);
+    tt_int_op(removed, ==, 40);
+
+    MC_ChunkSetMoveRadius(other, (MCChunkPosition) { 1, 0 }, 10, NULL, NULL, CDNull);
+    MC_ChunkSetSymmetricDifference(other, set);
+    tt_int_op(MC_ChunkSetLength(other), ==, 0);
+
+    end: {
+        MC_DestroyChunkSet(set);
+        MC_DestroyChunkSet(other);
+    }
+}
+
+struct testcase_t cd_beta_ChunkSet_tests[] = {
+    { "put",         cdtest_ChunkSet_put, },
+    { "move radius", cdtest_ChunkSet_moveRadius, },
+
+    END_OF_TESTCASES
+};
+
+void
+cdtest_EntityTable_ids (void* data)
+{
+    MCEntityTable*    table    = MC_CreateEntityTable();
+    MCPrecisePosition position = { 1, 64, 1 };
+    MCEntityId        ids[3];
+
+    for (int i = 0; i < 3; i++) {
+        ids[i] = MC_EntityTableSpawn(table, MCEntityMob, position, (CDPointer) i + 1);
+
+        tt_int_op(ids[i], >, 0);
+        tt_int_op(MC_EntityTableGet(table, ids[i]), ==, i + 1);
+    }
+
+    // the last entity is moved in the hole and can still be found
+    tt_int_op(MC_EntityTableDespawn(table, ids[0]), ==, 1);
+    tt_int_op(MC_EntityTableLength(table), ==, 2);
+    tt_int_op(MC_EntityTableGet(table, ids[2]), ==, 3);
+    tt_int_op(table->dense.id[0], ==, ids[2]);
+
+    // the slot is reused with a new generation, the old ID is dead
+    MCEntityId reused = MC_EntityTableSpawn(table, MCEntityPickup, position, (CDPointer) 4);
+
+    tt_int_op(reused & MC_ENTITY_INDEX_MASK, ==, ids[0] & MC_ENTITY_INDEX_MASK);
+    tt_int_op(reused, !=, ids[0]);
+    tt_assert(!MC_EntityTableHas(table, ids[0]));
+    tt_int_op(MC_EntityTableDespawn(table, ids[0]), ==, CDNull);
+    tt_int_op(MC_EntityTableGet(table, reused), ==, 4);
+
+    MC_EntityTableSetVelocity(table, ids[1], (MCVelocity) { 8000, 0, -4000 });
+    MC_EntityTableMove(table);
+    MC_EntityTableGetPosition(table, ids[1], &position);
+
+    tt_assert(position.x == 2 && position.y == 64 && position.z == 0.5);
+
+    end: {
+        MC_DestroyEntityTable(table);
+    }
+}
+
+#define CDTEST_ENTITY_THREADS 8
+#define CDTEST_ENTITY_SPAWNS  20000
+
+typedef struct _cdtest_EntityTableSpawner {
+    MCEntityTable* table;
+    MCEntityId*    ids;
+    uintptr_t      thread;
+} cdtest_EntityTableSpawner;
+
+static
+void*
+cdtest_EntityTable_spawner (cdtest_EntityTableSpawner* self)
+{
+    MCPrecisePosition position = { 0, 0, 0 };
+
+    for (uintptr_t i = 0; i < CDTEST_ENTITY_SPAWNS; i++) {
+        CDPointer value = self->thread * CDTEST_ENTITY_SPAWNS + i;
+
+        self->ids[i] = MC_EntityTableSpawn(self->table, MCEntityMob, position, value);
+
+        // churn the free list against the other spawners
+        if (i % 3 == 0) {
+            MC_EntityTableDespawn(self->table, self->ids[i]);
+            self->ids[i] = MC_EntityTableSpawn(self->table, MCEntityMob, position, value);
+        }
+    }
+
+    return NULL;
+}
+
+void
+cdtest_EntityTable_concurrent (void* data)
+{
+    MCEntityTable*            table = MC_CreateEntityTable();
+    cdtest_EntityTableSpawner spawners[CDTEST_ENTITY_THREADS];
+    pthread_t                 threads[CDTEST_ENTITY_THREADS];
+    CDSet*                    seen  = CD_CreateSet();
+
+    for (uintptr_t i = 0; i < CDTEST_ENTITY_THREADS; i++) {
+        spawners[i].table  = table;
+        spawners[i].ids    = CD_malloc(sizeof(MCEntityId) * CDTEST_ENTITY_SPAWNS);
+        spawners[i].thread = i;
+
+        pthread_create(&threads[i], NULL, (void *(*)(void *)) cdtest_EntityTable_spawner, &spawners[i]);
+    }
+
+    for (int i = 0; i < CDTEST_ENTITY_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    tt_int_op(MC_EntityTableLength(table), ==, CDTEST_ENTITY_THREADS * CDTEST_ENTITY_SPAWNS);
+
+    for (uintptr_t i = 0; i < CDTEST_ENTITY_THREADS; i++) {
+        for (uintptr_t j = 0; j < CDTEST_ENTITY_SPAWNS; j++) {
+            MCEntityId id = spawners[i].ids[j];
+
+            tt_int_op(id, >, 0);
+            tt_assert(!CD_SetHas(seen, id));
+            tt_int_op(MC_EntityTableGet(table, id), ==, i * CDTEST_ENTITY_SPAWNS + j);
+
+            CD_SetPut(seen, id);
+        }
+    }
+
+    end: {
+        for (int i = 0; i < CDTEST_ENTITY_THREADS; i++) {
+            CD_free(spawners[i].ids);
+        }
+
+        CD_DestroySet(seen);
+        MC_DestroyEntityTable(table);
+    }
+}
+
+struct testcase_t cd_beta_EntityTable_tests[] = {
+    { "ids",        cdtest_EntityTable_ids, },
+    { "concurrent", cdtest_EntityTable_concurrent, },
 
     END_OF_TESTCASES
 };
@@ -464,8 +1419,18 @@ struct testgroup_t cd_groups[] = {
     { "utils/Hash/",             cd_utils_Hash_tests },
     { "utils/Map/",              cd_utils_Map_tests },
     { "utils/List/",             cd_utils_List_tests },
+    { "utils/Vector/",           cd_utils_Vector_tests },
+    { "utils/LinkedList/",       cd_utils_LinkedList_tests },
     { "utils/Set/",              cd_utils_Set_tests },
+    { "utils/Dynamic/",          cd_utils_Dynamic_tests },
+    { "utils/TimeLoop/",         cd_utils_TimeLoop_tests },
+    { "utils/Ticker/",           cd_utils_Ticker_tests },
     { "utils/Regexp/",           cd_utils_Regexp_tests },
+    { "utils/Commands/",         cd_utils_Commands_tests },
+    { "utils/Digest/",           cd_utils_Digest_tests },
+    { "beta/Chunk/",             cd_beta_Chunk_tests },
+    { "beta/ChunkSet/",          cd_beta_ChunkSet_tests },
+    { "beta/EntityTable/",       cd_beta_EntityTable_tests },
 
     END_OF_GROUPS
 };
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/uio.h>
+
+#define CRAFTD_LOGGER_IGNORE_EXTERN
+#include <craftd/Logger.h>
+#undef CRAFTD_LOGGER_IGNORE_EXTERN
+
+#define CD_ASYNC_LOGGER_SLOTS 2048
+#define CD_ASYNC_LOGGER_LINE  512
+#define CD_ASYNC_LOGGER_BATCH 64
+
+/*
+ * Lines are formatted by the logging thread straight into a slot of a bounded
+ * multi producer ring (a slot is free for position p when its sequence is p,
+ * and ready to be written when it is p + 1), a single writer thread collects
+ * the ready slots and writes them out with one writev per batch.
+ *
+ * When the ring is full the line is dropped and counted, logging never blocks.
+ */
+
+typedef struct _CDAsyncLogSlot {
+    volatile uint64_t sequence;
+
+    size_t length;
+    char   line[CD_ASYNC_LOGGER_LINE];
+} CDAsyncLogSlot;
+
+static struct {
+    CDAsyncLogSlot slots[CD_ASYNC_LOGGER_SLOTS];
+
+    volatile uint64_t head __attribute__((aligned(64)));
+    uint64_t          tail __attribute__((aligned(64)));
+
+    volatile uint64_t dropped;
+    uint64_t          reported;
+
+    int mask;
+
+    volatile bool running;
+    volatile bool closed;
+    volatile bool sleeping;
+
+    pthread_once_t  once;
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+} _ring = {
+    .once = PTHREAD_ONCE_INIT,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER
+};
+
+static
+size_t
+cd_AsyncLogFormat (char* output, int priority, const char* format, va_list ap)
+{
+    static const char* names[] = {
+        "EMERG", "ALERT", "CRIT", "ERR", "WARNING", "NOTICE", "INFO", "DEBUG"
+    };
+
+    const char* name = (priority >= ARRAY_SIZE(names) || priority < 0) ? "UNKNOWN" : names[priority];
+    int         length;
+    int         written;
+
+    length = snprintf(output, CD_ASYNC_LOGGER_LINE, "%s: ", name);
+
+    written = vsnprintf(output + length, CD_ASYNC_LOGGER_LINE - length - 1, format, ap);
+
+    if (written < 0) {
+        written = 0;
+    }
+    else if (written > CD_ASYNC_LOGGER_LINE - length - 2) {
+        written = CD_ASYNC_LOGGER_LINE - length - 2;
+    }
+
+    length += written;
+
+    output[length++] = '\n';
+
+    return length;
+}
+
+static
+void
+cd_AsyncLogWrite (struct iovec* vectors, int count)
+{
+    while (count > 0) {
+        ssize_t written = writev(STDOUT_FILENO, vectors, count);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return;
+        }
+
+        while (count > 0 && (size_t) written >= vectors->iov_len) {
+            written -= vectors->iov_len;
+            vectors++;
+            count--;
+        }
+
+        if (count > 0) {
+            vectors->iov_base  = (char*) vectors->iov_base + written;
+            vectors->iov_len  -= written;
+        }
+    }
+}
+
+static
+void
+cd_AsyncLogReportDropped (void)
+{
+    uint64_t dropped = _ring.dropped;
+
+    if (dropped != _ring.reported) {
+        char         line[128];
+        struct iovec vector = { line, 0 };
+
+        vector.iov_len = snprintf(line, sizeof(line), "WARNING: %llu log lines dropped\n", (unsigned long long) (dropped - _ring.reported));
+
+        cd_AsyncLogWrite(&vector, 1);
+
+        _ring.reported = dropped;
+    }
+}
+
+/**
+ * Write out the ready slots, returns the number of lines written
+ */
+static
+size_t
+cd_AsyncLogFlush (void)
+{
+    struct iovec vectors[CD_ASYNC_LOGGER_BATCH];
+    size_t       count = 0;
+
+    while (count < CD_ASYNC_LOGGER_BATCH) {
+        CDAsyncLogSlot* slot = &_ring.slots[(_ring.tail + count) & (CD_ASYNC_LOGGER_SLOTS - 1)];
+
+        if (slot->sequence != _ring.tail + count + 1) {
+            break;
+        }
+
+        __sync_synchronize();
+
+        vectors[count].iov_base = slot->line;
+        vectors[count].iov_len  = slot->length;
+
+        count++;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    cd_AsyncLogWrite(vectors, count);
+
+    __sync_synchronize();
+
+    for (size_t i = 0; i < count; i++) {
+        _ring.slots[(_ring.tail + i) & (CD_ASYNC_LOGGER_SLOTS - 1)].sequence = _ring.tail + i + CD_ASYNC_LOGGER_SLOTS;
+    }
+
+    _ring.tail += count;
+
+    return count;
+}
+
+static
+void*
+cd_AsyncLogRun (void* _)
+{
+    while (true) {
+        if (cd_AsyncLogFlush() > 0) {
+            continue;
+        }
+
+        cd_AsyncLogReportDropped();
+
+        if (!_ring.running) {
+            break;
+        }
+
+        pthread_mutex_lock(&_ring.lock);
+        _ring.sleeping = true;
+        __sync_synchronize();
+
+        if (_ring.running && _ring.slots[_ring.tail & (CD_ASYNC_LOGGER_SLOTS - 1)].sequence != _ring.tail + 1) {
+            struct timespec timeout;
+
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_nsec += 100000000;
+
+            if (timeout.tv_nsec >= 1000000000) {
+                timeout.tv_sec++;
+                timeout.tv_nsec -= 1000000000;
+            }
+
+            pthread_cond_timedwait(&_ring.wake, &_ring.lock, &timeout);
+        }
+
+        _ring.sleeping = false;
+        pthread_mutex_unlock(&_ring.lock);
+    }
+
+    while (cd_AsyncLogFlush() > 0) {
+        continue;
+    }
+
+    return NULL;
+}
+
+static
+void
+cd_AsyncLogStart (void)
+{
+    if (_ring.closed) {
+        return;
+    }
+
+    for (size_t i = 0; i < CD_ASYNC_LOGGER_SLOTS; i++) {
+        _ring.slots[i].sequence = i;
+    }
+
+    _ring.running = true;
+
+    if (pthread_create(&_ring.thread, NULL, cd_AsyncLogRun, NULL) != 0) {
+        _ring.running = false;
+    }
+}
+
+static
+void
+cd_AsyncLogList (int priority, const char* format, va_list ap)
+{
+    CDAsyncLogSlot* slot;
+    uint64_t        position;
+
+    /* Return on MASKed log priorities */
+    if (LOG_MASK(priority) & _ring.mask) {
+        return;
+    }
+
+    pthread_once(&_ring.once, cd_AsyncLogStart);
+
+    if (!_ring.running) {
+        char         line[CD_ASYNC_LOGGER_LINE];
+        struct iovec vector = { line, cd_AsyncLogFormat(line, priority, format, ap) };
+
+        cd_AsyncLogWrite(&vector, 1);
+
+        return;
+    }
+
+    position = _ring.head;
+
+    while (true) {
+        slot = &_ring.slots[position & (CD_ASYNC_LOGGER_SLOTS - 1)];
+
+        int64_t difference = (int64_t) (slot->sequence - position);
+
+        if (difference == 0) {
+            if (__sync_bool_compare_and_swap(&_ring.head, position, position + 1)) {
+                break;
+            }
+        }
+        else if (difference < 0) {
+            __sync_fetch_and_add(&_ring.dropped, 1);
+
+            return;
+        }
+
+        position = _ring.head;
+    }
+
+    slot->length = cd_AsyncLogFormat(slot->line, priority, format, ap);
+
+    __sync_synchronize();
+
+    slot->sequence = position + 1;
+
+    if (_ring.sleeping) {
+        pthread_mutex_lock(&_ring.lock);
+        pthread_cond_signal(&_ring.wake);
+        pthread_mutex_unlock(&_ring.lock);
+    }
+}
+
+static
+void
+cd_AsyncLog (int priority, const char* format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    cd_AsyncLogList(priority, format, ap);
+    va_end(ap);
+}
+
+static
+int
+cd_AsyncSetLogMask (int mask)
+{
+    int old = _ring.mask;
+
+    if (mask != 0) {
+        _ring.mask = mask;
+    }
+
+    return old;
+}
+
+static
+void
+cd_AsyncCloseLog (void)
+{
+    _ring.closed = true;
+
+    if (!_ring.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&_ring.lock);
+    _ring.running = false;
+    pthread_cond_signal(&_ring.wake);
+    pthread_mutex_unlock(&_ring.lock);
+
+    pthread_join(_ring.thread, NULL);
+}
+
+uint64_t
+CD_AsyncLoggerDropped (void)
+{
+    return _ring.dropped;
+}
+
+CDLogger CDAsyncLogger = {
+    .log        = cd_AsyncLog,
+    .vlog       = cd_AsyncLogList,
+    .setlogmask = cd_AsyncSetLogMask,
+    .closelog   = cd_AsyncCloseLog
+};
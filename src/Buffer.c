@@ -98,11 +98,25 @@ CD_BufferAdd (CDBuffer* self, CDPointer data, size_t length)
 void
 CD_BufferAddBuffer (CDBuffer* self, CDBuffer* data)
 {
-    CDPointer stuff = CD_BufferContent(data);
+    int length = evbuffer_peek(data->raw, -1, NULL, NULL, 0);
 
-    evbuffer_add(self->raw, (void*) stuff, CD_BufferLength(data));
+    if (length <= 0) {
+        return;
+    }
+
+    struct evbuffer_iovec vectors[length];
+
+    evbuffer_peek(data->raw, -1, NULL, vectors, length);
+
+    for (int i = 0; i < length; i++) {
+        evbuffer_add(self->raw, vectors[i].iov_base, vectors[i].iov_len);
+    }
+}
 
-    CD_free((void*) stuff);
+void
+CD_BufferMoveBuffer (CDBuffer* self, CDBuffer* data)
+{
+    evbuffer_add_buffer(self->raw, data->raw);
 }
 
 CDPointer
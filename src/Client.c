@@ -42,6 +42,9 @@ CD_CreateClient (CDServer* server)
 
     self->buffers = NULL;
 
+    CD_InitializeLink(&self->link.clients);
+    CD_InitializeLink(&self->link.disconnecting);
+
     DYNAMIC(self) = CD_CreateDynamic();
     ERROR(self)   = CDNull;
 
@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ctype.h>
+
+#include <craftd/Commands.h>
+
+static inline
+char
+cd_CommandKey (char character)
+{
+    return tolower((unsigned char) character);
+}
+
+static inline
+bool
+cd_CommandIsSpace (char character)
+{
+    return character == ' ' || character == '\t';
+}
+
+static
+bool
+cd_CommandNameIsValid (const char* name)
+{
+    size_t length = 0;
+
+    if (!name) {
+        return false;
+    }
+
+    for (; name[length] != '\0'; length++) {
+        if ((unsigned char) name[length] <= ' ' || (unsigned char) name[length] >= 0x7F) {
+            return false;
+        }
+    }
+
+    return length > 0 && length <= CD_COMMAND_NAME_LENGTH;
+}
+
+/**
+ * Get the child with the given key, children are few and sorted so a binary search
+ * is as good as it gets.
+ */
+static
+CDCommandNode*
+cd_CommandNodeChild (CDCommandNode* node, char key, size_t* position)
+{
+    size_t low  = 0;
+    size_t high = node->length;
+
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+
+        if ((unsigned char) node->children[middle].key < (unsigned char) key) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    if (position) {
+        *position = low;
+    }
+
+    if (low < node->length && node->children[low].key == key) {
+        return &node->children[low];
+    }
+
+    return NULL;
+}
+
+static
+CDCommandNode*
+cd_CommandNodeFind (CDCommandNode* node, const char* name, size_t length)
+{
+    for (size_t i = 0; node && i < length; i++) {
+        node = cd_CommandNodeChild(node, cd_CommandKey(name[i]), NULL);
+    }
+
+    return node;
+}
+
+static
+CDCommandNode*
+cd_CommandNodeCreate (CDCommandNode* node, const char* name)
+{
+    for (; *name != '\0'; name++) {
+        char           key   = cd_CommandKey(*name);
+        size_t         position;
+        CDCommandNode* child = cd_CommandNodeChild(node, key, &position);
+
+        if (!child) {
+            node->children = CD_realloc(node->children, sizeof(CDCommandNode) * (node->length + 1));
+
+            memmove(&node->children[position + 1], &node->children[position],
+                sizeof(CDCommandNode) * (node->length - position));
+
+            node->length++;
+
+            child = &node->children[position];
+            memset(child, 0, sizeof(CDCommandNode));
+            child->key = key;
+        }
+
+        node = child;
+    }
+
+    return node;
+}
+
+/**
+ * Remove the command at the end of the name and the nodes left empty
+ *
+ * @return true if the node itself is left empty
+ */
+static
+bool
+cd_CommandNodeRemove (CDCommandNode* node, const char* name)
+{
+    if (*name == '\0') {
+        node->command = NULL;
+    }
+    else {
+        size_t         position;
+        CDCommandNode* child = cd_CommandNodeChild(node, cd_CommandKey(*name), &position);
+
+        if (child && cd_CommandNodeRemove(child, name + 1)) {
+            CD_free(child->children);
+
+            memmove(&node->children[position], &node->children[position + 1],
+                sizeof(CDCommandNode) * (node->length - position - 1));
+
+            if (--node->length == 0) {
+                CD_free(node->children);
+                node->children = NULL;
+            }
+        }
+    }
+
+    return !node->command && node->length == 0;
+}
+
+static
+void
+cd_DestroyCommand (CDCommand* self)
+{
+    CD_LIST_FOREACH(self->aliases, it) {
+        CD_free((void*) CD_ListIteratorValue(it));
+    }
+
+    CD_DestroyList(self->aliases);
+
+    CD_free(self->name);
+    CD_free(self);
+}
+
+/**
+ * Free the subtree, commands are freed on the node of their own name after their
+ * alias nodes have been cleared since those point to them too
+ */
+static
+void
+cd_CommandNodeDestroy (CDCommandNode* root, CDCommandNode* node, char* path, size_t depth)
+{
+    CDCommand* command = node->command;
+
+    if (command && strlen(command->name) == depth && strncmp(command->name, path, depth) == 0) {
+        CD_LIST_FOREACH(command->aliases, it) {
+            const char* alias = (const char*) CD_ListIteratorValue(it);
+
+            cd_CommandNodeFind(root, alias, strlen(alias))->command = NULL;
+        }
+
+        node->command = NULL;
+
+        cd_DestroyCommand(command);
+    }
+
+    for (size_t i = 0; i < node->length; i++) {
+        path[depth] = node->children[i].key;
+
+        cd_CommandNodeDestroy(root, &node->children[i], path, depth + 1);
+    }
+
+    CD_free(node->children);
+}
+
+static
+void
+cd_CommandNodeComplete (CDCommandNode* node, int level, char* path, size_t depth, CDList* result, size_t limit)
+{
+    if (limit && CD_ListLength(result) >= limit) {
+        return;
+    }
+
+    if (node->command && node->command->level <= level) {
+        CD_ListPush(result, (CDPointer) CD_CreateStringFromBufferCopy(path, depth));
+    }
+
+    for (size_t i = 0; i < node->length; i++) {
+        path[depth] = node->children[i].key;
+
+        cd_CommandNodeComplete(&node->children[i], level, path, depth + 1, result, limit);
+    }
+}
+
+static inline
+int
+cd_CommandsSenderLevel (CDCommands* self, CDPointer sender)
+{
+    CDCommandLevel level = self->level;
+
+    return level ? level(self->server, sender) : 0;
+}
+
+CDCommands*
+CD_CreateCommands (struct _CDServer* server)
+{
+    CDCommands* self = CD_alloc(sizeof(CDCommands));
+
+    self->server = server;
+
+    if (pthread_rwlock_init(&self->lock, NULL) != 0) {
+        CD_abort("pthread rwlock failed to initialize");
+    }
+
+    return self;
+}
+
+void
+CD_DestroyCommands (CDCommands* self)
+{
+    char path[CD_COMMAND_NAME_LENGTH];
+
+    cd_CommandNodeDestroy(&self->root, &self->root, path, 0);
+
+    pthread_rwlock_destroy(&self->lock);
+
+    CD_free(self);
+}
+
+void
+CD_CommandsSetLevel (CDCommands* self, CDCommandLevel level)
+{
+    self->level = level;
+}
+
+CDCommand*
+CD_RegisterCommand (CDCommands* self, const char* name, int level, CDCommandHandler handler)
+{
+    CDCommandNode* node;
+    CDCommand*     command = NULL;
+
+    assert(handler);
+
+    if (!cd_CommandNameIsValid(name)) {
+        return NULL;
+    }
+
+    pthread_rwlock_wrlock(&self->lock);
+    if (!(node = cd_CommandNodeCreate(&self->root, name))->command) {
+        command = CD_malloc(sizeof(CDCommand));
+
+        command->name    = strdup(name);
+        command->level   = level;
+        command->handler = handler;
+        command->aliases = CD_CreateList();
+
+        for (char* current = command->name; *current != '\0'; current++) {
+            *current = cd_CommandKey(*current);
+        }
+
+        node->command = command;
+    }
+    pthread_rwlock_unlock(&self->lock);
+
+    return command;
+}
+
+bool
+CD_RegisterCommandAlias (CDCommands* self, const char* name, const char* alias)
+{
+    CDCommandNode* node;
+    CDCommand*     command;
+    bool           result = false;
+
+    if (!cd_CommandNameIsValid(name) || !cd_CommandNameIsValid(alias)) {
+        return false;
+    }
+
+    pthread_rwlock_wrlock(&self->lock);
+    if ((node = cd_CommandNodeFind(&self->root, name, strlen(name))) && (command = node->command)) {
+        if (!(node = cd_CommandNodeCreate(&self->root, alias))->command) {
+            node->command = command;
+
+            CD_ListPush(command->aliases, (CDPointer) strdup(alias));
+
+            result = true;
+        }
+    }
+    pthread_rwlock_unlock(&self->lock);
+
+    return result;
+}
+
+void
+CD_UnregisterCommand (CDCommands* self, const char* name)
+{
+    CDCommandNode* node;
+    CDCommand*     command;
+
+    if (!cd_CommandNameIsValid(name)) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&self->lock);
+    if ((node = cd_CommandNodeFind(&self->root, name, strlen(name))) && (command = node->command)) {
+        CD_LIST_FOREACH(command->aliases, it) {
+            cd_CommandNodeRemove(&self->root, (const char*) CD_ListIteratorValue(it));
+        }
+
+        cd_CommandNodeRemove(&self->root, command->name);
+
+        cd_DestroyCommand(command);
+    }
+    pthread_rwlock_unlock(&self->lock);
+}
+
+bool
+CD_CommandsHas (CDCommands* self, const char* name)
+{
+    CDCommandNode* node;
+    bool           result;
+
+    if (!cd_CommandNameIsValid(name)) {
+        return false;
+    }
+
+    pthread_rwlock_rdlock(&self->lock);
+    result = (node = cd_CommandNodeFind(&self->root, name, strlen(name))) && node->command;
+    pthread_rwlock_unlock(&self->lock);
+
+    return result;
+}
+
+CDCommandStatus
+CD_CommandsDispatch (CDCommands* self, CDPointer sender, CDString* line)
+{
+    const char*      content   = CD_StringContent(line);
+    size_t           size      = CD_StringSize(line);
+    size_t           word      = 0;
+    CDCommandHandler handler   = NULL;
+    int              level     = 0;
+    CDString*        arguments = NULL;
+    CDCommandNode*   node;
+    bool             result;
+
+    while (word < size && !cd_CommandIsSpace(content[word])) {
+        word++;
+    }
+
+    if (word == 0 || word > CD_COMMAND_NAME_LENGTH) {
+        return CDCommandNotFound;
+    }
+
+    pthread_rwlock_rdlock(&self->lock);
+    if ((node = cd_CommandNodeFind(&self->root, content, word)) && node->command) {
+        handler = node->command->handler;
+        level   = node->command->level;
+    }
+    pthread_rwlock_unlock(&self->lock);
+
+    if (!handler) {
+        return CDCommandNotFound;
+    }
+
+    if (level > 0 && cd_CommandsSenderLevel(self, sender) < level) {
+        return CDCommandDenied;
+    }
+
+    DO {
+        size_t start = word;
+        size_t end   = size;
+
+        while (start < end && cd_CommandIsSpace(content[start])) {
+            start++;
+        }
+
+        while (end > start && cd_CommandIsSpace(content[end - 1])) {
+            end--;
+        }
+
+        if (end > start) {
+            arguments = CD_CreateStringFromBufferCopy(content + start, end - start);
+        }
+    }
+
+    result = handler(self->server, sender, arguments);
+
+    if (arguments) {
+        CD_DestroyString(arguments);
+    }
+
+    return result ? CDCommandHandled : CDCommandNotFound;
+}
+
+CDList*
+CD_CommandsComplete (CDCommands* self, CDPointer sender, const char* prefix, size_t limit)
+{
+    CDList*        result = CD_CreateList();
+    int            level  = cd_CommandsSenderLevel(self, sender);
+    size_t         length = strlen(prefix);
+    char           path[CD_COMMAND_NAME_LENGTH];
+    CDCommandNode* node;
+
+    if (length > CD_COMMAND_NAME_LENGTH) {
+        return result;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        path[i] = cd_CommandKey(prefix[i]);
+    }
+
+    pthread_rwlock_rdlock(&self->lock);
+    if ((node = cd_CommandNodeFind(&self->root, prefix, length))) {
+        cd_CommandNodeComplete(node, level, path, length, result, limit);
+    }
+    pthread_rwlock_unlock(&self->lock);
+
+    return result;
+}
@@ -30,9 +30,15 @@
 CDConfig*
 CD_ParseConfig (const char* path)
 {
-    CDConfig* self = CD_malloc(sizeof(CDConfig));
+    CDConfig* self = CD_alloc(sizeof(CDConfig));
 
     self->data = json_load_file(path, 0, &self->error);
+    self->path = strdup(path);
+
+    self->generation = 1;
+
+    self->cache.plugins = CD_CreateHash();
+    self->cache.engines = CD_CreateHash();
 
     if (!self->data) {
         ERR("error on line %d while parsing %s: %s", self->error.line, path, self->error.text);
@@ -44,6 +50,10 @@ CD_ParseConfig (const char* path)
 
     self->cache.daemonize = true;
 
+    self->cache.logger = "console";
+
+    self->cache.profiling = false;
+
     self->cache.connection.port         = 25565;
     self->cache.connection.backlog      = 16;
     self->cache.connection.simultaneous = 3;
@@ -62,16 +72,37 @@ CD_ParseConfig (const char* path)
     self->cache.httpd.connection.bind.ipv4 = "0.0.0.0";
     self->cache.httpd.connection.bind.ipv6 = "::";
 
+    self->cache.httpd.cache.limit = 1048576;
+
+    self->cache.httpd.threads            = 2;
+    self->cache.httpd.connection.backlog = 64;
+
+    self->cache.httpd.limits.connections = 256;
+    self->cache.httpd.limits.requests    = 100;
+    self->cache.httpd.limits.body        = 65536;
+    self->cache.httpd.limits.headers     = 8192;
+    self->cache.httpd.limits.timeout     = 30;
+
+    self->cache.httpd.stream.size    = 1024;
+    self->cache.httpd.stream.backlog = 1048576;
+
     self->cache.files.motd = "/etc/craftd/motd.conf";
 
     self->cache.workers = 2;
 
     self->cache.game.players.max = 0;
 
+    // subsystems missing from the log section go back to the base level on reload
+    int levels[CDLogSubsystems] = {
+        [0 ... CDLogSubsystems - 1] = -1
+    };
+
     J_DO {
         J_IN(server, self->data, "server") {
-            J_BOOL(server, "daemonize",   self->cache.daemonize);
-            J_INT(server,  "workers",     self->cache.workers);
+            J_BOOL(server,   "daemonize", self->cache.daemonize);
+            J_STRING(server, "logger",    self->cache.logger);
+            J_INT(server,    "workers",   self->cache.workers);
+            J_BOOL(server,   "profiling", self->cache.profiling);
 
             J_IN(game, server, "game") {
                 J_IN(players, game, "players") {
@@ -81,6 +112,42 @@ CD_ParseConfig (const char* path)
                 J_BOOL(game, "standard", self->cache.game.standard);
             }
 
+            J_IN(log, server, "log") {
+                static const char* subsystems[] = {
+                    "core", "network", "workers", "httpd", "plugins"
+                };
+
+                for (int i = 0; i < CDLogSubsystems; i++) {
+                    J_IF_STRING(log, subsystems[i]) {
+                        int level = CD_LogLevelFromName(J_STRING_VALUE);
+
+                        if (level >= 0) {
+                            levels[i] = level;
+                        }
+                    }
+                }
+            }
+
+            J_IN(plugin, server, "plugin") {
+                J_FOREACH(plugin, plugin, "plugins") {
+                    J_IF_STRING(plugin, "name") {
+                        if (!CD_HashHasKey(self->cache.plugins, J_STRING_VALUE)) {
+                            CD_HashPut(self->cache.plugins, J_STRING_VALUE, (CDPointer) plugin);
+                        }
+                    }
+                }
+            }
+
+            J_IN(scripting, server, "scripting") {
+                J_FOREACH(engine, scripting, "engines") {
+                    J_IF_STRING(engine, "name") {
+                        if (!CD_HashHasKey(self->cache.engines, J_STRING_VALUE)) {
+                            CD_HashPut(self->cache.engines, J_STRING_VALUE, (CDPointer) engine);
+                        }
+                    }
+                }
+            }
+
             J_IN(files, server, "files") {
                 J_STRING(files, "motd",  self->cache.files.motd);
             }
@@ -112,9 +179,28 @@ CD_ParseConfig (const char* path)
         J_IN(httpd, self->data, "httpd") {
             J_BOOL(httpd,   "enabled", self->cache.httpd.enabled);
             J_STRING(httpd, "root",    self->cache.httpd.root);
+            J_INT(httpd,    "threads", self->cache.httpd.threads);
+
+            J_IN(cache, httpd, "cache") {
+                J_INT(cache, "limit", self->cache.httpd.cache.limit);
+            }
+
+            J_IN(limits, httpd, "limits") {
+                J_INT(limits, "connections", self->cache.httpd.limits.connections);
+                J_INT(limits, "requests",    self->cache.httpd.limits.requests);
+                J_INT(limits, "body",        self->cache.httpd.limits.body);
+                J_INT(limits, "headers",     self->cache.httpd.limits.headers);
+                J_INT(limits, "timeout",     self->cache.httpd.limits.timeout);
+            }
+
+            J_IN(stream, httpd, "stream") {
+                J_INT(stream, "size",    self->cache.httpd.stream.size);
+                J_INT(stream, "backlog", self->cache.httpd.stream.backlog);
+            }
 
             J_IN(connection, httpd, "connection") {
-                J_INT(connection, "port", self->cache.httpd.connection.port);
+                J_INT(connection, "port",    self->cache.httpd.connection.port);
+                J_INT(connection, "backlog", self->cache.httpd.connection.backlog);
 
                 J_IN(bind, connection, "bind") {
                     J_STRING(bind, "ipv4", self->cache.httpd.connection.bind.ipv4);
@@ -124,6 +210,8 @@ CD_ParseConfig (const char* path)
         }
     }
 
+    CD_LogResetLevels(levels);
+
     return self;
 }
 
@@ -134,6 +222,43 @@ CD_DestroyConfig (CDConfig* self)
         json_delete(self->data);
     }
 
+    if (self->cache.plugins) {
+        CD_DestroyHash(self->cache.plugins);
+    }
+
+    if (self->cache.engines) {
+        CD_DestroyHash(self->cache.engines);
+    }
+
+    CD_free(self->path);
     CD_free(self);
 }
 
+bool
+CD_ConfigRequiresRestart (CDConfig* self, CDConfig* other)
+{
+    if (self->cache.daemonize != other->cache.daemonize || self->cache.workers != other->cache.workers) {
+        return true;
+    }
+
+    if (!CD_CStringIsEqual(self->cache.logger, other->cache.logger)) {
+        return true;
+    }
+
+    if (self->cache.connection.port != other->cache.connection.port ||
+        self->cache.connection.backlog != other->cache.connection.backlog ||
+        memcmp(&self->cache.connection.bind.ipv4.sin_addr, &other->cache.connection.bind.ipv4.sin_addr, sizeof(struct in_addr)) != 0) {
+        return true;
+    }
+
+    if (self->cache.httpd.enabled != other->cache.httpd.enabled || self->cache.httpd.threads != other->cache.httpd.threads ||
+        self->cache.httpd.connection.port != other->cache.httpd.connection.port ||
+        !CD_CStringIsEqual(self->cache.httpd.connection.bind.ipv4, other->cache.httpd.connection.bind.ipv4) ||
+        (self->cache.httpd.root != other->cache.httpd.root && (!self->cache.httpd.root || !other->cache.httpd.root ||
+            !CD_CStringIsEqual(self->cache.httpd.root, other->cache.httpd.root)))) {
+        return true;
+    }
+
+    return false;
+}
+
@@ -30,13 +30,19 @@ CD_ConvertStringColorForConsole (CDString* self)
 {
     CDString* result = CD_CreateString();
 
-    for (size_t i = 0, end = CD_StringLength(self); i < end; i++) {
-        CDString* ch = CD_CharAt(self, i);
+    for (CDStringIterator it = CD_StringBegin(self), end = CD_StringEnd(self); !CD_StringIteratorIsEqual(it, end); it = CD_StringNext(it)) {
+        if (CD_StringIteratorIs(it, "§")) {
+            it = CD_StringNext(it);
 
-        if (CD_StringIsEqual(ch, "§")) {
-            CD_DestroyString(ch);
-                 ch = CD_CharAt(self, i++);
-            char c  = CD_StringContent(ch)[0];
+            if (CD_StringIteratorIsEqual(it, end)) {
+                break;
+            }
+
+            char c = CD_StringIteratorValue(it)[0];
+
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+                continue;
+            }
 
             // use some math to get the array index
             CD_AppendCString(result, CDConsoleColors[
@@ -44,10 +50,8 @@ CD_ConvertStringColorForConsole (CDString* self)
             ]);
         }
         else {
-            CD_AppendString(result, ch);
+            CD_AppendBuffer(result, CD_StringIteratorValue(it), CD_StringIteratorSize(it));
         }
-
-        CD_DestroyString(ch);
     }
 
     return result;
@@ -31,7 +31,7 @@ static int cd_mask = 0;
 
 static
 void
-cd_ConsoleLog (int priority, const char* format, ...)
+cd_ConsoleLogList (int priority, const char* format, va_list ap)
 {
     /* Return on MASKed log priorities */
     if (LOG_MASK(priority) & cd_mask) {
@@ -42,11 +42,13 @@ cd_ConsoleLog (int priority, const char* format, ...)
         "EMERG", "ALERT", "CRIT", "ERR", "WARNING", "NOTICE", "INFO", "DEBUG"
     };
 
-    va_list ap;
-    va_start(ap, format);
+    char          storage[512];
+    CDStringArena arena;
+
+    CD_InitializeStringArena(&arena, storage, sizeof(storage));
 
     CDString* priorityBuffer;
-    CDString* messageBuffer = CD_CreateStringFromFormatList(format, ap);
+    CDString* messageBuffer = CD_CreateStringFromFormatListInArena(&arena, format, ap);
 
     if (priority >= ARRAY_SIZE(names) || priority < 0) {
         priorityBuffer = CD_CreateStringFromCString("UNKNOWN");
@@ -59,8 +61,18 @@ cd_ConsoleLog (int priority, const char* format, ...)
     fflush(stdout);
 
     CD_DestroyString(priorityBuffer);
-    CD_DestroyString(messageBuffer);
 
+    CD_FinalizeStringArena(&arena);
+}
+
+static
+void
+cd_ConsoleLog (int priority, const char* format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    cd_ConsoleLogList(priority, format, ap);
     va_end(ap);
 }
 
@@ -84,6 +96,7 @@ void cd_ConsoleCloseLog (void)
 
 CDLogger CDConsoleLogger = {
     .log        = cd_ConsoleLog,
+    .vlog       = cd_ConsoleLogList,
     .setlogmask = cd_ConsoleSetLogMask,
     .closelog   = cd_ConsoleCloseLog
 };
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/Digest.h>
+
+static const uint32_t _k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static
+void
+cd_SHA256Transform (CDSHA256* self, const uint8_t* block)
+{
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16) |
+               ((uint32_t) block[i * 4 + 2] << 8) | ((uint32_t) block[i * 4 + 3]);
+    }
+
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    a = self->state[0]; b = self->state[1]; c = self->state[2]; d = self->state[3];
+    e = self->state[4]; f = self->state[5]; g = self->state[6]; h = self->state[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + _k[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    self->state[0] += a; self->state[1] += b; self->state[2] += c; self->state[3] += d;
+    self->state[4] += e; self->state[5] += f; self->state[6] += g; self->state[7] += h;
+}
+
+#undef ROTR
+
+void
+CD_SHA256Init (CDSHA256* self)
+{
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memcpy(self->state, initial, sizeof(initial));
+
+    self->length = 0;
+    self->used   = 0;
+}
+
+void
+CD_SHA256Update (CDSHA256* self, const void* data, size_t length)
+{
+    const uint8_t* current = data;
+
+    self->length += length;
+
+    if (self->used > 0) {
+        size_t missing = (64 - self->used < length) ? 64 - self->used : length;
+
+        memcpy(self->buffer + self->used, current, missing);
+
+        self->used += missing;
+        current    += missing;
+        length     -= missing;
+
+        if (self->used < 64) {
+            return;
+        }
+
+        cd_SHA256Transform(self, self->buffer);
+        self->used = 0;
+    }
+
+    for (; length >= 64; current += 64, length -= 64) {
+        cd_SHA256Transform(self, current);
+    }
+
+    memcpy(self->buffer, current, length);
+    self->used = length;
+}
+
+void
+CD_SHA256Final (CDSHA256* self, uint8_t digest[CD_SHA256_LENGTH])
+{
+    uint64_t bits = self->length * 8;
+
+    self->buffer[self->used++] = 0x80;
+
+    if (self->used > 56) {
+        memset(self->buffer + self->used, 0, 64 - self->used);
+        cd_SHA256Transform(self, self->buffer);
+        self->used = 0;
+    }
+
+    memset(self->buffer + self->used, 0, 56 - self->used);
+
+    for (int i = 0; i < 8; i++) {
+        self->buffer[63 - i] = (uint8_t) (bits >> (i * 8));
+    }
+
+    cd_SHA256Transform(self, self->buffer);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4]     = (uint8_t) (self->state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t) (self->state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t) (self->state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t) (self->state[i]);
+    }
+}
+
+void
+CD_SHA256 (const void* data, size_t length, uint8_t digest[CD_SHA256_LENGTH])
+{
+    CDSHA256 context;
+
+    CD_SHA256Init(&context);
+    CD_SHA256Update(&context, data, length);
+    CD_SHA256Final(&context, digest);
+}
+
+void
+CD_RandomBytes (void* buffer, size_t length)
+{
+    int     fd   = open("/dev/urandom", O_RDONLY);
+    ssize_t done = 0;
+
+    if (fd >= 0) {
+        while ((size_t) done < length) {
+            ssize_t result = read(fd, (uint8_t*) buffer + done, length - done);
+
+            if (result <= 0) {
+                break;
+            }
+
+            done += result;
+        }
+
+        close(fd);
+    }
+
+    if ((size_t) done < length) {
+        CD_abort("could not read random bytes from /dev/urandom");
+    }
+}
@@ -23,3 +23,151 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <craftd/common.h>
+#include <craftd/Logger.h>
+
+/* open addressing, kept at most half full so probes stay short */
+#define CD_DYNAMIC_INDEX (CD_DYNAMIC_SLOTS * 2)
+
+static struct {
+    struct {
+        const char*   name;
+        CDDynamicSlot slot;
+    } index[CD_DYNAMIC_INDEX];
+
+    size_t length;
+
+    pthread_mutex_t lock;
+} _slots = {
+    .length = 0,
+    .lock   = PTHREAD_MUTEX_INITIALIZER
+};
+
+/**
+ * Find the slot of a name, or the index entry it would go in. Entries are only
+ * ever added and the name is published last, so it's safe to read them without
+ * the lock.
+ */
+static
+bool
+cd_DynamicFindSlot (const char* name, CDDynamicSlot* slot, size_t* position)
+{
+    size_t i = kh_str_hash_func(name) & (CD_DYNAMIC_INDEX - 1);
+
+    while (true) {
+        const char* current = *(const char* volatile*) &_slots.index[i].name;
+
+        if (!current) {
+            break;
+        }
+
+        __sync_synchronize();
+
+        if (strcmp(current, name) == 0) {
+            *slot = _slots.index[i].slot;
+
+            return true;
+        }
+
+        i = (i + 1) & (CD_DYNAMIC_INDEX - 1);
+    }
+
+    if (position) {
+        *position = i;
+    }
+
+    return false;
+}
+
+CDDynamicSlot
+CD_ReserveDynamicSlot (const char* name)
+{
+    CDDynamicSlot slot;
+    size_t        position;
+
+    assert(name);
+
+    pthread_mutex_lock(&_slots.lock);
+
+    if (!cd_DynamicFindSlot(name, &slot, &position)) {
+        if (_slots.length >= CD_DYNAMIC_SLOTS) {
+            ERR("no dynamic slots left for %s, it will be kept by name", name);
+
+            slot = CD_DYNAMIC_NO_SLOT;
+        }
+        else {
+            slot                        = _slots.length++;
+            _slots.index[position].slot = slot;
+
+            __sync_synchronize();
+
+            _slots.index[position].name = strdup(name);
+        }
+    }
+
+    pthread_mutex_unlock(&_slots.lock);
+
+    return slot;
+}
+
+CDDynamic*
+CD_CreateDynamic (void)
+{
+    CDDynamic* self = CD_alloc(sizeof(CDDynamic));
+
+    self->hash = CD_CreateHash();
+
+    return self;
+}
+
+void
+CD_DestroyDynamic (CDDynamic* self)
+{
+    assert(self);
+
+    CD_DestroyHash(self->hash);
+
+    CD_free(self);
+}
+
+CDPointer
+CD_DynamicPropertyGet (CDDynamic* self, const char* name)
+{
+    CDDynamicSlot slot;
+
+    assert(self);
+
+    if (cd_DynamicFindSlot(name, &slot, NULL)) {
+        return CD_DynamicSlotGet(self, slot);
+    }
+
+    return CD_HashGet(self->hash, name);
+}
+
+CDPointer
+CD_DynamicPropertyPut (CDDynamic* self, const char* name, CDPointer value)
+{
+    CDDynamicSlot slot;
+
+    assert(self);
+
+    if (cd_DynamicFindSlot(name, &slot, NULL)) {
+        return CD_DynamicSlotPut(self, slot, value);
+    }
+
+    return CD_HashPut(self->hash, name, value);
+}
+
+CDPointer
+CD_DynamicPropertyDelete (CDDynamic* self, const char* name)
+{
+    CDDynamicSlot slot;
+
+    assert(self);
+
+    if (cd_DynamicFindSlot(name, &slot, NULL)) {
+        return CD_DynamicSlotDelete(self, slot);
+    }
+
+    return CD_HashDelete(self->hash, name);
+}
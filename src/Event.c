@@ -23,6 +23,10 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <ctype.h>
+
 #include <craftd/Event.h>
 
 static
@@ -53,7 +57,7 @@ cd_EventCompare (CDEventCallback* a, CDEventCallback* b)
 CDEventCallback*
 CD_CreateEventCallback (CDEventCallbackFunction function, int priority)
 {
-    CDEventCallback* self = CD_malloc(sizeof(CDEventCallback));
+    CDEventCallback* self = CD_alloc(sizeof(CDEventCallback));
 
     self->function = function;
     self->priority = priority;
@@ -61,30 +65,80 @@ CD_CreateEventCallback (CDEventCallbackFunction function, int priority)
     return self;
 }
 
+CDEventCallback*
+CD_CreateEventCallbackFor (const char* eventName, CDEventCallbackFunction function, int priority, const char* name)
+{
+    CDEventCallback* self = CD_CreateEventCallback(function, priority);
+    Dl_info          info;
+
+    self->eventName = strdup(eventName);
+
+    if (name) {
+        // skip the cast if the callback was registered as (CDEventCallbackFunction) function
+        if (*name == '(' && strchr(name, ')')) {
+            name = strchr(name, ')') + 1;
+        }
+
+        while (isspace(*name)) {
+            name++;
+        }
+
+        self->name = strdup(name);
+    }
+
+    if (dladdr((void*) function, &info)) {
+        if (!self->name && info.dli_sname && info.dli_saddr == (void*) function) {
+            self->name = strdup(info.dli_sname);
+        }
+
+        if (info.dli_fname) {
+            const char* slash = strrchr(info.dli_fname, '/');
+
+            self->module = strdup(slash ? slash + 1 : info.dli_fname);
+        }
+    }
+
+    if (!self->name) {
+        self->name = CD_malloc(2 + sizeof(void*) * 2 + 1);
+        snprintf(self->name, 2 + sizeof(void*) * 2 + 1, "%p", (void*) function);
+    }
+
+    if (!self->module) {
+        self->module = strdup("craftd");
+    }
+
+    return self;
+}
+
 void
 CD_DestroyEventCallback (CDEventCallback* self)
 {
+    CD_free(self->eventName);
+    CD_free(self->name);
+    CD_free(self->module);
+
     CD_free(self);
 }
 
 bool
 cd_EventBeforeDispatch (CDServer* self, const char* eventName, ...)
 {
-    CDList* callbacks = (CDList*) CD_HashGet(self->event.callbacks, "Event.dispatch:before");
-    bool    result    = true;
-    va_list ap;
+    CDVector* callbacks;
+    bool      result = true;
+    va_list   ap;
 
     va_start(ap, eventName);
 
-    CD_LIST_FOREACH(callbacks, it) {
-        if (!CD_ListIteratorValue(it)) {
-            continue;
-        }
+    pthread_rwlock_rdlock(&self->event.lock);
+    callbacks = (CDVector*) CD_HashGet(self->event.callbacks, "Event.dispatch:before");
 
-        if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, eventName, ap)) {
-            result = CD_LIST_BREAK(callbacks);
+    CD_VECTOR_FOREACH(callbacks, i) {
+        if (!((CDEventCallback*) CD_VectorGet(callbacks, i))->function(self, eventName, ap)) {
+            result = false;
+            break;
         }
     }
+    pthread_rwlock_unlock(&self->event.lock);
 
     va_end(ap);
 
@@ -94,21 +148,22 @@ cd_EventBeforeDispatch (CDServer* self, const char* eventName, ...)
 bool
 cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrupted, ...)
 {
-    CDList* callbacks = (CDList*) CD_HashGet(self->event.callbacks, "Event.dispatch:after");
-    bool    result    = true;
-    va_list ap;
+    CDVector* callbacks;
+    bool      result = true;
+    va_list   ap;
 
     va_start(ap, interrupted);
 
-    CD_LIST_FOREACH(callbacks, it) {
-        if (!CD_ListIteratorValue(it)) {
-            continue;
-        }
+    pthread_rwlock_rdlock(&self->event.lock);
+    callbacks = (CDVector*) CD_HashGet(self->event.callbacks, "Event.dispatch:after");
 
-        if (!((CDEventCallback*) CD_ListIteratorValue(it))->function(self, eventName, interrupted, ap)) {
-            result = CD_LIST_BREAK(callbacks);
+    CD_VECTOR_FOREACH(callbacks, i) {
+        if (!((CDEventCallback*) CD_VectorGet(callbacks, i))->function(self, eventName, interrupted, ap)) {
+            result = false;
+            break;
         }
     }
+    pthread_rwlock_unlock(&self->event.lock);
 
     va_end(ap);
 
@@ -116,57 +171,152 @@ cd_EventAfterDispatch (CDServer* self, const char* eventName, bool interrupted,
 }
 
 void
-CD_EventRegister (CDServer* self, const char* eventName, CDEventCallbackFunction callback)
+cd_EventRegister (CDServer* self, const char* eventName, int priority, CDEventCallbackFunction callback, const char* name)
 {
-    assert(self);
+    CDEventCallback* created = CD_CreateEventCallbackFor(eventName, callback, priority, name);
+    CDVector*        callbacks;
 
-    CDList* callbacks = (CDList*) CD_HashGet(self->event.callbacks, eventName);
+    assert(self);
 
-    if (!callbacks) {
-        callbacks = CD_CreateList();
+    pthread_rwlock_wrlock(&self->event.lock);
+    if (!(callbacks = (CDVector*) CD_HashGet(self->event.callbacks, eventName))) {
+        callbacks = CD_CreateVector();
         CD_HashPut(self->event.callbacks, eventName, (CDPointer) callbacks);
     }
 
-    CD_ListSortedPush(callbacks, (CDPointer) CD_CreateEventCallback(callback, 0), (CDListCompareCallback) cd_EventCompare);
+    CD_VectorSortedPush(callbacks, (CDPointer) created, (CDVectorCompareCallback) cd_EventCompare);
+    pthread_rwlock_unlock(&self->event.lock);
+}
+
+CDEventCallback**
+CD_EventUnregister (CDServer* self, const char* eventName, CDEventCallbackFunction callback)
+{
+    CDVector*         callbacks;
+    CDEventCallback** result = NULL;
+    size_t            length = 0;
+
+    pthread_rwlock_wrlock(&self->event.lock);
+    if (!(callbacks = (CDVector*) CD_HashGet(self->event.callbacks, eventName))) {
+        pthread_rwlock_unlock(&self->event.lock);
+
+        return NULL;
+    }
+
+    result = CD_calloc(CD_VectorLength(callbacks) + 1, sizeof(CDEventCallback*));
+
+    CD_VECTOR_FOREACH(callbacks, i) {
+        CDEventCallback* current = (CDEventCallback*) CD_VectorGet(callbacks, i);
+
+        if (!callback || cd_EventIsEqual(callback, current) == 0) {
+            result[length++] = (CDEventCallback*) CD_VectorDeleteAt(callbacks, i--);
+        }
+    }
+
+    if (CD_VectorLength(callbacks) == 0) {
+        CD_HashDelete(self->event.callbacks, eventName);
+        CD_DestroyVector(callbacks);
+    }
+    pthread_rwlock_unlock(&self->event.lock);
+
+    return result;
 }
 
 void
-CD_EventRegisterWithPriority (CDServer* self, const char* eventName, int priority, CDEventCallbackFunction callback)
+CD_EventProfiling (CDServer* self, bool enabled)
 {
     assert(self);
 
-    CDList* callbacks = (CDList*) CD_HashGet(self->event.callbacks, eventName);
+    self->event.profiling = enabled;
+}
 
-    if (!callbacks) {
-        callbacks = CD_CreateList();
-        CD_HashPut(self->event.callbacks, eventName, (CDPointer) callbacks);
+void
+CD_EventProfileReset (CDServer* self)
+{
+    assert(self);
+
+    pthread_rwlock_rdlock(&self->event.lock);
+    CD_HASH_FOREACH(self->event.callbacks, it) {
+        CDVector* callbacks = (CDVector*) CD_HashIteratorValue(it);
+
+        CD_VECTOR_FOREACH(callbacks, i) {
+            CDEventCallback* callback = (CDEventCallback*) CD_VectorGet(callbacks, i);
+
+            __sync_lock_test_and_set(&callback->profile.calls, 0);
+            __sync_lock_test_and_set(&callback->profile.total, 0);
+            __sync_lock_test_and_set(&callback->profile.max,   0);
+        }
     }
+    pthread_rwlock_unlock(&self->event.lock);
+}
 
-    CD_ListSortedPush(callbacks, (CDPointer) CD_CreateEventCallback(callback, priority), (CDListCompareCallback) cd_EventCompare);
+static
+int
+cd_EventProfileCompare (const void* a, const void* b)
+{
+    uint64_t first  = (*(CDEventCallback**) a)->profile.total;
+    uint64_t second = (*(CDEventCallback**) b)->profile.total;
+
+    return (first < second) - (first > second);
 }
 
-CDEventCallback**
-CD_EventUnregister (CDServer* self, const char* eventName, CDEventCallbackFunction callback)
+json_t*
+CD_EventProfileToJSON (CDServer* self, size_t limit)
 {
-    CDList*           callbacks = (CDList*) CD_HashGet(self->event.callbacks, eventName);
-    CDEventCallback** result    = NULL;
+    assert(self);
 
-    if (!callbacks) {
-        return NULL;
+    json_t*           result    = json_array();
+    CDEventCallback** callbacks = NULL;
+    size_t            length    = 0;
+    size_t            size      = 0;
+
+    // Callbacks can't be unregistered and freed while they're being looked at
+    pthread_rwlock_rdlock(&self->event.lock);
+    CD_HASH_FOREACH(self->event.callbacks, it) {
+        CDVector* vector = (CDVector*) CD_HashIteratorValue(it);
+
+        CD_VECTOR_FOREACH(vector, i) {
+            CDEventCallback* callback = (CDEventCallback*) CD_VectorGet(vector, i);
+
+            if (callback->profile.calls == 0) {
+                continue;
+            }
+
+            if (length == size) {
+                size      = size ? size * 2 : 32;
+                callbacks = CD_realloc(callbacks, sizeof(CDEventCallback*) * size);
+            }
+
+            callbacks[length++] = callback;
+        }
     }
 
-    if (callback) {
-        result    = CD_calloc(2, sizeof(CDEventCallback));
-        result[0] = (CDEventCallback*) CD_ListDeleteAllIf(callbacks, (CDPointer) callback,
-            (CDListCompareCallback) cd_EventIsEqual);
+    if (length > 0) {
+        qsort(callbacks, length, sizeof(CDEventCallback*), cd_EventProfileCompare);
     }
-    else {
-        result = (CDEventCallback**) CD_ListClear(callbacks);
+
+    if (limit == 0 || limit > length) {
+        limit = length;
     }
 
-    if (CD_ListLength(callbacks) == 0) {
-        CD_DestroyList(callbacks);
+    for (size_t i = 0; i < limit; i++) {
+        CDEventCallback* callback = callbacks[i];
+        uint64_t         calls    = callback->profile.calls;
+        uint64_t         total    = callback->profile.total;
+
+        json_array_append_new(result, json_pack("{s:s, s:s, s:s, s:i, s:I, s:I, s:I, s:I}",
+            "event",    callback->eventName ? callback->eventName : "",
+            "callback", callback->name ? callback->name : "",
+            "module",   callback->module ? callback->module : "",
+            "priority", callback->priority,
+            "calls",    (json_int_t) calls,
+            "total",    (json_int_t) total,
+            "max",      (json_int_t) callback->profile.max,
+            "average",  (json_int_t) (calls ? total / calls : 0)));
     }
 
+    pthread_rwlock_unlock(&self->event.lock);
+
+    CD_free(callbacks);
+
     return result;
 }
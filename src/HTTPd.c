@@ -23,104 +23,483 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define CRAFTD_LOG_SUBSYSTEM CDLogHTTPd
+
 #include <craftd/HTTPd.h>
 #include <craftd/Server.h>
 
+#include <craftd/Job.h>
+#include <craftd/Workers.h>
+
+#include <netinet/in.h>
+#include <event2/keyvalq_struct.h>
+
+static CDLogger _logger;
+static CDHTTPd* _tap = NULL;
+
+typedef struct _CDHTTPdRPC {
+    CDHTTPdThread*         thread;
+    CDHTTPdConnection*     connection;
+    struct evhttp_request* request;
+
+    json_t* input;
+    json_t* output;
+
+    bool pretty;
+} CDHTTPdRPC;
+
 static
-const char*
-cd_GuessContentType (const char* path)
+void
+cd_HTTPdConnectionClosed (struct evhttp_connection* raw, CDHTTPdThread* thread)
 {
-	const char*          lastPeriod = strrchr(path, '.');
-    const char*          extension;
-	const CDContentType* type;
+    CDHTTPdConnection* connection = (CDHTTPdConnection*) CD_MapDelete(thread->connections, (CDMapId) raw);
 
-	if (lastPeriod == NULL || strchr(lastPeriod, '/')) {
-		goto end;
+    if (!connection) {
+        return;
     }
 
-	extension = lastPeriod + 1;
-	for (type = CDContentTypes; type->extension; type++) {
-		if (!evutil_ascii_strcasecmp(type->extension, extension)) {
-			return type->mime;
+    // the requests are gone with the connection, the RPCs will be dropped when the workers are done
+    CD_LIST_FOREACH(connection->pending, it) {
+        CDHTTPdRPC* rpc = (CDHTTPdRPC*) CD_ListIteratorValue(it);
+
+        rpc->request    = NULL;
+        rpc->connection = NULL;
+    }
+
+    if (connection->subscriber) {
+        CD_ListDeleteAll(thread->stream.subscribers, (CDPointer) connection->subscriber);
+        CD_free(connection->subscriber);
+
+        __sync_sub_and_fetch(&thread->parent->stream->subscribers, 1);
+    }
+
+    CD_DestroyList(connection->pending);
+    CD_free(connection);
+
+    __sync_sub_and_fetch(&thread->parent->connections, 1);
+}
+
+/**
+ * Account the request to its connection, enforcing the connection and keep-alive limits.
+ *
+ * @return The connection or NULL if the request has been refused
+ */
+static
+CDHTTPdConnection*
+cd_HTTPdConnection (CDHTTPdThread* thread, struct evhttp_request* request)
+{
+    CDServer*                 server     = thread->parent->server;
+    struct evhttp_connection* raw        = evhttp_request_get_connection(request);
+    CDHTTPdConnection*        connection = (CDHTTPdConnection*) CD_MapGet(thread->connections, (CDMapId) raw);
+
+    if (!connection) {
+        if (__sync_add_and_fetch(&thread->parent->connections, 1) > server->config->cache.httpd.limits.connections) {
+            __sync_sub_and_fetch(&thread->parent->connections, 1);
+
+            evhttp_add_header(evhttp_request_get_output_headers(request), "Connection", "close");
+            evhttp_send_error(request, HTTP_SERVUNAVAIL, "Too many connections");
+
+            return NULL;
         }
-	}
 
-    end: {
-    	return "application/octet-stream";
+        connection             = CD_malloc(sizeof(CDHTTPdConnection));
+        connection->raw        = raw;
+        connection->pending    = CD_CreateList();
+        connection->subscriber = NULL;
+
+        connection->requests = 0;
+
+        CD_MapPut(thread->connections, (CDMapId) raw, (CDPointer) connection);
+
+        evhttp_connection_set_closecb(raw, (void (*)(struct evhttp_connection*, void*)) cd_HTTPdConnectionClosed, thread);
     }
+
+    // let the client reconnect once it made enough requests on the same connection
+    if (++connection->requests >= server->config->cache.httpd.limits.requests) {
+        evhttp_add_header(evhttp_request_get_output_headers(request), "Connection", "close");
+    }
+
+    return connection;
 }
 
+static
+bool
+cd_HTTPdQuery (struct evhttp_request* request, const char* name, const char** value)
+{
+    static __thread char buffer[64];
+
+    bool               result  = false;
+    struct evhttp_uri* decoded = evhttp_uri_parse(evhttp_request_get_uri(request));
+
+    if (decoded && evhttp_uri_get_query(decoded)) {
+        struct evkeyvalq query;
+
+        if (evhttp_parse_query_str(evhttp_uri_get_query(decoded), &query) == 0) {
+            const char* found = evhttp_find_header(&query, name);
+
+            // a flag without a value is parsed as an empty string
+            if (found) {
+                result = true;
+
+                if (value) {
+                    snprintf(buffer, sizeof(buffer), "%s", found);
+
+                    *value = buffer;
+                }
+            }
+
+            evhttp_clear_headers(&query);
+        }
+    }
+
+    if (decoded) {
+        evhttp_uri_free(decoded);
+    }
+
+    return result;
+}
 
 static
 void
-cd_JSONRequest (struct evhttp_request* request, CDServer* server)
+cd_HTTPdSendJSON (struct evhttp_request* request, json_t* output, bool pretty)
 {
-    struct evbuffer* buffer = evhttp_request_get_input_buffer(request);
-    char*            text   = CD_alloc(evbuffer_get_length(buffer) + 1);
-    
-    evbuffer_remove(buffer, text, evbuffer_get_length(buffer));
+    char*            outString = json_dumps(output, pretty ? JSON_INDENT(2) : JSON_COMPACT);
+    struct evbuffer* outBuffer = evbuffer_new();
 
-    json_error_t error;
-    json_t*      input  = json_loads(text, 0, &error);
-    json_t*      output = json_object();
+    evbuffer_add(outBuffer, outString, strlen(outString));
 
-    printf("%s\n", text);
+    evhttp_add_header(evhttp_request_get_output_headers(request),
+        "Content-Type", "application/json");
+
+    evhttp_send_reply(request, HTTP_OK, "OK", outBuffer);
+
+    evbuffer_free(outBuffer);
+    free(outString);
+}
+
+static
+void
+cd_DestroyHTTPdRPC (CDHTTPdRPC* self)
+{
+    if (self->input) {
+        json_delete(self->input);
+    }
+
+    if (self->output) {
+        json_delete(self->output);
+    }
+
+    CD_free(self);
+}
+
+static
+void
+cd_JSONReply (evutil_socket_t fd, short event, CDHTTPdRPC* rpc)
+{
+    if (rpc->connection) {
+        CD_ListDeleteAll(rpc->connection->pending, (CDPointer) rpc);
+    }
+
+    if (rpc->request) {
+        cd_HTTPdSendJSON(rpc->request, rpc->output, rpc->pretty);
+    }
+
+    cd_DestroyHTTPdRPC(rpc);
+}
+
+static
+void
+cd_JSONDispatch (CDHTTPdRPC* rpc)
+{
+    struct timeval now = { 0, 0 };
+
+    CD_EventDispatch(rpc->thread->parent->server, "RPC.JSON", rpc->input, rpc->output);
+
+    // the request belongs to the HTTPd thread, reply from there
+    if (event_base_once(rpc->thread->event.base, -1, EV_TIMEOUT, (event_callback_fn) cd_JSONReply, rpc, &now) != 0) {
+        CD_abort("could not schedule the RPC reply");
+    }
+}
+
+static
+void
+cd_JSONRequest (struct evhttp_request* request, CDHTTPdThread* thread)
+{
+    CDServer*          server     = thread->parent->server;
+    CDHTTPdConnection* connection = cd_HTTPdConnection(thread, request);
+    json_error_t       error;
+
+    if (!connection) {
+        return;
+    }
 
     if (evhttp_request_get_command(request) != EVHTTP_REQ_POST) {
-        goto error;
+        evhttp_send_error(request, HTTP_BADMETHOD, "Invalid request method");
+
+        return;
     }
 
+    struct evbuffer* buffer = evhttp_request_get_input_buffer(request);
+
+    // terminate the body in place instead of copying it out of the buffer
+    evbuffer_add(buffer, "", 1);
+
+    json_t* input = json_loads((const char*) evbuffer_pullup(buffer, -1), 0, &error);
+
     if (input == NULL) {
         SERR(server, "RPC.JSON: error on line %d: %s", error.line, error.text);
-        
-        goto error;
+
+        evhttp_send_error(request, HTTP_BADREQUEST, "Bad request");
+
+        return;
+    }
+
+    CDHTTPdRPC* rpc = CD_malloc(sizeof(CDHTTPdRPC));
+
+    rpc->thread     = thread;
+    rpc->connection = connection;
+    rpc->request    = request;
+    rpc->input      = input;
+    rpc->output     = json_object();
+    rpc->pretty     = cd_HTTPdQuery(request, "pretty", NULL);
+
+    // plugins may touch the world in RPC.JSON, so it runs on the workers like everything else
+    if (server->workers && server->workers->length > 0) {
+        CD_ListPush(connection->pending, (CDPointer) rpc);
+
+        CD_AddJob(server->workers, CD_CreateJob(CDCustomJob,
+            (CDPointer) CD_CreateCustomJob((CDCustomJobCallback) cd_JSONDispatch, (CDPointer) rpc)));
+    }
+    else {
+        CD_EventDispatch(server, "RPC.JSON", rpc->input, rpc->output);
+
+        rpc->connection = NULL;
+
+        cd_JSONReply(-1, EV_TIMEOUT, rpc);
+    }
+}
+
+static
+void
+cd_MetricsRequest (struct evhttp_request* request, CDHTTPdThread* thread)
+{
+    if (!cd_HTTPdConnection(thread, request)) {
+        return;
     }
 
-    CD_EventDispatch(server, "RPC.JSON", input, output);
+    if (evhttp_request_get_command(request) != EVHTTP_REQ_GET) {
+        evhttp_send_error(request, HTTP_BADMETHOD, "Invalid request method");
 
-    done: {
-        char*            outString = json_dumps(output, JSON_INDENT(2));
-        struct evbuffer* outBuffer = evbuffer_new();
+        return;
+    }
+
+    CDBuffer* buffer = CD_CreateBuffer();
 
-        evbuffer_add_printf(outBuffer, "%s", outString);
+    CD_MetricsToBuffer(buffer);
 
-        evhttp_send_reply(request, HTTP_OK, "OK", outBuffer);
+    evhttp_add_header(evhttp_request_get_output_headers(request),
+        "Content-Type", "text/plain; version=0.0.4");
 
-        evbuffer_free(outBuffer);
-        free(outString);
-        json_delete(output);
-        json_delete(input);
-        CD_free(text);
+    evhttp_send_reply(request, HTTP_OK, "OK", buffer->raw);
+
+    CD_DestroyBuffer(buffer);
+}
+
+static
+void
+cd_EventsRequest (struct evhttp_request* request, CDHTTPdThread* thread)
+{
+    CDServer*   server = thread->parent->server;
+    const char* limit  = NULL;
+
+    if (!cd_HTTPdConnection(thread, request)) {
+        return;
+    }
+
+    if (evhttp_request_get_command(request) != EVHTTP_REQ_GET) {
+        evhttp_send_error(request, HTTP_BADMETHOD, "Invalid request method");
 
         return;
     }
 
-    error: {
-        evhttp_send_error(request, HTTP_INTERNAL, "Internal server error");
+    cd_HTTPdQuery(request, "limit", &limit);
 
-        CD_free(text);
+    json_t* profile = CD_EventProfileToJSON(server, limit ? strtoul(limit, NULL, 10) : 0);
+    json_t* output  = json_pack("{s:b, s:o}", "profiling", server->event.profiling, "callbacks", profile);
 
-        if (input) {
-            json_delete(input);
+    cd_HTTPdSendJSON(request, output, cd_HTTPdQuery(request, "pretty", NULL));
+
+    json_delete(output);
+}
+
+static
+void
+cd_HTTPdStreamFlush (evutil_socket_t fd, short event, CDHTTPdThread* thread)
+{
+    CDHTTPdStream* stream  = thread->parent->stream;
+    CDList*        dropped = NULL;
+
+    CD_LIST_FOREACH(thread->stream.subscribers, it) {
+        CDHTTPdSubscriber*        subscriber = (CDHTTPdSubscriber*) CD_ListIteratorValue(it);
+        struct evhttp_connection* connection = evhttp_request_get_connection(subscriber->request);
+        struct evbuffer*          output     = bufferevent_get_output(evhttp_connection_get_bufferevent(connection));
+        struct evbuffer*          buffer     = evbuffer_new();
+
+        if (evbuffer_get_length(output) > stream->backlog || !CD_HTTPdStreamRead(stream, &subscriber->cursor, buffer)) {
+            if (!dropped) {
+                dropped = CD_CreateList();
+            }
+
+            CD_ListPush(dropped, (CDPointer) connection);
+        }
+        else if (evbuffer_get_length(buffer) > 0) {
+            evhttp_send_reply_chunk(subscriber->request, buffer);
         }
 
-        if (output) {
-            json_delete(output);
+        evbuffer_free(buffer);
+    }
+
+    // freeing the connection runs the close callback, which removes the subscriber
+    CD_LIST_FOREACH(dropped, it) {
+        SDEBUG(thread->parent->server, "dropping slow stream subscriber");
+
+        evhttp_connection_free((struct evhttp_connection*) CD_ListIteratorValue(it));
+    }
+
+    if (dropped) {
+        CD_DestroyList(dropped);
+    }
+}
+
+static
+void
+cd_HTTPdStreamTick (evutil_socket_t fd, short event, CDHTTPd* self)
+{
+    CDServer* server = self->server;
+
+    if (!CD_HTTPdIsStreaming(self)) {
+        return;
+    }
+
+    CD_HTTPdPublish(self, "stats", json_pack("{s:I, s:I, s:I, s:I, s:I, s:I}",
+        "clients",  (json_int_t) CD_MetricValue(server->metrics.clients),
+        "accepted", (json_int_t) CD_MetricValue(server->metrics.accepted),
+        "reads",    (json_int_t) CD_MetricValue(server->metrics.reads),
+        "events",   (json_int_t) CD_MetricValue(server->metrics.events),
+        "p99",      (json_int_t) CD_MetricQuantile(server->metrics.events, 0.99),
+        "dropped",  (json_int_t) CD_AsyncLoggerDropped()));
+}
+
+static
+void
+cd_HTTPdLogList (int priority, const char* format, va_list ap)
+{
+    // only format the line here when somebody is listening, the wrapped logger formats its own
+    if (CD_HTTPdIsStreaming(_tap)) {
+        char    message[1024];
+        va_list copy;
+
+        va_copy(copy, ap);
+        vsnprintf(message, sizeof(message), format, copy);
+        va_end(copy);
+
+        CD_HTTPdPublish(_tap, "log", json_pack("{s:i, s:s}", "priority", priority, "message", message));
+    }
+
+    _logger.vlog(priority, format, ap);
+}
+
+static
+void
+cd_HTTPdLog (int priority, const char* format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    cd_HTTPdLogList(priority, format, ap);
+    va_end(ap);
+}
+
+void
+CD_HTTPdPublish (CDHTTPd* self, const char* event, json_t* data)
+{
+    if (!CD_HTTPdIsStreaming(self) || !data) {
+        if (data) {
+            json_decref(data);
         }
 
         return;
-    }     
+    }
+
+    CD_HTTPdStreamPublish(self->stream, event, data);
+
+    for (size_t i = 0; i < self->length; i++) {
+        event_active(self->item[i]->stream.wakeup, EV_READ, 1);
+    }
+}
+
+static
+void
+cd_StreamRequest (struct evhttp_request* request, CDHTTPdThread* thread)
+{
+    CDHTTPdConnection* connection = cd_HTTPdConnection(thread, request);
+    CDHTTPdStream*     stream     = thread->parent->stream;
+
+    if (!connection) {
+        return;
+    }
+
+    if (evhttp_request_get_command(request) != EVHTTP_REQ_GET || connection->subscriber) {
+        evhttp_send_error(request, HTTP_BADMETHOD, "Invalid request method");
+
+        return;
+    }
+
+    struct evkeyvalq* output = evhttp_request_get_output_headers(request);
+
+    evhttp_add_header(output, "Content-Type",  "text/event-stream");
+    evhttp_add_header(output, "Cache-Control", "no-cache");
+
+    connection->subscriber          = CD_malloc(sizeof(CDHTTPdSubscriber));
+    connection->subscriber->request = request;
+    connection->subscriber->cursor  = CD_HTTPdStreamCursor(stream,
+        evhttp_find_header(evhttp_request_get_input_headers(request), "Last-Event-ID"));
+
+    CD_ListPush(thread->stream.subscribers, (CDPointer) connection->subscriber);
+
+    __sync_add_and_fetch(&stream->subscribers, 1);
+
+    evhttp_send_reply_start(request, HTTP_OK, "OK");
+
+    // send what a resuming client missed once we're out of the evhttp callback
+    event_active(thread->stream.wakeup, EV_READ, 1);
 }
 
 static
 void
-cd_StaticRequest (struct evhttp_request* request, CDServer* server)
+cd_StaticFileCleanup (const void* data, size_t length, CDHTTPdFile* file)
 {
+    CD_HTTPdFileRelease(file);
+}
+
+static
+void
+cd_StaticRequest (struct evhttp_request* request, CDHTTPdThread* thread)
+{
+    CDHTTPdCache* cache = thread->parent->cache;
+
+    if (!cd_HTTPdConnection(thread, request)) {
+        return;
+    }
+
     int         error   = HTTP_OK;
     const char* message = "OK";
 
     const char*        uri     = evhttp_request_get_uri(request);
     struct evhttp_uri* decoded = evhttp_uri_parse(uri);
+    char*              path    = NULL;
+    size_t             size    = 0;
+    CDHTTPdFile*       file    = NULL;
 
     if (evhttp_request_get_command(request) != EVHTTP_REQ_GET) {
         error   = HTTP_BADMETHOD;
@@ -129,45 +508,100 @@ cd_StaticRequest (struct evhttp_request* request, CDServer* server)
         goto end;
     }
 
-    if (!decoded || strstr(evhttp_uri_get_path(decoded), "..")) {
+    if (decoded) {
+        const char* raw = evhttp_uri_get_path(decoded);
+
+        path = evhttp_uridecode(raw && *raw ? raw : "/", 0, &size);
+    }
+
+    // check the decoded path, %2e%2e is as much of a way out of the root as .. and %00 would cut it short
+    if (!path || strlen(path) != size || strstr(path, "..")) {
         error   = HTTP_BADREQUEST;
         message = "Bad request";
 
         goto end;
     }
 
+    if (!cache || !(file = CD_HTTPdCacheGet(cache, path))) {
+        error   = HTTP_NOTFOUND;
+        message = "File not found";
+
+        goto end;
+    }
+
     DO {
-        CDString* path = CD_CreateStringFromFormat("%s/%s", server->config->cache.httpd.root,
-            evhttp_uri_get_path(decoded) ? evhttp_uri_get_path(decoded) : "index.html");
+        struct evkeyvalq* input  = evhttp_request_get_input_headers(request);
+        struct evkeyvalq* output = evhttp_request_get_output_headers(request);
 
-        if (CD_IsDirectory(CD_StringContent(path))) {
-            CD_AppendCString(path, "/index.html");
-        }
+        evhttp_add_header(output, "Content-Type",  file->type);
+        evhttp_add_header(output, "ETag",          file->etag);
+        evhttp_add_header(output, "Last-Modified", file->lastModified);
 
-        if (!CD_IsReadable(CD_StringContent(path))) {
-            error   = HTTP_NOTFOUND;
-            message = "File not found";
+        if (file->gzip.data) {
+            evhttp_add_header(output, "Vary", "Accept-Encoding");
+        }
 
-            CD_DestroyString(path);
+        if (CD_HTTPdFileIsFresh(file, evhttp_find_header(input, "If-None-Match"),
+                evhttp_find_header(input, "If-Modified-Since"))) {
+            evhttp_send_reply(request, HTTP_NOTMODIFIED, "Not Modified", NULL);
 
             goto end;
         }
 
         struct evbuffer* buffer = evbuffer_new();
-        int              fd     = open(CD_StringContent(path), O_RDONLY);
 
-        evhttp_add_header(evhttp_request_get_output_headers(request),
-            "Content-Type", cd_GuessContentType(CD_StringContent(path)));
+        if (file->content.data) {
+            const char* encoding = evhttp_find_header(input, "Accept-Encoding");
+            uint8_t*    data     = file->content.data;
+            size_t      length   = file->content.length;
+
+            if (file->gzip.data && encoding && strstr(encoding, "gzip")) {
+                evhttp_add_header(output, "Content-Encoding", "gzip");
+
+                data   = file->gzip.data;
+                length = file->gzip.length;
+            }
+
+            // the buffer references the cached content, the file is released once it's been sent
+            if (length > 0) {
+                __sync_add_and_fetch(&file->references, 1);
+
+                evbuffer_add_reference(buffer, data, length,
+                    (evbuffer_ref_cleanup_cb) cd_StaticFileCleanup, file);
+            }
+        }
+        else {
+            int fd = open(file->path, O_RDONLY);
 
-        evbuffer_add_file(buffer, fd, 0, CD_FileSize(CD_StringContent(path)));
+            if (fd < 0) {
+                CD_HTTPdCacheInvalidate(cache, file->path);
+
+                evbuffer_free(buffer);
+
+                error   = HTTP_NOTFOUND;
+                message = "File not found";
+
+                goto end;
+            }
+
+            // the buffer owns the descriptor and sends it with sendfile where available
+            evbuffer_add_file(buffer, fd, 0, file->size);
+        }
 
         evhttp_send_reply(request, HTTP_OK, "OK", buffer);
 
         evbuffer_free(buffer);
-        CD_DestroyString(path);
     }
 
     end: {
+        if (file) {
+            CD_HTTPdFileRelease(file);
+        }
+
+        if (path) {
+            free(path);
+        }
+
         if (decoded) {
             evhttp_uri_free(decoded);
         }
@@ -178,6 +612,134 @@ cd_StaticRequest (struct evhttp_request* request, CDServer* server)
     }
 }
 
+static
+evutil_socket_t
+cd_HTTPdListen (CDServer* server, bool reuse)
+{
+    struct sockaddr_in address;
+    evutil_socket_t    fd;
+
+    memset(&address, 0, sizeof(address));
+
+    address.sin_family = AF_INET;
+    address.sin_port   = htons(server->config->cache.httpd.connection.port);
+
+    if (evutil_inet_pton(AF_INET, server->config->cache.httpd.connection.bind.ipv4, &address.sin_addr) != 1) {
+        address.sin_addr.s_addr = INADDR_ANY;
+    }
+
+    if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        return -1;
+    }
+
+    evutil_make_socket_nonblocking(fd);
+    evutil_make_socket_closeonexec(fd);
+    evutil_make_listen_socket_reuseable(fd);
+
+#ifdef SO_REUSEPORT
+    if (reuse) {
+        int on = 1;
+
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void*) &on, sizeof(on));
+    }
+#endif
+
+    if (bind(fd, (struct sockaddr*) &address, sizeof(address)) < 0 || listen(fd, server->config->cache.httpd.connection.backlog) < 0) {
+        evutil_closesocket(fd);
+
+        return -1;
+    }
+
+    return fd;
+}
+
+static
+void
+cd_HTTPdRoute (struct evhttp_request* request, CDHTTPdRoute* route)
+{
+    CD_ServerEnterSnapshot(route->thread->parent->server, &route->thread->reader);
+    route->handler(request, route->thread);
+    CD_ServerLeaveSnapshot(&route->thread->reader);
+}
+
+/**
+ * Bind a handler to a path, or to every other path if it's NULL
+ */
+static
+void
+cd_HTTPdSetRoute (CDHTTPdThread* self, size_t index, const char* path, CDHTTPdHandler handler)
+{
+    assert(index < CD_HTTPD_ROUTES);
+
+    self->routes[index].thread  = self;
+    self->routes[index].handler = handler;
+
+    if (path) {
+        evhttp_set_cb(self->event.httpd, path, (void (*)(struct evhttp_request*, void*)) cd_HTTPdRoute, &self->routes[index]);
+    }
+    else {
+        evhttp_set_gencb(self->event.httpd, (void (*)(struct evhttp_request*, void*)) cd_HTTPdRoute, &self->routes[index]);
+    }
+}
+
+static
+CDHTTPdThread*
+cd_CreateHTTPdThread (CDHTTPd* parent)
+{
+    CDHTTPdThread* self   = CD_malloc(sizeof(CDHTTPdThread));
+    CDServer*      server = parent->server;
+
+    self->parent       = parent;
+    self->event.base   = event_base_new();
+    self->event.httpd  = evhttp_new(self->event.base);
+    self->event.handle = NULL;
+    self->connections  = CD_CreateMap();
+
+    self->stream.subscribers = CD_CreateList();
+    self->stream.wakeup      = event_new(self->event.base, -1, 0, (event_callback_fn) cd_HTTPdStreamFlush, self);
+
+    evhttp_set_timeout(self->event.httpd, server->config->cache.httpd.limits.timeout);
+    evhttp_set_max_body_size(self->event.httpd, server->config->cache.httpd.limits.body);
+    evhttp_set_max_headers_size(self->event.httpd, server->config->cache.httpd.limits.headers);
+
+    cd_HTTPdSetRoute(self, 0, "/rpc/json", cd_JSONRequest);
+    cd_HTTPdSetRoute(self, 1, "/metrics", cd_MetricsRequest);
+    cd_HTTPdSetRoute(self, 2, "/events", cd_EventsRequest);
+    cd_HTTPdSetRoute(self, 3, "/stream", cd_StreamRequest);
+    cd_HTTPdSetRoute(self, 4, NULL, cd_StaticRequest);
+
+    CD_ServerAddReader(server, &self->reader);
+
+    return self;
+}
+
+static
+void
+cd_DestroyHTTPdThread (CDHTTPdThread* self)
+{
+    // freeing the evhttp closes the connections, which cleans up the connection map
+    evhttp_free(self->event.httpd);
+
+    CD_ServerRemoveReader(self->parent->server, &self->reader);
+
+    event_free(self->stream.wakeup);
+    event_base_free(self->event.base);
+
+    CD_DestroyMap(self->connections);
+    CD_DestroyList(self->stream.subscribers);
+
+    CD_free(self);
+}
+
+static
+void*
+cd_RunHTTPdThread (CDHTTPdThread* self)
+{
+    event_base_dispatch(self->event.base);
+
+    return NULL;
+}
+
 CDHTTPd*
 CD_CreateHTTPd (CDServer* server)
 {
@@ -187,32 +749,127 @@ CD_CreateHTTPd (CDServer* server)
         CD_abort("pthread attribute failed to initialize");
     }
 
-    if (pthread_attr_setdetachstate(&self->attributes, PTHREAD_CREATE_DETACHED) != 0) {
-        CD_abort("pthread attribute failed to set in detach state");
+    if (pthread_attr_setdetachstate(&self->attributes, PTHREAD_CREATE_JOINABLE) != 0) {
+        CD_abort("pthread attribute failed to set in joinable state");
     }
 
     self->server      = server;
-    self->event.base  = event_base_new();
-    self->event.httpd = evhttp_new(self->event.base);
-    
-    evhttp_set_cb(self->event.httpd, "/rpc/json", (void (*)(struct evhttp_request*, void*)) cd_JSONRequest, server);
-    evhttp_set_gencb(self->event.httpd, (void (*)(struct evhttp_request*, void*)) cd_StaticRequest, server);
+    self->connections = 0;
+    self->stream      = CD_CreateHTTPdStream(server->config->cache.httpd.stream.size > 0 ? server->config->cache.httpd.stream.size : 1,
+        server->config->cache.httpd.stream.backlog);
+    self->length      = server->config->cache.httpd.threads > 0 ? server->config->cache.httpd.threads : 1;
+    self->item        = CD_malloc(sizeof(CDHTTPdThread*) * self->length);
+
+    for (size_t i = 0; i < self->length; i++) {
+        self->item[i] = cd_CreateHTTPdThread(self);
+    }
+
+    // the file cache is shared, its watcher runs on the first thread
+    if (server->config->cache.httpd.root) {
+        self->cache = CD_CreateHTTPdCache(self->item[0]->event.base, server->config->cache.httpd.root,
+            server->config->cache.httpd.cache.limit);
+    }
+    else {
+        self->cache = NULL;
+    }
+
+    self->ticker = event_new(self->item[0]->event.base, -1, EV_PERSIST, (event_callback_fn) cd_HTTPdStreamTick, self);
 
     return self;
 }
 
-void*
-CD_RunHTTPd (CDHTTPd* self)
+void
+CD_DestroyHTTPd (CDHTTPd* self)
 {
-    self->event.handle = evhttp_bind_socket_with_handle(self->event.httpd,
-        self->server->config->cache.httpd.connection.bind.ipv4,
-        self->server->config->cache.httpd.connection.port);
+    assert(self);
 
-    SLOG(self->server, LOG_NOTICE, "Started HTTPd at http://%s:%d",
-        self->server->config->cache.httpd.connection.bind.ipv4,
-        self->server->config->cache.httpd.connection.port);
+    for (size_t i = 0; i < self->length; i++) {
+        if (self->item[i]->event.handle) {
+            event_base_loopbreak(self->item[i]->event.base);
 
-    event_base_dispatch(self->event.base);
+            pthread_join(self->item[i]->thread, NULL);
+        }
+    }
 
-    return NULL;
+    if (_tap == self) {
+        self->server->logger.log  = _logger.log;
+        self->server->logger.vlog = _logger.vlog;
+
+        _tap = NULL;
+    }
+
+    event_free(self->ticker);
+
+    if (self->cache) {
+        CD_DestroyHTTPdCache(self->cache);
+    }
+
+    for (size_t i = 0; i < self->length; i++) {
+        cd_DestroyHTTPdThread(self->item[i]);
+    }
+
+    CD_DestroyHTTPdStream(self->stream);
+
+    pthread_attr_destroy(&self->attributes);
+
+    CD_free(self->item);
+    CD_free(self);
+}
+
+bool
+CD_StartHTTPd (CDHTTPd* self)
+{
+    evutil_socket_t shared = -1;
+
+    assert(self);
+
+    for (size_t i = 0; i < self->length; i++) {
+        evutil_socket_t fd = -1;
+
+#ifdef SO_REUSEPORT
+        fd = cd_HTTPdListen(self->server, true);
+#endif
+
+        // without SO_REUSEPORT every thread polls the same listening socket
+        if (fd < 0) {
+            if (shared < 0 && (shared = cd_HTTPdListen(self->server, false)) < 0) {
+                SERR(self->server, "HTTPd could not listen on %s:%d: %s",
+                    self->server->config->cache.httpd.connection.bind.ipv4,
+                    self->server->config->cache.httpd.connection.port, strerror(errno));
+
+                return false;
+            }
+
+            fd = dup(shared);
+        }
+
+        self->item[i]->event.handle = evhttp_accept_socket_with_handle(self->item[i]->event.httpd, fd);
+
+        pthread_create(&self->item[i]->thread, &self->attributes, (void *(*)(void *)) cd_RunHTTPdThread, self->item[i]);
+    }
+
+    if (shared >= 0) {
+        evutil_closesocket(shared);
+    }
+
+    DO {
+        struct timeval interval = { 1, 0 };
+
+        event_add(self->ticker, &interval);
+    }
+
+    // log lines go to the stream too, the original logger is restored on destruction
+    if (!_tap) {
+        _logger = self->server->logger;
+        _tap    = self;
+
+        self->server->logger.log  = cd_HTTPdLog;
+        self->server->logger.vlog = cd_HTTPdLogList;
+    }
+
+    SLOG(self->server, LOG_NOTICE, "Started HTTPd at http://%s:%d with %d threads",
+        self->server->config->cache.httpd.connection.bind.ipv4,
+        self->server->config->cache.httpd.connection.port, (int) self->length);
+
+    return true;
 }
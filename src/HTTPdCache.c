@@ -0,0 +1,509 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#define CRAFTD_LOG_SUBSYSTEM CDLogHTTPd
+
+#include <craftd/HTTPd.h>
+#include <craftd/HTTPdCache.h>
+#include <craftd/Logger.h>
+
+#include <zlib.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+
+#define CD_HTTPD_CACHE_NOTIFY_MASK (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | \
+    IN_DELETE_SELF | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO)
+#endif
+
+static
+const char*
+cd_GuessContentType (const char* path)
+{
+    const char*          lastPeriod = strrchr(path, '.');
+    const char*          extension;
+    const CDContentType* type;
+
+    if (lastPeriod == NULL || strchr(lastPeriod, '/')) {
+        goto end;
+    }
+
+    extension = lastPeriod + 1;
+    for (type = CDContentTypes; type->extension; type++) {
+        if (!evutil_ascii_strcasecmp(type->extension, extension)) {
+            return type->mime;
+        }
+    }
+
+    end: {
+        return "application/octet-stream";
+    }
+}
+
+static
+bool
+cd_IsCompressible (const char* type)
+{
+    return strncmp(type, "text/", 5) == 0 || strstr(type, "javascript") || strstr(type, "json") ||
+        strstr(type, "xml");
+}
+
+static
+void
+cd_HTTPdFileCompress (CDHTTPdFile* self)
+{
+    z_stream stream;
+    uLong    bound;
+
+    memset(&stream, 0, sizeof(stream));
+
+    // 16 + MAX_WBITS makes zlib write a gzip header and trailer
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return;
+    }
+
+    bound = deflateBound(&stream, self->content.length);
+
+    self->gzip.data = CD_malloc(bound);
+
+    stream.next_in   = self->content.data;
+    stream.avail_in  = self->content.length;
+    stream.next_out  = self->gzip.data;
+    stream.avail_out = bound;
+
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END || stream.total_out >= self->content.length) {
+        CD_free(self->gzip.data);
+
+        self->gzip.data = NULL;
+    }
+    else {
+        self->gzip.length = stream.total_out;
+    }
+
+    deflateEnd(&stream);
+}
+
+static
+CDHTTPdFile*
+cd_CreateHTTPdFile (void)
+{
+    CDHTTPdFile* self = CD_alloc(sizeof(CDHTTPdFile));
+
+    // one reference for the cache and one for the request loading it
+    self->state      = CDHTTPdFileLoading;
+    self->references = 2;
+
+    return self;
+}
+
+static
+bool
+cd_HTTPdFileLoad (CDHTTPdFile* self, const char* path, struct stat* status, size_t limit)
+{
+    struct tm modified;
+
+    self->path     = strdup(path);
+    self->type     = cd_GuessContentType(path);
+    self->size     = status->st_size;
+    self->modified = status->st_mtime;
+
+    snprintf(self->etag, sizeof(self->etag), "\"%llx-%llx-%llx\"",
+        (unsigned long long) status->st_ino,
+        (unsigned long long) status->st_size,
+        (unsigned long long) status->st_mtime);
+
+    strftime(self->lastModified, sizeof(self->lastModified), "%a, %d %b %Y %H:%M:%S GMT",
+        gmtime_r(&self->modified, &modified));
+
+    if ((size_t) self->size <= limit) {
+        int fd = open(path, O_RDONLY);
+
+        if (fd < 0) {
+            return false;
+        }
+
+        self->content.data = CD_malloc(self->size ? self->size : 1);
+
+        while (self->content.length < (size_t) self->size) {
+            ssize_t result = read(fd, self->content.data + self->content.length, self->size - self->content.length);
+
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (result <= 0) {
+                break;
+            }
+
+            self->content.length += result;
+        }
+
+        close(fd);
+
+        // the file changed while reading it, the watcher will invalidate the entry
+        self->size = self->content.length;
+
+        if (self->content.length >= CD_HTTPD_CACHE_GZIP_MINIMUM && cd_IsCompressible(self->type)) {
+            cd_HTTPdFileCompress(self);
+        }
+    }
+    else if (access(path, R_OK) != 0) {
+        return false;
+    }
+
+    return true;
+}
+
+void
+CD_HTTPdFileRelease (CDHTTPdFile* self)
+{
+    if (!self || __sync_sub_and_fetch(&self->references, 1) > 0) {
+        return;
+    }
+
+    CD_free(self->content.data);
+    CD_free(self->gzip.data);
+    CD_free(self->path);
+
+    CD_free(self);
+}
+
+bool
+CD_HTTPdFileIsFresh (CDHTTPdFile* self, const char* ifNoneMatch, const char* ifModifiedSince)
+{
+    assert(self);
+
+    if (ifNoneMatch) {
+        return strcmp(ifNoneMatch, "*") == 0 || strstr(ifNoneMatch, self->etag) != NULL;
+    }
+
+    if (ifModifiedSince) {
+        struct tm since;
+
+        memset(&since, 0, sizeof(since));
+
+        if (strptime(ifModifiedSince, "%a, %d %b %Y %H:%M:%S GMT", &since)) {
+            return self->modified <= timegm(&since);
+        }
+    }
+
+    return false;
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+static
+void
+cd_HTTPdCacheWatch (CDHTTPdCache* self, const char* path)
+{
+    char* directory = strdup(path);
+    char* slash     = strrchr(directory, '/');
+    int   wd;
+
+    if (slash) {
+        *slash = '\0';
+    }
+
+    if ((wd = inotify_add_watch(self->notify.fd, directory, CD_HTTPD_CACHE_NOTIFY_MASK)) < 0) {
+        CD_free(directory);
+
+        return;
+    }
+
+    if (CD_MapHasKey(self->notify.directories, wd)) {
+        CD_free(directory);
+    }
+    else {
+        CD_MapPut(self->notify.directories, wd, (CDPointer) directory);
+    }
+}
+
+static
+void
+cd_HTTPdCacheNotify (evutil_socket_t fd, short what, CDHTTPdCache* self)
+{
+    char    buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char* current = buffer; current < buffer + length; ) {
+            struct inotify_event* event     = (struct inotify_event*) current;
+            const char*           directory = (const char*) CD_MapGet(self->notify.directories, event->wd);
+
+            current += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                CD_HTTPdCacheInvalidate(self, NULL);
+
+                continue;
+            }
+
+            if (!directory) {
+                continue;
+            }
+
+            if (event->len > 0) {
+                CDString* path = CD_CreateStringFromFormat("%s/%s", directory, event->name);
+
+                CD_HTTPdCacheInvalidate(self, CD_StringContent(path));
+
+                CD_DestroyString(path);
+            }
+            else {
+                CD_HTTPdCacheInvalidate(self, directory);
+            }
+
+            if (event->mask & IN_IGNORED) {
+                CD_free((void*) CD_MapDelete(self->notify.directories, event->wd));
+            }
+        }
+    }
+}
+#endif
+
+static
+bool
+cd_HTTPdCacheLoad (CDHTTPdCache* self, CDHTTPdFile* file, const char* path)
+{
+    CDString*   full   = CD_CreateStringFromFormat("%s%s%s", self->root, path[0] == '/' ? "" : "/", path);
+    struct stat status;
+    bool        result = false;
+
+    if (stat(CD_StringContent(full), &status) != 0) {
+        goto done;
+    }
+
+    if (S_ISDIR(status.st_mode)) {
+        bool slash = CD_StringSize(full) > 0 && CD_StringContent(full)[CD_StringSize(full) - 1] == '/';
+
+        CD_AppendCString(full, slash ? "index.html" : "/index.html");
+
+        if (stat(CD_StringContent(full), &status) != 0) {
+            goto done;
+        }
+    }
+
+    if (!S_ISREG(status.st_mode)) {
+        goto done;
+    }
+
+#ifdef HAVE_SYS_INOTIFY_H
+    // watch before reading so a change during the read isn't lost
+    if (self->notify.fd >= 0) {
+        pthread_mutex_lock(&self->lock);
+        cd_HTTPdCacheWatch(self, CD_StringContent(full));
+        pthread_mutex_unlock(&self->lock);
+    }
+#endif
+
+    result = cd_HTTPdFileLoad(file, CD_StringContent(full), &status, self->limit);
+
+    done: {
+        CD_DestroyString(full);
+    }
+
+    return result;
+}
+
+CDHTTPdCache*
+CD_CreateHTTPdCache (struct event_base* base, const char* root, size_t limit)
+{
+    CDHTTPdCache* self = CD_malloc(sizeof(CDHTTPdCache));
+
+    self->root  = strdup(root);
+    self->limit = limit;
+    self->files = CD_CreateHash();
+
+    // paths are built as root + request path, which always starts with a slash
+    for (size_t length = strlen(self->root); length > 1 && self->root[length - 1] == '/'; length--) {
+        self->root[length - 1] = '\0';
+    }
+
+    if (pthread_mutex_init(&self->lock, NULL) != 0) {
+        CD_abort("pthread mutex failed to initialize");
+    }
+
+    if (pthread_cond_init(&self->loaded, NULL) != 0) {
+        CD_abort("pthread cond failed to initialize");
+    }
+
+    self->notify.fd          = -1;
+    self->notify.event       = NULL;
+    self->notify.directories = CD_CreateMap();
+
+#ifdef HAVE_SYS_INOTIFY_H
+    if ((self->notify.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) >= 0) {
+        self->notify.event = event_new(base, self->notify.fd, EV_READ | EV_PERSIST,
+            (event_callback_fn) cd_HTTPdCacheNotify, self);
+
+        event_add(self->notify.event, NULL);
+    }
+#endif
+
+    return self;
+}
+
+void
+CD_DestroyHTTPdCache (CDHTTPdCache* self)
+{
+    assert(self);
+
+    if (self->notify.event) {
+        event_free(self->notify.event);
+    }
+
+    if (self->notify.fd >= 0) {
+        close(self->notify.fd);
+    }
+
+    CD_MAP_FOREACH(self->notify.directories, it) {
+        CD_free((void*) CD_MapIteratorValue(it));
+    }
+
+    CD_DestroyMap(self->notify.directories);
+
+    CD_HTTPdCacheInvalidate(self, NULL);
+    CD_DestroyHash(self->files);
+
+    pthread_mutex_destroy(&self->lock);
+    pthread_cond_destroy(&self->loaded);
+
+    CD_free(self->root);
+    CD_free(self);
+}
+
+CDHTTPdFile*
+CD_HTTPdCacheGet (CDHTTPdCache* self, const char* path)
+{
+    CDHTTPdFile* file;
+    struct stat  status;
+    bool         loaded;
+
+    assert(self);
+    assert(path);
+
+    pthread_mutex_lock(&self->lock);
+
+    while ((file = (CDHTTPdFile*) CD_HashGet(self->files, path))) {
+        __sync_add_and_fetch(&file->references, 1);
+
+        // another request is reading it, wait for that instead of reading it twice
+        while (file->state == CDHTTPdFileLoading) {
+            pthread_cond_wait(&self->loaded, &self->lock);
+        }
+
+        if (file->state == CDHTTPdFileMissing) {
+            pthread_mutex_unlock(&self->lock);
+
+            CD_HTTPdFileRelease(file);
+
+            return NULL;
+        }
+
+        pthread_mutex_unlock(&self->lock);
+
+        // without a watcher revalidate the entry, a stat is still cheaper than reading the file
+        if (self->notify.fd >= 0 || (stat(file->path, &status) == 0 &&
+                status.st_mtime == file->modified && status.st_size == file->size)) {
+            return file;
+        }
+
+        pthread_mutex_lock(&self->lock);
+
+        if ((CDHTTPdFile*) CD_HashGet(self->files, path) == file) {
+            CD_HashDelete(self->files, path);
+            CD_HTTPdFileRelease(file);
+        }
+
+        CD_HTTPdFileRelease(file);
+    }
+
+    file = cd_CreateHTTPdFile();
+
+    CD_HashPut(self->files, path, (CDPointer) file);
+
+    pthread_mutex_unlock(&self->lock);
+
+    loaded = cd_HTTPdCacheLoad(self, file, path);
+
+    pthread_mutex_lock(&self->lock);
+
+    if (loaded) {
+        file->state = CDHTTPdFileLoaded;
+    }
+    else {
+        // an invalidation may have dropped it, or someone else may be loading the path again already
+        if ((CDHTTPdFile*) CD_HashGet(self->files, path) == file) {
+            CD_HashDelete(self->files, path);
+            CD_HTTPdFileRelease(file);
+        }
+
+        file->state = CDHTTPdFileMissing;
+    }
+
+    pthread_cond_broadcast(&self->loaded);
+    pthread_mutex_unlock(&self->lock);
+
+    if (!loaded) {
+        CD_HTTPdFileRelease(file);
+
+        return NULL;
+    }
+
+    return file;
+}
+
+void
+CD_HTTPdCacheInvalidate (CDHTTPdCache* self, const char* path)
+{
+    CDList* stale  = CD_CreateList();
+    size_t  length = path ? strlen(path) : 0;
+
+    assert(self);
+
+    pthread_mutex_lock(&self->lock);
+
+    CD_HASH_FOREACH(self->files, it) {
+        CDHTTPdFile* file = (CDHTTPdFile*) CD_HashIteratorValue(it);
+
+        // a loading entry has no path yet and might have read the old content, drop it to be safe
+        if (!path || file->state == CDHTTPdFileLoading || (strncmp(file->path, path, length) == 0 &&
+                (file->path[length] == '\0' || file->path[length] == '/'))) {
+            CD_ListPush(stale, (CDPointer) strdup(CD_HashIteratorKey(it)));
+        }
+    }
+
+    CD_LIST_FOREACH(stale, it) {
+        char* key = (char*) CD_ListIteratorValue(it);
+
+        CD_HTTPdFileRelease((CDHTTPdFile*) CD_HashDelete(self->files, key));
+
+        CD_free(key);
+    }
+
+    pthread_mutex_unlock(&self->lock);
+
+    CD_DestroyList(stale);
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/HTTPdStream.h>
+
+static
+void
+cd_HTTPdFrameRelease (CDHTTPdFrame* self)
+{
+    if (self && __sync_sub_and_fetch(&self->references, 1) == 0) {
+        CD_free(self);
+    }
+}
+
+static
+void
+cd_HTTPdFrameCleanup (const void* data, size_t length, CDHTTPdFrame* self)
+{
+    cd_HTTPdFrameRelease(self);
+}
+
+CDHTTPdStream*
+CD_CreateHTTPdStream (size_t size, size_t backlog)
+{
+    CDHTTPdStream* self = CD_malloc(sizeof(CDHTTPdStream));
+
+    assert(size > 0);
+
+    self->size        = size;
+    self->backlog     = backlog;
+    self->frames      = CD_calloc(size, sizeof(CDHTTPdFrame*));
+    self->next        = 1;
+    self->subscribers = 0;
+
+    if (pthread_mutex_init(&self->lock, NULL) != 0) {
+        CD_abort("pthread mutex failed to initialize");
+    }
+
+    return self;
+}
+
+void
+CD_DestroyHTTPdStream (CDHTTPdStream* self)
+{
+    assert(self);
+
+    for (size_t i = 0; i < self->size; i++) {
+        cd_HTTPdFrameRelease(self->frames[i]);
+    }
+
+    pthread_mutex_destroy(&self->lock);
+
+    CD_free(self->frames);
+    CD_free(self);
+}
+
+uint64_t
+CD_HTTPdStreamPublish (CDHTTPdStream* self, const char* event, json_t* data)
+{
+    char*         encoded = json_dumps(data, JSON_COMPACT);
+    size_t        length  = strlen(event) + strlen(encoded) + 64;
+    CDHTTPdFrame* frame   = CD_malloc(sizeof(CDHTTPdFrame) + length);
+    CDHTTPdFrame* old;
+    uint64_t      id;
+
+    assert(self);
+
+    json_decref(data);
+
+    frame->references = 1;
+
+    // the id is only known under the lock, encode the payload outside of it
+    pthread_mutex_lock(&self->lock);
+
+    id            = self->next++;
+    frame->id     = id;
+    frame->length = snprintf(frame->data, length, "id: %llu\nevent: %s\ndata: %s\n\n",
+        (unsigned long long) id, event, encoded);
+
+    old = self->frames[id % self->size];
+    self->frames[id % self->size] = frame;
+
+    pthread_mutex_unlock(&self->lock);
+
+    cd_HTTPdFrameRelease(old);
+    free(encoded);
+
+    return id;
+}
+
+uint64_t
+CD_HTTPdStreamCursor (CDHTTPdStream* self, const char* last)
+{
+    uint64_t result;
+
+    assert(self);
+
+    pthread_mutex_lock(&self->lock);
+
+    result = self->next;
+
+    if (last) {
+        uint64_t after = strtoull(last, NULL, 10) + 1;
+
+        if (after <= self->next && after + self->size >= self->next) {
+            result = after;
+        }
+    }
+
+    pthread_mutex_unlock(&self->lock);
+
+    return result;
+}
+
+bool
+CD_HTTPdStreamRead (CDHTTPdStream* self, uint64_t* cursor, struct evbuffer* buffer)
+{
+    bool result = true;
+
+    assert(self);
+
+    pthread_mutex_lock(&self->lock);
+
+    if (*cursor + self->size < self->next) {
+        result = false;
+    }
+    else {
+        for (; *cursor < self->next; (*cursor)++) {
+            CDHTTPdFrame* frame = self->frames[*cursor % self->size];
+
+            __sync_add_and_fetch(&frame->references, 1);
+
+            evbuffer_add_reference(buffer, frame->data, frame->length,
+                (evbuffer_ref_cleanup_cb) cd_HTTPdFrameCleanup, frame);
+        }
+    }
+
+    pthread_mutex_unlock(&self->lock);
+
+    return result;
+}
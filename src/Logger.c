@@ -28,3 +28,58 @@
 #undef CRAFTD_LOGGER_IGNORE_EXTERN
 
 CDLogger CDDefaultLogger;
+
+int CDLogLevel[CDLogSubsystems] = {
+    [0 ... CDLogSubsystems - 1] = LOG_DEBUG
+};
+
+void
+CD_LogSetLevel (CDLogSubsystem subsystem, int level)
+{
+    if (subsystem == CDLogSubsystems) {
+        for (int i = 0; i < CDLogSubsystems; i++) {
+            CDLogLevel[i] = level;
+        }
+    }
+    else {
+        CDLogLevel[subsystem] = level;
+    }
+}
+
+static struct {
+    int  level;
+    bool forced;
+} _base = { LOG_DEBUG, false };
+
+void
+CD_LogSetBaseLevel (int level, bool forced)
+{
+    _base.level  = level;
+    _base.forced = forced;
+
+    CD_LogSetLevel(CDLogSubsystems, level);
+}
+
+void
+CD_LogResetLevels (const int levels[CDLogSubsystems])
+{
+    for (int i = 0; i < CDLogSubsystems; i++) {
+        CDLogLevel[i] = (levels[i] >= 0 && !_base.forced) ? levels[i] : _base.level;
+    }
+}
+
+int
+CD_LogLevelFromName (const char* name)
+{
+    static const char* names[] = {
+        "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug"
+    };
+
+    for (int i = 0; i < ARRAY_SIZE(names); i++) {
+        if (CD_CStringIsEqual(name, names[i])) {
+            return i;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/Metrics.h>
+#include <craftd/Logger.h>
+
+static struct {
+    pthread_mutex_t lock;
+
+    size_t     length;
+    CDMetric** item;
+} _registry = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static __thread int _shard     = -1;
+static volatile int _nextShard = 0;
+
+static inline
+CDMetricShard*
+cd_MetricShard (CDMetric* self, int index)
+{
+    return (CDMetricShard*) (self->shards + index * self->stride);
+}
+
+static inline
+CDMetricShard*
+cd_MetricCurrentShard (CDMetric* self)
+{
+    if (_shard < 0) {
+        _shard = __sync_fetch_and_add(&_nextShard, 1) % CD_METRIC_SHARDS;
+    }
+
+    return cd_MetricShard(self, _shard);
+}
+
+static inline
+size_t
+cd_MetricBucket (uint64_t nanoseconds)
+{
+    int    msb;
+    int    octave;
+    size_t sub;
+
+    if (nanoseconds < 1024) {
+        return 0;
+    }
+
+    msb    = 63 - __builtin_clzll(nanoseconds);
+    octave = msb - 10;
+
+    if (octave >= CD_METRIC_OCTAVES) {
+        return CD_METRIC_BUCKETS - 1;
+    }
+
+    sub = (nanoseconds >> (msb - CD_METRIC_PRECISION)) & ((1 << CD_METRIC_PRECISION) - 1);
+
+    return 1 + (octave << CD_METRIC_PRECISION) + sub;
+}
+
+/**
+ * Get the exclusive upper bound of a bucket in nanoseconds
+ */
+static
+uint64_t
+cd_MetricBucketLimit (size_t bucket)
+{
+    if (bucket == 0) {
+        return 1024;
+    }
+
+    if (bucket == CD_METRIC_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+
+    uint64_t base = 1024ULL << ((bucket - 1) >> CD_METRIC_PRECISION);
+    uint64_t sub  = (bucket - 1) & ((1 << CD_METRIC_PRECISION) - 1);
+
+    return base + (base >> CD_METRIC_PRECISION) * (sub + 1);
+}
+
+CDMetric*
+CD_CreateMetric (CDMetricType type, const char* name, const char* labels, const char* help)
+{
+    CDMetric* self = CD_malloc(sizeof(CDMetric));
+    size_t    size = sizeof(CDMetricShard);
+
+    if (type == CDMetricHistogram) {
+        size += CD_METRIC_BUCKETS * sizeof(int64_t);
+    }
+
+    self->type   = type;
+    self->name   = strdup(name);
+    self->labels = labels ? strdup(labels) : NULL;
+    self->help   = strdup(help);
+    self->stride = (size + 63) & ~63;
+    self->shards = CD_memalign(64, self->stride * CD_METRIC_SHARDS);
+
+    memset(self->shards, 0, self->stride * CD_METRIC_SHARDS);
+
+    pthread_mutex_lock(&_registry.lock);
+    _registry.item = CD_realloc(_registry.item, sizeof(CDMetric*) * ++_registry.length);
+    _registry.item[_registry.length - 1] = self;
+    pthread_mutex_unlock(&_registry.lock);
+
+    return self;
+}
+
+void
+CD_DestroyMetric (CDMetric* self)
+{
+    if (!self) {
+        return;
+    }
+
+    pthread_mutex_lock(&_registry.lock);
+    for (size_t i = 0; i < _registry.length; i++) {
+        if (_registry.item[i] == self) {
+            memmove(&_registry.item[i], &_registry.item[i + 1], sizeof(CDMetric*) * (_registry.length - i - 1));
+
+            _registry.item = CD_realloc(_registry.item, sizeof(CDMetric*) * --_registry.length);
+
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_registry.lock);
+
+    CD_free(self->name);
+    CD_free(self->labels);
+    CD_free(self->help);
+    CD_free(self->shards);
+    CD_free(self);
+}
+
+void
+CD_MetricAdd (CDMetric* self, int64_t value)
+{
+    if (!self) {
+        return;
+    }
+
+    if (self->type == CDMetricGauge) {
+        __sync_fetch_and_add(&cd_MetricShard(self, 0)->value, value);
+    }
+    else {
+        __sync_fetch_and_add(&cd_MetricCurrentShard(self)->value, value);
+    }
+}
+
+void
+CD_MetricSet (CDMetric* self, int64_t value)
+{
+    if (!self || self->type != CDMetricGauge) {
+        return;
+    }
+
+    cd_MetricShard(self, 0)->value = value;
+}
+
+void
+CD_MetricObserve (CDMetric* self, uint64_t nanoseconds)
+{
+    if (!self || self->type != CDMetricHistogram) {
+        return;
+    }
+
+    CDMetricShard* shard = cd_MetricCurrentShard(self);
+
+    __sync_fetch_and_add(&shard->buckets[cd_MetricBucket(nanoseconds)], 1);
+    __sync_fetch_and_add(&shard->value, nanoseconds);
+    __sync_fetch_and_add(&shard->count, 1);
+}
+
+int64_t
+CD_MetricValue (CDMetric* self)
+{
+    int64_t result = 0;
+
+    for (int i = 0; i < CD_METRIC_SHARDS; i++) {
+        result += (self->type == CDMetricHistogram) ? cd_MetricShard(self, i)->count : cd_MetricShard(self, i)->value;
+    }
+
+    return result;
+}
+
+static
+void
+cd_MetricBuckets (CDMetric* self, int64_t* buckets)
+{
+    memset(buckets, 0, sizeof(int64_t) * CD_METRIC_BUCKETS);
+
+    for (int i = 0; i < CD_METRIC_SHARDS; i++) {
+        for (size_t j = 0; j < CD_METRIC_BUCKETS; j++) {
+            buckets[j] += cd_MetricShard(self, i)->buckets[j];
+        }
+    }
+}
+
+uint64_t
+CD_MetricQuantile (CDMetric* self, double quantile)
+{
+    int64_t buckets[CD_METRIC_BUCKETS];
+    int64_t total = 0;
+    int64_t seen  = 0;
+
+    if (self->type != CDMetricHistogram) {
+        return 0;
+    }
+
+    cd_MetricBuckets(self, buckets);
+
+    for (size_t i = 0; i < CD_METRIC_BUCKETS; i++) {
+        total += buckets[i];
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < CD_METRIC_BUCKETS; i++) {
+        seen += buckets[i];
+
+        if (seen >= quantile * total) {
+            return cd_MetricBucketLimit(i);
+        }
+    }
+
+    return UINT64_MAX;
+}
+
+static
+void
+cd_MetricToBuffer (CDMetric* self, CDBuffer* buffer)
+{
+    const char* labels = self->labels ? self->labels : "";
+    const char* comma  = self->labels ? "," : "";
+
+    if (self->type != CDMetricHistogram) {
+        if (self->labels) {
+            evbuffer_add_printf(buffer->raw, "%s{%s} %lld\n", self->name, labels, (long long) CD_MetricValue(self));
+        }
+        else {
+            evbuffer_add_printf(buffer->raw, "%s %lld\n", self->name, (long long) CD_MetricValue(self));
+        }
+
+        return;
+    }
+
+    int64_t buckets[CD_METRIC_BUCKETS];
+    int64_t cumulative = 0;
+    int64_t sum        = 0;
+
+    cd_MetricBuckets(self, buckets);
+
+    for (int i = 0; i < CD_METRIC_SHARDS; i++) {
+        sum += cd_MetricShard(self, i)->value;
+    }
+
+    /* export one bucket per power of two, the finer ones are only used for quantiles */
+    for (size_t i = 0; i < CD_METRIC_BUCKETS - 1; i++) {
+        cumulative += buckets[i];
+
+        if (i == 0 || (i & ((1 << CD_METRIC_PRECISION) - 1)) == 0) {
+            evbuffer_add_printf(buffer->raw, "%s_bucket{%s%sle=\"%.12g\"} %lld\n", self->name, labels, comma,
+                cd_MetricBucketLimit(i) / 1e9, (long long) cumulative);
+        }
+    }
+
+    cumulative += buckets[CD_METRIC_BUCKETS - 1];
+
+    evbuffer_add_printf(buffer->raw, "%s_bucket{%s%sle=\"+Inf\"} %lld\n", self->name, labels, comma, (long long) cumulative);
+
+    if (self->labels) {
+        evbuffer_add_printf(buffer->raw, "%s_sum{%s} %.9f\n", self->name, labels, sum / 1e9);
+        evbuffer_add_printf(buffer->raw, "%s_count{%s} %lld\n", self->name, labels, (long long) cumulative);
+    }
+    else {
+        evbuffer_add_printf(buffer->raw, "%s_sum %.9f\n", self->name, sum / 1e9);
+        evbuffer_add_printf(buffer->raw, "%s_count %lld\n", self->name, (long long) cumulative);
+    }
+}
+
+void
+CD_MetricsToBuffer (CDBuffer* buffer)
+{
+    static const char* types[] = { "counter", "gauge", "histogram" };
+
+    pthread_mutex_lock(&_registry.lock);
+
+    bool printed[_registry.length + 1];
+
+    memset(printed, 0, sizeof(printed));
+
+    /* every sample of a metric family has to be grouped under its HELP and TYPE */
+    for (size_t i = 0; i < _registry.length; i++) {
+        CDMetric* metric = _registry.item[i];
+
+        if (printed[i]) {
+            continue;
+        }
+
+        evbuffer_add_printf(buffer->raw, "# HELP %s %s\n# TYPE %s %s\n",
+            metric->name, metric->help, metric->name, types[metric->type]);
+
+        for (size_t j = i; j < _registry.length; j++) {
+            if (!printed[j] && CD_CStringIsEqual(_registry.item[j]->name, metric->name)) {
+                cd_MetricToBuffer(_registry.item[j], buffer);
+
+                printed[j] = true;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&_registry.lock);
+
+    evbuffer_add_printf(buffer->raw,
+        "# HELP craftd_log_dropped_total Log lines dropped by the asynchronous logger\n"
+        "# TYPE craftd_log_dropped_total counter\n"
+        "craftd_log_dropped_total %llu\n", (unsigned long long) CD_AsyncLoggerDropped());
+}
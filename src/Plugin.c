@@ -68,23 +68,19 @@ CD_CreatePlugin (CDServer* server, const char* name)
     self->initialize = lt_dlsym(self->handle, "CD_PluginInitialize");
     self->finalize   = lt_dlsym(self->handle, "CD_PluginFinalize");
 
-    J_DO { self->config = NULL;
-        J_IN(server, self->server->config->data, "server") {
-            J_IN(plugin, server, "plugin") {
-                J_FOREACH(plugin, plugin, "plugins") {
-                    J_IF_STRING(plugin, "name") {
-                        if (CD_CStringIsEqual(J_STRING_VALUE, name)) {
-                            self->config = (CDRawConfig) plugin;
-                            break;
-                        }
-                    }
-                }
-            }
-        }
-    }
+    self->config = CD_ConfigPlugin(server->config, name);
+
+    if (self->initialize && !self->initialize(self)) {
+        // a plugin that failed to initialize has nothing to finalize
+        self->finalize = NULL;
+
+        CD_DestroyPlugin(self);
 
-    if (self->initialize) {
-        self->initialize(self);
+        SERR(server, "Couldn't initialize plugin %s", name);
+
+        errno = EINVAL;
+
+        return NULL;
     }
 
     if (self->description) {
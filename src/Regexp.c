@@ -26,6 +26,25 @@
 #include <craftd/Regexp.h>
 #include <craftd/Logger.h>
 
+static struct {
+    pthread_mutex_t lock;
+    CDHash*         items;
+} _cache = {
+    .lock  = PTHREAD_MUTEX_INITIALIZER,
+    .items = NULL
+};
+
+static
+void
+cd_RegexpFreeStudy (pcre_extra* study)
+{
+#ifdef PCRE_STUDY_JIT_COMPILE
+    pcre_free_study(study);
+#else
+    pcre_free(study);
+#endif
+}
+
 CDRegexp*
 CD_CreateRegexp (char* string, int options)
 {
@@ -44,10 +63,20 @@ CD_CreateRegexp (char* string, int options)
 
     CDRegexp* self = CD_malloc(sizeof(CDRegexp));
 
-    self->string  = string;
-    self->options = options;
-    self->pattern = pattern;
-    self->study   = pcre_study(pattern, 0, &error);
+    self->string   = string;
+    self->options  = options;
+    self->pattern  = pattern;
+    self->captures = 0;
+    self->cached   = false;
+    self->next     = NULL;
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+    self->study = pcre_study(pattern, PCRE_STUDY_JIT_COMPILE, &error);
+#else
+    self->study = pcre_study(pattern, 0, &error);
+#endif
+
+    pcre_fullinfo(self->pattern, self->study, PCRE_INFO_CAPTURECOUNT, &self->captures);
 
     return self;
 }
@@ -55,8 +84,12 @@ CD_CreateRegexp (char* string, int options)
 void
 CD_DestroyRegexp (CDRegexp* self)
 {
+    if (self->cached) {
+        return;
+    }
+
     if (self->study) {
-        CD_free(self->study);
+        cd_RegexpFreeStudy(self->study);
     }
 
     pcre_free(self->pattern);
@@ -68,8 +101,12 @@ CD_DestroyRegexp (CDRegexp* self)
 void
 CD_DestroyRegexpKeepString (CDRegexp* self)
 {
+    if (self->cached) {
+        return;
+    }
+
     if (self->study) {
-        CD_free(self->study);
+        cd_RegexpFreeStudy(self->study);
     }
 
     pcre_free(self->pattern);
@@ -77,6 +114,89 @@ CD_DestroyRegexpKeepString (CDRegexp* self)
     CD_free(self);
 }
 
+static
+CDRegexp*
+cd_RegexpCacheFind (CDRegexp* self, int options)
+{
+    options |= PCRE_UTF8 | PCRE_EXTRA;
+
+    for (; self; self = self->next) {
+        if (self->options == options) {
+            return self;
+        }
+    }
+
+    return NULL;
+}
+
+CDRegexp*
+CD_GetRegexp (const char* regexp, int options)
+{
+    CDRegexp* head = NULL;
+    CDRegexp* self = NULL;
+
+    // keyed by the pattern alone, the few option variants of a pattern hang off each other
+    if (_cache.items && (self = cd_RegexpCacheFind((CDRegexp*) CD_HashGet(_cache.items, regexp), options))) {
+        return self;
+    }
+
+    pthread_mutex_lock(&_cache.lock);
+    if (!_cache.items) {
+        _cache.items = CD_CreateHash();
+    }
+
+    head = (CDRegexp*) CD_HashGet(_cache.items, regexp);
+
+    // Someone else could have compiled it in the meantime
+    if (!(self = cd_RegexpCacheFind(head, options))) {
+        if ((self = CD_CreateRegexp(strdup(regexp), options))) {
+            self->cached = true;
+
+            // readers walk the variants without the lock, only link a complete regexp
+            __sync_synchronize();
+
+            if (!head) {
+                CD_HashPut(_cache.items, regexp, (CDPointer) self);
+            }
+            else {
+                while (head->next) {
+                    head = head->next;
+                }
+
+                head->next = self;
+            }
+        }
+    }
+    pthread_mutex_unlock(&_cache.lock);
+
+    return self;
+}
+
+void
+CD_ClearRegexpCache (void)
+{
+    pthread_mutex_lock(&_cache.lock);
+    if (_cache.items) {
+        CD_HASH_FOREACH(_cache.items, it) {
+            CDRegexp* regexp = (CDRegexp*) CD_HashIteratorValue(it);
+
+            while (regexp) {
+                CDRegexp* next = regexp->next;
+
+                regexp->cached = false;
+
+                CD_DestroyRegexp(regexp);
+
+                regexp = next;
+            }
+        }
+
+        CD_DestroyHash(_cache.items);
+        _cache.items = NULL;
+    }
+    pthread_mutex_unlock(&_cache.lock);
+}
+
 CDRegexpMatches*
 CD_CreateRegexpMatches (size_t length)
 {
@@ -96,42 +216,40 @@ CD_DestroyRegexpMatches (CDRegexpMatches* self)
             CD_DestroyString(self->item[i]);
         }
     }
+
+    CD_free(self->item);
+    CD_free(self);
 }
 
 CDRegexpMatches*
 CD_RegexpMatch (CDRegexp* self, CDString* string)
 {
-    CDRegexpMatches* matches;
-
-    int  length  = 0;
-    int  matched = 0;
-    int* substrings;
+    CDRegexpMatches* matches = NULL;
+    int              size    = 3 * (self->captures + 1);
+    int*             offsets;
+    int              result;
 
     assert(self);
     assert(string);
 
-    pcre_fullinfo(self->pattern, self->study, PCRE_INFO_CAPTURECOUNT, &length);
-    substrings = CD_calloc((3 * (length + 1)), sizeof(int));
-
-    matched = pcre_exec(self->pattern, self->study, CD_StringContent(string), CD_StringSize(string), 0, 0, substrings, (3 * (length + 1))) - 1;
+    // sized for the pattern, unlike CDRegexpCaptures there's no cap on the groups
+    offsets = CD_malloc(sizeof(int) * size);
+    result  = pcre_exec(self->pattern, self->study, CD_StringContent(string), CD_StringSize(string), 0, 0,
+        offsets, size);
 
-    if (matched < 0) {
-        CD_free(substrings);
+    if (result > 0) {
+        matches          = CD_CreateRegexpMatches(self->captures + 1);
+        matches->matched = result - 1;
 
-        return NULL;
-    }
-
-    matches          = CD_CreateRegexpMatches(length + 1);
-    matches->matched = matched;
-
-    for (size_t i = 0; i < matches->matched + 1; i++) {
-        const char* substrStart  = CD_StringContent(string) + substrings[2 * i];
-        int         substrLength = substrings[2 * i + 1] - substrings[2 * i];
-
-        matches->item[i] = CD_CreateStringFromBufferCopy(substrStart, substrLength);
+        for (int i = 0; i < result; i++) {
+            if (offsets[2 * i] >= 0) {
+                matches->item[i] = CD_CreateStringFromBufferCopy(CD_StringContent(string) + offsets[2 * i],
+                    offsets[2 * i + 1] - offsets[2 * i]);
+            }
+        }
     }
 
-    CD_free(substrings);
+    CD_free(offsets);
 
     return matches;
 }
@@ -139,24 +257,27 @@ CD_RegexpMatch (CDRegexp* self, CDString* string)
 CDRegexpMatches*
 CD_RegexpMatchString (char* regexp, int options, CDString* string)
 {
-    CDRegexp* self = CD_CreateRegexp(regexp, options);
+    CDRegexp* self = CD_GetRegexp(regexp, options);
 
-    CDRegexpMatches* result = CD_RegexpMatch(self, string);
-
-    CD_DestroyRegexpKeepString(self);
+    if (!self) {
+        return NULL;
+    }
 
-    return result;
+    return CD_RegexpMatch(self, string);
 }
 
 CDRegexpMatches*
 CD_RegexpMatchCString (char* regexp, int options, char* string)
 {
-    CDRegexp* self = CD_CreateRegexp(regexp, options);
+    CDRegexp* self = CD_GetRegexp(regexp, options);
+
+    if (!self) {
+        return NULL;
+    }
 
-    CDString*        str     = CD_CreateStringFromCString(string);
+    CDString*        str     = CD_CreateStringFromBuffer(string, strlen(string));
     CDRegexpMatches* matches = CD_RegexpMatch(self, str);
 
-    CD_DestroyRegexpKeepString(self);
     CD_DestroyString(str);
 
     return matches;
@@ -165,19 +286,41 @@ CD_RegexpMatchCString (char* regexp, int options, char* string)
 bool
 CD_RegexpTest (CDRegexp* self, CDString* string)
 {
-    size_t length = 0;
-    int*   substrings;
-    int    result;
-
     assert(self);
     assert(string);
 
-    pcre_fullinfo(self->pattern, self->study, PCRE_INFO_CAPTURECOUNT, &length);
-    substrings = CD_alloc((length * 3) * sizeof(int));
+    // no captures needed, pcre returns 0 on a match when the ovector has no room
+    return pcre_exec(self->pattern, self->study, CD_StringContent(string), CD_StringSize(string), 0, 0,
+        NULL, 0) >= 0;
+}
 
-    result = pcre_exec(self->pattern, self->study, CD_StringContent(string), CD_StringSize(string), 0, 0, substrings, length);
+bool
+CD_RegexpExec (CDRegexp* self, const char* subject, size_t length, CDRegexpCaptures* captures)
+{
+    int result;
+
+    assert(self);
+    assert(subject);
+
+    captures->subject = subject;
+    captures->length  = 0;
+
+    // pcre would silently drop the groups that don't fit, which reads as them not matching
+    if (self->captures > CD_REGEXP_CAPTURES) {
+        ERR("%s has %d groups but CD_RegexpExec only has room for %d, use CD_RegexpMatch", self->string,
+            self->captures, CD_REGEXP_CAPTURES);
+
+        return false;
+    }
+
+    result = pcre_exec(self->pattern, self->study, subject, length, 0, 0, captures->offsets,
+        sizeof(captures->offsets) / sizeof(int));
+
+    if (result <= 0) {
+        return false;
+    }
 
-    CD_free(substrings);
+    captures->length = result;
 
-    return result >= 0;
+    return true;
 }
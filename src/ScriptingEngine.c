@@ -68,20 +68,7 @@ CD_CreateScriptingEngine (CDServer* server, const char* name)
     self->initialize = lt_dlsym(self->handle, "CD_ScriptingEngineInitialize");
     self->finalize   = lt_dlsym(self->handle, "CD_ScriptingEngineFinalize");
 
-    J_DO { self->config = NULL;
-        J_IN(server, self->server->config->data, "server") {
-            J_IN(scripting, server, "scripting") {
-                J_FOREACH(engine, scripting, "engines") {
-                    J_IF_STRING(engine, "name") {
-                        if (CD_CStringIsEqual(J_STRING_VALUE, name)) {
-                            self->config = (CDRawConfig) engine;
-                            break;
-                        }
-                    }
-                }
-            }
-        }
-    }
+    self->config = CD_ConfigScriptingEngine(server->config, name);
 
     if (self->initialize) {
         self->initialize(self);
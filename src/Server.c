@@ -32,6 +32,13 @@
 
 CDServer* CDMainServer = NULL;
 
+typedef struct _CDRetired {
+    CDPointer data;
+    void      (*destroy) (CDPointer);
+
+    uint64_t epoch;
+} CDRetired;
+
 static
 void
 cd_HandleSignal (evutil_socket_t fd, short what, CDServer* self)
@@ -39,6 +46,71 @@ cd_HandleSignal (evutil_socket_t fd, short what, CDServer* self)
     CD_StopServer(self);
 }
 
+static
+void
+cd_HandleReload (evutil_socket_t fd, short what, CDServer* self)
+{
+    CD_ServerReload(self);
+}
+
+static inline
+bool
+cd_EpochIsBefore (uint64_t epoch, CDRetired* retired)
+{
+    return epoch != 0 && epoch <= retired->epoch;
+}
+
+static
+bool
+cd_ServerIsQuiescent (CDServer* self, CDRetired* retired)
+{
+    bool result = true;
+
+    for (size_t i = 0; i < self->workers->length; i++) {
+        if (cd_EpochIsBefore(self->workers->item[i]->epoch, retired)) {
+            return false;
+        }
+    }
+
+    pthread_mutex_lock(&self->snapshot.lock);
+    CD_LINKED_LIST_FOREACH(&self->snapshot.readers, it) {
+        if (cd_EpochIsBefore(CD_LINK_OWNER(it, CDSnapshotReader, link)->epoch, retired)) {
+            result = false;
+
+            break;
+        }
+    }
+    pthread_mutex_unlock(&self->snapshot.lock);
+
+    return result;
+}
+
+static
+void
+cd_ServerReclaim (CDServer* self, bool force)
+{
+    CDRetired* retired;
+
+    while ((retired = (CDRetired*) CD_ListFirst(self->snapshot.retired))) {
+        if (!force && !cd_ServerIsQuiescent(self, retired)) {
+            break;
+        }
+
+        CD_ListShift(self->snapshot.retired);
+
+        retired->destroy(retired->data);
+
+        CD_free(retired);
+    }
+}
+
+static
+void
+cd_HandleReclaim (evutil_socket_t fd, short what, CDServer* self)
+{
+    cd_ServerReclaim(self, false);
+}
+
 CDServer*
 CD_CreateServer (const char* path)
 {
@@ -56,8 +128,29 @@ CD_CreateServer (const char* path)
         return NULL;
     }
 
+    if (CD_CStringIsEqual(self->config->cache.logger, "async")) {
+        self->logger = CDAsyncLogger;
+    }
+    else if (CD_CStringIsEqual(self->config->cache.logger, "syslog")) {
+        self->logger = CDSystemLogger;
+    }
+
+    self->metrics.accepted = CD_CreateMetric(CDMetricCounter, "craftd_clients_accepted_total", NULL, "Accepted client connections");
+    self->metrics.clients  = CD_CreateMetric(CDMetricGauge, "craftd_clients", NULL, "Connected clients");
+    self->metrics.reads    = CD_CreateMetric(CDMetricCounter, "craftd_client_reads_total", NULL, "Client read callbacks");
+    self->metrics.events   = CD_CreateMetric(CDMetricHistogram, "craftd_event_dispatch_seconds", NULL, "Time spent dispatching events, while profiling");
+
+    // the TimeLoop, Ticker and HTTPd threads register as snapshot readers
+    CD_InitializeLinkedList(&self->snapshot.readers);
+
+    if (pthread_mutex_init(&self->snapshot.lock, NULL) != 0) {
+        CD_abort("pthread mutex failed to initialize");
+    }
+
     self->timeloop         = CD_CreateTimeLoop(self);
+    self->ticker           = CD_CreateTicker(self);
     self->workers          = CD_CreateWorkers(self);
+    self->commands         = CD_CreateCommands(self);
     self->plugins          = CD_CreatePlugins(self);
     self->scriptingEngines = CD_CreateScriptingEngines(self);
 
@@ -68,10 +161,24 @@ CD_CreateServer (const char* path)
         self->httpd = NULL;
     }
 
-    self->clients       = CD_CreateList();
-    self->disconnecting = CD_CreateList();
+    CD_InitializeLinkedList(&self->clients);
+    CD_InitializeLinkedList(&self->disconnecting);
+
+    if (pthread_rwlock_init(&self->lock.clients, NULL) != 0 || pthread_mutex_init(&self->lock.disconnecting, NULL) != 0) {
+        CD_abort("pthread lock failed to initialize");
+    }
 
     self->event.callbacks = CD_CreateHash();
+    self->event.profiling = self->config->cache.profiling;
+
+    if (pthread_rwlock_init(&self->event.lock, NULL) != 0) {
+        CD_abort("pthread rwlock failed to initialize");
+    }
+
+    self->snapshot.reload  = NULL;
+    self->snapshot.reclaim = NULL;
+    self->snapshot.retired = CD_CreateList();
+    self->snapshot.epoch   = 1;
 
     self->running = false;
 
@@ -87,9 +194,10 @@ CD_DestroyServer (CDServer* self)
     assert(self);
 
     CD_StopTimeLoop(self->timeloop);
+    CD_StopTicker(self->ticker);
 
-    CD_LIST_FOREACH(self->clients, it) {
-        CD_ServerKick(self, (CDClient*) CD_ListIteratorValue(it), CD_CreateStringFromCString("shutting down"));
+    CD_LINKED_LIST_FOREACH(&self->clients, it) {
+        CD_ServerKick(self, CD_LINK_OWNER(it, CDClient, link.clients), CD_CreateStringFromCString("shutting down"));
     }
 
     if (self->workers) {
@@ -98,6 +206,13 @@ CD_DestroyServer (CDServer* self)
 
     CD_StopServer(self);
 
+    if (self->httpd) {
+        CD_DestroyHTTPd(self->httpd);
+    }
+
+    // Destructors can live in plugins, so they have to run before unloading them
+    cd_ServerReclaim(self, true);
+
     if (self->plugins) {
         CD_DestroyPlugins(self->plugins);
     }
@@ -106,6 +221,11 @@ CD_DestroyServer (CDServer* self)
         CD_DestroyScriptingEngines(self->scriptingEngines);
     }
 
+    if (self->commands) {
+        CD_DestroyCommands(self->commands);
+    }
+
+    CD_DestroyTicker(self->ticker);
     CD_DestroyTimeLoop(self->timeloop);
 
     if (self->event.listener) {
@@ -113,6 +233,17 @@ CD_DestroyServer (CDServer* self)
         self->event.listener = NULL;
     }
 
+    if (self->snapshot.reload) {
+        event_free(self->snapshot.reload);
+    }
+
+    if (self->snapshot.reclaim) {
+        event_free(self->snapshot.reclaim);
+    }
+
+    cd_ServerReclaim(self, true);
+    CD_DestroyList(self->snapshot.retired);
+
     if (self->event.base) {
         event_base_free(self->event.base);
         self->event.base = NULL;
@@ -123,9 +254,18 @@ CD_DestroyServer (CDServer* self)
     }
 
     if (self->event.callbacks) {
+        CD_HASH_FOREACH(self->event.callbacks, it) {
+            CD_DestroyVector((CDVector*) CD_HashIteratorValue(it));
+        }
+
         CD_DestroyHash(self->event.callbacks);
     }
 
+    pthread_rwlock_destroy(&self->event.lock);
+    pthread_rwlock_destroy(&self->lock.clients);
+    pthread_mutex_destroy(&self->lock.disconnecting);
+    pthread_mutex_destroy(&self->snapshot.lock);
+
     if (DYNAMIC(self)) {
         CD_DestroyDynamic(DYNAMIC(self));
     }
@@ -134,6 +274,11 @@ CD_DestroyServer (CDServer* self)
         CD_free(self->name);
     }
 
+    CD_DestroyMetric(self->metrics.accepted);
+    CD_DestroyMetric(self->metrics.clients);
+    CD_DestroyMetric(self->metrics.reads);
+    CD_DestroyMetric(self->metrics.events);
+
     CD_free(self);
 }
 
@@ -160,7 +305,9 @@ cd_ReadCallback (struct bufferevent* event, CDClient* client)
 
     pthread_rwlock_wrlock(&client->lock.status);
 
-    SDEBUG(self, "read data from %s, %d byte/s available", client->ip, CD_BufferLength(client->buffers->input));
+    CD_MetricAdd(self->metrics.reads, 1);
+
+    SDEBUG_IN(self, CDLogNetwork, "read data from %s, %d byte/s available", client->ip, CD_BufferLength(client->buffers->input));
 
     if (client->status == CDClientIdle) {
         void* packet;
@@ -224,15 +371,15 @@ cd_LogCallback (int priority, const char* message)
 {
     static char priorities[] = { LOG_DEBUG, LOG_NOTICE, LOG_WARNING, LOG_ERR };
 
-    if (CDMainServer) {
-        CDString* output = CD_CreateStringFromFormat("%s> %s", CD_ServerToString(CDMainServer), message);
-
-        CDMainServer->logger.log(priorities[priority], CD_StringContent(output));
+    if (!CD_LogIsEnabled(CDLogNetwork, priorities[priority])) {
+        return;
+    }
 
-        CD_DestroyString(output);
+    if (CDMainServer) {
+        CDMainServer->logger.log(priorities[priority], "%s> %s", CD_ServerToString(CDMainServer), message);
     }
     else {
-        CDDefaultLogger.log(priorities[priority], message);
+        CDDefaultLogger.log(priorities[priority], "%s", message);
     }
 }
 
@@ -271,7 +418,7 @@ cd_Accept (evutil_socket_t listener, short event, CDServer* self)
     }
 
     if (self->config->cache.game.players.max > 0) {
-        if (CD_ListLength(self->clients) >= self->config->cache.game.players.max) {
+        if (CD_LinkedListLength(&self->clients) >= self->config->cache.game.players.max) {
             SERR(self, "too many clients");
             close(fd);
             CD_DestroyClient(client);
@@ -282,15 +429,15 @@ cd_Accept (evutil_socket_t listener, short event, CDServer* self)
     if (self->config->cache.connection.simultaneous > 0) {
         size_t same = 0;
 
-        CD_LIST_FOREACH(self->clients, it) {
-            CDClient* tmp = (CDClient*) CD_ListIteratorValue(it);
+        CD_LINKED_LIST_FOREACH(&self->clients, it) {
+            CDClient* tmp = CD_LINK_OWNER(it, CDClient, link.clients);
 
             if (CD_CStringIsEqual(tmp->ip, client->ip)) {
                 same++;
             }
 
             if (same >= self->config->cache.connection.simultaneous) {
-                CD_LIST_BREAK(self->clients);
+                break;
             }
         }
 
@@ -310,7 +457,12 @@ cd_Accept (evutil_socket_t listener, short event, CDServer* self)
     bufferevent_setcb(client->buffers->raw, (bufferevent_data_cb) cd_ReadCallback, NULL, (bufferevent_event_cb) cd_ErrorCallback, client);
     bufferevent_enable(client->buffers->raw, EV_READ | EV_WRITE);
 
-    CD_ListPush(self->clients, (CDPointer) client);
+    pthread_rwlock_wrlock(&self->lock.clients);
+    CD_LinkedListPush(&self->clients, &client->link.clients);
+    pthread_rwlock_unlock(&self->lock.clients);
+
+    CD_MetricAdd(self->metrics.accepted, 1);
+    CD_MetricAdd(self->metrics.clients, 1);
 
     CD_AddJob(self->workers, CD_CreateExternalJob(CDClientConnectJob, (CDPointer) client));
 }
@@ -328,6 +480,16 @@ CD_RunServer (CDServer* self)
     }
 
     event_add(evsignal_new(self->event.base, SIGINT, (event_callback_fn) cd_HandleSignal, self), NULL);
+    event_add(evsignal_new(self->event.base, SIGHUP, (event_callback_fn) cd_HandleReload, self), NULL);
+
+    self->snapshot.reload  = event_new(self->event.base, -1, 0, (event_callback_fn) cd_HandleReload, self);
+    self->snapshot.reclaim = event_new(self->event.base, -1, EV_PERSIST, (event_callback_fn) cd_HandleReclaim, self);
+
+    DO {
+        struct timeval interval = { 1, 0 };
+
+        event_add(self->snapshot.reclaim, &interval);
+    }
 
     if ((self->socket = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
         SERR(self, "could not create socket: %s", strerror(-self->socket));
@@ -364,11 +526,11 @@ CD_RunServer (CDServer* self)
     CD_free(CD_SpawnWorkers(self->workers, self->config->cache.workers));
 
     // Start the TimeLoop for timed events
-    pthread_create(&self->timeloop->thread, &self->timeloop->attributes, (void *(*)(void *)) CD_RunTimeLoop, self->timeloop);
+    CD_StartTimeLoop(self->timeloop);
 
     // Start HTTPd if enabled
     if (self->httpd) {
-        pthread_create(&self->httpd->thread, &self->httpd->attributes, (void *(*)(void *)) CD_RunHTTPd, self->httpd);
+        CD_StartHTTPd(self->httpd);
     }
 
     self->event.listener = event_new(self->event.base, self->socket, EV_READ | EV_PERSIST, (event_callback_fn) cd_Accept, self);
@@ -380,6 +542,9 @@ CD_RunServer (CDServer* self)
 
     CD_EventDispatch(self, "Server.start!");
 
+    // Start the game ticks once the plugins have set up their worlds
+    CD_RunTicker(self->ticker);
+
     self->running = true;
 
     while (self->running) {
@@ -402,6 +567,9 @@ CD_StopServer (CDServer* self)
 
     CD_ServerFlush(self, true);
 
+    // No tick can run on what the stop handlers tear down
+    CD_StopTicker(self->ticker);
+
     CD_EventDispatch(self, "Server.stop!");
 
     return true;
@@ -420,15 +588,130 @@ CD_ServerFlush (CDServer* self, bool now)
     }
 }
 
+bool
+CD_ServerReload (CDServer* self)
+{
+    CDConfig* old  = self->config;
+    CDConfig* next = CD_ParseConfig(old->path);
+
+    if (!next) {
+        SERR(self, "could not reload %s, keeping the current config", old->path);
+
+        return false;
+    }
+
+    // another reload can swap in between, whatever config gets replaced is the one to retire
+    do {
+        old              = self->config;
+        next->generation = old->generation + 1;
+    } while (!__sync_bool_compare_and_swap(&self->config, old, next));
+
+    self->event.profiling = next->cache.profiling;
+
+    CD_HASH_FOREACH(self->plugins->items, it) {
+        ((CDPlugin*) CD_HashIteratorValue(it))->config = CD_ConfigPlugin(next, CD_HashIteratorKey(it));
+    }
+
+    CD_HASH_FOREACH(self->scriptingEngines->items, it) {
+        ((CDScriptingEngine*) CD_HashIteratorValue(it))->config = CD_ConfigScriptingEngine(next, CD_HashIteratorKey(it));
+    }
+
+    SLOG(self, LOG_NOTICE, "config reloaded from %s (generation %llu)", next->path, (unsigned long long) next->generation);
+
+    if (CD_ConfigRequiresRestart(old, next)) {
+        SLOG(self, LOG_WARNING, "some of the changed settings will only be applied after a restart");
+    }
+
+    CD_EventDispatch(self, "Config.reload", next, old);
+
+    CD_ServerRetire(self, (CDPointer) old, (void (*)(CDPointer)) CD_DestroyConfig);
+
+    return true;
+}
+
+void
+CD_ServerScheduleReload (CDServer* self)
+{
+    if (self->snapshot.reload) {
+        event_active(self->snapshot.reload, 0, 0);
+    }
+}
+
+void
+CD_ServerRetire (CDServer* self, CDPointer data, void (*destroy)(CDPointer))
+{
+    CDRetired* retired = CD_malloc(sizeof(CDRetired));
+
+    retired->data    = data;
+    retired->destroy = destroy;
+    retired->epoch   = __sync_fetch_and_add(&self->snapshot.epoch, 1);
+
+    CD_ListPush(self->snapshot.retired, (CDPointer) retired);
+}
+
+void
+CD_ServerAddReader (CDServer* self, CDSnapshotReader* reader)
+{
+    reader->epoch = 0;
+
+    pthread_mutex_lock(&self->snapshot.lock);
+    CD_LinkedListPush(&self->snapshot.readers, &reader->link);
+    pthread_mutex_unlock(&self->snapshot.lock);
+}
+
+void
+CD_ServerRemoveReader (CDServer* self, CDSnapshotReader* reader)
+{
+    pthread_mutex_lock(&self->snapshot.lock);
+    CD_LinkedListDelete(&self->snapshot.readers, &reader->link);
+    pthread_mutex_unlock(&self->snapshot.lock);
+}
+
+void
+CD_ServerEnterSnapshot (CDServer* self, CDSnapshotReader* reader)
+{
+    reader->epoch = self->snapshot.epoch;
+
+    // the epoch has to be visible before any snapshot pointer is read
+    __sync_synchronize();
+}
+
+void
+CD_ServerLeaveSnapshot (CDSnapshotReader* reader)
+{
+    __sync_synchronize();
+
+    reader->epoch = 0;
+}
+
 void
 CD_ServerCleanDisconnects (CDServer* self)
 {
-    if (CD_ListLength(self->disconnecting) > 0) {
-        CD_LIST_FOREACH(self->disconnecting, it) {
-            CD_DestroyClient((CDClient*) CD_ListDelete(self->clients, CD_ListIteratorValue(it)));
-        }
+    CDLinkedList disconnected;
+
+    CD_InitializeLinkedList(&disconnected);
+
+    pthread_mutex_lock(&self->lock.disconnecting);
+    CD_LinkedListSplice(&disconnected, &self->disconnecting);
+    pthread_mutex_unlock(&self->lock.disconnecting);
+
+    if (CD_LinkedListIsEmpty(&disconnected)) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&self->lock.clients);
+    CD_LINKED_LIST_FOREACH(&disconnected, it) {
+        CD_LinkedListDelete(&self->clients, &CD_LINK_OWNER(it, CDClient, link.disconnecting)->link.clients);
+    }
+    pthread_rwlock_unlock(&self->lock.clients);
+
+    CD_LINKED_LIST_FOREACH(&disconnected, it) {
+        CDClient* client = CD_LINK_OWNER(it, CDClient, link.disconnecting);
+
+        CD_LinkedListDelete(&disconnected, it);
+        CD_DestroyClient(client);
 
-        CD_free(CD_ListClear(self->disconnecting));
+        CD_MetricAdd(self->metrics.clients, -1);
     }
 }
 
@@ -25,6 +25,15 @@
 
 #include <libgen.h>
 
+#if defined(__SSE2__)
+#   include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   include <immintrin.h>
+#   define CD_UTF8_HAVE_AVX2
+#endif
+
 #include <craftd/common.h>
 
 static inline
@@ -50,44 +59,192 @@ cd_UTF8_nextCharLength (char data)
     return 0;
 }
 
+/*
+ * A char starts on every byte that isn't a continuation byte (10xxxxxx), as
+ * signed chars continuation bytes are exactly the ones <= -65 so counting
+ * chars is a compare and a popcount per block.
+ */
+
+#ifdef CD_UTF8_HAVE_AVX2
+__attribute__((target("avx2")))
+static
 size_t
-CD_UTF8_strlen (const char* data)
+cd_UTF8_countAVX2 (const unsigned char* data, size_t size, size_t* consumed)
 {
-    size_t result  = 0;
-    size_t i       = 0;
+    const __m256i continuation = _mm256_set1_epi8(-65);
+    size_t        result       = 0;
+    size_t        i            = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*) (data + i));
 
-    while (data[i] != '\0') {
-        i += cd_UTF8_nextCharLength(data[i]);
-        result++;
+        result += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi8(block, continuation)));
     }
 
+    *consumed = i;
+
     return result;
 }
+#endif
 
+static
 size_t
-CD_UTF8_strnlen (const char* data, size_t limit)
+cd_UTF8_count (const unsigned char* data, size_t size)
 {
-    size_t result  = 0;
-    size_t i       = 0;
+    size_t result = 0;
+    size_t i      = 0;
+
+#ifdef CD_UTF8_HAVE_AVX2
+    if (size >= 64 && __builtin_cpu_supports("avx2")) {
+        result = cd_UTF8_countAVX2(data, size, &i);
+    }
+#endif
 
-    while (data[i] != '\0' && i < limit) {
-        i += cd_UTF8_nextCharLength(data[i]);
-        result++;
+#ifdef __SSE2__
+    const __m128i continuation = _mm_set1_epi8(-65);
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*) (data + i));
+
+        result += __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(block, continuation)));
+    }
+#endif
+
+    for (; i < size; i++) {
+        result += (data[i] & 0xC0) != 0x80;
     }
 
     return result;
 }
 
+static
+size_t
+cd_UTF8_offset (const unsigned char* data, size_t offset, size_t size)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i continuation = _mm_set1_epi8(-65);
+
+    // skip whole blocks while the wanted char is past them
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*) (data + i));
+        size_t  chars = __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(block, continuation)));
+
+        if (chars > offset) {
+            break;
+        }
+
+        offset -= chars;
+    }
+#endif
+
+    for (; i < size; i++) {
+        if ((data[i] & 0xC0) != 0x80) {
+            if (offset == 0) {
+                return i;
+            }
+
+            offset--;
+        }
+    }
+
+    return size;
+}
+
+size_t
+CD_UTF8_strlen (const char* data)
+{
+    return cd_UTF8_count((const unsigned char*) data, strlen(data));
+}
+
+size_t
+CD_UTF8_strnlen (const char* data, size_t limit)
+{
+    return cd_UTF8_count((const unsigned char*) data, strnlen(data, limit));
+}
+
 size_t
 CD_UTF8_offset (const char* data, size_t offset)
 {
-    size_t result = 0;
+    return cd_UTF8_offset((const unsigned char*) data, offset, strlen(data));
+}
+
+size_t
+CD_UTF8_noffset (const char* data, size_t offset, size_t limit)
+{
+    return cd_UTF8_offset((const unsigned char*) data, offset, limit);
+}
+
+bool
+CD_UTF8_valid (const char* data, size_t size)
+{
+    const unsigned char* current = (const unsigned char*) data;
+    const unsigned char* end     = current + size;
+
+    while (current < end) {
+#ifdef __SSE2__
+        // plain ASCII blocks are the common case, skip them 16 bytes at a time
+        if (end - current >= 16 && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) current)) == 0) {
+            current += 16;
+            continue;
+        }
+#endif
+
+        unsigned char byte   = *current;
+        unsigned char lower  = 0x80;
+        unsigned char upper  = 0xBF;
+        size_t        length = 0;
+
+        if (byte < 0x80) {
+            current++;
+            continue;
+        }
+        else if (byte >= 0xC2 && byte <= 0xDF) {
+            length = 1;
+        }
+        else if (byte >= 0xE0 && byte <= 0xEF) {
+            length = 2;
+
+            if (byte == 0xE0) {
+                lower = 0xA0; // overlong
+            }
+            else if (byte == 0xED) {
+                upper = 0x9F; // surrogates
+            }
+        }
+        else if (byte >= 0xF0 && byte <= 0xF4) {
+            length = 3;
+
+            if (byte == 0xF0) {
+                lower = 0x90; // overlong
+            }
+            else if (byte == 0xF4) {
+                upper = 0x8F; // > U+10FFFF
+            }
+        }
+        else {
+            return false;
+        }
+
+        if ((size_t) (end - current) <= length) {
+            return false;
+        }
+
+        if (current[1] < lower || current[1] > upper) {
+            return false;
+        }
+
+        for (size_t i = 2; i <= length; i++) {
+            if ((current[i] & 0xC0) != 0x80) {
+                return false;
+            }
+        }
 
-    for (size_t i = 0; i < offset; i++) {
-        result += cd_UTF8_nextCharLength(data[result]);
+        current += length + 1;
     }
 
-    return result;
+    return true;
 }
 
 static
@@ -99,53 +256,295 @@ cd_UpdateLength (CDString* self)
     self->length = CD_UTF8_strnlen(CD_StringContent(self), self->raw->slen);
 }
 
+static inline
+bool
+cd_StringOwnsHeap (CDString* self)
+{
+    return !self->external && self->arena == NULL && self->raw->data != (unsigned char*) self->buffer;
+}
+
+/**
+ * Get the byte offset of the given char, every char is a byte when the
+ * cached length matches the size so there's no need to scan.
+ */
+static inline
+size_t
+cd_StringOffset (CDString* self, size_t index)
+{
+    if (self->length == (size_t) self->raw->slen) {
+        return index;
+    }
+
+    return cd_UTF8_offset(self->raw->data, index, self->raw->slen);
+}
+
+static
+void*
+cd_StringArenaAllocate (CDStringArena* self, size_t size)
+{
+    void* result;
+
+    size = (size + 15) & ~((size_t) 15);
+
+    if (self->current.size - self->current.used < size) {
+        size_t              chunkSize = CD_STRING_ARENA_CHUNK_SIZE;
+        CDStringArenaChunk* chunk;
+
+        if (chunkSize < size) {
+            chunkSize = size;
+        }
+
+        chunk        = CD_malloc(sizeof(CDStringArenaChunk) + chunkSize);
+        chunk->next  = self->chunks;
+        chunk->size  = chunkSize;
+        self->chunks = chunk;
+
+        self->current.data = chunk->data;
+        self->current.size = chunkSize;
+        self->current.used = 0;
+    }
+
+    result              = self->current.data + self->current.used;
+    self->current.used += size;
+
+    return result;
+}
+
+static
 CDString*
-CD_CreateString (void)
+cd_StringAllocate (CDStringArena* arena)
 {
-    CDString* self = CD_malloc(sizeof(CDString));
+    CDString* self;
 
-    self->raw      = bfromcstr("");
-    self->length   = 0;
-    self->external = false;
+    if (arena) {
+        self = cd_StringArenaAllocate(arena, sizeof(CDString));
+    }
+    else {
+        self = CD_malloc(sizeof(CDString));
+    }
 
-    assert(self->raw);
+    self->raw       = &self->header;
+    self->raw->data = (unsigned char*) self->buffer;
+    self->raw->mlen = CD_STRING_INLINE_SIZE;
+    self->raw->slen = 0;
+    self->buffer[0] = '\0';
+    self->length    = 0;
+    self->external  = false;
+    self->arena     = arena;
 
     return self;
 }
 
-CDString*
-CD_CreateStringFromCString (const char* string)
+/**
+ * Make room for size bytes plus the terminator, external content gets copied
+ * so the String owns its data afterwards.
+ */
+static
+void
+cd_StringReserve (CDString* self, size_t size)
 {
-    CDString* self = CD_malloc(sizeof(CDString));
+    unsigned char* data;
+    size_t         capacity;
 
-    self->raw = CD_malloc(sizeof(*self->raw));
+    if (!self->external && (size_t) self->raw->mlen > size) {
+        return;
+    }
 
-    if (string == NULL) {
-        self->raw->data = (unsigned char*) "";
+    if (self->external && size < CD_STRING_INLINE_SIZE) {
+        data     = (unsigned char*) self->buffer;
+        capacity = CD_STRING_INLINE_SIZE;
     }
     else {
-        self->raw->data = (unsigned char*) string;
+        capacity = (self->raw->mlen > CD_STRING_INLINE_SIZE) ? self->raw->mlen : CD_STRING_INLINE_SIZE;
+
+        while (capacity <= size) {
+            capacity *= 2;
+        }
+
+        if (cd_StringOwnsHeap(self)) {
+            data = CD_realloc(self->raw->data, capacity);
+        }
+        else if (self->arena) {
+            data = cd_StringArenaAllocate(self->arena, capacity);
+        }
+        else {
+            data = CD_malloc(capacity);
+        }
+    }
+
+    if (!cd_StringOwnsHeap(self)) {
+        memcpy(data, self->raw->data, self->raw->slen);
+    }
+
+    data[self->raw->slen] = '\0';
+
+    self->raw->data = data;
+    self->raw->mlen = capacity;
+    self->external  = false;
+}
+
+/**
+ * Replace removeSize bytes (removeLength chars) at offset with the given data,
+ * the cached length is updated with the known lengths instead of rescanning.
+ */
+static
+void
+cd_StringSplice (CDString* self, size_t offset, size_t removeSize, size_t removeLength, const char* data, size_t size, size_t length)
+{
+    size_t total   = self->raw->slen - removeSize + size;
+    char*  aliased = NULL;
+
+    assert(offset + removeSize <= (size_t) self->raw->slen);
+
+    if (size > 0 && data >= (const char*) self->raw->data && data < (const char*) self->raw->data + self->raw->mlen) {
+        aliased = CD_malloc(size);
+        data    = memcpy(aliased, data, size);
+    }
+
+    cd_StringReserve(self, total);
+
+    memmove(self->raw->data + offset + size, self->raw->data + offset + removeSize, self->raw->slen - offset - removeSize);
+    memcpy(self->raw->data + offset, data, size);
+
+    self->raw->data[total] = '\0';
+    self->raw->slen        = total;
+    self->length           = self->length - removeLength + length;
+
+    CD_free(aliased);
+}
+
+static
+CDString*
+cd_CreateStringFromBufferCopy (CDStringArena* arena, const char* buffer, size_t size)
+{
+    CDString* self = cd_StringAllocate(arena);
+
+    cd_StringReserve(self, size);
+
+    memcpy(self->raw->data, buffer, size);
+
+    self->raw->data[size] = '\0';
+    self->raw->slen       = size;
+
+    return self;
+}
+
+static
+void
+cd_StringFormat (CDString* self, const char* format, va_list ap)
+{
+    va_list copy;
+    int     size;
+
+    va_copy(copy, ap);
+    size = vsnprintf((char*) self->raw->data, self->raw->mlen, format, copy);
+    va_end(copy);
+
+    if (size < 0) {
+        size = 0;
     }
+    else if (size >= self->raw->mlen) {
+        cd_StringReserve(self, size);
 
-    self->raw->slen = strlen((const char*) self->raw->data);
-    self->raw->mlen = self->raw->slen;
+        vsnprintf((char*) self->raw->data, self->raw->mlen, format, ap);
+    }
 
-    self->external = true;
+    self->raw->data[size] = '\0';
+    self->raw->slen       = size;
 
     cd_UpdateLength(self);
+}
+
+CDStringArena*
+CD_CreateStringArena (size_t size)
+{
+    CDStringArena* self = CD_malloc(sizeof(CDStringArena));
+
+    if (size == 0) {
+        size = CD_STRING_ARENA_CHUNK_SIZE;
+    }
+
+    CD_InitializeStringArena(self, CD_malloc(size), size);
+
+    self->initial.allocated = true;
 
     return self;
 }
 
+void
+CD_DestroyStringArena (CDStringArena* self)
+{
+    assert(self);
+
+    CD_FinalizeStringArena(self);
+
+    CD_free(self);
+}
+
+void
+CD_InitializeStringArena (CDStringArena* self, void* buffer, size_t size)
+{
+    size_t padding = (16 - ((uintptr_t) buffer & 15)) & 15;
+
+    assert(self);
+
+    if (buffer == NULL || size < padding) {
+        padding = size = 0;
+    }
+
+    self->initial.data      = (char*) buffer + padding;
+    self->initial.size      = size - padding;
+    self->initial.allocated = false;
+
+    self->chunks = NULL;
+
+    CD_StringArenaReset(self);
+}
+
+void
+CD_FinalizeStringArena (CDStringArena* self)
+{
+    assert(self);
+
+    CD_StringArenaReset(self);
+
+    if (self->initial.allocated) {
+        CD_free(self->initial.data);
+    }
+}
+
+void
+CD_StringArenaReset (CDStringArena* self)
+{
+    assert(self);
+
+    while (self->chunks) {
+        CDStringArenaChunk* next = self->chunks->next;
+
+        CD_free(self->chunks);
+
+        self->chunks = next;
+    }
+
+    self->current.data = self->initial.data;
+    self->current.size = self->initial.size;
+    self->current.used = 0;
+}
+
 CDString*
-CD_CreateStringFromCStringCopy (const char* string)
+CD_CreateStringInArena (CDStringArena* arena)
 {
-    CDString* self = CD_malloc(sizeof(CDString));
+    assert(arena);
+
+    return cd_StringAllocate(arena);
+}
 
-    self->raw      = bfromcstr(string);
-    self->external = false;
+CDString*
+CD_CreateStringFromBufferInArena (CDStringArena* arena, const char* buffer, size_t length)
+{
+    assert(arena);
 
-    assert(self->raw);
+    CDString* self = cd_CreateStringFromBufferCopy(arena, buffer, length);
 
     cd_UpdateLength(self);
 
@@ -153,18 +552,63 @@ CD_CreateStringFromCStringCopy (const char* string)
 }
 
 CDString*
-CD_CreateStringFromBuffer (const char* buffer, size_t length)
+CD_CreateStringFromFormatInArena (CDStringArena* arena, const char* format, ...)
 {
-    CDString* self = CD_malloc(sizeof(CDString));
+    va_list ap;
+    va_start(ap, format);
+
+    CDString* self = CD_CreateStringFromFormatListInArena(arena, format, ap);
+
+    va_end(ap);
 
-    self->raw      = CD_malloc(sizeof(*self->raw));
-    self->external = true;
+    return self;
+}
 
-    assert(self->raw);
+CDString*
+CD_CreateStringFromFormatListInArena (CDStringArena* arena, const char* format, va_list ap)
+{
+    assert(arena);
+
+    CDString* self = cd_StringAllocate(arena);
+
+    cd_StringFormat(self, format, ap);
+
+    return self;
+}
+
+CDString*
+CD_CreateString (void)
+{
+    return cd_StringAllocate(NULL);
+}
+
+CDString*
+CD_CreateStringFromCString (const char* string)
+{
+    if (string == NULL) {
+        return CD_CreateString();
+    }
+
+    return CD_CreateStringFromBuffer(string, strlen(string));
+}
+
+CDString*
+CD_CreateStringFromCStringCopy (const char* string)
+{
+    assert(string);
+
+    return CD_CreateStringFromBufferCopy(string, strlen(string));
+}
+
+CDString*
+CD_CreateStringFromBuffer (const char* buffer, size_t length)
+{
+    CDString* self = cd_StringAllocate(NULL);
 
     self->raw->data = (unsigned char*) buffer;
     self->raw->mlen = length;
     self->raw->slen = length;
+    self->external  = true;
 
     cd_UpdateLength(self);
 
@@ -174,12 +618,7 @@ CD_CreateStringFromBuffer (const char* buffer, size_t length)
 CDString*
 CD_CreateStringFromBufferCopy (const char* buffer, size_t length)
 {
-    CDString* self = CD_malloc(sizeof(CDString));
-
-    self->raw      = blk2bstr(buffer, length);
-    self->external = false;
-
-    assert(self->raw);
+    CDString* self = cd_CreateStringFromBufferCopy(NULL, buffer, length);
 
     cd_UpdateLength(self);
 
@@ -204,9 +643,7 @@ CD_CreateStringFromFormatList (const char* format, va_list ap)
 {
     CDString* self = CD_CreateString();
 
-    bvcformata(self->raw, 9001, format, ap);
-
-    cd_UpdateLength(self);
+    cd_StringFormat(self, format, ap);
 
     return self;
 }
@@ -215,6 +652,9 @@ CDString*
 CD_CreateStringFromOffset (CDString* string, size_t offset, size_t limit)
 {
     const char* data;
+    size_t      start;
+    size_t      size;
+    CDString*   self;
 
     assert(string);
 
@@ -222,29 +662,38 @@ CD_CreateStringFromOffset (CDString* string, size_t offset, size_t limit)
         return NULL;
     }
 
-    data = CD_StringContent(string) + CD_UTF8_offset(CD_StringContent(string), offset);
+    if (limit == 0 || limit > string->length - offset) {
+        limit = string->length - offset;
+    }
+
+    start = cd_StringOffset(string, offset);
+    data  = CD_StringContent(string) + start;
 
-    if (limit == 0) {
-        limit = strlen(data);
+    if (string->length == (size_t) string->raw->slen) {
+        size = limit;
+    }
+    else if (offset + limit == string->length) {
+        size = strnlen(data, string->raw->slen - start);
     }
     else {
-        limit = CD_UTF8_offset(data, limit);
+        size = CD_UTF8_noffset(data, limit, string->raw->slen - start);
     }
 
-    return CD_CreateStringFromBufferCopy(data, limit);
+    self         = cd_CreateStringFromBufferCopy(NULL, data, size);
+    self->length = limit;
+
+    return self;
 }
 
 CDString*
 CD_CloneString (CDString* self)
 {
-    CDString* cloned = CD_CreateString();
-
-    bdestroy(cloned->raw);
-    cloned->raw = (CDRawString) bstrcpy(self->raw);
+    CDString* cloned;
 
-    assert(cloned->raw);
+    assert(self);
 
-    cd_UpdateLength(cloned);
+    cloned         = cd_CreateStringFromBufferCopy(NULL, CD_StringContent(self), self->raw->slen);
+    cloned->length = self->length;
 
     return cloned;
 }
@@ -254,11 +703,12 @@ CD_DestroyString (CDString* self)
 {
     assert(self);
 
-    if (self->external) {
-        CD_free(self->raw);
+    if (self->arena) {
+        return;
     }
-    else {
-        bdestroy(self->raw);
+
+    if (cd_StringOwnsHeap(self)) {
+        CD_free(self->raw->data);
     }
 
     CD_free(self);
@@ -267,9 +717,21 @@ CD_DestroyString (CDString* self)
 CDRawString
 CD_DestroyStringKeepData (CDString* self)
 {
-    CDRawString result = self->raw;
+    CDRawString result;
 
-    CD_free(self);
+    assert(self);
+
+    if (cd_StringOwnsHeap(self)) {
+        result  = CD_malloc(sizeof(*result));
+        *result = self->header;
+    }
+    else {
+        result = blk2bstr(self->raw->data, self->raw->slen);
+    }
+
+    if (!self->arena) {
+        CD_free(self);
+    }
 
     return result;
 }
@@ -286,22 +748,19 @@ CD_CharAt (CDString* self, size_t index)
 CDString*
 CD_CharAtSet (CDString* self, size_t index, CDString* set)
 {
+    size_t offset;
+
     assert(self);
+    assert(set);
 
-    if (self->external) {
-        CDString* tmp = self;
-        self          = CD_CloneString(tmp);
-        CD_DestroyString(tmp);
+    if (index >= CD_StringLength(self)) {
+        return NULL;
     }
 
-    size_t offset = CD_UTF8_offset((const char*) self->raw->data, index);
+    offset = cd_StringOffset(self, index);
 
-    if (breplace(self->raw, offset, cd_UTF8_nextCharLength(self->raw->data[offset]), set->raw, '\0') == BSTR_OK) {
-        cd_UpdateLength(self);
-    }
-    else {
-        self = NULL;
-    }
+    cd_StringSplice(self, offset, cd_UTF8_nextCharLength(self->raw->data[offset]), 1,
+        CD_StringContent(set), set->raw->slen, set->length);
 
     return self;
 }
@@ -312,18 +771,12 @@ CD_InsertString (CDString* self, CDString* insert, size_t position)
     assert(self);
     assert(insert);
 
-    if (self->external) {
-        CDString* tmp = self;
-        self          = CD_CloneString(tmp);
-        CD_DestroyString(tmp);
+    if (position > CD_StringLength(self)) {
+        return NULL;
     }
 
-    if (binsert(self->raw, CD_UTF8_offset(CD_StringContent(self), position), insert->raw, '\0') == BSTR_OK) {
-        cd_UpdateLength(self);
-    }
-    else {
-        self = NULL;
-    }
+    cd_StringSplice(self, cd_StringOffset(self, position), 0, 0,
+        CD_StringContent(insert), insert->raw->slen, insert->length);
 
     return self;
 }
@@ -334,18 +787,8 @@ CD_AppendString (CDString* self, CDString* append)
     assert(self);
     assert(append);
 
-    if (self->external) {
-        CDString* tmp = self;
-        self          = CD_CloneString(tmp);
-        CD_DestroyString(tmp);
-    }
-
-    if (binsert(self->raw, self->raw->slen, append->raw, '\0') == BSTR_OK) {
-        cd_UpdateLength(self);
-    }
-    else {
-        self = NULL;
-    }
+    cd_StringSplice(self, self->raw->slen, 0, 0,
+        CD_StringContent(append), append->raw->slen, append->length);
 
     return self;
 }
@@ -353,24 +796,125 @@ CD_AppendString (CDString* self, CDString* append)
 CDString*
 CD_AppendCString (CDString* self, const char* append)
 {
-    assert(self);
     assert(append);
 
-    if (self->external) {
-        CDString* tmp = self;
-        self          = CD_CloneString(tmp);
-        CD_DestroyString(tmp);
+    return CD_AppendBuffer(self, append, strlen(append));
+}
+
+CDString*
+CD_AppendBuffer (CDString* self, const char* buffer, size_t size)
+{
+    assert(self);
+    assert(buffer || size == 0);
+
+    cd_StringSplice(self, self->raw->slen, 0, 0,
+        buffer, size, cd_UTF8_count((const unsigned char*) buffer, size));
+
+    return self;
+}
+
+CDStringIterator
+CD_StringBegin (CDString* self)
+{
+    CDStringIterator it;
+
+    assert(self);
+
+    it.parent   = self;
+    it.position = 0;
+    it.index    = 0;
+
+    return it;
+}
+
+CDStringIterator
+CD_StringEnd (CDString* self)
+{
+    CDStringIterator it;
+
+    assert(self);
+
+    it.parent   = self;
+    it.position = self->raw->slen;
+    it.index    = self->length;
+
+    return it;
+}
+
+CDStringIterator
+CD_StringAt (CDString* self, size_t index)
+{
+    CDStringIterator it;
+
+    assert(self);
+
+    if (index > self->length) {
+        index = self->length;
     }
 
-    CDString* tmp = CD_CreateStringFromCString(append);
+    it.parent   = self;
+    it.position = cd_StringOffset(self, index);
+    it.index    = index;
+
+    return it;
+}
 
-    if (!CD_AppendString(self, tmp)) {
-        self = NULL;
+CDStringIterator
+CD_StringNext (CDStringIterator it)
+{
+    if (it.position < (size_t) it.parent->raw->slen) {
+        it.position += CD_StringIteratorSize(it);
+        it.index++;
     }
 
-    CD_DestroyString(tmp);
+    return it;
+}
 
-    return self;
+inline
+bool
+CD_StringIteratorIsEqual (CDStringIterator a, CDStringIterator b)
+{
+    return a.parent == b.parent && a.position == b.position;
+}
+
+inline
+const char*
+CD_StringIteratorValue (CDStringIterator it)
+{
+    return (const char*) it.parent->raw->data + it.position;
+}
+
+size_t
+CD_StringIteratorSize (CDStringIterator it)
+{
+    const unsigned char* data = it.parent->raw->data;
+    size_t               end  = it.parent->raw->slen;
+    size_t               i    = it.position + 1;
+
+    if (it.position >= end) {
+        return 0;
+    }
+
+    while (i < end && (data[i] & 0xC0) == 0x80) {
+        i++;
+    }
+
+    return i - it.position;
+}
+
+inline
+size_t
+CD_StringIteratorIndex (CDStringIterator it)
+{
+    return it.index;
+}
+
+bool
+CD_StringIteratorIs (CDStringIterator it, const char* check)
+{
+    size_t size = CD_StringIteratorSize(it);
+
+    return size > 0 && strlen(check) == size && memcmp(CD_StringIteratorValue(it), check, size) == 0;
 }
 
 inline
@@ -30,6 +30,7 @@
 
 CDLogger CDSystemLogger = {
     .log        = syslog,
+    .vlog       = vsyslog,
     .setlogmask = setlogmask,
     .closelog   = closelog,
 };
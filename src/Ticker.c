@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/Ticker.h>
+#include <craftd/Server.h>
+#include <craftd/Logger.h>
+
+static const char* cd_TickPhaseNames[] = {
+    "input", "world", "entities", "flush"
+};
+
+static
+void*
+cd_TickerRun (CDTicker* self)
+{
+    struct timespec deadline;
+
+    while (self->running) {
+        uint64_t now = CD_MetricsNow();
+
+        if (now < self->deadline) {
+            deadline.tv_sec  = self->deadline / 1000000000;
+            deadline.tv_nsec = self->deadline % 1000000000;
+
+            // an interrupted sleep just goes around again
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+            continue;
+        }
+
+        CD_TickerStep(self, now);
+    }
+
+    return NULL;
+}
+
+CDTicker*
+CD_CreateTicker (struct _CDServer* server)
+{
+    CDTicker* self = CD_malloc(sizeof(CDTicker));
+
+    self->server   = server;
+    self->started  = false;
+    self->running  = false;
+    self->tick     = 0;
+    self->deadline = CD_MetricsNow();
+
+    if (server) {
+        CD_ServerAddReader(server, &self->reader);
+    }
+
+    if (pthread_rwlock_init(&self->lock.phases, NULL) != 0) {
+        CD_abort("pthread rwlock failed to initialize");
+    }
+
+    self->metrics.ticks    = CD_CreateMetric(CDMetricCounter, "craftd_ticks_total", NULL, "Game ticks run");
+    self->metrics.skipped  = CD_CreateMetric(CDMetricCounter, "craftd_ticks_skipped_total", NULL, "Game ticks skipped because the server couldn't keep up");
+    self->metrics.overruns = CD_CreateMetric(CDMetricCounter, "craftd_ticks_overrun_total", NULL, "Game ticks that took longer than their period");
+    self->metrics.lateness = CD_CreateMetric(CDMetricHistogram, "craftd_tick_lateness_seconds", NULL, "Delay between a tick deadline and its start");
+    self->metrics.duration = CD_CreateMetric(CDMetricHistogram, "craftd_tick_seconds", NULL, "Time spent running a game tick");
+
+    for (CDTickPhase phase = 0; phase < CDTickPhases; phase++) {
+        char labels[32];
+
+        snprintf(labels, sizeof(labels), "phase=\"%s\"", cd_TickPhaseNames[phase]);
+
+        self->phases[phase]         = CD_CreateVector();
+        self->metrics.phases[phase] = CD_CreateMetric(CDMetricHistogram, "craftd_tick_phase_seconds", labels, "Time spent running a game tick phase");
+    }
+
+    return self;
+}
+
+void
+CD_DestroyTicker (CDTicker* self)
+{
+    assert(self);
+
+    CD_StopTicker(self);
+
+    for (CDTickPhase phase = 0; phase < CDTickPhases; phase++) {
+        CD_VECTOR_FOREACH(self->phases[phase], i) {
+            CD_free((void*) CD_VectorGet(self->phases[phase], i));
+        }
+
+        CD_DestroyVector(self->phases[phase]);
+        CD_DestroyMetric(self->metrics.phases[phase]);
+    }
+
+    CD_DestroyMetric(self->metrics.ticks);
+    CD_DestroyMetric(self->metrics.skipped);
+    CD_DestroyMetric(self->metrics.overruns);
+    CD_DestroyMetric(self->metrics.lateness);
+    CD_DestroyMetric(self->metrics.duration);
+
+    pthread_rwlock_destroy(&self->lock.phases);
+
+    if (self->server) {
+        CD_ServerRemoveReader(self->server, &self->reader);
+    }
+
+    CD_free(self);
+}
+
+bool
+CD_RunTicker (CDTicker* self)
+{
+    assert(self);
+
+    if (self->started) {
+        return true;
+    }
+
+    self->deadline = CD_MetricsNow();
+    self->running  = true;
+
+    if (pthread_create(&self->thread, NULL, (void *(*)(void *)) cd_TickerRun, self) != 0) {
+        self->running = false;
+
+        return false;
+    }
+
+    self->started = true;
+
+    return true;
+}
+
+bool
+CD_StopTicker (CDTicker* self)
+{
+    assert(self);
+
+    if (!self->started) {
+        return true;
+    }
+
+    self->running = false;
+
+    pthread_join(self->thread, NULL);
+
+    self->started = false;
+
+    return true;
+}
+
+void
+CD_TickerRegister (CDTicker* self, CDTickPhase phase, CDTickFunction function, CDPointer data)
+{
+    CDTickHandler* handler = CD_malloc(sizeof(CDTickHandler));
+
+    assert(self);
+    assert(phase < CDTickPhases);
+
+    handler->function = function;
+    handler->data     = data;
+
+    pthread_rwlock_wrlock(&self->lock.phases);
+    CD_VectorPush(self->phases[phase], (CDPointer) handler);
+    pthread_rwlock_unlock(&self->lock.phases);
+}
+
+bool
+CD_TickerUnregister (CDTicker* self, CDTickPhase phase, CDTickFunction function, CDPointer data)
+{
+    CDTickHandler* handler = NULL;
+
+    assert(self);
+    assert(phase < CDTickPhases);
+
+    pthread_rwlock_wrlock(&self->lock.phases);
+    CD_VECTOR_FOREACH(self->phases[phase], i) {
+        CDTickHandler* current = (CDTickHandler*) CD_VectorGet(self->phases[phase], i);
+
+        if (current->function == function && current->data == data) {
+            handler = (CDTickHandler*) CD_VectorDeleteAt(self->phases[phase], i);
+
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&self->lock.phases);
+
+    CD_free(handler);
+
+    return handler != NULL;
+}
+
+bool
+CD_TickerStep (CDTicker* self, uint64_t now)
+{
+    uint64_t start;
+    uint64_t end;
+
+    assert(self);
+
+    if (now < self->deadline) {
+        return false;
+    }
+
+    // more than a whole period behind, the missed ticks are dropped and the schedule
+    // stays aligned to the original start
+    if (now - self->deadline >= CD_TICKER_PERIOD) {
+        uint64_t missed = (now - self->deadline) / CD_TICKER_PERIOD;
+
+        self->deadline += missed * CD_TICKER_PERIOD;
+
+        CD_MetricAdd(self->metrics.skipped, missed);
+
+        if (self->server && missed >= CD_TICKER_RATE) {
+            SLOG(self->server, LOG_WARNING, "can't keep up, skipped %llu ticks", (unsigned long long) missed);
+        }
+    }
+
+    CD_MetricObserve(self->metrics.lateness, now - self->deadline);
+
+    start = end = CD_MetricsNow();
+
+    if (self->server) {
+        CD_ServerEnterSnapshot(self->server, &self->reader);
+    }
+
+    pthread_rwlock_rdlock(&self->lock.phases);
+    for (CDTickPhase phase = 0; phase < CDTickPhases; phase++) {
+        uint64_t begin = end;
+
+        CD_VECTOR_FOREACH(self->phases[phase], i) {
+            CDTickHandler* handler = (CDTickHandler*) CD_VectorGet(self->phases[phase], i);
+
+            handler->function(self->server, self->tick, handler->data);
+        }
+
+        end = CD_MetricsNow();
+
+        CD_MetricObserve(self->metrics.phases[phase], end - begin);
+    }
+    pthread_rwlock_unlock(&self->lock.phases);
+
+    if (self->server) {
+        CD_ServerLeaveSnapshot(&self->reader);
+    }
+
+    CD_MetricObserve(self->metrics.duration, end - start);
+    CD_MetricAdd(self->metrics.ticks, 1);
+
+    if (end - start > CD_TICKER_PERIOD) {
+        CD_MetricAdd(self->metrics.overruns, 1);
+    }
+
+    self->tick++;
+    self->deadline += CD_TICKER_PERIOD;
+
+    return true;
+}
+
+const char*
+CD_TickPhaseToString (CDTickPhase phase)
+{
+    assert(phase < CDTickPhases);
+
+    return cd_TickPhaseNames[phase];
+}
@@ -24,39 +24,333 @@
  */
 
 #include <craftd/TimeLoop.h>
+#include <craftd/Server.h>
+#include <craftd/Metrics.h>
 #include <craftd/Logger.h>
 
+/**
+ * Expired timers handed to a worker, they're looked up again by ID so a
+ * timer cleared in the meantime is skipped.
+ */
+typedef struct _CDTimerBatch {
+    CDTimeLoop* timeloop;
+
+    struct _CDTimerBatch* next;
+
+    CDLink link;   /* in timeloop->queued while a worker hasn't picked it up */
+    bool   queued;
+
+    size_t    length;
+    CDTimerId item[CD_TIMELOOP_BATCH];
+} CDTimerBatch;
+
+#define CD_TIMER_NONE UINT32_MAX
+
+static inline
+CDTimer*
+cd_TimeLoopTimer (CDTimeLoop* self, uint32_t index)
+{
+    return &self->timers.pages[index >> CD_TIMELOOP_PAGE_BITS][index & (CD_TIMELOOP_PAGE_SIZE - 1)];
+}
+
+static inline
+CDTimerId
+cd_TimerId (CDTimer* timer)
+{
+    return ((uint64_t) timer->generation << 32) | timer->index;
+}
+
+static
+CDTimer*
+cd_TimeLoopFind (CDTimeLoop* self, CDTimerId id)
+{
+    uint32_t index      = (uint32_t) (id & 0xFFFFFFFF);
+    uint32_t generation = (uint32_t) (id >> 32);
+    CDTimer* timer;
+
+    if ((index >> CD_TIMELOOP_PAGE_BITS) >= self->timers.length) {
+        return NULL;
+    }
+
+    timer = cd_TimeLoopTimer(self, index);
+
+    if (timer->state == CDTimerFree || timer->generation != generation) {
+        return NULL;
+    }
+
+    return timer;
+}
+
+static
+uint32_t
+cd_TimeLoopAllocate (CDTimeLoop* self)
+{
+    uint32_t index;
+
+    if (self->timers.free == CD_TIMER_NONE) {
+        size_t page = self->timers.length++;
+
+        self->timers.pages       = CD_realloc(self->timers.pages, sizeof(CDTimer*) * self->timers.length);
+        self->timers.pages[page] = CD_malloc(sizeof(CDTimer) * CD_TIMELOOP_PAGE_SIZE);
+
+        for (int i = CD_TIMELOOP_PAGE_SIZE - 1; i >= 0; i--) {
+            CDTimer* timer = &self->timers.pages[page][i];
+
+            timer->index      = (page << CD_TIMELOOP_PAGE_BITS) | i;
+            timer->generation = 1;
+            timer->state      = CDTimerFree;
+            timer->next       = self->timers.free;
+
+            self->timers.free = timer->index;
+        }
+    }
+
+    index             = self->timers.free;
+    self->timers.free = cd_TimeLoopTimer(self, index)->next;
+
+    self->timers.active++;
+
+    return index;
+}
+
+static
+void
+cd_TimeLoopRelease (CDTimeLoop* self, CDTimer* timer)
+{
+    if (timer->state == CDTimerPending) {
+        CD_LinkedListDelete(timer->list, &timer->link);
+    }
+
+    // a new generation makes the old ID stale
+    if (++timer->generation == 0) {
+        timer->generation = 1;
+    }
+
+    timer->state = CDTimerFree;
+    timer->next  = self->timers.free;
+
+    self->timers.free = timer->index;
+    self->timers.active--;
+}
+
+static
+void
+cd_TimeLoopInsert (CDTimeLoop* self, CDTimer* timer)
+{
+    uint64_t current = self->wheel.current;
+    uint64_t delta;
+
+    if (timer->expires < current) {
+        timer->expires = current;
+    }
+
+    delta = timer->expires - current;
+
+    if (delta < CD_TIMELOOP_ROOT_SIZE) {
+        timer->list = &self->wheel.root[timer->expires & (CD_TIMELOOP_ROOT_SIZE - 1)];
+    }
+    else {
+        int level = 0;
+
+        while (level < CD_TIMELOOP_LEVELS - 1 && delta >= (UINT64_C(1) << (CD_TIMELOOP_ROOT_BITS + (level + 1) * CD_TIMELOOP_LEVEL_BITS))) {
+            level++;
+        }
+
+        // past the last level the timer waits a whole turn of the wheel and gets cascaded again
+        if (delta >= (UINT64_C(1) << (CD_TIMELOOP_ROOT_BITS + CD_TIMELOOP_LEVELS * CD_TIMELOOP_LEVEL_BITS))) {
+            timer->list = &self->wheel.levels[level][((current >> (CD_TIMELOOP_ROOT_BITS + level * CD_TIMELOOP_LEVEL_BITS)) - 1) & (CD_TIMELOOP_LEVEL_SIZE - 1)];
+        }
+        else {
+            timer->list = &self->wheel.levels[level][(timer->expires >> (CD_TIMELOOP_ROOT_BITS + level * CD_TIMELOOP_LEVEL_BITS)) & (CD_TIMELOOP_LEVEL_SIZE - 1)];
+        }
+    }
+
+    timer->state = CDTimerPending;
+
+    CD_LinkedListPush(timer->list, &timer->link);
+}
+
+static
+void
+cd_TimeLoopCascade (CDTimeLoop* self, CDLinkedList* slot)
+{
+    CDLinkedList pending;
+
+    CD_InitializeLinkedList(&pending);
+    CD_LinkedListSplice(&pending, slot);
+
+    CD_LINKED_LIST_FOREACH(&pending, it) {
+        CDTimer* timer = CD_LINK_OWNER(it, CDTimer, link);
+
+        CD_LinkedListDelete(&pending, it);
+        cd_TimeLoopInsert(self, timer);
+    }
+}
+
+/**
+ * Process the current tick, moving its timers to the expired list
+ */
+static
+void
+cd_TimeLoopTick (CDTimeLoop* self, CDLinkedList* expired)
+{
+    uint64_t current = self->wheel.current;
+    size_t   index   = current & (CD_TIMELOOP_ROOT_SIZE - 1);
+
+    // a full turn of a level moves a slot of the next one down
+    if (index == 0) {
+        for (int level = 0; level < CD_TIMELOOP_LEVELS; level++) {
+            size_t slot = (current >> (CD_TIMELOOP_ROOT_BITS + level * CD_TIMELOOP_LEVEL_BITS)) & (CD_TIMELOOP_LEVEL_SIZE - 1);
+
+            cd_TimeLoopCascade(self, &self->wheel.levels[level][slot]);
+
+            if (slot != 0) {
+                break;
+            }
+        }
+    }
+
+    CD_LinkedListSplice(expired, &self->wheel.root[index]);
+
+    self->wheel.current++;
+}
+
+static
+void
+cd_TimeLoopRunBatch (CDTimerBatch* batch)
+{
+    CDTimeLoop* self = batch->timeloop;
+
+    if (batch->queued) {
+        pthread_mutex_lock(&self->lock.wheel);
+        CD_LinkedListDelete(&self->queued, &batch->link);
+        pthread_mutex_unlock(&self->lock.wheel);
+    }
+
+    for (size_t i = 0; i < batch->length; i++) {
+        event_callback_fn callback;
+        CDPointer         data;
+        CDTimer*          timer;
+
+        pthread_mutex_lock(&self->lock.wheel);
+        if ((timer = cd_TimeLoopFind(self, batch->item[i])) == NULL || timer->state != CDTimerFired) {
+            pthread_mutex_unlock(&self->lock.wheel);
+            continue;
+        }
+
+        callback = timer->callback;
+        data     = timer->data;
+        pthread_mutex_unlock(&self->lock.wheel);
+
+        callback(-1, EV_TIMEOUT, (void*) data);
+
+        // intervals go back in the wheel only now, so they never run twice at once
+        pthread_mutex_lock(&self->lock.wheel);
+        if ((timer = cd_TimeLoopFind(self, batch->item[i])) != NULL && timer->state == CDTimerFired) {
+            if (timer->interval) {
+                timer->expires += timer->interval;
+
+                cd_TimeLoopInsert(self, timer);
+            }
+            else {
+                cd_TimeLoopRelease(self, timer);
+            }
+        }
+        pthread_mutex_unlock(&self->lock.wheel);
+    }
+
+    CD_free(batch);
+}
+
+static
+void
+cd_TimeLoopDispatch (CDTimeLoop* self, CDTimerBatch* batch)
+{
+    CDWorkers* workers = self->server ? self->server->workers : NULL;
+
+    if (workers && workers->length > 0) {
+        batch->queued = true;
+
+        pthread_mutex_lock(&self->lock.wheel);
+        CD_LinkedListPush(&self->queued, &batch->link);
+        pthread_mutex_unlock(&self->lock.wheel);
+
+        CD_AddJob(workers, CD_CreateJob(CDCustomJob,
+            (CDPointer) CD_CreateCustomJob((CDCustomJobCallback) cd_TimeLoopRunBatch, (CDPointer) batch)));
+    }
+    else {
+        cd_TimeLoopRunBatch(batch);
+    }
+}
+
 static
 void
-cd_KeepTimeLoopAlive (void)
+cd_TimeLoopTickEvent (evutil_socket_t fd, short events, CDTimeLoop* self)
 {
-    return;
+    if (!self->server) {
+        CD_TimeLoopExpire(self, CD_TimeLoopNow(self));
+
+        return;
+    }
+
+    CD_ServerEnterSnapshot(self->server, &self->reader);
+    CD_TimeLoopExpire(self, CD_TimeLoopNow(self));
+    CD_ServerLeaveSnapshot(&self->reader);
 }
 
 CDTimeLoop*
 CD_CreateTimeLoop (struct _CDServer* server)
 {
-    CDTimeLoop* self = CD_malloc(sizeof(CDTimeLoop));
+    CDTimeLoop*    self     = CD_malloc(sizeof(CDTimeLoop));
+    struct timeval interval = { 0, CD_TIMELOOP_RESOLUTION * 1000 };
 
-    if (pthread_spin_init(&self->lock.last, PTHREAD_PROCESS_PRIVATE) != 0) {
-        CD_abort("pthread spinlock failed to initialize");
+    if (pthread_mutex_init(&self->lock.wheel, NULL) != 0) {
+        CD_abort("pthread mutex failed to initialize");
     }
 
     if (pthread_attr_init(&self->attributes) != 0) {
         CD_abort("pthread attribute failed to initialize");
     }
 
-    if (pthread_attr_setdetachstate(&self->attributes, PTHREAD_CREATE_DETACHED) != 0) {
-        CD_abort("pthread attribute failed to set in detach state");
+    if (pthread_attr_setdetachstate(&self->attributes, PTHREAD_CREATE_JOINABLE) != 0) {
+        CD_abort("pthread attribute failed to set in joinable state");
     }
 
     self->server     = server;
     self->running    = false;
+
+    if (server) {
+        CD_ServerAddReader(server, &self->reader);
+    }
+
     self->event.base = event_base_new();
-    self->callbacks  = CD_CreateMap();
-    self->last       = INT_MIN;
 
-    CD_SetInterval(self, 10000000, (event_callback_fn) cd_KeepTimeLoopAlive, CDNull);
+    self->wheel.start   = CD_MetricsNow() / (CD_TIMELOOP_RESOLUTION * 1000000);
+    self->wheel.current = 0;
+
+    for (size_t i = 0; i < CD_TIMELOOP_ROOT_SIZE; i++) {
+        CD_InitializeLinkedList(&self->wheel.root[i]);
+    }
+
+    for (size_t level = 0; level < CD_TIMELOOP_LEVELS; level++) {
+        for (size_t i = 0; i < CD_TIMELOOP_LEVEL_SIZE; i++) {
+            CD_InitializeLinkedList(&self->wheel.levels[level][i]);
+        }
+    }
+
+    self->timers.pages  = NULL;
+    self->timers.length = 0;
+    self->timers.free   = CD_TIMER_NONE;
+    self->timers.active = 0;
+
+    CD_InitializeLinkedList(&self->queued);
+
+    // the tick also keeps the loop alive when there are no other events
+    self->event.tick = event_new(self->event.base, -1, EV_PERSIST, (event_callback_fn) cd_TimeLoopTickEvent, self);
+
+    if (evtimer_add(self->event.tick, &interval) < 0) {
+        CD_abort("could not add the timeloop tick");
+    }
 
     return self;
 }
@@ -66,11 +360,26 @@ CD_DestroyTimeLoop (CDTimeLoop* self)
 {
     CD_StopTimeLoop(self);
 
+    // the workers are gone by now, nobody is going to run these
+    CD_LINKED_LIST_FOREACH(&self->queued, it) {
+        CD_LinkedListDelete(&self->queued, it);
+        CD_free(CD_LINK_OWNER(it, CDTimerBatch, link));
+    }
+
+    event_free(self->event.tick);
     event_base_free(self->event.base);
 
-    CD_DestroyMap(self->callbacks);
+    for (size_t i = 0; i < self->timers.length; i++) {
+        CD_free(self->timers.pages[i]);
+    }
+
+    CD_free(self->timers.pages);
+
+    pthread_mutex_destroy(&self->lock.wheel);
 
-    pthread_spin_destroy(&self->lock.last);
+    if (self->server) {
+        CD_ServerRemoveReader(self->server, &self->reader);
+    }
 
     CD_free(self);
 }
@@ -82,79 +391,161 @@ CD_RunTimeLoop (CDTimeLoop* self)
 }
 
 bool
-CD_StopTimeLoop (CDTimeLoop* self)
+CD_StartTimeLoop (CDTimeLoop* self)
 {
-    struct timeval interval = { 0, 0 };
+    if (self->running) {
+        return true;
+    }
+
+    if (pthread_create(&self->thread, &self->attributes, (void *(*)(void *)) CD_RunTimeLoop, self) != 0) {
+        return false;
+    }
 
-    return event_base_loopexit(self->event.base, &interval);
+    self->running = true;
+
+    return true;
 }
 
-int
-CD_SetTimeout (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data)
+bool
+CD_StopTimeLoop (CDTimeLoop* self)
 {
-    struct timeval timeout      = { (int) seconds, (seconds - (int) seconds) * 1000000 };
-    struct event*  timeoutEvent = event_new(self->event.base, -1, 0, callback, (void*) (data ? data : (CDPointer) self->server));
-    int            result;
+    struct timeval interval = { 0, 0 };
 
-    if (evtimer_add(timeoutEvent, &timeout) < 0) {
-        SERR(self->server, "could not add a timeout");
-        event_free(timeoutEvent);
-        return 0;
+    if (event_base_loopexit(self->event.base, &interval) != 0) {
+        return false;
     }
 
-    pthread_spin_lock(&self->lock.last);
-    if ((self->last + 1) == 0) {
-        self->last++;
+    if (self->running && !pthread_equal(self->thread, pthread_self())) {
+        pthread_join(self->thread, NULL);
+
+        self->running = false;
     }
 
-    CD_MapPut(self->callbacks, (result = self->last++), (CDPointer) timeoutEvent);
-    pthread_spin_unlock(&self->lock.last);
+    return true;
+}
 
-    return result;
+uint64_t
+CD_TimeLoopNow (CDTimeLoop* self)
+{
+    return CD_MetricsNow() / (CD_TIMELOOP_RESOLUTION * 1000000) - self->wheel.start;
 }
 
-void
-CD_ClearTimeout (CDTimeLoop* self, int id)
+size_t
+CD_TimeLoopExpire (CDTimeLoop* self, uint64_t now)
 {
-    struct event* clear = (struct event*) CD_MapDelete(self->callbacks, id);
+    CDLinkedList  expired;
+    CDTimerBatch* batches = NULL;
+    CDTimerBatch* batch   = NULL;
+    size_t        result  = 0;
+
+    CD_InitializeLinkedList(&expired);
+
+    pthread_mutex_lock(&self->lock.wheel);
+    if (self->timers.active == 0 && self->wheel.current <= now) {
+        self->wheel.current = now + 1;
+    }
+
+    while (self->wheel.current <= now) {
+        cd_TimeLoopTick(self, &expired);
+    }
+
+    CD_LINKED_LIST_FOREACH(&expired, it) {
+        CDTimer* timer = CD_LINK_OWNER(it, CDTimer, link);
+
+        CD_LinkedListDelete(&expired, it);
+
+        timer->state = CDTimerFired;
+
+        if (!batch || batch->length == CD_TIMELOOP_BATCH) {
+            CDTimerBatch* next = CD_malloc(sizeof(CDTimerBatch));
+
+            next->timeloop = self;
+            next->length   = 0;
+            next->next     = NULL;
+            next->queued   = false;
+
+            if (batch) {
+                batch->next = next;
+            }
+            else {
+                batches = next;
+            }
+
+            batch = next;
+        }
 
-    if (clear) {
-        evtimer_del(clear);
-        event_free(clear);
+        batch->item[batch->length++] = cd_TimerId(timer);
+        result++;
     }
+    pthread_mutex_unlock(&self->lock.wheel);
+
+    while (batches) {
+        batch   = batches;
+        batches = batch->next;
+
+        cd_TimeLoopDispatch(self, batch);
+    }
+
+    return result;
 }
 
-int
-CD_SetInterval (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data)
+static
+CDTimerId
+cd_TimeLoopSet (CDTimeLoop* self, float seconds, bool repeat, event_callback_fn callback, CDPointer data)
 {
-    struct timeval interval      = { (int) seconds, (seconds - (int) seconds) * 1000000 };
-    struct event*  intervalEvent = event_new(self->event.base, -1, EV_PERSIST, callback, (void*) (data ? data : (CDPointer) self->server));
-    int            result;
+    uint64_t  ticks = ((uint64_t) (seconds * 1000 + 0.5) + CD_TIMELOOP_RESOLUTION - 1) / CD_TIMELOOP_RESOLUTION;
+    uint64_t  now   = CD_TimeLoopNow(self);
+    uint32_t  index;
+    CDTimer*  timer;
+    CDTimerId result;
 
-    if (evtimer_add(intervalEvent, &interval) < 0) {
-        SERR(self->server, "could not add an interval");
-        event_free(intervalEvent);
-        return 0;
+    if (ticks == 0) {
+        ticks = 1;
     }
 
-    pthread_spin_lock(&self->lock.last);
-    if ((self->last + 1) == 0) {
-        self->last++;
-    }
+    pthread_mutex_lock(&self->lock.wheel);
+    index = cd_TimeLoopAllocate(self);
+    timer = cd_TimeLoopTimer(self, index);
+
+    timer->callback = callback;
+    timer->data     = data ? data : (CDPointer) self->server;
+    timer->interval = repeat ? ticks : 0;
+    timer->expires  = ((now > self->wheel.current) ? now : self->wheel.current) + ticks;
 
-    CD_MapPut(self->callbacks, (result = self->last++), (CDPointer) intervalEvent);
-    pthread_spin_unlock(&self->lock.last);
+    cd_TimeLoopInsert(self, timer);
+
+    result = cd_TimerId(timer);
+    pthread_mutex_unlock(&self->lock.wheel);
 
     return result;
 }
 
+CDTimerId
+CD_SetTimeout (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data)
+{
+    return cd_TimeLoopSet(self, seconds, false, callback, data);
+}
+
 void
-CD_ClearInterval (CDTimeLoop* self, int id)
+CD_ClearTimeout (CDTimeLoop* self, CDTimerId id)
 {
-    struct event* clear = (struct event*) CD_MapDelete(self->callbacks, id);
+    CDTimer* timer;
 
-    if (clear) {
-        evtimer_del(clear);
-        event_free(clear);
+    pthread_mutex_lock(&self->lock.wheel);
+    if ((timer = cd_TimeLoopFind(self, id)) != NULL) {
+        cd_TimeLoopRelease(self, timer);
     }
+    pthread_mutex_unlock(&self->lock.wheel);
+}
+
+CDTimerId
+CD_SetInterval (CDTimeLoop* self, float seconds, event_callback_fn callback, CDPointer data)
+{
+    return cd_TimeLoopSet(self, seconds, true, callback, data);
+}
+
+void
+CD_ClearInterval (CDTimeLoop* self, CDTimerId id)
+{
+    CD_ClearTimeout(self, id);
 }
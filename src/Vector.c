@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2010-2011 Kevin M. Bowling, <kevin.bowling@kev009.com>, USA
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <craftd/common.h>
+#include <craftd/Vector.h>
+
+static
+void
+cd_VectorReserve (CDVector* self, size_t length)
+{
+    if (length <= self->size) {
+        return;
+    }
+
+    if (self->size == 0) {
+        self->size = 4;
+    }
+
+    while (self->size < length) {
+        self->size *= 2;
+    }
+
+    self->item = CD_realloc(self->item, sizeof(CDPointer) * self->size);
+}
+
+CDVector*
+CD_CreateVector (void)
+{
+    return CD_CreateVectorWith(0);
+}
+
+CDVector*
+CD_CreateVectorWith (size_t hint)
+{
+    CDVector* self = CD_malloc(sizeof(CDVector));
+
+    self->length = 0;
+    self->size   = 0;
+    self->item   = NULL;
+
+    cd_VectorReserve(self, hint);
+
+    return self;
+}
+
+void
+CD_DestroyVector (CDVector* self)
+{
+    assert(self);
+
+    CD_free(self->item);
+    CD_free(self);
+}
+
+CDVector*
+CD_VectorPush (CDVector* self, CDPointer data)
+{
+    assert(self);
+
+    cd_VectorReserve(self, self->length + 1);
+
+    self->item[self->length++] = data;
+
+    return self;
+}
+
+CDVector*
+CD_VectorSortedPush (CDVector* self, CDPointer data, CDVectorCompareCallback callback)
+{
+    size_t index = 0;
+
+    assert(self);
+
+    while (index < self->length && callback(data, self->item[index]) > 0) {
+        index++;
+    }
+
+    cd_VectorReserve(self, self->length + 1);
+
+    memmove(&self->item[index + 1], &self->item[index], sizeof(CDPointer) * (self->length - index));
+
+    self->item[index] = data;
+    self->length++;
+
+    return self;
+}
+
+ssize_t
+CD_VectorIndexOf (CDVector* self, CDPointer data)
+{
+    assert(self);
+
+    for (size_t i = 0; i < self->length; i++) {
+        if (self->item[i] == data) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+CDPointer
+CD_VectorDeleteAt (CDVector* self, size_t index)
+{
+    CDPointer result;
+
+    assert(self);
+    assert(index < self->length);
+
+    result = self->item[index];
+
+    memmove(&self->item[index], &self->item[index + 1], sizeof(CDPointer) * (self->length - index - 1));
+
+    self->length--;
+
+    return result;
+}
+
+CDPointer
+CD_VectorDelete (CDVector* self, CDPointer data)
+{
+    ssize_t index = CD_VectorIndexOf(self, data);
+
+    if (index < 0) {
+        return CDNull;
+    }
+
+    return CD_VectorDeleteAt(self, index);
+}
+
+CDPointer
+CD_VectorFastDelete (CDVector* self, CDPointer data)
+{
+    ssize_t index = CD_VectorIndexOf(self, data);
+
+    if (index < 0) {
+        return CDNull;
+    }
+
+    self->item[index] = self->item[--self->length];
+
+    return data;
+}
+
+void
+CD_VectorClear (CDVector* self)
+{
+    assert(self);
+
+    self->length = 0;
+}
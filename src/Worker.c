@@ -23,6 +23,8 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define CRAFTD_LOG_SUBSYSTEM CDLogWorkers
+
 #include <craftd/Worker.h>
 #include <craftd/Server.h>
 #include <craftd/Workers.h>
@@ -39,6 +41,7 @@ CD_CreateWorker (CDServer* server)
     self->id      = 0;
     self->working = false;
     self->job     = NULL;
+    self->epoch   = 0;
 
     return self;
 }
@@ -68,7 +71,8 @@ CD_RunWorker (CDWorker* self)
     SLOG(self->server, LOG_INFO, "worker %d started", self->id);
 
     while (self->working) {
-        self->job = NULL;
+        self->job   = NULL;
+        self->epoch = 0;
 
         if (!CD_HasJobs(self->workers)) {
             pthread_mutex_lock(&self->workers->lock.mutex);
@@ -93,6 +97,12 @@ CD_RunWorker (CDWorker* self)
 
         SDEBUG(self->server, "worker %d running", self->id);
 
+        // Snapshots retired after this point can't be reclaimed until the job is done
+        self->epoch = self->server->snapshot.epoch;
+        __sync_synchronize();
+
+        uint64_t start = CD_MetricsNow();
+
         if (self->job->type == CDCustomJob) {
             CDCustomJobData* data = (CDCustomJobData*) self->job->data;
 
@@ -179,7 +189,9 @@ CD_RunWorker (CDWorker* self)
 
                 CD_EventDispatch(self->server, "Client.disconnect", client, (bool) ERROR(client));
 
-                CD_ListPush(self->server->disconnecting, (CDPointer) client);
+                pthread_mutex_lock(&self->server->lock.disconnecting);
+                CD_LinkedListPush(&self->server->disconnecting, &client->link.disconnecting);
+                pthread_mutex_unlock(&self->server->lock.disconnecting);
 
                 CD_ServerFlush(client->server, false);
 
@@ -187,6 +199,8 @@ CD_RunWorker (CDWorker* self)
             }
         }
 
+        CD_MetricObserve(self->workers->metrics.latency, CD_MetricsNow() - start);
+
         self->job = NULL;
     }
 
@@ -40,6 +40,10 @@ CD_CreateWorkers (CDServer* server)
 
     self->jobs = CD_CreateList();
 
+    self->metrics.jobs    = CD_CreateMetric(CDMetricCounter, "craftd_jobs_total", NULL, "Jobs added to the worker queue");
+    self->metrics.queued  = CD_CreateMetric(CDMetricGauge, "craftd_jobs_queued", NULL, "Jobs waiting for a worker");
+    self->metrics.latency = CD_CreateMetric(CDMetricHistogram, "craftd_job_seconds", NULL, "Time spent running jobs");
+
     if (pthread_attr_init(&self->attributes) != 0) {
         CD_abort("pthread attribute failed to initialize");
     }
@@ -82,11 +86,19 @@ CD_DestroyWorkers (CDWorkers* self)
 
     CD_free(self->item);
 
+    CD_LIST_FOREACH(self->jobs, it) {
+        CD_DestroyJob((CDJob*) CD_ListIteratorValue(it));
+    }
+
     CD_DestroyList(self->jobs);
 
     pthread_mutex_destroy(&self->lock.mutex);
     pthread_cond_destroy(&self->lock.condition);
 
+    CD_DestroyMetric(self->metrics.jobs);
+    CD_DestroyMetric(self->metrics.queued);
+    CD_DestroyMetric(self->metrics.latency);
+
     CD_free(self);
 }
 
@@ -203,6 +215,9 @@ CD_AddJob (CDWorkers* self, CDJob* job)
 
     CD_ListPush(self->jobs, (CDPointer) job);
 
+    CD_MetricAdd(self->metrics.jobs, 1);
+    CD_MetricAdd(self->metrics.queued, 1);
+
     pthread_cond_signal(&self->lock.condition);
 
     pthread_mutex_unlock(&self->lock.mutex);
@@ -211,5 +226,11 @@ CD_AddJob (CDWorkers* self, CDJob* job)
 CDJob*
 CD_NextJob (CDWorkers* self)
 {
-    return (CDJob*) CD_ListShift(self->jobs);
+    CDJob* job = (CDJob*) CD_ListShift(self->jobs);
+
+    if (job) {
+        CD_MetricAdd(self->metrics.queued, -1);
+    }
+
+    return job;
 }
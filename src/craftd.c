@@ -115,21 +115,21 @@ main (int argc, char** argv)
         evthread_enable_lock_debuging();
     }
 
+    /* By default, skip debugging messages, the config can still enable them per subsystem */
+    CD_LogSetBaseLevel(debugging ? LOG_DEBUG : LOG_INFO, debugging);
+
     CDMainServer = server = CD_CreateServer(config);
 
     if (!server) {
         CD_abort("Server couldn't be instantiated");
     }
 
-    /* By default, mask debugging messages */
-    if (!debugging) {
-        server->logger.setlogmask(LOG_MASK(LOG_DEBUG));
-    }
-
     CD_RunServer(server);
 
     LOG(LOG_INFO, "Exiting.");
     LOG_CLOSE();
 
     CD_DestroyServer(server);
+
+    CD_ClearRegexpCache();
 }